@@ -0,0 +1,156 @@
+#include "caches/cache.hpp"
+#include "caches/compressed_cache.hpp"
+#include "caches/lru_cache_policy.hpp"
+#include "caches/lz_codec.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+using benchmark_clock = std::chrono::steady_clock;
+
+// JSON-like record with repeated field names and small varying values
+std::string JsonBlob(std::mt19937 &gen)
+{
+    static const char *const names[] = {"alpha", "bravo", "charlie", "delta", "echo", "foxtrot"};
+    std::string blob = "{\"id\":" + std::to_string(gen()) + ",\"items\":[";
+
+    for (int i = 0; i < 24; ++i)
+    {
+        blob += "{\"name\":\"" + std::string{names[gen() % 6]} + "\",\"enabled\":" +
+                (gen() % 2 ? "true" : "false") + ",\"weight\":" + std::to_string(gen() % 100) +
+                ",\"tags\":[\"" + names[gen() % 6] + "\",\"" + names[gen() % 6] + "\"]},";
+    }
+
+    return blob + "]}";
+}
+
+double Percentile(std::vector<double> &samples, double percentile)
+{
+    const auto index = static_cast<std::size_t>(percentile * (samples.size() - 1));
+
+    std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+
+    return samples[index];
+}
+
+template <typename F>
+double MeasureNs(F &&function)
+{
+    const auto start = benchmark_clock::now();
+
+    function();
+
+    return std::chrono::duration<double, std::nano>(benchmark_clock::now() - start).count();
+}
+} // namespace
+
+int main()
+{
+    constexpr std::size_t ENTRIES = 20000;
+    constexpr std::size_t HOT = ENTRIES / 16;
+    constexpr std::size_t LOOKUPS = 200000;
+    std::mt19937 gen{42};
+    std::vector<std::string> values;
+
+    for (std::size_t i = 0; i < ENTRIES; ++i)
+    {
+        values.push_back(JsonBlob(gen));
+    }
+
+    // codec alone
+    caches::lz_codec codec;
+    std::vector<double> decompress_ns;
+    std::string compressed;
+    std::string decompressed;
+    std::size_t raw_bytes = 0;
+    std::size_t compressed_bytes = 0;
+    double compress_ns = 0;
+
+    for (const auto &value : values)
+    {
+        compress_ns += MeasureNs([&] { codec.Compress(value.data(), value.size(), compressed); });
+        decompress_ns.push_back(MeasureNs(
+            [&] { codec.Decompress(compressed.data(), compressed.size(), decompressed); }));
+        raw_bytes += value.size();
+        compressed_bytes += compressed.size();
+    }
+
+    std::printf("lz_codec: %zu values, average size %zu bytes\n", values.size(),
+                raw_bytes / values.size());
+    std::printf("  ratio %.2f, compression %.1f MB/s\n",
+                static_cast<double>(raw_bytes) / compressed_bytes, raw_bytes / compress_ns * 1e3);
+    std::printf("  decompression p50 %.0f ns, p99 %.0f ns\n", Percentile(decompress_ns, 0.5),
+                Percentile(decompress_ns, 0.99));
+
+    // cache lookups: uniform keys mostly hit cold elements, skewed keys mostly hit hot ones
+    caches::compressed_cache<std::size_t, std::string, caches::LRUCachePolicy> cache{ENTRIES, HOT};
+    caches::fixed_sized_cache<std::size_t, std::string, caches::LRUCachePolicy> plain{ENTRIES};
+
+    for (std::size_t i = 0; i < ENTRIES; ++i)
+    {
+        cache.Put(i, values[i]);
+        plain.Put(i, values[i]);
+    }
+
+    const auto stats = cache.Stats();
+    const auto plain_bytes =
+        plain.MemoryUsage([](const std::string &value) { return value.capacity() + 1; }).values;
+
+    std::printf("compressed_cache: %zu entries, %zu hot, ratio %.2f\n", stats.entries,
+                stats.hot_entries, stats.Ratio());
+    std::printf("  values take %.1f MiB instead of %.1f MiB (%.2fx entries per byte)\n",
+                stats.bytes / 1048576.0, plain_bytes / 1048576.0,
+                static_cast<double>(plain_bytes) / stats.bytes);
+
+    // the same values under a byte budget that holds a third of them uncompressed
+    caches::compressed_cache<std::size_t, std::string, caches::LRUCachePolicy> budgeted{
+        ENTRIES, HOT, plain_bytes / 3};
+
+    for (std::size_t i = 0; i < ENTRIES; ++i)
+    {
+        budgeted.Put(i, values[i]);
+    }
+
+    std::printf("  budget of %.1f MiB holds %zu of %zu entries\n", plain_bytes / 3 / 1048576.0,
+                budgeted.Size(), ENTRIES);
+
+    std::uniform_int_distribution<std::size_t> uniform{0, ENTRIES - 1};
+    std::uniform_int_distribution<std::size_t> skewed{0, HOT / 2};
+    std::vector<std::size_t> uniform_keys(LOOKUPS);
+    std::vector<std::size_t> skewed_keys(LOOKUPS);
+
+    for (std::size_t i = 0; i < LOOKUPS; ++i)
+    {
+        uniform_keys[i] = uniform(gen);
+        skewed_keys[i] = skewed(gen);
+    }
+
+    const auto run = [](const char *name, const std::vector<std::size_t> &keys, auto &target)
+    {
+        std::size_t checksum = 0;
+        const double total_ns = MeasureNs(
+            [&]
+            {
+                for (auto key : keys)
+                {
+                    checksum += target.Get(key)->size();
+                }
+            });
+
+        std::printf("  %-28s %8.0f ns/lookup (checksum %zu)\n", name, total_ns / keys.size(),
+                    checksum);
+    };
+
+    run("fixed_sized_cache uniform", uniform_keys, plain);
+    run("compressed_cache uniform", uniform_keys, cache);
+    run("fixed_sized_cache skewed", skewed_keys, plain);
+    run("compressed_cache skewed", skewed_keys, cache);
+
+    return 0;
+}
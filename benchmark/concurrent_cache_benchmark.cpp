@@ -0,0 +1,114 @@
+#include "caches/cache.hpp"
+#include "caches/concurrent_cache.hpp"
+#include "caches/lru_cache_policy.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+using benchmark_clock = std::chrono::steady_clock;
+
+constexpr int KEYS = 100000;
+constexpr int OPERATIONS_PER_THREAD = 400000;
+// one write per WRITE_RATIO operations
+constexpr int WRITE_RATIO = 100;
+
+// run the mixed workload on every thread at once and return millions of operations per second
+template <typename Cache>
+double Run(unsigned threads, Cache &cache)
+{
+    std::atomic<unsigned> ready{0};
+    std::atomic<bool> start{false};
+    std::atomic<long> checksum{0};
+    std::vector<std::thread> workers;
+
+    for (unsigned t = 0; t < threads; ++t)
+    {
+        workers.emplace_back(
+            [&, t]
+            {
+                std::mt19937 gen{t};
+                std::vector<int> keys(OPERATIONS_PER_THREAD);
+
+                for (auto &key : keys)
+                {
+                    // skewed access: half of the lookups go to 1% of the keys
+                    key = gen() % 2 ? static_cast<int>(gen() % (KEYS / 100))
+                                    : static_cast<int>(gen() % KEYS);
+                }
+
+                long local = 0;
+
+                ++ready;
+
+                while (!start)
+                {
+                }
+
+                for (int i = 0; i < OPERATIONS_PER_THREAD; ++i)
+                {
+                    if (i % WRITE_RATIO == 0)
+                    {
+                        cache.Put(keys[i], keys[i]);
+                    }
+                    else
+                    {
+                        const auto result = cache.TryGet(keys[i]);
+
+                        local += result.second ? *result.first : 0;
+                    }
+                }
+
+                checksum += local;
+            });
+    }
+
+    while (ready != threads)
+    {
+    }
+
+    const auto begin = benchmark_clock::now();
+
+    start = true;
+
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+
+    const auto elapsed = std::chrono::duration<double, std::micro>(benchmark_clock::now() - begin);
+
+    return threads * static_cast<double>(OPERATIONS_PER_THREAD) / elapsed.count();
+}
+} // namespace
+
+int main()
+{
+    const auto hardware = std::thread::hardware_concurrency();
+
+    std::printf("%8s %24s %24s\n", "threads", "fixed_sized_cache Mops/s", "concurrent_cache Mops/s");
+
+    for (unsigned threads = 1; threads <= (hardware == 0 ? 4 : hardware); threads *= 2)
+    {
+        caches::fixed_sized_cache<int, int, caches::LRUCachePolicy> locked{KEYS / 2};
+        caches::concurrent_cache<int, int, caches::LRUCachePolicy> concurrent{KEYS / 2};
+
+        for (int key = 0; key < KEYS / 2; ++key)
+        {
+            locked.Put(key, key);
+            concurrent.Put(key, key);
+        }
+
+        const double locked_rate = Run(threads, locked);
+        const double concurrent_rate = Run(threads, concurrent);
+
+        std::printf("%8u %24.2f %24.2f\n", threads, locked_rate, concurrent_rate);
+    }
+
+    return 0;
+}
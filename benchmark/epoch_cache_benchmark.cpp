@@ -0,0 +1,97 @@
+#include "caches/epoch_cache.hpp"
+#include "caches/lru_cache_policy.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+using benchmark_clock = std::chrono::steady_clock;
+using cache_t = caches::epoch_cache<int, std::string, caches::LRUCachePolicy>;
+
+constexpr int HOT_KEYS = 4;
+constexpr int READS_PER_THREAD = 500000;
+
+// run the reader on every thread at once and return the average time of a read
+template <typename Reader>
+double Run(unsigned threads, Reader reader)
+{
+    std::atomic<unsigned> ready{0};
+    std::atomic<bool> start{false};
+    std::atomic<std::size_t> checksum{0};
+    std::vector<std::thread> workers;
+
+    for (unsigned t = 0; t < threads; ++t)
+    {
+        workers.emplace_back(
+            [&]
+            {
+                ++ready;
+
+                while (!start)
+                {
+                }
+
+                std::size_t local = 0;
+
+                for (int i = 0; i < READS_PER_THREAD; ++i)
+                {
+                    local += reader(i % HOT_KEYS);
+                }
+
+                checksum += local;
+            });
+    }
+
+    while (ready != threads)
+    {
+    }
+
+    const auto begin = benchmark_clock::now();
+
+    start = true;
+
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+
+    const auto elapsed = std::chrono::duration<double, std::nano>(benchmark_clock::now() - begin);
+
+    return elapsed.count() / READS_PER_THREAD;
+}
+} // namespace
+
+int main()
+{
+    cache_t cache{1024};
+
+    for (int key = 0; key < HOT_KEYS; ++key)
+    {
+        cache.Put(key, std::string(64, static_cast<char>('a' + key)));
+    }
+
+    const auto hardware = std::thread::hardware_concurrency();
+
+    std::printf("%8s %18s %18s\n", "threads", "shared_ptr ns/get", "guard ns/get");
+
+    for (unsigned threads = 1; threads <= (hardware == 0 ? 4 : hardware); threads *= 2)
+    {
+        const double shared = Run(threads, [&cache](int key) { return cache.Get(key)->size(); });
+        const double guarded = Run(threads,
+                                   [&cache](int key)
+                                   {
+                                       auto guard = cache.Pin();
+
+                                       return cache.Get(key, guard).size();
+                                   });
+
+        std::printf("%8u %18.1f %18.1f\n", threads, shared, guarded);
+    }
+
+    return 0;
+}
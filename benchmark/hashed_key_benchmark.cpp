@@ -0,0 +1,80 @@
+#include "caches/cache.hpp"
+#include "caches/hashed_key.hpp"
+#include "caches/lru_cache_policy.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+using benchmark_clock = std::chrono::steady_clock;
+
+constexpr std::size_t CAPACITY = 4096;
+constexpr std::size_t OPERATIONS = 2000000;
+constexpr std::size_t KEY_SIZE = 100;
+
+// hit rate around 80%: keys are drawn from a range slightly wider than the capacity
+std::vector<std::string> MakeKeys()
+{
+    std::mt19937 gen{42};
+    std::vector<std::string> keys;
+
+    keys.reserve(OPERATIONS);
+
+    for (std::size_t i = 0; i < OPERATIONS; ++i)
+    {
+        auto key = std::string(KEY_SIZE, 'k');
+
+        key.replace(KEY_SIZE - 8, 8, std::to_string(10000000 + gen() % (CAPACITY * 5 / 4)));
+        keys.push_back(std::move(key));
+    }
+
+    return keys;
+}
+
+// get-or-put loop, the key is wrapped once per operation as a request parser would do
+template <typename Key>
+double NsPerOperation(const std::vector<std::string> &keys)
+{
+    caches::fixed_sized_cache<Key, int, caches::LRUCachePolicy> cache{CAPACITY};
+    long checksum = 0;
+    const auto start = benchmark_clock::now();
+
+    for (const auto &raw : keys)
+    {
+        const Key key{raw};
+        const auto found = cache.TryGet(key);
+
+        if (found.second)
+        {
+            checksum += *found.first;
+        }
+        else
+        {
+            cache.Put(key, 1);
+        }
+    }
+
+    const auto elapsed = std::chrono::duration<double, std::nano>(benchmark_clock::now() - start);
+
+    std::printf("checksum %ld\n", checksum);
+
+    return elapsed.count() / OPERATIONS;
+}
+} // namespace
+
+int main()
+{
+    const auto keys = MakeKeys();
+    const auto plain = NsPerOperation<std::string>(keys);
+    const auto hashed = NsPerOperation<caches::hashed_key<std::string>>(keys);
+
+    std::printf("%zu-byte keys, LRU, get-or-put\n", KEY_SIZE);
+    std::printf("%24s %10.1f ns/op\n", "std::string", plain);
+    std::printf("%24s %10.1f ns/op\n", "hashed_key<std::string>", hashed);
+
+    return 0;
+}
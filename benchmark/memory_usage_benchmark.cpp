@@ -0,0 +1,58 @@
+#include "caches/cache.hpp"
+#include "caches/fifo_cache_policy.hpp"
+#include "caches/lfu_cache_policy.hpp"
+#include "caches/lru_cache_policy.hpp"
+
+#include <cstdio>
+#include <string>
+
+namespace
+{
+constexpr int ELEMENTS = 100000;
+
+// bytes per element taken by every component of a full cache
+template <typename Key, template <typename> class Policy>
+void Report(const char *name, Key (*make_key)(int))
+{
+    caches::fixed_sized_cache<Key, long, Policy> cache{ELEMENTS};
+
+    for (int i = 0; i < ELEMENTS; ++i)
+    {
+        cache.Put(make_key(i), i);
+    }
+
+    const auto usage = cache.MemoryUsage();
+
+    std::printf("%-24s %8.1f %8.1f %8.1f %8.1f\n", name,
+                static_cast<double>(usage.index) / ELEMENTS,
+                static_cast<double>(usage.policy) / ELEMENTS,
+                static_cast<double>(usage.values) / ELEMENTS,
+                static_cast<double>(usage.Total()) / ELEMENTS);
+}
+
+int IntKey(int i)
+{
+    return i;
+}
+
+std::string StringKey(int i)
+{
+    return "key:" + std::to_string(i);
+}
+} // namespace
+
+int main()
+{
+    std::printf("%-24s %8s %8s %8s %8s\n", "bytes per element", "index", "policy", "values",
+                "total");
+    Report<int, caches::NoCachePolicy>("int, no policy", IntKey);
+    Report<int, caches::FIFOCachePolicy>("int, FIFO", IntKey);
+    Report<int, caches::LRUCachePolicy>("int, LRU", IntKey);
+    Report<int, caches::LFUCachePolicy>("int, LFU", IntKey);
+    Report<std::string, caches::NoCachePolicy>("std::string, no policy", StringKey);
+    Report<std::string, caches::FIFOCachePolicy>("std::string, FIFO", StringKey);
+    Report<std::string, caches::LRUCachePolicy>("std::string, LRU", StringKey);
+    Report<std::string, caches::LFUCachePolicy>("std::string, LFU", StringKey);
+
+    return 0;
+}
@@ -0,0 +1,85 @@
+#include "caches/cache.hpp"
+#include "caches/fifo_cache_policy.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace
+{
+using benchmark_clock = std::chrono::steady_clock;
+using cache_t = caches::fixed_sized_cache<int, long, caches::FIFOCachePolicy>;
+
+// several times larger than the last level cache of a server CPU
+constexpr int KEYS = 1 << 22;
+constexpr std::size_t LOOKUPS = 4000000;
+constexpr std::size_t BATCH = 16;
+
+template <typename F>
+double NsPerLookup(F &&function)
+{
+    const auto start = benchmark_clock::now();
+    const auto checksum = function();
+    const auto elapsed = std::chrono::duration<double, std::nano>(benchmark_clock::now() - start);
+
+    std::printf("checksum %ld\n", checksum);
+
+    return elapsed.count() / LOOKUPS;
+}
+} // namespace
+
+int main()
+{
+    cache_t cache{KEYS};
+    std::mt19937 gen{42};
+    std::vector<int> keys(LOOKUPS);
+
+    for (int key = 0; key < KEYS; ++key)
+    {
+        cache.Put(key, key);
+    }
+
+    for (auto &key : keys)
+    {
+        key = static_cast<int>(gen() % KEYS);
+    }
+
+    const auto plain = NsPerLookup(
+        [&]
+        {
+            long checksum = 0;
+
+            for (auto key : keys)
+            {
+                checksum += *cache.Get(key);
+            }
+
+            return checksum;
+        });
+
+    // the keys of the next batch are known in advance: prefetch them all, then look them up
+    const auto batched = NsPerLookup(
+        [&]
+        {
+            long checksum = 0;
+
+            for (std::size_t i = 0; i < LOOKUPS; i += BATCH)
+            {
+                cache.Prefetch(keys.begin() + i, keys.begin() + i + BATCH);
+
+                for (std::size_t j = i; j < i + BATCH; ++j)
+                {
+                    checksum += *cache.Get(keys[j]);
+                }
+            }
+
+            return checksum;
+        });
+
+    std::printf("%d elements, random hits\n", KEYS);
+    std::printf("%28s %8.1f ns/lookup\n", "Get", plain);
+    std::printf("%28s %8.1f ns/lookup\n", "Prefetch(batch of 16) + Get", batched);
+
+    return 0;
+}
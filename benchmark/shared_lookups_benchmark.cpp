@@ -0,0 +1,96 @@
+#include "caches/cache.hpp"
+#include "caches/fifo_cache_policy.hpp"
+#include "caches/lru_cache_policy.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace
+{
+using benchmark_clock = std::chrono::steady_clock;
+
+constexpr int KEYS = 4096;
+constexpr int READS_PER_THREAD = 1000000;
+
+// run lookups on every thread at once and return the number of lookups per microsecond
+template <typename Cache>
+double Run(unsigned threads, const Cache &cache)
+{
+    std::atomic<unsigned> ready{0};
+    std::atomic<bool> start{false};
+    std::atomic<long long> checksum{0};
+    std::vector<std::thread> workers;
+
+    for (unsigned t = 0; t < threads; ++t)
+    {
+        workers.emplace_back(
+            [&, t]
+            {
+                ++ready;
+
+                while (!start)
+                {
+                }
+
+                long long local = 0;
+
+                for (int i = 0; i < READS_PER_THREAD; ++i)
+                {
+                    local += *cache.TryGet(static_cast<int>((i * 7 + t) % KEYS)).first;
+                }
+
+                checksum += local;
+            });
+    }
+
+    while (ready != threads)
+    {
+    }
+
+    const auto begin = benchmark_clock::now();
+
+    start = true;
+
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+
+    const auto elapsed =
+        std::chrono::duration<double, std::micro>(benchmark_clock::now() - begin);
+
+    return threads * static_cast<double>(READS_PER_THREAD) / elapsed.count();
+}
+
+template <typename Cache>
+void Fill(Cache &cache)
+{
+    for (int key = 0; key < KEYS; ++key)
+    {
+        cache.Put(key, key);
+    }
+}
+} // namespace
+
+int main()
+{
+    caches::fixed_sized_cache<int, int, caches::FIFOCachePolicy> fifo{KEYS};
+    caches::fixed_sized_cache<int, int, caches::LRUCachePolicy> lru{KEYS};
+
+    Fill(fifo);
+    Fill(lru);
+
+    const auto hardware = std::thread::hardware_concurrency();
+
+    std::printf("%8s %22s %22s\n", "threads", "FIFO (shared) gets/us", "LRU (exclusive) gets/us");
+
+    for (unsigned threads = 1; threads <= (hardware == 0 ? 4 : hardware); threads *= 2)
+    {
+        std::printf("%8u %22.1f %22.1f\n", threads, Run(threads, fifo), Run(threads, lru));
+    }
+
+    return 0;
+}
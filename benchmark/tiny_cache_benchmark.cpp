@@ -0,0 +1,119 @@
+#include "caches/cache.hpp"
+#include "caches/lru_cache_policy.hpp"
+#include "caches/static_cache.hpp"
+#include "caches/tiny_cache.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace
+{
+using benchmark_clock = std::chrono::steady_clock;
+
+constexpr std::size_t OPERATIONS = 2000000;
+
+// hit rate around 80%: keys are drawn from a range slightly wider than the capacity
+std::vector<int> MakeKeys(std::size_t capacity)
+{
+    std::mt19937 gen{static_cast<unsigned>(capacity)};
+    std::vector<int> keys(OPERATIONS);
+
+    for (auto &key : keys)
+    {
+        key = static_cast<int>(gen() % (capacity + capacity / 4));
+    }
+
+    return keys;
+}
+
+template <typename F>
+double NsPerOperation(F &&function)
+{
+    const auto start = benchmark_clock::now();
+
+    function();
+
+    const auto elapsed = std::chrono::duration<double, std::nano>(benchmark_clock::now() - start);
+
+    return elapsed.count() / OPERATIONS;
+}
+
+// get-or-put loop over a cache returning plain pointers
+template <typename Cache>
+double RunInline(const std::vector<int> &keys)
+{
+    Cache cache;
+    long checksum = 0;
+    const double result = NsPerOperation(
+        [&]
+        {
+            for (auto key : keys)
+            {
+                if (const auto *value = cache.TryGet(key))
+                {
+                    checksum += *value;
+                }
+                else
+                {
+                    cache.Put(key, key);
+                }
+            }
+        });
+
+    std::printf("%s", checksum == 42 ? " " : "");
+
+    return result;
+}
+
+template <std::size_t Capacity>
+void Run()
+{
+    const auto keys = MakeKeys(Capacity);
+    caches::fixed_sized_cache<int, int, caches::LRUCachePolicy> fixed{Capacity};
+    long checksum = 0;
+    const double fixed_ns = NsPerOperation(
+        [&]
+        {
+            for (auto key : keys)
+            {
+                const auto result = fixed.TryGet(key);
+
+                if (result.second)
+                {
+                    checksum += *result.first;
+                }
+                else
+                {
+                    fixed.Put(key, key);
+                }
+            }
+        });
+    const double static_ns =
+        RunInline<caches::static_cache<int, int, Capacity, caches::static_lru_policy>>(keys);
+    const double tiny_ns = RunInline<caches::tiny_cache<int, int, Capacity>>(keys);
+
+    std::printf("%8zu %18.1f %18.1f %18.1f %8.1fx%s\n", Capacity, fixed_ns, static_ns, tiny_ns,
+                fixed_ns / tiny_ns, checksum == 42 ? " " : "");
+}
+} // namespace
+
+int main()
+{
+#if defined(CACHES_TINY_CACHE_AVX2)
+    std::printf("key search: AVX2\n");
+#elif defined(CACHES_TINY_CACHE_SSE2)
+    std::printf("key search: SSE2\n");
+#else
+    std::printf("key search: scalar\n");
+#endif
+    std::printf("%8s %18s %18s %18s %9s\n", "capacity", "fixed_sized ns/op", "static ns/op",
+                "tiny ns/op", "speedup");
+
+    Run<16>();
+    Run<32>();
+    Run<64>();
+
+    return 0;
+}
@@ -0,0 +1,568 @@
+/**
+ * \file
+ * \brief Cache that switches its eviction policy at runtime using sampled shadow caches
+ */
+#ifndef ADAPTIVE_CACHE_HPP
+#define ADAPTIVE_CACHE_HPP
+
+#include "cache.hpp"
+#include "cache_policy.hpp"
+#include "fifo_cache_policy.hpp"
+#include "lfu_cache_policy.hpp"
+#include "lru_cache_policy.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace caches
+{
+/**
+ * \brief Eviction policies an adaptive cache chooses from
+ */
+enum class adaptive_policy
+{
+    lru,
+    lfu,
+    fifo
+};
+
+/// Number of the adaptive_policy values
+constexpr std::size_t ADAPTIVE_POLICIES = 3;
+
+/**
+ * \brief Name of the policy, e.g. for logging switch events
+ */
+inline const char *PolicyName(adaptive_policy policy) noexcept
+{
+    switch (policy)
+    {
+    case adaptive_policy::lru:
+        return "LRU";
+    case adaptive_policy::lfu:
+        return "LFU";
+    default:
+        return "FIFO";
+    }
+}
+
+/// Hit ratios of the shadow caches indexed by adaptive_policy
+using shadow_hit_ratios = std::array<double, ADAPTIVE_POLICIES>;
+
+/**
+ * \brief Change of the policy chosen by a policy_selector
+ */
+struct policy_switch
+{
+    std::chrono::steady_clock::time_point time;
+    /// Index of the window that triggered the switch (counting from 1)
+    std::uint64_t window;
+    adaptive_policy from;
+    adaptive_policy to;
+    /// Hit ratios of the shadow caches within that window
+    shadow_hit_ratios hit_ratios;
+};
+
+/**
+ * \brief Chooses an eviction policy by simulating every candidate on a sample of the keys
+ * \details Keys are sampled by their hash the same way as in shards_estimator, so a sampled key is
+ * seen on every access and the sample is a miniature of the whole workload. Every sampled access
+ * is replayed on a shadow cache per policy, whose capacity is the cache capacity scaled by the
+ * sampling rate (at least one element). Every access is treated as a lookup that loads the
+ * element on a miss.
+ *
+ * After every `window` sampled accesses the hit ratios of the shadows within the window are
+ * compared. The chosen policy switches to the best shadow only if it beats the current one by
+ * more than `margin`, so the choice doesn't flap between policies that perform the same.
+ *
+ * A sample of a few hundred elements per shadow (`capacity * sampling_rate`) is needed for the
+ * ratios to be meaningful. Accesses to keys outside of the sample cost one hash computation and a
+ * comparison. The selector can be attached to fixed_sized_cache with `SetAccessObserver`, results
+ * can be queried from any thread.
+ * \tparam Key Type of a key
+ * \tparam Hash Hash function used for sampling and by the shadow caches
+ */
+template <typename Key, typename Hash = std::hash<Key>>
+class policy_selector : public IAccessObserver<Key>
+{
+  public:
+    /// Number of the latest switch events kept for Switches()
+    static constexpr std::size_t MAX_SWITCH_HISTORY = 64;
+
+    /**
+     * \brief Construct the selector
+     * \throw std::invalid_argument
+     * \param[in] capacity Capacity of the cache whose policy is chosen
+     * \param[in] sampling_rate Share of keys to simulate (0, 1]
+     * \param[in] window Number of sampled accesses between comparisons of the shadows
+     * \param[in] margin Minimum difference of hit ratios that makes the policy switch
+     * \param[in] initial Policy chosen until the first switch
+     */
+    explicit policy_selector(std::size_t capacity, double sampling_rate = 0.05,
+                             std::size_t window = 4096, double margin = 0.05,
+                             adaptive_policy initial = adaptive_policy::lru)
+        : threshold{ThresholdOf(sampling_rate)}, window{window},
+          margin{margin}, chosen{initial}
+    {
+        if (capacity == 0 || window == 0 || !(margin >= 0.0))
+        {
+            throw std::invalid_argument{"Invalid policy selector configuration"};
+        }
+
+        shadow_capacity =
+            std::max<std::size_t>(1, static_cast<std::size_t>(capacity * sampling_rate));
+        shadows[Index(adaptive_policy::lru)].reset(new LRUCachePolicy<Key>);
+        shadows[Index(adaptive_policy::lfu)].reset(new LFUCachePolicy<Key>);
+        shadows[Index(adaptive_policy::fifo)].reset(new FIFOCachePolicy<Key>);
+        shadow_sizes.fill(0);
+        shadow_hits.fill(0);
+        hit_ratios.fill(0.0);
+    }
+
+    ~policy_selector() override = default;
+
+    void OnAccess(const Key &key) noexcept override
+    {
+        if (Mix(hasher(key)) % MODULUS >= threshold)
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock{selector_op};
+
+        Simulate(key);
+
+        if (++samples == window)
+        {
+            CompleteWindow();
+        }
+    }
+
+    /**
+     * \brief Policy the cache should use now
+     */
+    adaptive_policy Chosen() const noexcept
+    {
+        return chosen.load(std::memory_order_acquire);
+    }
+
+    /**
+     * \brief Hit ratios of the shadow caches within the last completed window
+     * \details All ratios are zero until the first window is completed
+     */
+    shadow_hit_ratios HitRatios() const
+    {
+        std::lock_guard<std::mutex> lock{selector_op};
+
+        return hit_ratios;
+    }
+
+    /**
+     * \brief The latest switch events, the oldest first
+     * \details At most MAX_SWITCH_HISTORY events are kept (see SwitchCount for the total number)
+     */
+    std::vector<policy_switch> Switches() const
+    {
+        std::lock_guard<std::mutex> lock{selector_op};
+
+        return std::vector<policy_switch>(history.begin(), history.end());
+    }
+
+    /**
+     * \brief Total number of switches
+     */
+    std::uint64_t SwitchCount() const
+    {
+        std::lock_guard<std::mutex> lock{selector_op};
+
+        return switches;
+    }
+
+    /**
+     * \brief Number of completed windows
+     */
+    std::uint64_t Windows() const
+    {
+        std::lock_guard<std::mutex> lock{selector_op};
+
+        return windows;
+    }
+
+  private:
+    static constexpr std::uint32_t MODULUS = 1U << 24;
+
+    // checked before the conversion, so an out of range or NaN rate throws instead of overflowing
+    static std::uint32_t ThresholdOf(double sampling_rate)
+    {
+        if (!(sampling_rate > 0.0 && sampling_rate <= 1.0))
+        {
+            throw std::invalid_argument{"Invalid policy selector configuration"};
+        }
+
+        return static_cast<std::uint32_t>(sampling_rate * MODULUS);
+    }
+
+    static std::size_t Index(adaptive_policy policy) noexcept
+    {
+        return static_cast<std::size_t>(policy);
+    }
+
+    static std::uint64_t Mix(std::uint64_t value) noexcept
+    {
+        // splitmix64 finalizer, decorrelates sampling from the hash map's bucket choice
+        value ^= value >> 30;
+        value *= 0xbf58476d1ce4e5b9ULL;
+        value ^= value >> 27;
+        value *= 0x94d049bb133111ebULL;
+        value ^= value >> 31;
+
+        return value;
+    }
+
+    // replay the access on every shadow cache
+    void Simulate(const Key &key)
+    {
+        // one lookup tells which shadows hold the key, bit `i` stands for the policy `i`
+        auto &members = membership[key];
+
+        for (std::size_t i = 0; i < ADAPTIVE_POLICIES; ++i)
+        {
+            const auto bit = 1U << i;
+
+            if ((members & bit) != 0)
+            {
+                shadows[i]->Touch(key);
+                ++shadow_hits[i];
+                continue;
+            }
+
+            if (shadow_sizes[i] == shadow_capacity)
+            {
+                const auto victim = shadows[i]->ReplCandidate();
+                const auto victim_it = membership.find(victim);
+
+                shadows[i]->Erase(victim);
+                --shadow_sizes[i];
+                victim_it->second &= ~bit;
+
+                if (victim_it->second == 0)
+                {
+                    membership.erase(victim_it);
+                }
+            }
+
+            shadows[i]->Insert(key);
+            ++shadow_sizes[i];
+            members |= bit;
+        }
+    }
+
+    void CompleteWindow()
+    {
+        for (std::size_t i = 0; i < ADAPTIVE_POLICIES; ++i)
+        {
+            hit_ratios[i] = static_cast<double>(shadow_hits[i]) / samples;
+            shadow_hits[i] = 0;
+        }
+
+        samples = 0;
+        ++windows;
+
+        const auto current = chosen.load(std::memory_order_relaxed);
+        const auto best = static_cast<adaptive_policy>(
+            std::max_element(hit_ratios.begin(), hit_ratios.end()) - hit_ratios.begin());
+
+        if (hit_ratios[Index(best)] <= hit_ratios[Index(current)] + margin)
+        {
+            return;
+        }
+
+        if (history.size() == MAX_SWITCH_HISTORY)
+        {
+            history.pop_front();
+        }
+
+        history.push_back(
+            policy_switch{std::chrono::steady_clock::now(), windows, current, best, hit_ratios});
+        ++switches;
+        chosen.store(best, std::memory_order_release);
+    }
+
+    Hash hasher;
+    std::uint32_t threshold;
+    std::size_t window;
+    double margin;
+    std::atomic<adaptive_policy> chosen;
+    mutable std::mutex selector_op;
+    std::size_t shadow_capacity;
+    std::array<std::unique_ptr<ICachePolicy<Key>>, ADAPTIVE_POLICIES> shadows;
+    std::array<std::size_t, ADAPTIVE_POLICIES> shadow_sizes;
+    std::array<std::uint64_t, ADAPTIVE_POLICIES> shadow_hits;
+    std::unordered_map<Key, unsigned, Hash> membership;
+    shadow_hit_ratios hit_ratios;
+    std::size_t samples = 0;
+    std::uint64_t windows = 0;
+    std::uint64_t switches = 0;
+    std::deque<policy_switch> history;
+};
+
+/**
+ * \brief Eviction policy that follows the choice of a policy_selector
+ * \details Keeps the elements in one of LRU, LFU or FIFO policies. Before every insertion and
+ * touch the policy checks the selector (one atomic load) and, if another policy has been chosen,
+ * migrates the elements: they are moved to the new policy in their eviction order, so the element
+ * that would have been evicted next is still evicted first. Access frequencies are not carried
+ * over to LFU: every migrated element starts with the same frequency, and as LFU evicts the newest
+ * of equally used elements first, a full cache needs a while to let the frequently used elements
+ * back in. A migration takes O(n log n) under the cache lock and happens only when the choice
+ * changes.
+ *
+ * Touch is not a no-op (even while FIFO is active), so lookups take the exclusive cache lock.
+ * Copies of the policy share the selector. Without a selector the policy works as LRU.
+ * \tparam Key Type of a key a policy works with
+ */
+template <typename Key>
+class AdaptiveCachePolicy : public ICachePolicy<Key>
+{
+  public:
+    AdaptiveCachePolicy() = default;
+
+    /**
+     * \brief Construct policy
+     * \param[in] selector Selector whose choice the policy follows
+     */
+    explicit AdaptiveCachePolicy(std::shared_ptr<const policy_selector<Key>> selector)
+        : selector{std::move(selector)}
+    {
+    }
+
+    ~AdaptiveCachePolicy() override = default;
+    AdaptiveCachePolicy(const AdaptiveCachePolicy &) = default;
+    AdaptiveCachePolicy(AdaptiveCachePolicy &&) = default;
+    AdaptiveCachePolicy &operator=(const AdaptiveCachePolicy &) = default;
+    AdaptiveCachePolicy &operator=(AdaptiveCachePolicy &&) = default;
+
+    void Insert(const Key &key) override
+    {
+        Follow();
+        Policy(active).Insert(key);
+        ++size;
+    }
+
+    void Touch(const Key &key) override
+    {
+        Follow();
+        Policy(active).Touch(key);
+    }
+
+    void Erase(const Key &key) noexcept override
+    {
+        Policy(active).Erase(key);
+        --size;
+    }
+
+    const Key &ReplCandidate() const noexcept override
+    {
+        return Policy(active).ReplCandidate();
+    }
+
+    /**
+     * \brief Policy that currently keeps the elements
+     */
+    adaptive_policy Active() const noexcept
+    {
+        return active;
+    }
+
+    /**
+     * \brief Count the memory of the policy's containers in the given counter
+     * \details Must be called while the policy is empty
+     */
+    void CountMemory(std::size_t *counter)
+    {
+        lru.CountMemory(counter);
+        lfu.CountMemory(counter);
+        fifo.CountMemory(counter);
+    }
+
+  private:
+    ICachePolicy<Key> &Policy(adaptive_policy policy) noexcept
+    {
+        return policy == adaptive_policy::lru   ? static_cast<ICachePolicy<Key> &>(lru)
+               : policy == adaptive_policy::lfu ? static_cast<ICachePolicy<Key> &>(lfu)
+                                                : static_cast<ICachePolicy<Key> &>(fifo);
+    }
+
+    const ICachePolicy<Key> &Policy(adaptive_policy policy) const noexcept
+    {
+        return const_cast<AdaptiveCachePolicy *>(this)->Policy(policy);
+    }
+
+    void Follow()
+    {
+        if (selector && selector->Chosen() != active)
+        {
+            Migrate(selector->Chosen());
+        }
+    }
+
+    // the eviction order can only be read by erasing the elements from the source, so they can't
+    // be put back if copying a key or inserting it into the destination fails
+    void Migrate(adaptive_policy target) noexcept
+    {
+        std::vector<Key> order;
+
+        order.reserve(size);
+
+        auto &source = Policy(active);
+
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            order.push_back(source.ReplCandidate());
+            source.Erase(order.back());
+        }
+
+        auto &destination = Policy(target);
+
+        // LFU puts a new element in front of the elements with the same frequency, the others
+        // put it at the end of the eviction order
+        if (target == adaptive_policy::lfu)
+        {
+            std::for_each(order.rbegin(), order.rend(),
+                          [&destination](const Key &key) { destination.Insert(key); });
+        }
+        else
+        {
+            for (const auto &key : order)
+            {
+                destination.Insert(key);
+            }
+        }
+
+        active = target;
+    }
+
+    LRUCachePolicy<Key> lru;
+    LFUCachePolicy<Key> lfu;
+    FIFOCachePolicy<Key> fifo;
+    adaptive_policy active = adaptive_policy::lru;
+    std::size_t size = 0;
+    std::shared_ptr<const policy_selector<Key>> selector;
+};
+
+/**
+ * \brief Fixed sized cache whose eviction policy is chosen at runtime
+ * \details Lookups (Get/TryGet) are reported to a policy_selector, which simulates LRU, LFU and
+ * FIFO on a sample of the keys, and the elements are kept in an AdaptiveCachePolicy following
+ * the selector's choice. The access observer of the cache stays free for other uses.
+ * \tparam Key Type of a key (should be hashable)
+ * \tparam Value Type of a value stored in the cache
+ */
+template <typename Key, typename Value>
+class adaptive_cache : public fixed_sized_cache<Key, Value, AdaptiveCachePolicy>
+{
+    using base_type = fixed_sized_cache<Key, Value, AdaptiveCachePolicy>;
+
+  public:
+    using typename base_type::on_erase_cb;
+    using typename base_type::value_type;
+
+    /**
+     * \brief Construct cache
+     * \throw std::invalid_argument
+     * \param[in] max_size Maximum size of the cache
+     * \param[in] selector Selector of the policy, a selector with the default configuration is
+     * created for `max_size` if it's `nullptr`
+     * \param[in] on_erase on_erase_cb function to be called when cache's element get erased
+     */
+    explicit adaptive_cache(std::size_t max_size,
+                            std::shared_ptr<policy_selector<Key>> selector = nullptr,
+                            on_erase_cb on_erase = on_erase_cb{})
+        : adaptive_cache{max_size,
+                         selector ? std::move(selector)
+                                  : std::make_shared<policy_selector<Key>>(max_size),
+                         std::move(on_erase), 0}
+    {
+    }
+
+    /**
+     * \brief Try to get an element by the given key from the cache
+     * \param[in] key Get element by key
+     * \return Pair of the value (`nullptr` if it's not found) and whether it has been found
+     */
+    std::pair<value_type, bool> TryGet(const Key &key) const noexcept
+    {
+        selector->OnAccess(key);
+
+        return base_type::TryGet(key);
+    }
+
+    /**
+     * \brief Get element from the cache if present
+     * \throw std::range_error
+     * \param[in] key Get element by key
+     */
+    value_type Get(const Key &key) const
+    {
+        selector->OnAccess(key);
+
+        return base_type::Get(key);
+    }
+
+    /**
+     * \brief Policy chosen by the selector, the cache migrates to it on its next insertion or
+     * touch
+     */
+    adaptive_policy ActivePolicy() const noexcept
+    {
+        return selector->Chosen();
+    }
+
+    /**
+     * \brief Hit ratios of the shadow caches within the last completed window
+     */
+    shadow_hit_ratios ShadowHitRatios() const
+    {
+        return selector->HitRatios();
+    }
+
+    /**
+     * \brief The latest policy switches, the oldest first
+     */
+    std::vector<policy_switch> Switches() const
+    {
+        return selector->Switches();
+    }
+
+    /**
+     * \brief Selector of the policy
+     */
+    const policy_selector<Key> &Selector() const noexcept
+    {
+        return *selector;
+    }
+
+  private:
+    adaptive_cache(std::size_t max_size, std::shared_ptr<policy_selector<Key>> selector,
+                   on_erase_cb on_erase, int)
+        : base_type{max_size, AdaptiveCachePolicy<Key>{selector}, std::move(on_erase)},
+          selector{std::move(selector)}
+    {
+    }
+
+    std::shared_ptr<policy_selector<Key>> selector;
+};
+} // namespace caches
+
+#endif // ADAPTIVE_CACHE_HPP
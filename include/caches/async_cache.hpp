@@ -0,0 +1,531 @@
+/**
+ * \file
+ * \brief Cache with an asynchronous interface that batches queued operations
+ */
+#ifndef ASYNC_CACHE_HPP
+#define ASYNC_CACHE_HPP
+
+#include "cache.hpp"
+#include "cache_policy.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace caches
+{
+/**
+ * \brief Executor running tasks on its own worker threads
+ * \details Tasks are run in the order they are submitted. The destructor runs the tasks that are
+ * still queued and joins the workers
+ */
+class thread_executor
+{
+  public:
+    /**
+     * \brief Start the workers
+     * \throw std::invalid_argument
+     * \param[in] threads Number of worker threads
+     */
+    explicit thread_executor(std::size_t threads = 1)
+    {
+        if (threads == 0)
+        {
+            throw std::invalid_argument{"Number of threads should be non-zero"};
+        }
+
+        for (std::size_t i = 0; i < threads; ++i)
+        {
+            workers.emplace_back([this] { Work(); });
+        }
+    }
+
+    thread_executor(const thread_executor &) = delete;
+    thread_executor &operator=(const thread_executor &) = delete;
+
+    ~thread_executor()
+    {
+        {
+            std::lock_guard<std::mutex> lock{tasks_op};
+            stopped = true;
+        }
+
+        tasks_ready.notify_all();
+
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    /**
+     * \brief Queue the task for execution
+     */
+    void operator()(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock{tasks_op};
+            tasks.push_back(std::move(task));
+        }
+
+        tasks_ready.notify_one();
+    }
+
+  private:
+    void Work()
+    {
+        for (;;)
+        {
+            std::function<void()> task;
+
+            {
+                std::unique_lock<std::mutex> lock{tasks_op};
+
+                tasks_ready.wait(lock, [this] { return stopped || !tasks.empty(); });
+
+                if (tasks.empty())
+                {
+                    return;
+                }
+
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+
+            task();
+        }
+    }
+
+    std::mutex tasks_op;
+    std::condition_variable tasks_ready;
+    std::deque<std::function<void()>> tasks;
+    bool stopped = false;
+    std::vector<std::thread> workers;
+};
+
+/**
+ * \brief Fixed sized cache with an asynchronous interface for event loops
+ * \details Asynchronous operations are queued and run by an executor: all operations queued by
+ * the time a batch starts are served under a single acquisition of the cache lock, and their
+ * completions are called after the lock is released, on the executor. Queuing an operation takes
+ * a separate queue lock just for the push, so a caller never waits for the cache lock or for
+ * other operations.
+ *
+ * Every operation comes in two forms: with a completion callback, which suits event loops that
+ * post the result back to themselves, and returning a `std::future`. `GetOrLoadAsync` runs the
+ * loader of a missing key on the executor and stores its result; concurrent loads of the same
+ * key share a single loader call.
+ *
+ * An operation that fails in a batch (e.g. because copying its value throws) gets its exception
+ * in its completion, the other operations of the batch are not affected. Completions must not
+ * throw. The synchronous interface of fixed_sized_cache stays available.
+ * The destructor waits for the queued operations and running loaders to complete.
+ * \tparam Key Type of a key (should be hashable)
+ * \tparam Value Type of a value stored in the cache
+ * \tparam Policy Type of a policy to be used with the cache
+ */
+template <typename Key, typename Value, template <typename> class Policy = NoCachePolicy>
+class async_cache : public fixed_sized_cache<Key, Value, Policy>
+{
+    using base_type = fixed_sized_cache<Key, Value, Policy>;
+
+  public:
+    using typename base_type::on_erase_cb;
+    using typename base_type::value_type;
+    /// Runs the given task, possibly on another thread
+    using executor_type = std::function<void(std::function<void()>)>;
+    /// Receives the value, or `nullptr` and the error of a failed operation
+    using completion_type = std::function<void(value_type, std::exception_ptr)>;
+    using loader_type = std::function<Value(const Key &)>;
+
+    /**
+     * \brief Construct cache
+     * \throw std::invalid_argument
+     * \param[in] max_size Maximum size of the cache
+     * \param[in] executor Executor of batches and loaders, a thread_executor with a single
+     * worker owned by the cache if empty
+     * \param[in] policy Cache policy to use
+     * \param[in] on_erase on_erase_cb function to be called when cache's element get erased
+     */
+    explicit async_cache(std::size_t max_size, executor_type executor = executor_type{},
+                         const Policy<Key> &policy = Policy<Key>{},
+                         on_erase_cb on_erase = on_erase_cb{})
+        : base_type{max_size, policy, std::move(on_erase)}, executor{std::move(executor)}
+    {
+        if (!this->executor)
+        {
+            own_executor.reset(new thread_executor{});
+
+            auto *worker = own_executor.get();
+
+            this->executor = [worker](std::function<void()> task) { (*worker)(std::move(task)); };
+        }
+    }
+
+    ~async_cache()
+    {
+        std::unique_lock<std::mutex> lock{queue_op};
+
+        idle.wait(lock, [this] { return outstanding == 0; });
+    }
+
+    /**
+     * \brief Get an element asynchronously
+     * \param[in] key Get element by key
+     * \param[in] done Called with the value, or with std::range_error if there is no such element
+     */
+    void GetAsync(const Key &key, completion_type done)
+    {
+        Enqueue(request{request_kind::get, key, nullptr, std::move(done)});
+    }
+
+    /**
+     * \brief Get an element asynchronously
+     * \return Future of the value, holding std::range_error if there is no such element
+     */
+    std::future<value_type> GetAsync(const Key &key)
+    {
+        auto promise = std::make_shared<std::promise<value_type>>();
+        auto result = promise->get_future();
+
+        GetAsync(key, Fulfill(promise));
+
+        return result;
+    }
+
+    /**
+     * \brief Put an element asynchronously
+     * \param[in] key Key value to use
+     * \param[in] value Value to assign to the given key
+     * \param[in] done Called with the stored value once it's in the cache
+     */
+    void PutAsync(const Key &key, const Value &value, completion_type done)
+    {
+        Enqueue(request{request_kind::put, key, std::unique_ptr<Value>{new Value(value)},
+                        std::move(done)});
+    }
+
+    /**
+     * \brief Put an element asynchronously
+     * \return Future that is ready once the element is in the cache
+     */
+    std::future<void> PutAsync(const Key &key, const Value &value)
+    {
+        auto promise = std::make_shared<std::promise<void>>();
+        auto result = promise->get_future();
+
+        PutAsync(key, value,
+                 [promise](value_type, std::exception_ptr error)
+                 {
+                     if (error)
+                     {
+                         promise->set_exception(error);
+                     }
+                     else
+                     {
+                         promise->set_value();
+                     }
+                 });
+
+        return result;
+    }
+
+    /**
+     * \brief Get an element asynchronously, loading it on a miss
+     * \details On a miss, `loader` is called on the executor and its result is put into the
+     * cache. While a key is loading, other loads of the same key wait for the same result. An
+     * exception thrown by the loader is passed to all of them and nothing is stored
+     * \param[in] key Get element by key
+     * \param[in] loader Callable with `(const Key &)` returning the value of a missing key
+     * \param[in] done Called with the value or the loader's error
+     */
+    void GetOrLoadAsync(const Key &key, loader_type loader, completion_type done)
+    {
+        auto shared_loader = std::make_shared<loader_type>(std::move(loader));
+
+        Enqueue(request{request_kind::get, key, nullptr,
+                        [this, key, shared_loader, done](value_type value, std::exception_ptr)
+                        {
+                            if (value != nullptr)
+                            {
+                                done(std::move(value), nullptr);
+                            }
+                            else
+                            {
+                                Load(key, std::move(*shared_loader), done);
+                            }
+                        }});
+    }
+
+    /**
+     * \brief Get an element asynchronously, loading it on a miss
+     * \return Future of the value or the loader's error
+     */
+    std::future<value_type> GetOrLoadAsync(const Key &key, loader_type loader)
+    {
+        auto promise = std::make_shared<std::promise<value_type>>();
+        auto result = promise->get_future();
+
+        GetOrLoadAsync(key, std::move(loader), Fulfill(promise));
+
+        return result;
+    }
+
+  private:
+    enum class request_kind
+    {
+        get,
+        put
+    };
+
+    struct request
+    {
+        request_kind kind;
+        Key key;
+        std::unique_ptr<Value> value;
+        completion_type done;
+    };
+
+    static completion_type Fulfill(std::shared_ptr<std::promise<value_type>> promise)
+    {
+        return [promise](value_type value, std::exception_ptr error)
+        {
+            if (error)
+            {
+                promise->set_exception(error);
+            }
+            else
+            {
+                promise->set_value(std::move(value));
+            }
+        };
+    }
+
+    void Enqueue(request pending_request)
+    {
+        bool schedule = false;
+
+        {
+            std::lock_guard<std::mutex> lock{queue_op};
+
+            pending.push_back(std::move(pending_request));
+
+            if (!draining)
+            {
+                draining = true;
+                schedule = true;
+                ++outstanding;
+            }
+        }
+
+        if (schedule)
+        {
+            executor([this] { Drain(); });
+        }
+    }
+
+    // serve all queued requests under a single lock acquisition
+    void Drain()
+    {
+        std::vector<request> batch;
+        {
+            std::lock_guard<std::mutex> lock{queue_op};
+            batch.swap(pending);
+        }
+
+        Serve(batch);
+
+        bool reschedule = false;
+
+        {
+            std::lock_guard<std::mutex> lock{queue_op};
+
+            if (pending.empty())
+            {
+                draining = false;
+            }
+            else
+            {
+                reschedule = true;
+                ++outstanding;
+            }
+        }
+
+        if (reschedule)
+        {
+            executor([this] { Drain(); });
+        }
+
+        Finish();
+    }
+
+    // a request that fails (e.g. a copy of its value throws) gets its own error, the others are
+    // served as usual
+    void Serve(std::vector<request> &batch) noexcept
+    {
+        std::vector<value_type> results;
+        std::vector<std::exception_ptr> errors;
+
+        try
+        {
+            results.resize(batch.size());
+            errors.resize(batch.size());
+        }
+        catch (...)
+        {
+            for (auto &current : batch)
+            {
+                Complete(current, nullptr, std::current_exception());
+            }
+
+            return;
+        }
+
+        this->Modify(cache_operation::batch,
+                     [&]
+                     {
+                         for (std::size_t i = 0; i < batch.size(); ++i)
+                         {
+                             ServeLocked(batch[i], results[i], errors[i]);
+                         }
+                     });
+
+        for (std::size_t i = 0; i < batch.size(); ++i)
+        {
+            if (errors[i])
+            {
+                Complete(batch[i], nullptr, errors[i]);
+            }
+            else if (results[i] == nullptr)
+            {
+                Complete(batch[i], nullptr,
+                         std::make_exception_ptr(std::range_error{"No such element in the cache"}));
+            }
+            else
+            {
+                Complete(batch[i], std::move(results[i]), nullptr);
+            }
+        }
+    }
+
+    // must be called with the lock held
+    void ServeLocked(request &current, value_type &result, std::exception_ptr &error) noexcept
+    {
+        try
+        {
+            if (current.kind == request_kind::put)
+            {
+                this->PutLocked(current.key, *current.value);
+                result = this->FindElem(current.key)->second;
+                return;
+            }
+
+            this->NotifyAccess(current.key);
+            const auto found = this->GetInternal(current.key);
+
+            if (found.second)
+            {
+                result = found.first->second;
+            }
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+    }
+
+    static void Complete(request &current, value_type value, std::exception_ptr error) noexcept
+    {
+        if (current.done)
+        {
+            current.done(std::move(value), std::move(error));
+        }
+    }
+
+    void Load(const Key &key, loader_type loader, completion_type done)
+    {
+        {
+            std::lock_guard<std::mutex> lock{queue_op};
+            auto &waiters = loading[key];
+
+            waiters.push_back(std::move(done));
+
+            if (waiters.size() > 1)
+            {
+                return;
+            }
+
+            ++outstanding;
+        }
+
+        executor(
+            [this, key, loader]
+            {
+                try
+                {
+                    const auto value = loader(key);
+
+                    PutAsync(key, value,
+                             [this, key](value_type stored, std::exception_ptr error)
+                             { Complete(key, std::move(stored), error); });
+                }
+                catch (...)
+                {
+                    Complete(key, nullptr, std::current_exception());
+                }
+
+                Finish();
+            });
+    }
+
+    void Complete(const Key &key, value_type value, std::exception_ptr error)
+    {
+        std::vector<completion_type> waiters;
+
+        {
+            std::lock_guard<std::mutex> lock{queue_op};
+            auto loading_it = loading.find(key);
+
+            waiters.swap(loading_it->second);
+            loading.erase(loading_it);
+        }
+
+        for (auto &waiter : waiters)
+        {
+            waiter(value, error);
+        }
+    }
+
+    void Finish()
+    {
+        std::lock_guard<std::mutex> lock{queue_op};
+
+        if (--outstanding == 0)
+        {
+            idle.notify_all();
+        }
+    }
+
+    std::unique_ptr<thread_executor> own_executor;
+    executor_type executor;
+    std::mutex queue_op;
+    std::condition_variable idle;
+    std::vector<request> pending;
+    std::unordered_map<Key, std::vector<completion_type>> loading;
+    bool draining = false;
+    // scheduled batches and running loaders
+    std::size_t outstanding = 0;
+};
+} // namespace caches
+
+#endif // ASYNC_CACHE_HPP
@@ -6,44 +6,262 @@
 #define CACHE_HPP
 
 #include "cache_policy.hpp"
+#include "erase_listener.hpp"
+#include "lock_profiler.hpp"
+#include "memory_accounting.hpp"
 
 #include <algorithm>
 #include <cstddef>
+#include <deque>
 #include <functional>
 #include <limits>
 #include <memory>
 #include <mutex>
 #include <stdexcept>
+#include <type_traits>
+#include <thread>
 #include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if __cplusplus >= 201402L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201402L)
+#include <shared_mutex>
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
 
 namespace caches
 {
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+/**
+ * \brief Reader-writer lock of caches that serve lookups under a shared lock
+ * \details `std::shared_mutex` since C++17, `std::shared_timed_mutex` in C++14. C++11 has no
+ * reader-writer lock, so lookups take an exclusive `std::mutex` there
+ */
+using shared_mutex_type = std::shared_mutex;
+using shared_read_guard = std::shared_lock<shared_mutex_type>;
+#elif __cplusplus >= 201402L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201402L)
+using shared_mutex_type = std::shared_timed_mutex;
+using shared_read_guard = std::shared_lock<shared_mutex_type>;
+#else
+using shared_mutex_type = std::mutex;
+using shared_read_guard = std::lock_guard<shared_mutex_type>;
+#endif
+
+/**
+ * \brief Ask the CPU to bring the memory at the given address into its caches
+ * \details A hint only: it never faults and does nothing on compilers without prefetch intrinsics
+ */
+inline void PrefetchForRead(const void *address) noexcept
+{
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(address, 0, 3);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_prefetch(static_cast<const char *>(address), _MM_HINT_T0);
+#else
+    (void)address;
+#endif
+}
+
+/**
+ * \brief Check whether a hash map exposes its buckets through local iterators
+ */
+template <typename Map, typename = void>
+struct has_local_iterators : std::false_type
+{
+};
+
+template <typename Map>
+struct has_local_iterators<
+    Map, decltype(void(std::declval<const Map &>().begin(std::declval<std::size_t>())))>
+    : std::true_type
+{
+};
+
 /**
  * \brief Wrapper over the given value type to allow safe returning of a value from the cache
  */
 template <typename V>
 using WrappedValue = std::shared_ptr<V>;
 
+/**
+ * \brief Default value storage that keeps every value in its own heap allocation
+ * \details Value storage is responsible for wrapping values put into the cache and may ask the
+ * cache to evict particular keys before a new value can be stored (see `EvictionCandidate`).
+ * This implementation never requests evictions and allocates every value together with its
+ * reference count, as `std::make_shared` does.
+ *
+ * A storage may keep values in another form than `WrappedValue<Value>` (e.g. compressed, see
+ * compressed_value_storage). Then the hash map of the cache maps keys to that form and the
+ * storage provides `WrappedValue<Value> Load(const stored &value, bool promote) const`, which
+ * the cache calls without its lock held to turn the stored form into a value. Such a storage may
+ * also limit the bytes it keeps with `bool NeedsRoom(const stored &value) const`: the cache
+ * evicts elements by its policy while it returns `true` for a value that is being put
+ * \tparam Key Type of a key
+ * \tparam Value Type of a value stored in the cache
+ */
+template <typename Key, typename Value>
+class heap_value_storage
+{
+  public:
+    using value_type = WrappedValue<Value>;
+
+    static constexpr bool touch_is_noop = true;
+
+    /**
+     * \brief Wrap the given value for storing in the cache
+     * \param[in] value Value to store
+     * \return Wrapped copy of the value
+     */
+    value_type Create(const Value &value)
+    {
+        const auto measured_before = measured_bytes();
+        auto wrapped = std::allocate_shared<Value>(measuring_allocator<Value>{}, value);
+
+        element_bytes = measured_bytes() - measured_before;
+
+        return wrapped;
+    }
+
+    /**
+     * \brief Bytes taken by a stored value with its reference count (0 until a value is created)
+     */
+    std::size_t ElementBytes() const noexcept
+    {
+        return element_bytes;
+    }
+
+    /**
+     * \brief Return a key that has to be evicted before the given value can be stored
+     * \param[in] value Value that is going to be stored
+     * \return Pointer to the key to evict or `nullptr` if there is enough room for the value
+     */
+    const Key *EvictionCandidate(const Value &value) const noexcept
+    {
+        (void)value;
+        return nullptr;
+    }
+
+    /**
+     * \brief Handle insertion of a wrapped value into the cache
+     */
+    void OnInsert(const Key &key, const value_type &value) noexcept
+    {
+        (void)key;
+        (void)value;
+    }
+
+    /**
+     * \brief Handle access to a stored value
+     */
+    void OnTouch(const Key &key, const value_type &value) noexcept
+    {
+        (void)key;
+        (void)value;
+    }
+
+    /**
+     * \brief Handle deletion of a stored value from the cache
+     */
+    void OnErase(const Key &key, const value_type &value) noexcept
+    {
+        (void)key;
+        (void)value;
+    }
+
+    /**
+     * \brief Handle detaching of all elements by InvalidateAll or Clear
+     * \details Called under the same lock acquisition as the detaching. The detached values are
+     * erased one by one later (see OnErase), when they are reclaimed
+     */
+    void OnDetach() noexcept
+    {
+    }
+
+  private:
+    std::size_t element_bytes = 0;
+};
+
+/**
+ * \brief Check whether a value storage limits the bytes it keeps (see heap_value_storage)
+ */
+template <typename Storage, typename Stored, typename = void>
+struct has_byte_budget : std::false_type
+{
+};
+
+template <typename Storage, typename Stored>
+struct has_byte_budget<Storage, Stored,
+                       decltype(void(std::declval<const Storage &>().NeedsRoom(
+                           std::declval<const Stored &>())))> : std::true_type
+{
+};
+
+/**
+ * \brief Observer of lookups performed on a cache
+ * \details Observers are called while the cache operation is in progress, so implementations
+ * should keep the work done for every access minimal (e.g. by sampling). Caches with shared
+ * lookups (see has_noop_touch) call observers from several threads at once
+ * \tparam Key Type of a key
+ */
+template <typename Key>
+class IAccessObserver
+{
+  public:
+    virtual ~IAccessObserver() = default;
+
+    /**
+     * \brief Handle lookup of the given key
+     * \param[in] key Key that has been looked up
+     */
+    virtual void OnAccess(const Key &key) noexcept = 0;
+};
+
 /**
  * \brief Fixed sized cache that can be used with different policy types (e.g. LRU, FIFO, LFU)
  * \tparam Key Type of a key (should be hashable)
  * \tparam Value Type of a value stored in the cache
  * \tparam Policy Type of a policy to be used with the cache
  * \tparam HashMap Type of a hashmap to use for cache operations. Should have `std::unordered_map`
- * compatible interface
+ * compatible interface and map keys to the values in the form kept by the value storage
+ * \tparam ValueStorage Type of a value storage that wraps values put into the cache (see
+ * heap_value_storage for the required interface)
+ * \tparam OnErase Type of a listener to notify about erased elements. Notifications are delivered
+ * after the cache lock is released (see erase_notifier). Use no_erase_callback to avoid any
+ * notification overhead
  */
 template <typename Key, typename Value, template <typename> class Policy = NoCachePolicy,
-          typename HashMap = std::unordered_map<Key, WrappedValue<Value>>>
+          typename HashMap = counted_unordered_map<Key, WrappedValue<Value>>,
+          typename ValueStorage = heap_value_storage<Key, Value>,
+          typename OnErase = std::function<void(const Key &, const WrappedValue<Value> &)>>
 class fixed_sized_cache
 {
   public:
     using map_type = HashMap;
-    using value_type = typename map_type::mapped_type;
+    using value_type = WrappedValue<Value>;
+    /// Form in which the value storage keeps the values, `value_type` unless they are loaded
+    using stored_type = typename map_type::mapped_type;
     using iterator = typename map_type::iterator;
     using const_iterator = typename map_type::const_iterator;
-    using operation_guard = typename std::lock_guard<std::mutex>;
-    using on_erase_cb =
-        typename std::function<void(const Key &key, const value_type &value)>;
+    using on_erase_cb = OnErase;
+
+    /// Values are kept in another form and loaded by the value storage without the lock held
+    static constexpr bool loads_values = !std::is_same<stored_type, value_type>::value;
+
+    /// Lookups don't modify the cache and run concurrently under a shared lock
+    static constexpr bool shared_lookups =
+        has_noop_touch<Policy<Key>>::value && has_noop_touch<ValueStorage>::value;
+
+    using mutex_type =
+        typename std::conditional<shared_lookups, shared_mutex_type, std::mutex>::type;
+    using operation_guard = typename std::lock_guard<mutex_type>;
+    using read_guard =
+        typename std::conditional<shared_lookups, shared_read_guard, operation_guard>::type;
+    /// Lock guards that record the lock wait and hold times if lock profiling is enabled
+    using profiled_operation_guard = profiled_lock<operation_guard, cache_lock_profile>;
+    using profiled_read_guard = profiled_lock<read_guard, cache_lock_profile>;
 
     /**
      * \brief Fixed sized cache constructor
@@ -51,21 +269,60 @@ class fixed_sized_cache
      * \param[in] max_size Maximum size of the cache
      * \param[in] policy Cache policy to use
      * \param[in] on_erase on_erase_cb function to be called when cache's element get erased
+     * \param[in] storage Value storage to use
      */
-    explicit fixed_sized_cache(
-        size_t max_size, const Policy<Key> policy = Policy<Key>{},
-        on_erase_cb on_erase = [](const Key &, const value_type &) {})
-        : cache_policy{policy}, max_cache_size{max_size}, on_erase_callback{on_erase}
+    explicit fixed_sized_cache(size_t max_size, const Policy<Key> policy = Policy<Key>{},
+                               on_erase_cb on_erase = on_erase_cb{},
+                               ValueStorage storage = ValueStorage{})
+        : cache_policy{policy}, policy_prototype{policy}, max_cache_size{max_size},
+          notifier{std::move(on_erase)}, value_storage{std::move(storage)}
     {
         if (max_cache_size == 0)
         {
             throw std::invalid_argument{"Size of the cache should be non-zero"};
         }
+
+        cache_items_map = MakeEmptyMap();
+        CountPolicyMemory(cache_policy, has_memory_counting<Policy<Key>>{});
+        CountPolicyMemory(policy_prototype, has_memory_counting<Policy<Key>>{});
     }
 
+    /**
+     * \brief Destroy the cache
+     * \details The remaining elements are reported to the erase listener with erase_cause::cleared
+     * and the detached ones with the cause of their invalidation, so only listeners that accept
+     * the cause argument are called. The elements are not walked at all if neither the listener
+     * nor the value storage needs to see them
+     */
     ~fixed_sized_cache() noexcept
     {
-        Clear();
+        if (!notifier.Wants(erase_cause::cleared) && !notifier.Wants(erase_cause::invalidated) &&
+            std::is_same<ValueStorage, heap_value_storage<Key, Value>>::value)
+        {
+            return;
+        }
+
+        // nobody can access the cache anymore, so the policy is destroyed as a whole instead of
+        // erasing the keys one by one
+        notification_batch notifications;
+
+        for (const auto &elem : cache_items_map)
+        {
+            value_storage.OnErase(elem.first, elem.second);
+            notifier.Record(elem.first, elem.second, erase_cause::cleared);
+        }
+
+        for (const auto &generation : detached)
+        {
+            for (const auto &elem : generation.items)
+            {
+                value_storage.OnErase(elem.first, elem.second);
+                notifier.Record(elem.first, elem.second, generation.cause);
+            }
+        }
+
+        notifier.Take(notifications);
+        DeliverLoaded(notifications);
     }
 
     /**
@@ -75,26 +332,23 @@ class fixed_sized_cache
      */
     void Put(const Key &key, const Value &value) noexcept
     {
-        operation_guard lock{safe_op};
-        auto elem_it = FindElem(key);
+        bool pinned = false;
 
-        if (elem_it == cache_items_map.end())
+        // the memory of the evicted values is freed by delivering their notifications, unless the
+        // users still hold them, every round evicts at least one element
+        do
         {
-            // add new element to the cache
-            if (cache_items_map.size() + 1 > max_cache_size)
-            {
-                auto disp_candidate_key = cache_policy.ReplCandidate();
-
-                Erase(disp_candidate_key);
-            }
+            Modify(cache_operation::put,
+                   [&]
+                   {
+                       pinned = !MakeRoom(key, value);
 
-            Insert(key, value);
-        }
-        else
-        {
-            // update previous value
-            Update(key, value);
-        }
+                       if (!pinned)
+                       {
+                           PutLocked(key, value);
+                       }
+                   });
+        } while (pinned);
     }
 
     /**
@@ -105,13 +359,24 @@ class fixed_sized_cache
      * the element is not presented in the cache. If pair's boolean value is true,
      * returned iterator can be used to get access to the element
      */
-    std::pair<value_type, bool> TryGet(const Key &key) const noexcept
+    std::pair<value_type, bool> TryGet(const Key &key) const noexcept(!loads_values)
     {
-        operation_guard lock{safe_op};
-        const auto result = GetInternal(key);
+        stored_type stored;
 
-        return std::make_pair(result.second ? result.first->second : nullptr,
-                              result.second);
+        {
+            profiled_read_guard lock{safe_op, lock_profile, cache_operation::lookup};
+            NotifyAccess(key);
+            const auto result = GetInternal(key);
+
+            if (!result.second)
+            {
+                return std::make_pair(nullptr, false);
+            }
+
+            stored = result.first->second;
+        }
+
+        return std::make_pair(LoadValue(std::move(stored), true), true);
     }
 
     /**
@@ -124,17 +389,22 @@ class fixed_sized_cache
      */
     value_type Get(const Key &key) const
     {
-        operation_guard lock{safe_op};
-        auto elem = GetInternal(key);
+        stored_type stored;
 
-        if (elem.second)
         {
-            return elem.first->second;
-        }
-        else
-        {
-            throw std::range_error{"No such element in the cache"};
+            profiled_read_guard lock{safe_op, lock_profile, cache_operation::lookup};
+            NotifyAccess(key);
+            auto elem = GetInternal(key);
+
+            if (!elem.second)
+            {
+                throw std::range_error{"No such element in the cache"};
+            }
+
+            stored = elem.first->second;
         }
+
+        return LoadValue(std::move(stored), true);
     }
 
     /**
@@ -145,17 +415,52 @@ class fixed_sized_cache
      */
     bool Cached(const Key &key) const noexcept
     {
-        operation_guard lock{safe_op};
+        profiled_read_guard lock{safe_op, lock_profile, cache_operation::contains};
         return FindElem(key) != cache_items_map.cend();
     }
 
+    /**
+     * \brief Hint that the element with the given key is going to be looked up soon
+     * \details Finds the element without touching the policy or notifying the access observer
+     * and prefetches its value, so the following lookup finds the hash map entry and the value
+     * in the CPU caches. The hint is taken under the lookup lock (shared if lookups are shared):
+     * the hash map can't be probed while it's being modified
+     * \param[in] key Key of the element to prefetch
+     */
+    void Prefetch(const Key &key) const noexcept
+    {
+        profiled_read_guard lock{safe_op, lock_profile, cache_operation::prefetch};
+
+        PrefetchLocked(key);
+    }
+
+    /**
+     * \brief Hint that the elements with the given keys are going to be looked up soon
+     * \details Same as `Prefetch(key)` for every key, but the lock is taken once and the keys
+     * are probed in groups: with hash maps that expose their buckets (e.g. `std::unordered_map`)
+     * the first entries of all buckets of a group are prefetched before any of them is searched,
+     * so the memory accesses of the group overlap instead of waiting for each other
+     * \param[in] first Iterator to the first key
+     * \param[in] last Iterator past the last key
+     */
+    template <typename InputIt>
+    void Prefetch(InputIt first, InputIt last) const
+    {
+        profiled_read_guard lock{safe_op, lock_profile, cache_operation::prefetch};
+
+        while (first != last)
+        {
+            first = PrefetchGroup(first, last, has_local_iterators<map_type>{});
+        }
+    }
+
     /**
      * \brief Get number of elements in cache
      * \return Number of elements currently stored in the cache
      */
     std::size_t Size() const
     {
-        operation_guard lock{safe_op};
+        profiled_read_guard lock{safe_op, lock_profile, cache_operation::size};
 
         return cache_items_map.size();
     }
@@ -168,29 +473,384 @@ class fixed_sized_cache
      */
     bool Remove(const Key &key)
     {
-        operation_guard lock{safe_op};
+        notification_batch notifications;
+        bool sampled;
 
-        auto elem = FindElem(key);
-
-        if (elem == cache_items_map.end())
         {
-            return false;
+            profiled_operation_guard lock{safe_op, lock_profile, cache_operation::remove};
+
+            auto elem = FindElem(key);
+
+            if (elem == cache_items_map.end())
+            {
+                return false;
+            }
+
+            Erase(elem, erase_cause::removed);
+            notifier.Take(notifications);
+            sampled = lock.Sampled();
         }
 
-        Erase(elem);
+        Deliver(notifications, cache_operation::remove, sampled);
 
         return true;
     }
 
+    /**
+     * \brief Get maximum number of elements the cache can hold
+     */
+    std::size_t MaxSize() const
+    {
+        profiled_read_guard lock{safe_op, lock_profile, cache_operation::size};
+
+        return max_cache_size;
+    }
+
+    /**
+     * \brief Get memory taken by the cache
+     * \details The hash map and the policy count their allocations exactly when they allocate
+     * with counting_allocator (as the default hash map and the policies of the library do),
+     * otherwise their usage is reported as 0. Values are counted with their reference counts if
+     * the value storage reports the size of its elements (see heap_value_storage::ElementBytes).
+     * Elements invalidated by InvalidateAll are counted until they are reclaimed
+     */
+    memory_usage MemoryUsage() const
+    {
+        profiled_read_guard lock{safe_op, lock_profile, cache_operation::size};
+        memory_usage usage;
+        auto elements = cache_items_map.size();
+
+        for (const auto &generation : detached)
+        {
+            elements += generation.items.size();
+        }
+
+        usage.index = index_bytes;
+        usage.policy = policy_bytes;
+        usage.values = elements * ElementBytes(has_element_bytes<ValueStorage>{});
+
+        return usage;
+    }
+
+    /**
+     * \brief Get memory taken by the cache, including the memory owned by the values
+     * \details Same as MemoryUsage(), plus the sizes reported by `value_sizer` for every element
+     * in the cache (e.g. the capacity of a string). The cache is walked in chunks (see NextChunk),
+     * so the call takes time proportional to the number of elements without blocking the cache
+     * for long. The sizer is called with the lock held. Not available for caches that load their
+     * values: the value storage accounts for the bytes of the stored form in ElementBytes
+     * \throw std::invalid_argument
+     * \param[in] value_sizer Callable with `(const Value &)` returning the number of heap bytes
+     * owned by the value
+     * \param[in] chunk_size Approximate number of elements sized under a single lock acquisition
+     */
+    template <typename ValueSizer>
+    memory_usage MemoryUsage(ValueSizer &&value_sizer, std::size_t chunk_size = 1024) const
+    {
+        static_assert(!loads_values, "Values of the cache are not kept in memory as they are");
+
+        if (chunk_size == 0)
+        {
+            throw std::invalid_argument{"Size of the chunk should be non-zero"};
+        }
+
+        auto usage = MemoryUsage();
+        cursor position;
+
+        while (!position.Finished())
+        {
+            profiled_read_guard lock{safe_op, lock_profile, cache_operation::walk};
+
+            Advance(position, chunk_size,
+                    [&](const std::pair<const Key, stored_type> &elem)
+                    { usage.values += value_sizer(*elem.second); });
+        }
+
+        return usage;
+    }
+
+    /**
+     * \brief Change maximum size of the cache
+     * \details Growing takes effect immediately. When the cache shrinks, the new limit applies to
+     * all following operations at once, while the elements above the limit are evicted according
+     * to the policy in batches of at most `batch_size` elements. The lock is released between
+     * batches, so concurrent operations proceed while a large cache is being shrunk
+     * \throw std::invalid_argument
+     * \param[in] max_size New maximum size of the cache
+     * \param[in] batch_size Maximum number of elements evicted under a single lock acquisition
+     */
+    void SetMaxSize(std::size_t max_size, std::size_t batch_size = 1024)
+    {
+        if (max_size == 0 || batch_size == 0)
+        {
+            throw std::invalid_argument{"Size of the cache and eviction batch should be non-zero"};
+        }
+
+        {
+            profiled_operation_guard lock{safe_op, lock_profile, cache_operation::resize};
+
+            max_cache_size = max_size;
+        }
+
+        for (;;)
+        {
+            notification_batch notifications;
+            bool overflow;
+            bool sampled;
+
+            {
+                profiled_operation_guard lock{safe_op, lock_profile, cache_operation::resize};
+
+                for (std::size_t i = 0; i < batch_size && cache_items_map.size() > max_cache_size;
+                     ++i)
+                {
+                    Erase(cache_policy.ReplCandidate());
+                }
+
+                overflow = cache_items_map.size() > max_cache_size;
+                notifier.Take(notifications);
+                sampled = lock.Sampled();
+            }
+
+            Deliver(notifications, cache_operation::resize, sampled);
+
+            if (!overflow)
+            {
+                break;
+            }
+
+            std::this_thread::yield();
+        }
+    }
+
+    /**
+     * \brief Position of a chunked walk over the cache (see NextChunk)
+     */
+    class cursor
+    {
+      public:
+        /**
+         * \brief Check whether the walk has visited the whole cache
+         */
+        bool Finished() const noexcept
+        {
+            return finished;
+        }
+
+      private:
+        friend class fixed_sized_cache;
+
+        std::size_t bucket = 0;
+        std::size_t bucket_count = 0;
+        bool finished = false;
+    };
+
+    /**
+     * \brief Copy the next chunk of elements of a walk over the cache
+     * \details Only a single chunk is copied under the lock, so a walk over a large cache doesn't
+     * block other operations for long. The walk is weakly consistent: every element that stays in
+     * the cache during the whole walk is returned, elements put or erased concurrently may or may
+     * not be. An element is returned only once, unless the cache grows during the walk and its map
+     * is rehashed, which restarts the walk. Values that are kept in another form are loaded after
+     * the lock is released
+     * \throw std::invalid_argument
+     * \param[in,out] position Position of the walk, the walk is over when it's Finished()
+     * \param[in] chunk_size Approximate number of elements to copy
+     * \return Keys and values of the chunk
+     */
+    std::vector<std::pair<Key, value_type>> NextChunk(cursor &position,
+                                                      std::size_t chunk_size = 1024) const
+    {
+        if (chunk_size == 0)
+        {
+            throw std::invalid_argument{"Size of the chunk should be non-zero"};
+        }
+
+        std::vector<std::pair<Key, stored_type>> chunk;
+
+        {
+            profiled_read_guard lock{safe_op, lock_profile, cache_operation::walk};
+
+            chunk.reserve(std::min(chunk_size, cache_items_map.size()));
+            Advance(position, chunk_size, [&chunk](const std::pair<const Key, stored_type> &elem)
+                    { chunk.push_back(elem); });
+        }
+
+        return LoadChunk(std::move(chunk));
+    }
+
+    /**
+     * \brief Call the visitor for every element of the cache
+     * \details Elements are copied in chunks (see NextChunk) and the visitor is called without the
+     * lock held, so it may access the cache
+     * \throw std::invalid_argument
+     * \param[in] visitor Callable with `(const Key &, const value_type &)`
+     * \param[in] chunk_size Approximate number of elements copied under a single lock acquisition
+     */
+    template <typename Visitor>
+    void ForEach(Visitor visitor, std::size_t chunk_size = 1024) const
+    {
+        for (cursor position; !position.Finished();)
+        {
+            for (const auto &elem : NextChunk(position, chunk_size))
+            {
+                visitor(elem.first, elem.second);
+            }
+        }
+    }
+
+    /**
+     * \brief Invalidate all elements of the cache in constant time
+     * \details The elements and the policy state are detached from the cache at once, so they read
+     * as misses immediately and the cache can be filled again. Detached elements are reclaimed
+     * later: a few of them by every insertion of a new element, or in batches by
+     * ReclaimInvalidated (e.g. called from a background thread). Erase notifications with
+     * erase_cause::invalidated are delivered when the elements are reclaimed.
+     *
+     * The policy is moved out of the cache, so it should be cheaply movable (as all policies of
+     * the library are)
+     */
+    void InvalidateAll()
+    {
+        profiled_operation_guard lock{safe_op, lock_profile, cache_operation::invalidate};
+
+        Detach(erase_cause::invalidated);
+    }
+
+    /**
+     * \brief Invalidate the elements that satisfy the given predicate
+     * \details The cache is scanned in chunks of at most about `batch_size` elements and the lock
+     * is released between chunks, so concurrent operations proceed while a large cache is being
+     * scanned. Every element that stays in the cache during the whole call and satisfies the
+     * predicate is erased, elements put concurrently may be skipped. The predicate is called with
+     * the lock held, so it must not access the cache. Values kept in another form are loaded for
+     * the predicate with the lock held as well
+     * \throw std::invalid_argument
+     * \param[in] predicate Callable with `(const Key &, const value_type &)` that returns `true`
+     * for the elements to invalidate
+     * \param[in] batch_size Number of elements checked under a single lock acquisition
+     * \return Number of invalidated elements
+     */
+    template <typename Predicate>
+    std::size_t InvalidateIf(Predicate predicate, std::size_t batch_size = 1024)
+    {
+        if (batch_size == 0)
+        {
+            throw std::invalid_argument{"Size of the invalidation batch should be non-zero"};
+        }
+
+        std::size_t invalidated = 0;
+        std::vector<Key> matched;
+
+        for (cursor position; !position.Finished();)
+        {
+            Modify(
+                cache_operation::invalidate,
+                [&]
+                {
+                    Advance(position, batch_size,
+                            [&](const std::pair<const Key, stored_type> &elem)
+                            {
+                                if (predicate(elem.first, LoadValue(elem.second, false)))
+                                {
+                                    matched.push_back(elem.first);
+                                }
+                            });
+
+                    for (const auto &key : matched)
+                    {
+                        Erase(key, erase_cause::invalidated);
+                    }
+                });
+
+            invalidated += matched.size();
+            matched.clear();
+            std::this_thread::yield();
+        }
+
+        return invalidated;
+    }
+
+    /**
+     * \brief Reclaim all elements detached by InvalidateAll
+     * \details Elements are reclaimed in batches of at most `batch_size` elements and the lock is
+     * released between batches
+     * \throw std::invalid_argument
+     * \param[in] batch_size Maximum number of elements reclaimed under a single lock acquisition
+     * \return Number of reclaimed elements
+     */
+    std::size_t ReclaimInvalidated(std::size_t batch_size = 1024)
+    {
+        if (batch_size == 0)
+        {
+            throw std::invalid_argument{"Size of the reclamation batch should be non-zero"};
+        }
+
+        std::size_t reclaimed = 0;
+
+        for (;;)
+        {
+            notification_batch notifications;
+            bool pending;
+            bool sampled;
+
+            {
+                profiled_operation_guard lock{safe_op, lock_profile, cache_operation::reclaim};
+
+                reclaimed += ReclaimDetached(batch_size);
+                pending = !detached.empty();
+                notifier.Take(notifications);
+                sampled = lock.Sampled();
+            }
+
+            Deliver(notifications, cache_operation::reclaim, sampled);
+
+            if (!pending)
+            {
+                return reclaimed;
+            }
+
+            std::this_thread::yield();
+        }
+    }
+
+    /**
+     * \brief Attach an observer that is notified about every lookup (Get/TryGet)
+     * \param[in] observer Observer to attach or `nullptr` to detach the current one
+     */
+    void SetAccessObserver(std::shared_ptr<IAccessObserver<Key>> observer)
+    {
+        profiled_operation_guard lock{safe_op, lock_profile, cache_operation::configure};
+
+        access_observer = std::move(observer);
+    }
+
+    /**
+     * \brief Get the lock profile of the cache
+     * \details If `CACHES_PROFILE_LOCKS` is defined, every public operation samples the time spent
+     * waiting for the cache lock, holding it and delivering erase notifications into latency
+     * histograms per operation (see lock_profiler), which are written out by
+     * `LockProfile().Dump(stream)`. Otherwise the profile is a no_lock_profile, the operations
+     * take the lock without any instrumentation and the dump is empty
+     */
+    cache_lock_profile &LockProfile() const noexcept
+    {
+        return lock_profile;
+    }
+
   protected:
+    using notification_batch =
+        typename erase_notifier<Key, value_type, OnErase, stored_type>::batch_type;
+
     void Clear()
     {
-        operation_guard lock{safe_op};
+        {
+            profiled_operation_guard lock{safe_op, lock_profile, cache_operation::invalidate};
+
+            Detach(erase_cause::cleared);
+        }
 
-        std::for_each(begin(), end(),
-                      [&](const std::pair<const Key, value_type> &el)
-                      { cache_policy.Erase(el.first); });
-        cache_items_map.clear();
+        ReclaimInvalidated();
     }
 
     const_iterator begin() const noexcept
@@ -204,30 +864,241 @@ class fixed_sized_cache
     }
 
   protected:
+    /**
+     * \brief Run the given modification with the lock held
+     * \details Erase notifications recorded by the modification are delivered after the lock is
+     * released
+     */
+    template <typename F>
+    void Modify(cache_operation operation, F &&modification)
+    {
+        notification_batch notifications;
+        bool sampled;
+
+        {
+            profiled_operation_guard lock{safe_op, lock_profile, operation};
+
+            modification();
+            notifier.Take(notifications);
+            sampled = lock.Sampled();
+        }
+
+        Deliver(notifications, operation, sampled);
+    }
+
+    // `sampled` is the decision taken by the lock of the operation, so every phase of a sampled
+    // operation is timed; operations without notifications have no notify phase
+    void Deliver(notification_batch &notifications, cache_operation operation, bool sampled)
+    {
+        lock_profile.Time(operation, lock_phase::notify,
+                          sampled && !notifier.Empty(notifications),
+                          [&] { DeliverLoaded(notifications); });
+    }
+
+    void DeliverLoaded(notification_batch &notifications)
+    {
+        notifier.Deliver(notifications,
+                         [this](const stored_type &value) -> decltype(LoadValue(value, false))
+                         { return LoadValue(value, false); });
+    }
+
+    static const value_type &LoadValue(const value_type &value, bool) noexcept
+    {
+        return value;
+    }
+
+    static value_type LoadValue(value_type &&value, bool) noexcept
+    {
+        return std::move(value);
+    }
+
+    // values in another form are loaded by the storage, `promote` tells whether the value has
+    // been looked up (and the storage may keep the loaded value at hand) or only walked over
+    template <typename Stored>
+    value_type LoadValue(const Stored &value, bool promote) const
+    {
+        return value_storage.Load(value, promote);
+    }
+
+    static std::vector<std::pair<Key, value_type>>
+    LoadChunk(std::vector<std::pair<Key, value_type>> &&chunk) noexcept
+    {
+        return std::move(chunk);
+    }
+
+    template <typename Stored>
+    std::vector<std::pair<Key, value_type>>
+    LoadChunk(std::vector<std::pair<Key, Stored>> &&chunk) const
+    {
+        std::vector<std::pair<Key, value_type>> loaded;
+
+        loaded.reserve(chunk.size());
+
+        for (const auto &elem : chunk)
+        {
+            loaded.emplace_back(elem.first, LoadValue(elem.second, false));
+        }
+
+        return loaded;
+    }
+
+    // must be called with the lock held
+    void PutLocked(const Key &key, const Value &value)
+    {
+        auto elem_it = FindElem(key);
+
+        if (elem_it == cache_items_map.end())
+        {
+            // add new element to the cache
+            if (cache_items_map.size() + 1 > max_cache_size)
+            {
+                auto disp_candidate_key = cache_policy.ReplCandidate();
+
+                Erase(disp_candidate_key);
+            }
+
+            Insert(key, value);
+        }
+        else
+        {
+            // update previous value
+            Update(key, value);
+        }
+    }
+
     void Insert(const Key &key, const Value &value)
     {
+        if (!detached.empty())
+        {
+            // the value storage should never see the same key twice
+            ReclaimDetachedKey(key);
+            ReclaimDetached(RECLAIMED_PER_INSERT);
+        }
+
+        auto wrapped = MakeValue(key, value);
+
         cache_policy.Insert(key);
-        cache_items_map.emplace(std::make_pair(key, std::make_shared<Value>(value)));
+        auto elem_it = cache_items_map.emplace(std::make_pair(key, std::move(wrapped))).first;
+        value_storage.OnInsert(elem_it->first, elem_it->second);
     }
 
-    void Erase(const_iterator elem)
+    // returns true if the erased value is held by a pending notification
+    bool Erase(const_iterator elem, erase_cause cause = erase_cause::evicted)
     {
         cache_policy.Erase(elem->first);
-        on_erase_callback(elem->first, elem->second);
+        value_storage.OnErase(elem->first, elem->second);
+        const bool recorded = notifier.Record(elem->first, elem->second, cause);
         cache_items_map.erase(elem);
+
+        return recorded;
     }
 
-    void Erase(const Key &key)
+    void Erase(const Key &key, erase_cause cause = erase_cause::evicted)
     {
         auto elem_it = FindElem(key);
 
-        Erase(elem_it);
+        Erase(elem_it, cause);
     }
 
     void Update(const Key &key, const Value &value)
     {
+        auto wrapped = MakeValue(key, value);
+        auto &stored = cache_items_map[key];
+
         cache_policy.Touch(key);
-        cache_items_map[key] = std::make_shared<Value>(value);
+        value_storage.OnErase(key, stored);
+        std::swap(stored, wrapped);
+        notifier.Record(key, std::move(wrapped), erase_cause::replaced);
+        value_storage.OnInsert(key, stored);
+    }
+
+    stored_type MakeValue(const Key &key, const Value &value)
+    {
+        EvictForValue(key, value);
+
+        auto stored = value_storage.Create(value);
+
+        EvictForBudget(key, stored, has_byte_budget<ValueStorage, stored_type>{});
+
+        return stored;
+    }
+
+    // evict elements by the policy until the storage has room for the stored value, detached
+    // elements go first. The element of the given key stays even if the budget is exceeded
+    void EvictForBudget(const Key &key, const stored_type &stored, std::true_type)
+    {
+        while (value_storage.NeedsRoom(stored))
+        {
+            if (!detached.empty())
+            {
+                ReclaimDetached(1);
+                continue;
+            }
+
+            if (cache_items_map.empty())
+            {
+                return;
+            }
+
+            const Key victim = cache_policy.ReplCandidate();
+
+            if (victim == key)
+            {
+                return;
+            }
+
+            Erase(victim);
+        }
+    }
+
+    void EvictForBudget(const Key &, const stored_type &, std::false_type) noexcept
+    {
+    }
+
+    // must be called with the lock held, evicts the elements that a Put of the value would evict
+    // and returns false if the value storage gets room for the value only once the notifications
+    // about them are delivered
+    bool MakeRoom(const Key &key, const Value &value)
+    {
+        if (cache_items_map.size() + 1 > max_cache_size && FindElem(key) == end())
+        {
+            const bool recorded = Erase(FindElem(cache_policy.ReplCandidate()));
+
+            if (recorded && value_storage.EvictionCandidate(value) != nullptr)
+            {
+                return false;
+            }
+        }
+
+        return EvictForValue(key, value);
+    }
+
+    // let the storage free room for the value (e.g. in the value's size class), returns false if
+    // the room is held by the pending notifications
+    bool EvictForValue(const Key &key, const Value &value)
+    {
+        const Key *victim = value_storage.EvictionCandidate(value);
+
+        while (victim != nullptr && !(*victim == key))
+        {
+            auto elem_it = FindElem(*victim);
+
+            // the storage also tracks the detached elements that are not reclaimed yet
+            if (elem_it == end())
+            {
+                ReclaimDetachedKey(*victim);
+            }
+            else if (Erase(elem_it))
+            {
+                // the value's memory is freed once the notification is delivered, evicting more
+                // elements before that would evict them needlessly
+                return false;
+            }
+
+            victim = value_storage.EvictionCandidate(value);
+        }
+
+        return true;
     }
 
     const_iterator FindElem(const Key &key) const
@@ -235,6 +1106,68 @@ class fixed_sized_cache
         return cache_items_map.find(key);
     }
 
+    void NotifyAccess(const Key &key) const noexcept
+    {
+        if (access_observer)
+        {
+            access_observer->OnAccess(key);
+        }
+    }
+
+    static constexpr std::size_t PREFETCH_GROUP = 16;
+
+    template <typename InputIt>
+    InputIt PrefetchGroup(InputIt first, InputIt last, std::true_type) const
+    {
+        std::size_t buckets[PREFETCH_GROUP];
+        typename map_type::const_local_iterator heads[PREFETCH_GROUP];
+        std::size_t count = 0;
+        auto group_first = first;
+
+        // loads of the bucket heads don't depend on each other, so they are issued together
+        for (; count < PREFETCH_GROUP && first != last; ++count, ++first)
+        {
+            buckets[count] = cache_items_map.bucket(*first);
+            heads[count] = cache_items_map.begin(buckets[count]);
+        }
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            if (heads[i] != cache_items_map.end(buckets[i]))
+            {
+                PrefetchForRead(&*heads[i]);
+            }
+        }
+
+        for (; group_first != first; ++group_first)
+        {
+            PrefetchLocked(*group_first);
+        }
+
+        return first;
+    }
+
+    template <typename InputIt>
+    InputIt PrefetchGroup(InputIt first, InputIt last, std::false_type) const
+    {
+        for (; first != last; ++first)
+        {
+            PrefetchLocked(*first);
+        }
+
+        return first;
+    }
+
+    void PrefetchLocked(const Key &key) const noexcept
+    {
+        auto elem_it = FindElem(key);
+
+        if (elem_it != end() && elem_it->second)
+        {
+            PrefetchForRead(elem_it->second.get());
+        }
+    }
+
     std::pair<const_iterator, bool> GetInternal(const Key &key) const noexcept
     {
         auto elem_it = FindElem(key);
@@ -242,18 +1175,153 @@ class fixed_sized_cache
         if (elem_it != end())
         {
             cache_policy.Touch(key);
+            value_storage.OnTouch(elem_it->first, elem_it->second);
             return {elem_it, true};
         }
 
         return {elem_it, false};
     }
 
+  protected:
+    mutable mutex_type safe_op;
+    mutable cache_lock_profile lock_profile;
+
   private:
+    // elements and policy state invalidated at once, reclaimed incrementally
+    struct detached_generation
+    {
+        map_type items;
+        Policy<Key> policy;
+        erase_cause cause;
+    };
+
+    static constexpr std::size_t RECLAIMED_PER_INSERT = 2;
+
+    // call the visitor for the elements of the buckets following the cursor until about
+    // `chunk_size` elements are visited, must be called with the lock held
+    template <typename F>
+    void Advance(cursor &position, std::size_t chunk_size, F &&visitor) const
+    {
+        // a rehash moves elements between buckets, so the walk starts over. The map doesn't
+        // shrink its buckets, so this happens only while the cache grows
+        if (cache_items_map.bucket_count() != position.bucket_count)
+        {
+            position.bucket_count = cache_items_map.bucket_count();
+            position.bucket = 0;
+        }
+
+        for (std::size_t visited = 0;
+             position.bucket < position.bucket_count && visited < chunk_size; ++position.bucket)
+        {
+            for (auto elem_it = cache_items_map.cbegin(position.bucket);
+                 elem_it != cache_items_map.cend(position.bucket); ++elem_it, ++visited)
+            {
+                visitor(*elem_it);
+            }
+        }
+
+        position.finished = position.bucket == position.bucket_count;
+    }
+
+    template <typename M = map_type>
+    typename std::enable_if<is_counted_map<M>::value, M>::type MakeEmptyMap()
+    {
+        return M(0, typename M::hasher{}, typename M::key_equal{},
+                 typename M::allocator_type{&index_bytes});
+    }
+
+    template <typename M = map_type>
+    typename std::enable_if<!is_counted_map<M>::value, M>::type MakeEmptyMap()
+    {
+        return M{};
+    }
+
+    void CountPolicyMemory(Policy<Key> &policy, std::true_type)
+    {
+        policy.CountMemory(&policy_bytes);
+    }
+
+    void CountPolicyMemory(Policy<Key> &, std::false_type)
+    {
+    }
+
+    std::size_t ElementBytes(std::true_type) const noexcept
+    {
+        return value_storage.ElementBytes();
+    }
+
+    std::size_t ElementBytes(std::false_type) const noexcept
+    {
+        return 0;
+    }
+
+    void Detach(erase_cause cause)
+    {
+        if (cache_items_map.empty())
+        {
+            return;
+        }
+
+        value_storage.OnDetach();
+        detached.push_back(detached_generation{MakeEmptyMap(), policy_prototype, cause});
+
+        auto &generation = detached.back();
+
+        generation.items.swap(cache_items_map);
+        std::swap(generation.policy, cache_policy);
+    }
+
+    // reclaim up to `count` detached elements, oldest generations first
+    std::size_t ReclaimDetached(std::size_t count)
+    {
+        std::size_t reclaimed = 0;
+
+        for (; reclaimed < count && !detached.empty(); ++reclaimed)
+        {
+            Reclaim(detached.begin(), detached.front().items.begin());
+        }
+
+        return reclaimed;
+    }
+
+    void ReclaimDetachedKey(const Key &key)
+    {
+        for (auto generation = detached.begin(); generation != detached.end(); ++generation)
+        {
+            auto elem_it = generation->items.find(key);
+
+            if (elem_it != generation->items.end())
+            {
+                Reclaim(generation, elem_it);
+                return;
+            }
+        }
+    }
+
+    void Reclaim(typename std::deque<detached_generation>::iterator generation, iterator elem)
+    {
+        generation->policy.Erase(elem->first);
+        value_storage.OnErase(elem->first, elem->second);
+        notifier.Record(elem->first, elem->second, generation->cause);
+        generation->items.erase(elem);
+
+        if (generation->items.empty())
+        {
+            detached.erase(generation);
+        }
+    }
+
+    // declared before the containers, which update them until they are destroyed
+    std::size_t index_bytes = 0;
+    std::size_t policy_bytes = 0;
     map_type cache_items_map;
     mutable Policy<Key> cache_policy;
-    mutable std::mutex safe_op;
+    Policy<Key> policy_prototype;
     std::size_t max_cache_size;
-    on_erase_cb on_erase_callback;
+    erase_notifier<Key, value_type, OnErase, stored_type> notifier;
+    mutable ValueStorage value_storage;
+    std::shared_ptr<IAccessObserver<Key>> access_observer;
+    std::deque<detached_generation> detached;
 };
 } // namespace caches
 
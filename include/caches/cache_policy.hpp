@@ -5,6 +5,11 @@
 #ifndef CACHE_POLICY_HPP
 #define CACHE_POLICY_HPP
 
+#include "memory_accounting.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <type_traits>
 #include <unordered_set>
 
 namespace caches
@@ -44,6 +49,23 @@ class ICachePolicy
     virtual const Key &ReplCandidate() const = 0;
 };
 
+/**
+ * \brief Check whether `Touch` of a policy (or `OnTouch` of a value storage) has no side effects
+ * \details Types declare it with a `static constexpr bool touch_is_noop = true` member. Lookups in
+ * caches whose policy and value storage both have it don't modify the cache, so they can run
+ * concurrently under a shared lock
+ * \tparam T Type of a policy or a value storage
+ */
+template <typename T, typename = void>
+struct has_noop_touch : std::false_type
+{
+};
+
+template <typename T>
+struct has_noop_touch<T, typename std::enable_if<T::touch_is_noop>::type> : std::true_type
+{
+};
+
 /**
  * \brief Basic no caching policy class
  * \details Preserve any key provided. Erase procedure can get rid of any added keys
@@ -56,8 +78,14 @@ template <typename Key>
 class NoCachePolicy : public ICachePolicy<Key>
 {
   public:
+    static constexpr bool touch_is_noop = true;
+
     NoCachePolicy() = default;
     ~NoCachePolicy() noexcept override = default;
+    NoCachePolicy(const NoCachePolicy &) = default;
+    NoCachePolicy(NoCachePolicy &&) = default;
+    NoCachePolicy &operator=(const NoCachePolicy &) = default;
+    NoCachePolicy &operator=(NoCachePolicy &&) = default;
 
     void Insert(const Key &key) override
     {
@@ -81,8 +109,21 @@ class NoCachePolicy : public ICachePolicy<Key>
         return *key_storage.cbegin();
     }
 
+    /**
+     * \brief Count the memory of the policy's containers in the given counter
+     * \details Must be called while the policy is empty
+     */
+    void CountMemory(std::size_t *counter)
+    {
+        key_storage = key_storage_type(0, std::hash<Key>{}, std::equal_to<Key>{},
+                                       counting_allocator<Key>{counter});
+    }
+
   private:
-    std::unordered_set<Key> key_storage;
+    using key_storage_type =
+        std::unordered_set<Key, std::hash<Key>, std::equal_to<Key>, counting_allocator<Key>>;
+
+    key_storage_type key_storage;
 };
 } // namespace caches
 
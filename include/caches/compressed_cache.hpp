@@ -0,0 +1,491 @@
+/**
+ * \file
+ * \brief Cache that keeps cold values compressed
+ */
+#ifndef COMPRESSED_CACHE_HPP
+#define COMPRESSED_CACHE_HPP
+
+#include "cache.hpp"
+#include "cache_policy.hpp"
+#include "lz_codec.hpp"
+#include "memory_accounting.hpp"
+#include "value_serializer.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace caches
+{
+/**
+ * \brief Memory statistics of compressed_value_storage
+ */
+struct compressed_cache_stats
+{
+    /// Number of elements in the storage
+    std::size_t entries;
+    /// Number of elements that are kept decompressed
+    std::size_t hot_entries;
+    /// Total size of the serialized values of the elements kept compressed
+    std::size_t raw_bytes;
+    /// Total size of the compressed values
+    std::size_t compressed_bytes;
+    /// Bytes charged against the budget of the storage (see compressed_value_storage)
+    std::size_t bytes;
+
+    /**
+     * \brief Ratio of the serialized size to the compressed size
+     */
+    double Ratio() const noexcept
+    {
+        return compressed_bytes == 0 ? 1.0
+                                     : static_cast<double>(raw_bytes) / compressed_bytes;
+    }
+};
+
+/**
+ * \brief Element of compressed_value_storage
+ * \details An element is either cold and holds the compressed value only, or hot and holds the
+ * decompressed value only (an element that is being demoted holds it until it's compressed).
+ * Its fields are guarded by the mutex of the storage
+ * \tparam Value Type of a value
+ */
+template <typename Value>
+struct compressed_value
+{
+    /// Compressed value of a cold element, shared with the readers that decompress it
+    std::shared_ptr<const std::string> blob;
+    /// Decompressed value of a hot element
+    WrappedValue<Value> decompressed;
+    /// Size of the serialized value
+    std::size_t raw_size = 0;
+    /// Bytes of the element charged against the budget
+    std::size_t bytes = 0;
+    /// Position in the LRU queue of hot elements
+    typename std::list<std::shared_ptr<compressed_value>>::iterator hot_position;
+    /// Element is in the LRU queue of hot elements
+    bool hot = false;
+    /// Element has left the cache, it's not promoted anymore
+    bool erased = false;
+};
+
+/**
+ * \brief Value storage that keeps values compressed with the given codec
+ * \details Every value is serialized and compressed, except for the most recently used `hot_size`
+ * elements (an LRU queue), which are kept decompressed instead, so repeated reads of hot elements
+ * cost about the same as with heap_value_storage. A lookup of a cold element decompresses it
+ * without the cache lock held and promotes it, and the least recently used hot element is
+ * compressed again. A put element starts hot, so it's compressed only when it's demoted.
+ *
+ * The storage charges every element with its compressed (or, while hot, serialized) size and the
+ * allocations of the element and reports the average as ElementBytes. If `max_bytes` is given,
+ * the cache evicts elements by its policy until a new value fits into it (see has_byte_budget),
+ * so the number of elements follows the achieved compression ratio. Heap memory owned by a
+ * decompressed value is estimated by its serialized size.
+ *
+ * Values returned to the caller are shared with the hot elements, so a value stays alive while
+ * it's used even if its element is demoted or evicted. Copies of a storage share its state
+ * \tparam Key Type of a key
+ * \tparam Value Type of a value stored in the cache
+ * \tparam Codec Type of a codec to compress values with (see lz_codec for the required interface)
+ * \tparam Serializer Type that converts values to bytes and back (see value_serializer)
+ */
+template <typename Key, typename Value, typename Codec = lz_codec,
+          typename Serializer = value_serializer<Value>>
+class compressed_value_storage
+{
+  public:
+    using value_type = WrappedValue<Value>;
+    using stored_type = std::shared_ptr<compressed_value<Value>>;
+
+    static constexpr bool touch_is_noop = true;
+
+    /**
+     * \brief Construct the storage
+     * \param[in] hot_size Maximum number of elements kept decompressed
+     * \param[in] max_bytes Maximum number of bytes charged for all elements
+     * \param[in] codec Codec to compress values with
+     */
+    explicit compressed_value_storage(
+        std::size_t hot_size, std::size_t max_bytes = std::numeric_limits<std::size_t>::max(),
+        Codec codec = Codec{})
+        : state{std::make_shared<shared_state>(hot_size, max_bytes, std::move(codec))}
+    {
+    }
+
+    /**
+     * \brief Wrap the given value for storing in the cache
+     * \details The value is kept decompressed if there are hot elements, compressed otherwise
+     */
+    stored_type Create(const Value &value) const
+    {
+        const auto measured_before = measured_bytes();
+        auto stored = std::allocate_shared<compressed_value<Value>>(
+            measuring_allocator<compressed_value<Value>>{});
+        auto &raw = RawBuffer();
+
+        stored->bytes = measured_bytes() - measured_before;
+        Serializer::Serialize(value, raw);
+        stored->raw_size = raw.size();
+
+        if (state->max_hot > 0)
+        {
+            stored->decompressed = std::make_shared<Value>(value);
+        }
+        else
+        {
+            stored->blob = Compress(raw);
+        }
+
+        stored->bytes += Payload(*stored);
+
+        return stored;
+    }
+
+    /**
+     * \brief Get the value of the given element
+     * \details Called without the cache lock held. A cold element is decompressed and, if it has
+     * been looked up, promoted to the hot ones
+     * \throw std::runtime_error
+     * \param[in] stored Element to load
+     * \param[in] promote Whether the element has been looked up
+     */
+    value_type Load(const stored_type &stored, bool promote) const
+    {
+        std::unique_lock<std::mutex> lock{state->safe_op};
+
+        if (stored->decompressed)
+        {
+            auto value = stored->decompressed;
+
+            if (promote && !stored->erased)
+            {
+                MakeHot(stored);
+                Trim(lock);
+            }
+
+            return value;
+        }
+
+        auto blob = stored->blob;
+
+        lock.unlock();
+
+        auto value = Decompress(*blob);
+
+        if (promote && state->max_hot > 0)
+        {
+            lock.lock();
+
+            // promoted by a concurrent lookup in the meantime
+            if (stored->decompressed)
+            {
+                return stored->decompressed;
+            }
+
+            if (!stored->erased)
+            {
+                SetDecompressed(*stored, value);
+                MakeHot(stored);
+                Trim(lock);
+            }
+        }
+
+        return value;
+    }
+
+    std::size_t ElementBytes() const
+    {
+        std::lock_guard<std::mutex> lock{state->safe_op};
+
+        return state->entries == 0 ? 0 : state->bytes / state->entries;
+    }
+
+    /**
+     * \brief Check whether the given element exceeds the budget together with the stored ones
+     */
+    bool NeedsRoom(const stored_type &stored) const
+    {
+        std::lock_guard<std::mutex> lock{state->safe_op};
+
+        return state->bytes + stored->bytes > state->max_bytes;
+    }
+
+    const Key *EvictionCandidate(const Value &value) const noexcept
+    {
+        (void)value;
+        return nullptr;
+    }
+
+    void OnInsert(const Key &key, const stored_type &stored)
+    {
+        (void)key;
+        std::unique_lock<std::mutex> lock{state->safe_op};
+
+        ++state->entries;
+        state->bytes += stored->bytes;
+
+        if (stored->decompressed)
+        {
+            MakeHot(stored);
+            Trim(lock);
+        }
+        else
+        {
+            state->raw_bytes += stored->raw_size;
+            state->compressed_bytes += stored->blob->size();
+        }
+    }
+
+    void OnTouch(const Key &key, const stored_type &stored) noexcept
+    {
+        (void)key;
+        (void)stored;
+    }
+
+    void OnErase(const Key &key, const stored_type &stored) noexcept
+    {
+        (void)key;
+        std::lock_guard<std::mutex> lock{state->safe_op};
+
+        --state->entries;
+        state->bytes -= stored->bytes;
+        stored->erased = true;
+
+        if (stored->hot)
+        {
+            state->hot.erase(stored->hot_position);
+            stored->hot = false;
+        }
+
+        // the value stays with the element, which may still be loaded for a notification
+        if (!stored->decompressed)
+        {
+            state->raw_bytes -= stored->raw_size;
+            state->compressed_bytes -= stored->blob->size();
+        }
+    }
+
+    void OnDetach() noexcept
+    {
+    }
+
+    /**
+     * \brief Get memory statistics of the storage
+     */
+    compressed_cache_stats Stats() const
+    {
+        std::lock_guard<std::mutex> lock{state->safe_op};
+
+        return compressed_cache_stats{state->entries, state->hot.size(), state->raw_bytes,
+                                      state->compressed_bytes, state->bytes};
+    }
+
+  private:
+    struct shared_state
+    {
+        shared_state(std::size_t max_hot, std::size_t max_bytes, Codec codec)
+            : max_hot{max_hot}, max_bytes{max_bytes}, codec{std::move(codec)}
+        {
+        }
+
+        std::mutex safe_op;
+        // most recently used first
+        std::list<stored_type> hot;
+        std::size_t max_hot;
+        std::size_t max_bytes;
+        std::size_t entries = 0;
+        std::size_t bytes = 0;
+        std::size_t raw_bytes = 0;
+        std::size_t compressed_bytes = 0;
+        Codec codec;
+    };
+
+    static std::string &RawBuffer()
+    {
+        static thread_local std::string raw;
+
+        return raw;
+    }
+
+    std::shared_ptr<const std::string> Compress(const std::string &raw) const
+    {
+        static thread_local std::string compressed;
+
+        state->codec.Compress(raw.data(), raw.size(), compressed);
+
+        // the copy doesn't keep the spare capacity of the buffer
+        return std::make_shared<const std::string>(compressed);
+    }
+
+    value_type Decompress(const std::string &blob) const
+    {
+        auto &raw = RawBuffer();
+        auto value = std::make_shared<Value>();
+
+        if (!state->codec.Decompress(blob.data(), blob.size(), raw) ||
+            !Serializer::Deserialize(raw.data(), raw.size(), *value))
+        {
+            throw std::runtime_error{"Unable to decompress the cached value"};
+        }
+
+        return value;
+    }
+
+    // bytes of the compressed or, while decompressed, serialized value
+    static std::size_t Payload(const compressed_value<Value> &stored) noexcept
+    {
+        return stored.decompressed ? stored.raw_size : stored.blob->size();
+    }
+
+    // replace the compressed form of a cold element, must be called with the storage lock held
+    void SetDecompressed(compressed_value<Value> &stored, value_type value) const noexcept
+    {
+        state->raw_bytes -= stored.raw_size;
+        state->compressed_bytes -= stored.blob->size();
+        state->bytes -= stored.bytes;
+        stored.bytes -= Payload(stored);
+        stored.blob.reset();
+        stored.decompressed = std::move(value);
+        stored.bytes += Payload(stored);
+        state->bytes += stored.bytes;
+    }
+
+    // replace the decompressed form of an element, must be called with the storage lock held
+    void SetCompressed(compressed_value<Value> &stored,
+                       std::shared_ptr<const std::string> blob) const noexcept
+    {
+        state->bytes -= stored.bytes;
+        stored.bytes -= Payload(stored);
+        stored.blob = std::move(blob);
+        stored.decompressed.reset();
+        stored.bytes += Payload(stored);
+        state->bytes += stored.bytes;
+        state->raw_bytes += stored.raw_size;
+        state->compressed_bytes += stored.blob->size();
+    }
+
+    // move a decompressed element to the head of the hot ones, must be called with the storage
+    // lock held
+    void MakeHot(const stored_type &stored) const
+    {
+        if (stored->hot)
+        {
+            state->hot.splice(state->hot.begin(), state->hot, stored->hot_position);
+            return;
+        }
+
+        state->hot.push_front(stored);
+        stored->hot_position = state->hot.begin();
+        stored->hot = true;
+    }
+
+    // demote the least recently used hot elements above the limit. Values are compressed with
+    // the storage lock released, so lookups of hot elements don't wait for the compression. A
+    // demotion is dropped if its element is looked up or erased in the meantime
+    void Trim(std::unique_lock<std::mutex> &lock) const
+    {
+        while (state->hot.size() > state->max_hot)
+        {
+            const auto demoted = std::move(state->hot.back());
+            const auto value = demoted->decompressed;
+            auto &raw = RawBuffer();
+
+            state->hot.pop_back();
+            demoted->hot = false;
+            lock.unlock();
+            Serializer::Serialize(*value, raw);
+
+            auto blob = Compress(raw);
+
+            lock.lock();
+
+            if (!demoted->hot && !demoted->erased)
+            {
+                SetCompressed(*demoted, std::move(blob));
+            }
+        }
+    }
+
+    std::shared_ptr<shared_state> state;
+};
+
+/**
+ * \brief Fixed sized cache that stores values compressed with the given codec
+ * \details fixed_sized_cache with compressed_value_storage: the cache keeps the most recently
+ * used `hot_size` elements decompressed and the others compressed, and evicts elements by its
+ * policy when it holds `max_size` elements or when the storage exceeds `max_bytes`. All features
+ * of fixed_sized_cache (erase listeners, invalidation, resizing, walks, lock profiling) work as
+ * usual, the values are decompressed for walks and erase notifications as needed
+ * \tparam Key Type of a key (should be hashable)
+ * \tparam Value Type of a value stored in the cache
+ * \tparam Policy Type of a policy to be used for eviction of elements from the cache
+ * \tparam Codec Type of a codec to compress values with (see lz_codec for the required interface)
+ * \tparam Serializer Type that converts values to bytes and back (see value_serializer)
+ * \tparam OnErase Type of a listener to notify about erased elements (see fixed_sized_cache)
+ */
+template <typename Key, typename Value, template <typename> class Policy = NoCachePolicy,
+          typename Codec = lz_codec, typename Serializer = value_serializer<Value>,
+          typename OnErase = std::function<void(const Key &, const WrappedValue<Value> &)>>
+class compressed_cache
+    : public fixed_sized_cache<
+          Key, Value, Policy,
+          counted_unordered_map<
+              Key, typename compressed_value_storage<Key, Value, Codec, Serializer>::stored_type>,
+          compressed_value_storage<Key, Value, Codec, Serializer>, OnErase>
+{
+    using storage_type = compressed_value_storage<Key, Value, Codec, Serializer>;
+    using base_type =
+        fixed_sized_cache<Key, Value, Policy,
+                          counted_unordered_map<Key, typename storage_type::stored_type>,
+                          storage_type, OnErase>;
+
+  public:
+    using typename base_type::on_erase_cb;
+
+    /**
+     * \brief Construct compressed cache
+     * \throw std::invalid_argument
+     * \param[in] max_size Maximum number of elements in the cache
+     * \param[in] hot_size Maximum number of elements kept decompressed
+     * \param[in] max_bytes Maximum number of bytes charged for the values of the cache
+     * \param[in] policy Cache policy to use
+     * \param[in] on_erase on_erase_cb function to be called when cache's element get erased
+     * \param[in] codec Codec to compress values with
+     */
+    compressed_cache(std::size_t max_size, std::size_t hot_size,
+                     std::size_t max_bytes = std::numeric_limits<std::size_t>::max(),
+                     const Policy<Key> &policy = Policy<Key>{},
+                     on_erase_cb on_erase = on_erase_cb{}, Codec codec = Codec{})
+        : compressed_cache{max_size, policy, std::move(on_erase),
+                           storage_type{hot_size, max_bytes, std::move(codec)}}
+    {
+    }
+
+    /**
+     * \brief Get memory statistics of the cache
+     */
+    compressed_cache_stats Stats() const
+    {
+        return storage.Stats();
+    }
+
+  private:
+    compressed_cache(std::size_t max_size, const Policy<Key> &policy, on_erase_cb on_erase,
+                     storage_type storage)
+        : base_type{max_size, policy, std::move(on_erase), storage}, storage{std::move(storage)}
+    {
+    }
+
+    // shares the state with the storage of the cache
+    storage_type storage;
+};
+} // namespace caches
+
+#endif // COMPRESSED_CACHE_HPP
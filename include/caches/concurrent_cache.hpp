@@ -0,0 +1,303 @@
+/**
+ * \file
+ * \brief Fixed sized cache with lock-free lookups
+ */
+#ifndef CONCURRENT_CACHE_HPP
+#define CONCURRENT_CACHE_HPP
+
+#include "cache.hpp"
+#include "cache_policy.hpp"
+#include "concurrent_hash_index.hpp"
+#include "epoch_reclamation.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+namespace caches
+{
+/**
+ * \brief Fixed sized cache whose lookups take no lock
+ * \details Elements are kept in a concurrent_hash_index, so `Get`/`TryGet` only pin an epoch and
+ * traverse a bucket chain. Writes (`Put`, `Remove`) and all policy maintenance are serialized by
+ * a single mutex. Nodes unlinked by writers are reclaimed through an epoch_domain.
+ *
+ * Hits are reported to the policy asynchronously: a reader records the node it has found in a
+ * small lossy buffer of its stripe, and the buffers are drained into `Policy::Touch` by writers or
+ * by a reader that fills a buffer and finds the writer lock free. Readers never wait for the lock,
+ * at the cost of approximate recency under heavy load. A touch of an element that has been
+ * replaced or erased in the meantime is dropped.
+ * \tparam Key Type of a key (should be hashable)
+ * \tparam Value Type of a value stored in the cache
+ * \tparam Policy Type of a policy to be used with the cache
+ * \tparam Hash Type of a key hasher
+ */
+template <typename Key, typename Value, template <typename> class Policy = NoCachePolicy,
+          typename Hash = std::hash<Key>>
+class concurrent_cache
+{
+  public:
+    using value_type = WrappedValue<Value>;
+    using index_type = concurrent_hash_index<Key, value_type, Hash>;
+    using operation_guard = typename std::lock_guard<std::mutex>;
+
+    /**
+     * \brief Construct cache
+     * \throw std::invalid_argument
+     * \param[in] max_size Maximum size of the cache
+     * \param[in] policy Cache policy to use
+     */
+    explicit concurrent_cache(std::size_t max_size, const Policy<Key> &policy = Policy<Key>{})
+        : cache_policy{policy}, max_cache_size{max_size},
+          index{max_size == 0 ? 1 : max_size}, domain{0}
+    {
+        if (max_cache_size == 0)
+        {
+            throw std::invalid_argument{"Size of the cache should be non-zero"};
+        }
+    }
+
+    /**
+     * \brief Put element into the cache
+     * \param[in] key Key value to use
+     * \param[in] value Value to assign to the given key
+     */
+    void Put(const Key &key, const Value &value)
+    {
+        auto wrapped = std::make_shared<Value>(value);
+        operation_guard lock{safe_op};
+
+        DrainReads();
+
+        if (index.Find(key) == nullptr)
+        {
+            if (size.load(std::memory_order_relaxed) + 1 > max_cache_size)
+            {
+                Retire(index.Erase(cache_policy.ReplCandidate()));
+            }
+
+            cache_policy.Insert(key);
+            size.fetch_add(1, std::memory_order_relaxed);
+            index.InsertOrReplace(key, std::move(wrapped));
+        }
+        else
+        {
+            cache_policy.Touch(key);
+            Retire(index.InsertOrReplace(key, std::move(wrapped)));
+        }
+    }
+
+    /**
+     * \brief Try to get an element by the given key from the cache
+     * \param[in] key Get element by key
+     * \return Pair of the value and boolean value that shows whether it has been found
+     */
+    std::pair<value_type, bool> TryGet(const Key &key) const
+    {
+        epoch_guard guard{domain};
+        const auto *found = Lookup(key);
+
+        return found == nullptr ? std::make_pair(value_type{}, false)
+                                : std::make_pair(found->value, true);
+    }
+
+    /**
+     * \brief Get element from the cache if present
+     * \throw std::range_error
+     * \param[in] key Get element by key
+     */
+    value_type Get(const Key &key) const
+    {
+        auto result = TryGet(key);
+
+        if (!result.second)
+        {
+            throw std::range_error{"No such element in the cache"};
+        }
+
+        return result.first;
+    }
+
+    /**
+     * \brief Start a read section for the guarded read API
+     */
+    epoch_guard Pin() const
+    {
+        return epoch_guard{domain};
+    }
+
+    /**
+     * \brief Try to get an element without taking a reference to it
+     * \param[in] key Get element by key
+     * \param[in] guard Read section the returned pointer is valid in
+     * \return Pointer to the value or `nullptr` if the element is not in the cache
+     */
+    const Value *TryGet(const Key &key, const epoch_guard &guard) const
+    {
+        (void)guard;
+        const auto *found = Lookup(key);
+
+        return found == nullptr ? nullptr : found->value.get();
+    }
+
+    /**
+     * \brief Check whether the given key is presented in the cache
+     */
+    bool Cached(const Key &key) const
+    {
+        epoch_guard guard{domain};
+
+        return index.Find(key) != nullptr;
+    }
+
+    /**
+     * \brief Get number of elements in cache
+     */
+    std::size_t Size() const noexcept
+    {
+        return size.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief Remove an element specified by key
+     * \retval true if an element specified by key was found and deleted
+     * \retval false if an element is not present in a cache
+     */
+    bool Remove(const Key &key)
+    {
+        operation_guard lock{safe_op};
+
+        DrainReads();
+
+        auto *removed = index.Erase(key);
+
+        if (removed == nullptr)
+        {
+            return false;
+        }
+
+        Retire(removed);
+
+        return true;
+    }
+
+  private:
+    using node_type = typename index_type::node;
+
+    static constexpr std::size_t READ_STRIPES = 16;
+    static constexpr std::size_t READ_BUFFER_SIZE = 32;
+    static constexpr std::size_t RETIRED_PER_COLLECT = 64;
+
+    struct read_buffer
+    {
+        std::atomic<std::size_t> writes{0};
+        // position up to which the buffer has been drained, guarded by the writer lock
+        std::size_t drained = 0;
+        std::array<std::atomic<const node_type *>, READ_BUFFER_SIZE> slots{};
+    };
+
+    const node_type *Lookup(const Key &key) const
+    {
+        const auto *found = index.Find(key);
+
+        if (found != nullptr)
+        {
+            RecordRead(found);
+        }
+
+        return found;
+    }
+
+    void RecordRead(const node_type *found) const
+    {
+        static thread_local const std::size_t stripe =
+            std::hash<std::thread::id>{}(std::this_thread::get_id()) % READ_STRIPES;
+        auto &buffer = read_buffers[stripe];
+        const auto position = buffer.writes.fetch_add(1, std::memory_order_relaxed);
+
+        // a full buffer overwrites the oldest touches
+        buffer.slots[position % READ_BUFFER_SIZE].store(found, std::memory_order_release);
+
+        if (position % READ_BUFFER_SIZE == READ_BUFFER_SIZE - 1 && safe_op.try_lock())
+        {
+            DrainReads();
+            safe_op.unlock();
+        }
+    }
+
+    // apply buffered touches to the policy, must be called with the lock held
+    void DrainReads(bool all_slots = false) const
+    {
+        for (auto &buffer : read_buffers)
+        {
+            const auto writes = buffer.writes.load(std::memory_order_acquire);
+
+            if (writes == buffer.drained && !all_slots)
+            {
+                continue;
+            }
+
+            // a reader may still be storing into a slot below `drained`, a full drain picks it up
+            const auto from = all_slots || writes - buffer.drained > READ_BUFFER_SIZE
+                                  ? writes - READ_BUFFER_SIZE
+                                  : buffer.drained;
+
+            buffer.drained = writes;
+
+            for (auto position = from; position != writes; ++position)
+            {
+                auto &slot = buffer.slots[position % READ_BUFFER_SIZE];
+                const auto *touched = slot.exchange(nullptr, std::memory_order_acquire);
+
+                // nodes are not destroyed before the buffers are drained (see Retire)
+                if (touched != nullptr && !touched->unlinked)
+                {
+                    cache_policy.Touch(touched->key);
+                }
+            }
+        }
+    }
+
+    // must be called with the lock held
+    void Retire(node_type *node)
+    {
+        if (node == nullptr)
+        {
+            return;
+        }
+
+        if (node->unlinked && index.Find(node->key) == nullptr)
+        {
+            cache_policy.Erase(node->key);
+            size.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        domain.Retire(std::shared_ptr<const void>{node});
+
+        if (++retired_since_collect == RETIRED_PER_COLLECT)
+        {
+            retired_since_collect = 0;
+            // readers that could reference the destroyed nodes have left their read sections,
+            // so their buffered touches are visible here and can be dropped
+            domain.Collect([this] { DrainReads(true); });
+        }
+    }
+
+    mutable Policy<Key> cache_policy;
+    std::size_t max_cache_size;
+    std::atomic<std::size_t> size{0};
+    index_type index;
+    mutable epoch_domain domain;
+    mutable std::array<read_buffer, READ_STRIPES> read_buffers;
+    std::size_t retired_since_collect = 0;
+    mutable std::mutex safe_op;
+};
+} // namespace caches
+
+#endif // CONCURRENT_CACHE_HPP
@@ -0,0 +1,221 @@
+/**
+ * \file
+ * \brief Hash index with lock-free lookups
+ */
+#ifndef CONCURRENT_HASH_INDEX_HPP
+#define CONCURRENT_HASH_INDEX_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+namespace caches
+{
+/**
+ * \brief Fixed-size chained hash index with lock-free readers and a single writer at a time
+ * \details Buckets are singly linked lists of immutable nodes published with release stores, so
+ * `Find` never blocks and never observes a partially constructed node. Modifications have to be
+ * serialized by the caller. An updated element gets a new node, which replaces the old one in the
+ * chain with a single store. Nodes unlinked by `Erase` and `Replace` are returned to the caller,
+ * which has to delay their destruction until no reader can still traverse them (e.g. with an
+ * epoch_domain).
+ *
+ * The number of buckets is fixed at construction, which suits a cache whose maximum size is
+ * known in advance.
+ * \tparam Key Type of a key
+ * \tparam T Type of a mapped value
+ * \tparam Hash Type of a key hasher
+ */
+template <typename Key, typename T, typename Hash = std::hash<Key>>
+class concurrent_hash_index
+{
+  public:
+    /**
+     * \brief Element of the index
+     */
+    struct node
+    {
+        node(std::size_t hash, const Key &key, T value)
+            : hash{hash}, key{key}, value{std::move(value)}
+        {
+        }
+
+        const std::size_t hash;
+        const Key key;
+        const T value;
+        // set by the writer when the node is unlinked
+        bool unlinked = false;
+
+      private:
+        friend class concurrent_hash_index;
+
+        std::atomic<node *> next{nullptr};
+    };
+
+    /**
+     * \brief Construct index with at least the given number of buckets
+     * \throw std::invalid_argument
+     */
+    explicit concurrent_hash_index(std::size_t buckets, const Hash &hash = Hash{})
+        : hasher{hash}
+    {
+        if (buckets == 0)
+        {
+            throw std::invalid_argument{"Number of buckets should be non-zero"};
+        }
+
+        std::size_t count = 1;
+
+        while (count < buckets)
+        {
+            count <<= 1;
+        }
+
+        mask = count - 1;
+        heads.reset(new std::atomic<node *>[count]);
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            heads[i].store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    concurrent_hash_index(const concurrent_hash_index &) = delete;
+    concurrent_hash_index &operator=(const concurrent_hash_index &) = delete;
+
+    ~concurrent_hash_index()
+    {
+        for (std::size_t i = 0; i <= mask; ++i)
+        {
+            auto *current = heads[i].load(std::memory_order_relaxed);
+
+            while (current != nullptr)
+            {
+                auto *next = current->next.load(std::memory_order_relaxed);
+
+                delete current;
+                current = next;
+            }
+        }
+    }
+
+    /**
+     * \brief Find the node of the given key, safe to call concurrently with a writer
+     * \return Node or `nullptr` if the key is not in the index
+     */
+    const node *Find(const Key &key) const
+    {
+        const auto hash = hasher(key);
+
+        for (auto *current = heads[hash & mask].load(std::memory_order_acquire);
+             current != nullptr; current = current->next.load(std::memory_order_acquire))
+        {
+            if (current->hash == hash && current->key == key)
+            {
+                return current;
+            }
+        }
+
+        return nullptr;
+    }
+
+    /**
+     * \brief Insert the key or replace its value
+     * \return Node that has been replaced or `nullptr` if the key is new
+     */
+    node *InsertOrReplace(const Key &key, T value)
+    {
+        const auto hash = hasher(key);
+        auto *fresh = new node{hash, key, std::move(value)};
+        auto *link = FindLink(hash, key);
+        auto *old = link->load(std::memory_order_relaxed);
+
+        if (old != nullptr)
+        {
+            fresh->next.store(old->next.load(std::memory_order_relaxed),
+                              std::memory_order_relaxed);
+            old->unlinked = true;
+        }
+        else
+        {
+            auto &head = heads[hash & mask];
+
+            fresh->next.store(head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            link = &head;
+        }
+
+        link->store(fresh, std::memory_order_release);
+
+        return old;
+    }
+
+    /**
+     * \brief Unlink the node of the given key
+     * \return Unlinked node or `nullptr` if the key is not in the index
+     */
+    node *Erase(const Key &key)
+    {
+        auto *link = FindLink(hasher(key), key);
+        auto *old = link->load(std::memory_order_relaxed);
+
+        if (old != nullptr)
+        {
+            link->store(old->next.load(std::memory_order_relaxed), std::memory_order_release);
+            old->unlinked = true;
+        }
+
+        return old;
+    }
+
+    /**
+     * \brief Unlink all nodes
+     * \param[in] unlinked Callable taking each unlinked `node *`, which has to retire it
+     */
+    template <typename Unlinked>
+    void Clear(Unlinked &&unlinked)
+    {
+        for (std::size_t i = 0; i <= mask; ++i)
+        {
+            auto *current = heads[i].exchange(nullptr, std::memory_order_acq_rel);
+
+            while (current != nullptr)
+            {
+                auto *next = current->next.load(std::memory_order_relaxed);
+
+                current->unlinked = true;
+                unlinked(current);
+                current = next;
+            }
+        }
+    }
+
+  private:
+    // link pointing to the node of the key, or the null link at the end of the chain
+    std::atomic<node *> *FindLink(std::size_t hash, const Key &key)
+    {
+        auto *link = &heads[hash & mask];
+
+        for (auto *current = link->load(std::memory_order_relaxed); current != nullptr;
+             current = link->load(std::memory_order_relaxed))
+        {
+            if (current->hash == hash && current->key == key)
+            {
+                break;
+            }
+
+            link = &current->next;
+        }
+
+        return link;
+    }
+
+    Hash hasher;
+    std::size_t mask;
+    std::unique_ptr<std::atomic<node *>[]> heads;
+};
+} // namespace caches
+
+#endif // CONCURRENT_HASH_INDEX_HPP
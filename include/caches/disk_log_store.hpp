@@ -0,0 +1,304 @@
+/**
+ * \file
+ * \brief Append-only log-structured on-disk key-value store
+ */
+#ifndef DISK_LOG_STORE_HPP
+#define DISK_LOG_STORE_HPP
+
+#include "cache.hpp"
+#include "value_serializer.hpp"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+namespace caches
+{
+/**
+ * \brief Key-value store that keeps values in a circular append-only log file
+ * \details Values are appended to the log at the tail and located through an in-memory index.
+ * When the log reaches its capacity it wraps around and the oldest records are dropped, so the
+ * store behaves as a FIFO cache bounded by the file size.
+ *
+ * Reads use positional I/O outside of the index lock: a record is looked up, read with `pread`
+ * and validated afterwards, so a concurrent wrap-around that overwrites the record is detected and
+ * reported as a miss. Writes are serialized with each other, but do not block readers either.
+ *
+ * The file is created (truncated) on construction and removed on destruction.
+ * \tparam Key Type of a key
+ * \tparam Value Type of a value
+ * \tparam Serializer Type that converts values to bytes and back (see value_serializer)
+ */
+template <typename Key, typename Value, typename Serializer = value_serializer<Value>>
+class disk_log_store
+{
+  public:
+    using value_type = WrappedValue<Value>;
+
+    /**
+     * \brief Create the log file
+     * \throw std::invalid_argument
+     * \throw std::system_error
+     * \param[in] path Path of the log file
+     * \param[in] capacity Maximum size of the log file in bytes
+     */
+    disk_log_store(std::string path, std::uint64_t capacity)
+        : path{std::move(path)}, capacity{capacity}
+    {
+        if (capacity == 0)
+        {
+            throw std::invalid_argument{"Capacity of the log should be non-zero"};
+        }
+
+        fd = ::open(this->path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+
+        if (fd < 0)
+        {
+            throw std::system_error{errno, std::generic_category(), "Unable to open the log"};
+        }
+    }
+
+    disk_log_store(const disk_log_store &) = delete;
+    disk_log_store &operator=(const disk_log_store &) = delete;
+
+    ~disk_log_store()
+    {
+        ::close(fd);
+        ::unlink(path.c_str());
+    }
+
+    /**
+     * \brief Append the value to the log
+     * \param[in] key Key of the value
+     * \param[in] value Value to store
+     * \retval true The value is stored
+     * \retval false The value does not fit into the log or an I/O error occurred
+     */
+    bool Put(const Key &key, const Value &value)
+    {
+        std::string data;
+
+        Serializer::Serialize(value, data);
+
+        if (data.size() > capacity)
+        {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> write_lock{write_op};
+        std::uint64_t position;
+
+        {
+            std::lock_guard<std::mutex> lock{index_op};
+
+            // an empty value still takes a byte, so every record is eventually dropped by the
+            // wrap-around and the number of records stays bounded by the capacity
+            position = Reserve(data.empty() ? 1 : data.size());
+            // the old record stays in the log until it is overwritten, but can't be found anymore
+            index.erase(key);
+        }
+
+        if (!WriteAll(data.data(), data.size(), position % capacity))
+        {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock{index_op};
+
+        records.push_back(log_record{key, position, data.size()});
+        index[key] = index_entry{position, data.size()};
+
+        return true;
+    }
+
+    /**
+     * \brief Read the value from the log
+     * \param[in] key Key of the value
+     * \return Value or `nullptr` if it's not in the log
+     */
+    value_type Get(const Key &key) const
+    {
+        index_entry entry;
+
+        {
+            std::lock_guard<std::mutex> lock{index_op};
+            auto elem_it = index.find(key);
+
+            if (elem_it == index.end())
+            {
+                return nullptr;
+            }
+
+            entry = elem_it->second;
+        }
+
+        std::unique_ptr<char[]> data{new char[entry.size]};
+
+        if (!ReadAll(data.get(), entry.size, entry.position % capacity))
+        {
+            return nullptr;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock{index_op};
+
+            if (entry.position < head)
+            {
+                // the record has been overwritten while we were reading it
+                return nullptr;
+            }
+        }
+
+        auto value = std::make_shared<Value>();
+
+        return Serializer::Deserialize(data.get(), entry.size, *value) ? value : nullptr;
+    }
+
+    /**
+     * \brief Check whether the given key is in the log
+     */
+    bool Contains(const Key &key) const
+    {
+        std::lock_guard<std::mutex> lock{index_op};
+
+        return index.find(key) != index.end();
+    }
+
+    /**
+     * \brief Remove the value from the log
+     * \retval true The key was in the log
+     * \retval false The key was not found
+     */
+    bool Remove(const Key &key)
+    {
+        std::lock_guard<std::mutex> lock{index_op};
+
+        return index.erase(key) != 0;
+    }
+
+    /**
+     * \brief Number of values in the log
+     */
+    std::size_t Size() const
+    {
+        std::lock_guard<std::mutex> lock{index_op};
+
+        return index.size();
+    }
+
+  private:
+    struct index_entry
+    {
+        std::uint64_t position;
+        std::size_t size;
+    };
+
+    struct log_record
+    {
+        Key key;
+        std::uint64_t position;
+        std::size_t size;
+    };
+
+    // reserve place for a record at the tail, dropping the oldest records it overlaps
+    std::uint64_t Reserve(std::size_t size)
+    {
+        auto position = tail;
+
+        if (position % capacity + size > capacity)
+        {
+            // records never wrap around the end of the file
+            position += capacity - position % capacity;
+        }
+
+        while (!records.empty() && position + size - records.front().position > capacity)
+        {
+            const auto &oldest = records.front();
+            auto elem_it = index.find(oldest.key);
+
+            if (elem_it != index.end() && elem_it->second.position == oldest.position)
+            {
+                index.erase(elem_it);
+            }
+
+            records.pop_front();
+        }
+
+        head = records.empty() ? position : records.front().position;
+        tail = position + size;
+
+        return position;
+    }
+
+    bool WriteAll(const char *data, std::size_t size, std::uint64_t offset) const noexcept
+    {
+        while (size > 0)
+        {
+            const auto written = ::pwrite(fd, data, size, static_cast<off_t>(offset));
+
+            if (written < 0 && errno == EINTR)
+            {
+                continue;
+            }
+
+            if (written <= 0)
+            {
+                return false;
+            }
+
+            data += written;
+            size -= static_cast<std::size_t>(written);
+            offset += static_cast<std::uint64_t>(written);
+        }
+
+        return true;
+    }
+
+    bool ReadAll(char *data, std::size_t size, std::uint64_t offset) const noexcept
+    {
+        while (size > 0)
+        {
+            const auto read = ::pread(fd, data, size, static_cast<off_t>(offset));
+
+            if (read < 0 && errno == EINTR)
+            {
+                continue;
+            }
+
+            if (read <= 0)
+            {
+                return false;
+            }
+
+            data += read;
+            size -= static_cast<std::size_t>(read);
+            offset += static_cast<std::uint64_t>(read);
+        }
+
+        return true;
+    }
+
+    std::string path;
+    std::uint64_t capacity;
+    int fd;
+    std::uint64_t head = 0;
+    std::uint64_t tail = 0;
+    std::deque<log_record> records;
+    std::unordered_map<Key, index_entry> index;
+    mutable std::mutex index_op;
+    std::mutex write_op;
+};
+} // namespace caches
+
+#endif // DISK_LOG_STORE_HPP
@@ -0,0 +1,207 @@
+/**
+ * \file
+ * \brief Cache that hands out values under epoch-based read guards
+ */
+#ifndef EPOCH_CACHE_HPP
+#define EPOCH_CACHE_HPP
+
+#include "cache.hpp"
+#include "cache_policy.hpp"
+#include "concurrent_hash_index.hpp"
+#include "epoch_reclamation.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+namespace caches
+{
+/**
+ * \brief Value storage that retires erased values to an epoch_domain
+ * \details An erased or replaced value is kept alive by the domain until every read guard that
+ * could have seen it is released. Stored values are mirrored in a concurrent_hash_index, so they
+ * can be looked up under a read guard without the cache lock
+ * \tparam Key Type of a key
+ * \tparam Value Type of a value stored in the cache
+ */
+template <typename Key, typename Value>
+class epoch_value_storage : public heap_value_storage<Key, Value>
+{
+  public:
+    using value_type = typename heap_value_storage<Key, Value>::value_type;
+    using index_type = concurrent_hash_index<Key, const Value *>;
+
+    epoch_value_storage(std::shared_ptr<epoch_domain> domain, std::shared_ptr<index_type> index)
+        : domain{std::move(domain)}, index{std::move(index)}
+    {
+    }
+
+    void OnInsert(const Key &key, const value_type &value)
+    {
+        Retire(index->InsertOrReplace(key, value.get()));
+    }
+
+    void OnErase(const Key &key, const value_type &value)
+    {
+        const auto *indexed = index->Find(key);
+
+        // a detached value may be erased after its key has been put again
+        if (indexed != nullptr && indexed->value == value.get())
+        {
+            Retire(index->Erase(key));
+        }
+
+        domain->Retire(value);
+    }
+
+    void OnDetach()
+    {
+        index->Clear([this](typename index_type::node *node) { Retire(node); });
+    }
+
+    /**
+     * \brief Domain erased values are retired to
+     */
+    const std::shared_ptr<epoch_domain> &Domain() const noexcept
+    {
+        return domain;
+    }
+
+  private:
+    void Retire(typename index_type::node *node)
+    {
+        if (node != nullptr)
+        {
+            domain->Retire(std::shared_ptr<const void>{node});
+        }
+    }
+
+    std::shared_ptr<epoch_domain> domain;
+    std::shared_ptr<index_type> index;
+};
+
+/**
+ * \brief Fixed sized cache with a guarded read API that avoids reference counting
+ * \details Besides the regular API returning `WrappedValue`, values can be read as plain
+ * references under an epoch_guard:
+ * ```
+ * auto guard = cache.Pin();
+ * const auto &value = cache.Get(key, guard);
+ * // value stays valid until the guard is destroyed, even if the element is erased
+ * ```
+ * Such reads take no lock and do not touch the value's reference count: the value is found in a
+ * concurrent_hash_index kept next to the map, so concurrent reads of a hot element do not contend
+ * on the cache lock or on its control block. Every `TOUCH_INTERVAL`-th guarded lookup of a thread
+ * also goes through the locked path, so the policy and the access observer see a sample of them.
+ * A guarded lookup racing with a replacement of the same key may miss. Erased values are
+ * destroyed once all guards that could have seen them are released.
+ * \tparam Key Type of a key (should be hashable)
+ * \tparam Value Type of a value stored in the cache
+ * \tparam Policy Type of a policy to be used with the cache
+ */
+template <typename Key, typename Value, template <typename> class Policy = NoCachePolicy>
+class epoch_cache
+    : public fixed_sized_cache<Key, Value, Policy, counted_unordered_map<Key, WrappedValue<Value>>,
+                               epoch_value_storage<Key, Value>>
+{
+    using base_type =
+        fixed_sized_cache<Key, Value, Policy, counted_unordered_map<Key, WrappedValue<Value>>,
+                          epoch_value_storage<Key, Value>>;
+    using index_type = typename epoch_value_storage<Key, Value>::index_type;
+
+  public:
+    using typename base_type::on_erase_cb;
+    using base_type::Get;
+    using base_type::TryGet;
+
+    static constexpr std::uint32_t TOUCH_INTERVAL = 32;
+
+    /**
+     * \brief Construct cache
+     * \throw std::invalid_argument
+     * \param[in] max_size Maximum size of the cache
+     * \param[in] policy Cache policy to use
+     * \param[in] on_erase on_erase_cb function to be called when cache's element get erased
+     * \param[in] domain Reclamation domain, may be shared by several caches
+     */
+    explicit epoch_cache(std::size_t max_size, const Policy<Key> &policy = Policy<Key>{},
+                         on_erase_cb on_erase = on_erase_cb{},
+                         std::shared_ptr<epoch_domain> domain = std::make_shared<epoch_domain>())
+        : epoch_cache{max_size, policy, std::move(on_erase), std::move(domain),
+                      std::make_shared<index_type>(max_size == 0 ? 1 : max_size)}
+    {
+    }
+
+    /**
+     * \brief Start a read section
+     */
+    epoch_guard Pin() const
+    {
+        return epoch_guard{*domain};
+    }
+
+    /**
+     * \brief Try to get an element without taking a reference to it
+     * \param[in] key Get element by key
+     * \param[in] guard Read section the returned pointer is valid in
+     * \return Pointer to the value or `nullptr` if the element is not in the cache
+     */
+    const Value *TryGet(const Key &key, const epoch_guard &guard) const
+    {
+        (void)guard;
+        static thread_local std::uint32_t lookups = 0;
+
+        if (++lookups % TOUCH_INTERVAL == 0)
+        {
+            TryGet(key);
+        }
+
+        const auto *found = index->Find(key);
+
+        return found != nullptr ? found->value : nullptr;
+    }
+
+    /**
+     * \brief Get an element without taking a reference to it
+     * \throw std::range_error
+     * \param[in] key Get element by key
+     * \param[in] guard Read section the returned reference is valid in
+     */
+    const Value &Get(const Key &key, const epoch_guard &guard) const
+    {
+        const auto *value = TryGet(key, guard);
+
+        if (value == nullptr)
+        {
+            throw std::range_error{"No such element in the cache"};
+        }
+
+        return *value;
+    }
+
+    /**
+     * \brief Reclamation domain of the cache
+     */
+    epoch_domain &Domain() const noexcept
+    {
+        return *domain;
+    }
+
+  private:
+    epoch_cache(std::size_t max_size, const Policy<Key> &policy, on_erase_cb on_erase,
+                std::shared_ptr<epoch_domain> domain, std::shared_ptr<index_type> index)
+        : base_type{max_size, policy, std::move(on_erase),
+                    epoch_value_storage<Key, Value>{domain, index}},
+          domain{std::move(domain)}, index{std::move(index)}
+    {
+    }
+
+    std::shared_ptr<epoch_domain> domain;
+    std::shared_ptr<index_type> index;
+};
+} // namespace caches
+
+#endif // EPOCH_CACHE_HPP
@@ -0,0 +1,328 @@
+/**
+ * \file
+ * \brief Epoch-based reclamation of values erased from a cache
+ */
+#ifndef EPOCH_RECLAMATION_HPP
+#define EPOCH_RECLAMATION_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace caches
+{
+class epoch_guard;
+
+/**
+ * \brief Domain of epoch-based reclamation
+ * \details Readers pin the current global epoch for the duration of a read section (see
+ * epoch_guard). Objects retired by writers are tagged with the global epoch and destroyed only
+ * after the global epoch has advanced twice since then. The epoch advances only when every pinned
+ * reader has observed the current one, so no reader can still reference a destroyed object.
+ *
+ * Pinning costs a couple of stores to a cache line owned by the reading thread, so unlike
+ * copying a `std::shared_ptr` it does not bounce a shared reference count between cores.
+ * A thread gets its record in a domain on the first pin and releases it on exit.
+ */
+class epoch_domain
+{
+  public:
+    /**
+     * \param[in] collect_threshold Number of retired objects after which the domain tries to
+     * advance the epoch and destroy what can be destroyed. Zero disables automatic collection,
+     * so objects are destroyed only by explicit Collect calls
+     */
+    explicit epoch_domain(std::size_t collect_threshold = 64)
+        : state{std::make_shared<shared_state>()}, id{NextId()},
+          collect_threshold{collect_threshold}
+    {
+    }
+
+    epoch_domain(const epoch_domain &) = delete;
+    epoch_domain &operator=(const epoch_domain &) = delete;
+
+    /**
+     * \brief Retire the object, it's destroyed once no reader can reference it
+     * \param[in] object Object to retire (the last reference, if the object should be destroyed)
+     */
+    void Retire(std::shared_ptr<const void> object)
+    {
+        std::vector<std::shared_ptr<const void>> garbage;
+
+        {
+            std::lock_guard<std::mutex> lock{retire_op};
+
+            retired.push_back(retired_object{state->global.load(std::memory_order_acquire),
+                                             std::move(object)});
+
+            if (collect_threshold != 0 && retired.size() >= collect_threshold + collected_mark)
+            {
+                CollectLocked(garbage);
+                collected_mark = retired.size();
+            }
+        }
+        // garbage is destroyed here, outside of the lock
+    }
+
+    /**
+     * \brief Try to advance the epoch and destroy retired objects no reader can reference
+     * \return Number of objects that are still waiting for destruction
+     */
+    std::size_t Collect()
+    {
+        return Collect([] {});
+    }
+
+    /**
+     * \brief Try to advance the epoch and destroy retired objects no reader can reference
+     * \details `before_destroy` is called after the epoch has advanced, but before the objects
+     * are destroyed. It lets the owner drop other references to the objects (e.g. pointers
+     * buffered by readers that have already left their read sections)
+     * \param[in] before_destroy Function to call before destroying the objects
+     * \return Number of objects that are still waiting for destruction
+     */
+    template <typename F>
+    std::size_t Collect(F &&before_destroy)
+    {
+        std::vector<std::shared_ptr<const void>> garbage;
+        std::lock_guard<std::mutex> lock{retire_op};
+
+        CollectLocked(garbage);
+        collected_mark = retired.size();
+        before_destroy();
+
+        return retired.size();
+    }
+
+    /**
+     * \brief Number of retired objects waiting for destruction
+     */
+    std::size_t Pending() const
+    {
+        std::lock_guard<std::mutex> lock{retire_op};
+
+        return retired.size();
+    }
+
+  private:
+    friend class epoch_guard;
+
+    struct participant
+    {
+        // pinned epoch shifted left by one with the lowest bit telling whether it's pinned
+        std::atomic<std::uint64_t> pinned{0};
+        std::atomic<bool> in_use{true};
+        // nesting depth of guards, only touched by the owning thread
+        std::size_t depth = 0;
+        participant *next = nullptr;
+    };
+
+    struct shared_state
+    {
+        ~shared_state()
+        {
+            auto *record = head.load();
+
+            while (record != nullptr)
+            {
+                auto *next = record->next;
+
+                delete record;
+                record = next;
+            }
+        }
+
+        std::atomic<std::uint64_t> global{0};
+        std::atomic<participant *> head{nullptr};
+    };
+
+    struct retired_object
+    {
+        std::uint64_t epoch;
+        std::shared_ptr<const void> object;
+    };
+
+    // records of the current thread in all domains it has used
+    class thread_records
+    {
+      public:
+        ~thread_records()
+        {
+            for (auto &entry : records)
+            {
+                if (auto alive = entry.state.lock())
+                {
+                    entry.record->in_use.store(false, std::memory_order_release);
+                }
+            }
+        }
+
+        participant *Find(std::uint64_t id, const std::shared_ptr<shared_state> &state)
+        {
+            // ids are never reused, so the lookup doesn't need to lock the weak pointers
+            for (const auto &entry : records)
+            {
+                if (entry.id == id)
+                {
+                    return entry.record;
+                }
+            }
+
+            records.erase(std::remove_if(records.begin(), records.end(),
+                                         [](const entry_type &entry)
+                                         { return entry.state.expired(); }),
+                          records.end());
+
+            auto *record = Acquire(*state);
+
+            records.push_back(entry_type{id, state, record});
+
+            return record;
+        }
+
+      private:
+        struct entry_type
+        {
+            std::uint64_t id;
+            std::weak_ptr<shared_state> state;
+            participant *record;
+        };
+
+        static participant *Acquire(shared_state &state)
+        {
+            // reuse a record released by an exited thread
+            for (auto *record = state.head.load(std::memory_order_acquire); record != nullptr;
+                 record = record->next)
+            {
+                bool in_use = false;
+
+                if (!record->in_use.load(std::memory_order_relaxed) &&
+                    record->in_use.compare_exchange_strong(in_use, true))
+                {
+                    return record;
+                }
+            }
+
+            auto *record = new participant;
+
+            record->next = state.head.load(std::memory_order_relaxed);
+
+            while (!state.head.compare_exchange_weak(record->next, record))
+            {
+            }
+
+            return record;
+        }
+
+        std::vector<entry_type> records;
+    };
+
+    participant &LocalRecord() const
+    {
+        static thread_local thread_records records;
+
+        return *records.Find(id, state);
+    }
+
+    static std::uint64_t NextId() noexcept
+    {
+        static std::atomic<std::uint64_t> last_id{0};
+
+        return last_id.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    void CollectLocked(std::vector<std::shared_ptr<const void>> &garbage)
+    {
+        TryAdvance();
+
+        const auto global = state->global.load(std::memory_order_acquire);
+
+        // an object retired in epoch E may be referenced by readers pinned in E - 1 or E
+        while (!retired.empty() && retired.front().epoch + 2 <= global)
+        {
+            garbage.push_back(std::move(retired.front().object));
+            retired.pop_front();
+        }
+    }
+
+    void TryAdvance()
+    {
+        auto global = state->global.load(std::memory_order_seq_cst);
+
+        for (auto *record = state->head.load(std::memory_order_acquire); record != nullptr;
+             record = record->next)
+        {
+            const auto pinned = record->pinned.load(std::memory_order_seq_cst);
+
+            if ((pinned & 1) != 0 && (pinned >> 1) != global)
+            {
+                return;
+            }
+        }
+
+        state->global.compare_exchange_strong(global, global + 1);
+    }
+
+    std::shared_ptr<shared_state> state;
+    std::uint64_t id;
+    std::size_t collect_threshold;
+    std::size_t collected_mark = 0;
+    std::deque<retired_object> retired;
+    mutable std::mutex retire_op;
+};
+
+/**
+ * \brief RAII read section of an epoch_domain
+ * \details Objects reachable while the guard is alive are not destroyed until it's released.
+ * Guards may be nested, but must be released on the thread that created them
+ */
+class epoch_guard
+{
+  public:
+    explicit epoch_guard(const epoch_domain &domain) : record{&domain.LocalRecord()}
+    {
+        if (record->depth++ == 0)
+        {
+            const auto global = domain.state->global.load(std::memory_order_relaxed);
+
+            record->pinned.store((global << 1) | 1, std::memory_order_seq_cst);
+            // make sure the pinned epoch is still current, otherwise a concurrent advance could
+            // have missed this reader
+            const auto current = domain.state->global.load(std::memory_order_seq_cst);
+
+            if (current != global)
+            {
+                record->pinned.store((current << 1) | 1, std::memory_order_seq_cst);
+            }
+        }
+    }
+
+    epoch_guard(epoch_guard &&other) noexcept : record{other.record}
+    {
+        other.record = nullptr;
+    }
+
+    epoch_guard(const epoch_guard &) = delete;
+    epoch_guard &operator=(const epoch_guard &) = delete;
+    epoch_guard &operator=(epoch_guard &&) = delete;
+
+    ~epoch_guard()
+    {
+        if (record != nullptr && --record->depth == 0)
+        {
+            record->pinned.store(0, std::memory_order_release);
+        }
+    }
+
+  private:
+    epoch_domain::participant *record;
+};
+} // namespace caches
+
+#endif // EPOCH_RECLAMATION_HPP
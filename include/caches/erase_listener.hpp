@@ -0,0 +1,324 @@
+/**
+ * \file
+ * \brief Notifications about elements leaving a cache
+ */
+#ifndef ERASE_LISTENER_HPP
+#define ERASE_LISTENER_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace caches
+{
+/**
+ * \brief Reason an element left a cache
+ */
+enum class erase_cause
+{
+    evicted,  ///< Removed by the replacement policy to make room for other elements
+    replaced, ///< Value has been overwritten by a new one for the same key
+    removed,  ///< Removed explicitly by the user
+    expired,    ///< Lifetime of the element is over
+    cleared,    ///< The whole cache has been cleared
+    invalidated ///< Invalidated with InvalidateAll/InvalidateIf
+};
+
+/**
+ * \brief Erase listener that ignores all notifications
+ * \details Caches that use this listener do not collect notifications at all
+ */
+struct no_erase_callback
+{
+    template <typename Key, typename Value>
+    void operator()(const Key &key, const Value &value, erase_cause cause) const noexcept
+    {
+        (void)key;
+        (void)value;
+        (void)cause;
+    }
+};
+
+/**
+ * \brief Single notification about an element that left a cache
+ */
+template <typename Key, typename Value>
+struct erase_notification
+{
+    Key key;
+    Value value;
+    erase_cause cause;
+};
+
+/**
+ * \brief Collects erase notifications inside a cache critical section and delivers them later
+ * \details Notifications are queued with Record while the cache lock is held. The cache takes the
+ * queued batch before releasing the lock and delivers it after the lock is released, so listeners
+ * never block other cache operations.
+ *
+ * Listeners callable with `(key, value, cause)` receive every notification. Listeners callable
+ * with `(key, value)` only receive evictions and explicit removals, which matches the historical
+ * `on_erase` callback behaviour. Notifications that are not delivered are not recorded at all.
+ *
+ * Caches that keep values in a stored form (e.g. compressed) record the stored form and convert
+ * it to `Value` with a loader at delivery time, outside the cache lock.
+ * \tparam Key Type of a key
+ * \tparam Value Type of a wrapped value passed to the listener
+ * \tparam Listener Type of a listener
+ * \tparam Stored Type of a value kept in the cache
+ */
+template <typename Key, typename Value, typename Listener, typename Stored = Value>
+class erase_notifier
+{
+  public:
+    using batch_type = std::vector<erase_notification<Key, Stored>>;
+
+    explicit erase_notifier(Listener listener) : listener{std::move(listener)}
+    {
+    }
+
+    /**
+     * \brief Record a notification to be delivered later
+     * \return `true` if the pending notification holds the value until it's delivered
+     */
+    bool Record(const Key &key, Stored value, erase_cause cause)
+    {
+        if (!Wants(cause))
+        {
+            return false;
+        }
+
+        pending.push_back(erase_notification<Key, Stored>{key, std::move(value), cause});
+
+        return true;
+    }
+
+    void Take(batch_type &batch) noexcept
+    {
+        batch.swap(pending);
+    }
+
+    static bool Empty(const batch_type &batch) noexcept
+    {
+        return batch.empty();
+    }
+
+    /**
+     * \brief Check whether notifications with the given cause are delivered to the listener
+     */
+    bool Wants(erase_cause cause) const noexcept
+    {
+        return IsSet(listener) && Accepts(listener, cause, 0);
+    }
+
+    /**
+     * \brief Deliver the batch, converting every stored value with `load` first
+     */
+    template <typename Loader>
+    void Deliver(batch_type &batch, Loader &&load)
+    {
+        for (auto &notification : batch)
+        {
+            Invoke(listener, notification.key, load(notification.value), notification.cause, 0);
+        }
+    }
+
+  private:
+    template <typename F>
+    static bool IsSet(const F &) noexcept
+    {
+        return true;
+    }
+
+    template <typename Signature>
+    static bool IsSet(const std::function<Signature> &function) noexcept
+    {
+        return static_cast<bool>(function);
+    }
+
+    template <typename F>
+    static auto Accepts(const F &, erase_cause, int) noexcept -> decltype(
+        std::declval<F &>()(std::declval<const Key &>(), std::declval<const Value &>(),
+                            erase_cause::cleared),
+        bool())
+    {
+        return true;
+    }
+
+    template <typename F>
+    static bool Accepts(const F &, erase_cause cause, long) noexcept
+    {
+        return cause == erase_cause::evicted || cause == erase_cause::removed;
+    }
+
+    template <typename F>
+    static auto Invoke(F &function, const Key &key, const Value &value, erase_cause cause, int)
+        -> decltype(function(key, value, cause), void())
+    {
+        function(key, value, cause);
+    }
+
+    template <typename F>
+    static void Invoke(F &function, const Key &key, const Value &value, erase_cause, long)
+    {
+        // other causes are not recorded for listeners without the cause argument
+        function(key, value);
+    }
+
+    Listener listener;
+    batch_type pending;
+};
+
+/**
+ * \brief No-op notifier: nothing is recorded and delivered
+ */
+template <typename Key, typename Value, typename Stored>
+class erase_notifier<Key, Value, no_erase_callback, Stored>
+{
+  public:
+    struct batch_type
+    {
+    };
+
+    explicit erase_notifier(no_erase_callback) noexcept
+    {
+    }
+
+    bool Record(const Key &, const Stored &, erase_cause) noexcept
+    {
+        return false;
+    }
+
+    void Take(batch_type &) noexcept
+    {
+    }
+
+    static bool Empty(const batch_type &) noexcept
+    {
+        return true;
+    }
+
+    bool Wants(erase_cause) const noexcept
+    {
+        return false;
+    }
+
+    template <typename Loader>
+    void Deliver(batch_type &, Loader &&) noexcept
+    {
+    }
+};
+
+/**
+ * \brief Erase listener that delivers notifications on a dedicated thread
+ * \details Notifications are handed over to the listener thread in batches, so slow consumers
+ * (e.g. writing evicted elements to a secondary store) do not delay the threads working with the
+ * cache. Copies of the listener share the same thread, which is stopped when the last copy is
+ * destroyed after all queued notifications are delivered.
+ * \tparam Key Type of a key
+ * \tparam Value Type of a wrapped value
+ */
+template <typename Key, typename Value>
+class threaded_erase_listener
+{
+  public:
+    using callback_type = std::function<void(const Key &, const Value &, erase_cause)>;
+
+    /**
+     * \brief Start the listener thread
+     * \param[in] callback Function to call for every notification
+     */
+    explicit threaded_erase_listener(callback_type callback)
+        : state{std::make_shared<listener_state>(std::move(callback))}
+    {
+    }
+
+    void operator()(const Key &key, const Value &value, erase_cause cause)
+    {
+        {
+            std::lock_guard<std::mutex> lock{state->queue_op};
+            state->queue.push_back(erase_notification<Key, Value>{key, value, cause});
+        }
+
+        state->queue_cv.notify_one();
+    }
+
+    /**
+     * \brief Wait until all queued notifications are delivered
+     */
+    void Flush() const
+    {
+        std::unique_lock<std::mutex> lock{state->queue_op};
+
+        state->idle_cv.wait(lock, [this] { return state->queue.empty() && !state->busy; });
+    }
+
+  private:
+    struct listener_state
+    {
+        explicit listener_state(callback_type function)
+            : callback{std::move(function)}, worker{[this] { Run(); }}
+        {
+        }
+
+        ~listener_state()
+        {
+            {
+                std::lock_guard<std::mutex> lock{queue_op};
+                stop = true;
+            }
+
+            queue_cv.notify_one();
+            worker.join();
+        }
+
+        void Run()
+        {
+            std::vector<erase_notification<Key, Value>> batch;
+            std::unique_lock<std::mutex> lock{queue_op};
+
+            for (;;)
+            {
+                queue_cv.wait(lock, [this] { return stop || !queue.empty(); });
+
+                if (queue.empty())
+                {
+                    return;
+                }
+
+                batch.swap(queue);
+                busy = true;
+                lock.unlock();
+
+                for (const auto &notification : batch)
+                {
+                    callback(notification.key, notification.value, notification.cause);
+                }
+
+                batch.clear();
+                lock.lock();
+                busy = false;
+                idle_cv.notify_all();
+            }
+        }
+
+        callback_type callback;
+        std::vector<erase_notification<Key, Value>> queue;
+        bool stop = false;
+        bool busy = false;
+        std::mutex queue_op;
+        std::condition_variable queue_cv;
+        std::condition_variable idle_cv;
+        std::thread worker;
+    };
+
+    std::shared_ptr<listener_state> state;
+};
+} // namespace caches
+
+#endif // ERASE_LISTENER_HPP
@@ -6,8 +6,9 @@
 #define FIFO_CACHE_POLICY_HPP
 
 #include "cache_policy.hpp"
+#include <cstddef>
+#include <functional>
 #include <list>
-#include <unordered_map>
 
 namespace caches
 {
@@ -35,10 +36,18 @@ template <typename Key>
 class FIFOCachePolicy : public ICachePolicy<Key>
 {
   public:
-    using fifo_iterator = typename std::list<Key>::const_iterator;
+    using fifo_queue_type = std::list<Key, counting_allocator<Key>>;
+    using fifo_iterator = typename fifo_queue_type::const_iterator;
+    using key_lookup_type = counted_unordered_map<Key, fifo_iterator>;
+
+    static constexpr bool touch_is_noop = true;
 
     FIFOCachePolicy() = default;
     ~FIFOCachePolicy() override = default;
+    FIFOCachePolicy(const FIFOCachePolicy &) = default;
+    FIFOCachePolicy(FIFOCachePolicy &&) = default;
+    FIFOCachePolicy &operator=(const FIFOCachePolicy &) = default;
+    FIFOCachePolicy &operator=(FIFOCachePolicy &&) = default;
 
     void Insert(const Key &key) override
     {
@@ -65,9 +74,21 @@ class FIFOCachePolicy : public ICachePolicy<Key>
         return fifo_queue.back();
     }
 
+    /**
+     * \brief Count the memory of the policy's containers in the given counter
+     * \details Must be called while the policy is empty
+     */
+    void CountMemory(std::size_t *counter)
+    {
+        const counting_allocator<Key> allocator{counter};
+
+        fifo_queue = fifo_queue_type(allocator);
+        key_lookup = key_lookup_type(0, std::hash<Key>{}, std::equal_to<Key>{}, allocator);
+    }
+
   private:
-    std::list<Key> fifo_queue;
-    std::unordered_map<Key, fifo_iterator> key_lookup;
+    fifo_queue_type fifo_queue;
+    key_lookup_type key_lookup;
 };
 } // namespace caches
 
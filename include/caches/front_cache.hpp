@@ -0,0 +1,337 @@
+/**
+ * \file
+ * \brief Cache with a thread-local front cache for the hottest keys
+ */
+#ifndef FRONT_CACHE_HPP
+#define FRONT_CACHE_HPP
+
+#include "cache.hpp"
+#include "cache_policy.hpp"
+#include "erase_listener.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace caches
+{
+/**
+ * \brief Per key bucket invalidation epochs shared by front_cache and its backing cache
+ */
+class front_cache_epochs
+{
+  public:
+    explicit front_cache_epochs(std::size_t buckets) : epochs(buckets)
+    {
+        if (buckets == 0)
+        {
+            throw std::invalid_argument{"Number of epoch buckets should be non-zero"};
+        }
+    }
+
+    std::uint64_t Load(std::size_t hash) const noexcept
+    {
+        return epochs[hash % epochs.size()].load(std::memory_order_acquire);
+    }
+
+    void Bump(std::size_t hash) noexcept
+    {
+        epochs[hash % epochs.size()].fetch_add(1, std::memory_order_acq_rel);
+    }
+
+  private:
+    std::vector<std::atomic<std::uint64_t>> epochs;
+};
+
+/**
+ * \brief fixed_sized_cache fronted by a per-thread direct-mapped array of recently read elements
+ * \details Every thread keeps a `Slots` sized array of the elements it has read. A repeated read
+ * of the same key is served from the array without taking the cache lock or probing the cache's
+ * hash map. The array is kept coherent with invalidation epochs: every key maps to one of the
+ * epoch buckets, and `Put`, `Remove` and evictions bump the epoch of the key's bucket. A thread
+ * remembers the epoch it has seen together with the element and discards the element when the
+ * epoch has changed, so a write is observed by every reader on its next access after the write
+ * returns, without any cross-thread messaging.
+ *
+ * Every `TOUCH_INTERVAL`-th hit of a slot is served by the backing cache instead, so its policy and
+ * access observer keep seeing a sample of the reads of hot keys, and a hot key doesn't drift to the
+ * eviction end of e.g. an LRU policy while it's read from the front caches only.
+ *
+ * Every cache has its own slots in every thread that reads it. Elements kept in the slots stay
+ * alive until they are replaced, the thread exits or the cache is destroyed.
+ * \tparam Key Type of a key (should be hashable)
+ * \tparam Value Type of a value stored in the cache
+ * \tparam Policy Type of a policy to be used with the backing cache
+ * \tparam Slots Number of elements kept in the front cache of every thread
+ */
+template <typename Key, typename Value, template <typename> class Policy = NoCachePolicy,
+          std::size_t Slots = 256>
+class front_cache
+{
+  public:
+    using value_type = WrappedValue<Value>;
+
+    /// Every slot forwards one of this many hits to the backing cache
+    static constexpr std::uint32_t TOUCH_INTERVAL = 32;
+
+    /**
+     * \brief Listener that invalidates front caches of evicted elements
+     */
+    class eviction_invalidator
+    {
+      public:
+        explicit eviction_invalidator(std::shared_ptr<front_cache_epochs> epochs)
+            : epochs{std::move(epochs)}
+        {
+        }
+
+        void operator()(const Key &key, const value_type &, erase_cause cause) const
+        {
+            if (cause == erase_cause::evicted)
+            {
+                epochs->Bump(std::hash<Key>{}(key));
+            }
+        }
+
+      private:
+        std::shared_ptr<front_cache_epochs> epochs;
+    };
+
+    using backing_cache_type =
+        fixed_sized_cache<Key, Value, Policy, std::unordered_map<Key, value_type>,
+                          heap_value_storage<Key, Value>, eviction_invalidator>;
+
+    /**
+     * \brief Construct cache with a front cache
+     * \throw std::invalid_argument
+     * \param[in] max_size Maximum size of the backing cache
+     * \param[in] policy Cache policy to use
+     * \param[in] epoch_buckets Number of invalidation epochs. More buckets cause less false
+     * invalidations of keys that share a bucket with a written key
+     */
+    explicit front_cache(std::size_t max_size, const Policy<Key> &policy = Policy<Key>{},
+                         std::size_t epoch_buckets = 4096)
+        : epochs{std::make_shared<front_cache_epochs>(epoch_buckets)},
+          backing{max_size, policy, eviction_invalidator{epochs}}, id{NextId()}
+    {
+    }
+
+    front_cache(const front_cache &) = delete;
+    front_cache &operator=(const front_cache &) = delete;
+
+    /**
+     * \brief Destroy the cache and release the elements kept in the slots of all threads
+     * \details The cache must not be accessed concurrently, as with any other cache
+     */
+    ~front_cache()
+    {
+        std::lock_guard<std::mutex> lock{slots_op};
+
+        for (const auto &thread_slots : all_slots)
+        {
+            // the slots of the threads that have exited are released already
+            if (auto slots = thread_slots.lock())
+            {
+                slots->slots.fill(slot_type{});
+                slots->retired.store(true, std::memory_order_release);
+            }
+        }
+    }
+
+    /**
+     * \brief Put element into the cache
+     * \param[in] key Key value to use
+     * \param[in] value Value to assign to the given key
+     */
+    void Put(const Key &key, const Value &value)
+    {
+        backing.Put(key, value);
+        epochs->Bump(std::hash<Key>{}(key));
+    }
+
+    /**
+     * \brief Try to get an element by the given key from the cache
+     * \param[in] key Get element by key
+     * \return Pair of the value and boolean value that shows whether it has been found
+     */
+    std::pair<value_type, bool> TryGet(const Key &key) const
+    {
+        const auto hash = std::hash<Key>{}(key);
+        // the epoch is loaded before the backing cache is read, so a write that happens in
+        // between invalidates the element stored below
+        const auto epoch = epochs->Load(hash);
+        auto &slot = LocalSlots().slots[hash % Slots];
+
+        if (slot.value && slot.epoch == epoch && slot.key == key && ++slot.hits < TOUCH_INTERVAL)
+        {
+            return {slot.value, true};
+        }
+
+        auto result = backing.TryGet(key);
+
+        if (result.second)
+        {
+            slot.epoch = epoch;
+            slot.hits = 0;
+            slot.key = key;
+            slot.value = result.first;
+        }
+
+        return result;
+    }
+
+    /**
+     * \brief Get element from the cache if present
+     * \throw std::range_error
+     * \param[in] key Get element by key
+     */
+    value_type Get(const Key &key) const
+    {
+        auto result = TryGet(key);
+
+        if (!result.second)
+        {
+            throw std::range_error{"No such element in the cache"};
+        }
+
+        return result.first;
+    }
+
+    /**
+     * \brief Check whether the given key is presented in the cache
+     */
+    bool Cached(const Key &key) const
+    {
+        return backing.Cached(key);
+    }
+
+    /**
+     * \brief Get number of elements in cache
+     */
+    std::size_t Size() const
+    {
+        return backing.Size();
+    }
+
+    /**
+     * \brief Remove an element specified by key
+     * \retval true if an element specified by key was found and deleted
+     * \retval false if an element is not present in a cache
+     */
+    bool Remove(const Key &key)
+    {
+        const bool removed = backing.Remove(key);
+
+        epochs->Bump(std::hash<Key>{}(key));
+
+        return removed;
+    }
+
+    /**
+     * \brief Access the backing cache (e.g. to attach an access observer)
+     * \warning Elements written directly to the backing cache do not invalidate front caches
+     */
+    backing_cache_type &Backing() noexcept
+    {
+        return backing;
+    }
+
+  private:
+    struct slot_type
+    {
+        std::uint64_t epoch = 0;
+        // hits since the last read of the backing cache
+        std::uint32_t hits = 0;
+        Key key{};
+        // empty in unused slots, the cache never stores empty values
+        value_type value;
+    };
+
+    struct slot_array
+    {
+        std::array<slot_type, Slots> slots;
+        // set when the cache is destroyed
+        std::atomic<bool> retired{false};
+    };
+
+    // slot arrays of the caches read by the calling thread, by cache id
+    using thread_slots_map = std::unordered_map<std::uint64_t, std::shared_ptr<slot_array>>;
+
+    static std::uint64_t NextId() noexcept
+    {
+        static std::atomic<std::uint64_t> last_id{0};
+
+        return last_id.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    // ids are never reused, so an id of a destroyed cache never finds the slots of another one
+    slot_array &LocalSlots() const
+    {
+        static thread_local std::uint64_t last_id = 0;
+        static thread_local slot_array *last_slots = nullptr;
+
+        if (last_id == id)
+        {
+            return *last_slots;
+        }
+
+        static thread_local thread_slots_map owned;
+        auto owned_it = owned.find(id);
+
+        if (owned_it == owned.end())
+        {
+            owned_it = owned.emplace(id, RegisterSlots(owned)).first;
+        }
+
+        last_id = id;
+        last_slots = owned_it->second.get();
+
+        return *last_slots;
+    }
+
+    // create the slots of the calling thread, dropping the thread's slots of destroyed caches
+    std::shared_ptr<slot_array> RegisterSlots(thread_slots_map &owned) const
+    {
+        for (auto owned_it = owned.begin(); owned_it != owned.end();)
+        {
+            if (owned_it->second->retired.load(std::memory_order_acquire))
+            {
+                owned_it = owned.erase(owned_it);
+            }
+            else
+            {
+                ++owned_it;
+            }
+        }
+
+        auto slots = std::make_shared<slot_array>();
+        std::lock_guard<std::mutex> lock{slots_op};
+
+        all_slots.erase(std::remove_if(all_slots.begin(), all_slots.end(),
+                                       [](const std::weak_ptr<slot_array> &thread_slots)
+                                       { return thread_slots.expired(); }),
+                        all_slots.end());
+        all_slots.push_back(slots);
+
+        return slots;
+    }
+
+    std::shared_ptr<front_cache_epochs> epochs;
+    backing_cache_type backing;
+    std::uint64_t id;
+    mutable std::mutex slots_op;
+    // slots of the threads that have read the cache, owned by the threads
+    mutable std::vector<std::weak_ptr<slot_array>> all_slots;
+};
+} // namespace caches
+
+#endif // FRONT_CACHE_HPP
@@ -0,0 +1,99 @@
+/**
+ * \file
+ * \brief Key wrapper that carries its precomputed hash
+ */
+#ifndef HASHED_KEY_HPP
+#define HASHED_KEY_HPP
+
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+namespace caches
+{
+/**
+ * \brief Key with its hash computed once at construction
+ * \details Caches use `std::hash` of the key type in the hash map, in the policies (e.g. the
+ * key index of LRUCachePolicy) and for striping, so one operation on a cache hashes the key
+ * several times. When `hashed_key<Key>` is used as the key type of a cache, all of them reuse the
+ * stored hash, and the key is hashed once, where the hashed_key is made (e.g. while a request is
+ * parsed):
+ * ```
+ * using key_type = caches::hashed_key<std::string>;
+ * caches::fixed_sized_cache<key_type, int, caches::LRUCachePolicy> cache{256};
+ * const key_type key{ReadKey(request)};
+ * if (!cache.Cached(key)) { cache.Put(key, Load(key.Get())); }
+ * ```
+ * The conversion from `Key` is implicit, so calls with plain keys keep working (and hash once per
+ * call). Equal keys must have equal hashes, so the hash passed to the constructor has to be
+ * computed with `Hash`. Comparison checks the hashes first, so most unequal keys are rejected
+ * without comparing the keys themselves.
+ * \tparam Key Type of a key
+ * \tparam Hash Type of a key hasher
+ */
+template <typename Key, typename Hash = std::hash<Key>>
+class hashed_key
+{
+  public:
+    /**
+     * \brief Wrap a key (or anything convertible to it) and compute its hash
+     */
+    template <typename K,
+              typename = typename std::enable_if<std::is_convertible<K, Key>::value>::type>
+    hashed_key(K &&key) : key(std::forward<K>(key)), hash{Hash{}(this->key)}
+    {
+    }
+
+    /**
+     * \brief Wrap a key whose hash has already been computed with `Hash`
+     */
+    hashed_key(Key key, std::size_t hash) : key{std::move(key)}, hash{hash}
+    {
+    }
+
+    /**
+     * \brief The wrapped key
+     */
+    const Key &Get() const noexcept
+    {
+        return key;
+    }
+
+    /**
+     * \brief The stored hash
+     */
+    std::size_t HashValue() const noexcept
+    {
+        return hash;
+    }
+
+    friend bool operator==(const hashed_key &lhs, const hashed_key &rhs)
+    {
+        return lhs.hash == rhs.hash && lhs.key == rhs.key;
+    }
+
+    friend bool operator!=(const hashed_key &lhs, const hashed_key &rhs)
+    {
+        return !(lhs == rhs);
+    }
+
+  private:
+    Key key;
+    std::size_t hash;
+};
+} // namespace caches
+
+namespace std
+{
+template <typename Key, typename Hash>
+struct hash<caches::hashed_key<Key, Hash>>
+{
+    std::size_t operator()(const caches::hashed_key<Key, Hash> &key) const noexcept
+    {
+        return key.HashValue();
+    }
+};
+} // namespace std
+
+#endif // HASHED_KEY_HPP
@@ -0,0 +1,670 @@
+/**
+ * \file
+ * \brief Detection of hot keys and their replicated lock-free read path
+ */
+#ifndef HOT_KEY_CACHE_HPP
+#define HOT_KEY_CACHE_HPP
+
+#include "cache.hpp"
+#include "cache_policy.hpp"
+#include "epoch_reclamation.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace caches
+{
+/**
+ * \brief Estimated access count of a key
+ */
+template <typename Key>
+struct hot_key
+{
+    Key key;
+    /// Estimated number of sampled accesses, never below the real one
+    std::uint64_t count;
+    /// Maximum overestimation of `count`
+    std::uint64_t error;
+};
+
+/**
+ * \brief Space-saving heavy hitters sketch
+ * \details Keeps `capacity` counters. A key without a counter takes over the smallest one and
+ * inherits its count as the error bound, so every key accessed more than `total / capacity` times
+ * is guaranteed to have a counter. The sketch is not synchronized
+ * \tparam Key Type of a key (should be hashable)
+ * \tparam Hash Type of a key hasher
+ */
+template <typename Key, typename Hash = std::hash<Key>>
+class space_saving_sketch
+{
+  public:
+    /**
+     * \brief Construct sketch
+     * \throw std::invalid_argument
+     * \param[in] capacity Number of counters
+     */
+    explicit space_saving_sketch(std::size_t capacity) : capacity{capacity}
+    {
+        if (capacity == 0)
+        {
+            throw std::invalid_argument{"Capacity of the sketch should be non-zero"};
+        }
+
+        counters.reserve(capacity);
+        positions.reserve(capacity);
+    }
+
+    /**
+     * \brief Count an access to the given key
+     */
+    void Offer(const Key &key)
+    {
+        ++total;
+
+        auto pos_it = positions.find(key);
+
+        if (pos_it != positions.end())
+        {
+            ++counters[pos_it->second].count;
+            return;
+        }
+
+        if (counters.size() < capacity)
+        {
+            positions.emplace(key, counters.size());
+            counters.push_back(hot_key<Key>{key, 1, 0});
+            return;
+        }
+
+        // capacity is small, a linear scan is cheaper than keeping the counters ordered
+        auto smallest = std::min_element(counters.begin(), counters.end(),
+                                         [](const hot_key<Key> &lhs, const hot_key<Key> &rhs)
+                                         { return lhs.count < rhs.count; });
+
+        positions.erase(smallest->key);
+        positions.emplace(key, static_cast<std::size_t>(smallest - counters.begin()));
+        smallest->key = key;
+        smallest->error = smallest->count;
+        ++smallest->count;
+    }
+
+    /**
+     * \brief Keys ordered by decreasing estimated count
+     * \param[in] limit Maximum number of returned keys
+     */
+    std::vector<hot_key<Key>> Top(std::size_t limit) const
+    {
+        auto top = counters;
+
+        std::sort(top.begin(), top.end(),
+                  [](const hot_key<Key> &lhs, const hot_key<Key> &rhs)
+                  { return lhs.count > rhs.count; });
+        top.resize(std::min(limit, top.size()));
+
+        return top;
+    }
+
+    /**
+     * \brief Halve all counts, so keys that are not accessed anymore fade away
+     */
+    void Decay()
+    {
+        total /= 2;
+
+        for (std::size_t i = 0; i < counters.size();)
+        {
+            counters[i].count /= 2;
+            counters[i].error /= 2;
+
+            if (counters[i].count == 0)
+            {
+                positions.erase(counters[i].key);
+                counters[i] = counters.back();
+                counters.pop_back();
+
+                if (i < counters.size())
+                {
+                    positions[counters[i].key] = i;
+                }
+            }
+            else
+            {
+                ++i;
+            }
+        }
+    }
+
+    /**
+     * \brief Number of counted accesses (after decays)
+     */
+    std::uint64_t Total() const noexcept
+    {
+        return total;
+    }
+
+  private:
+    std::size_t capacity;
+    std::uint64_t total = 0;
+    std::vector<hot_key<Key>> counters;
+    std::unordered_map<Key, std::size_t, Hash> positions;
+};
+
+/**
+ * \brief Sampled detector of the most accessed keys
+ * \details Every `sample_rate`-th access of a thread is counted in a space_saving_sketch. After
+ * every `window` samples the hot set is recomputed and the counts are halved, so the detector
+ * follows shifts of the workload. A key is hot if its share of the sampled accesses is at least
+ * `min_share`. Accesses that are not sampled cost a thread-local increment.
+ *
+ * The detector can be attached to fixed_sized_cache with `SetAccessObserver`, the hot set can be
+ * queried from any thread.
+ * \tparam Key Type of a key (should be hashable)
+ * \tparam Hash Type of a key hasher
+ */
+template <typename Key, typename Hash = std::hash<Key>>
+class hot_key_detector : public IAccessObserver<Key>
+{
+  public:
+    /**
+     * \brief Construct detector
+     * \throw std::invalid_argument
+     * \param[in] max_hot_keys Maximum size of the hot set
+     * \param[in] min_share Minimum share of the sampled accesses of a hot key (0, 1]
+     * \param[in] sample_rate One of `sample_rate` accesses of a thread is sampled
+     * \param[in] window Number of samples between recomputations of the hot set
+     */
+    explicit hot_key_detector(std::size_t max_hot_keys = 16, double min_share = 0.01,
+                              std::size_t sample_rate = 16, std::size_t window = 4096)
+        : max_hot_keys{max_hot_keys}, min_share{min_share}, sample_rate{sample_rate},
+          window{window}, sketch{4 * max_hot_keys}
+    {
+        if (min_share <= 0.0 || min_share > 1.0 || sample_rate == 0 || window == 0)
+        {
+            throw std::invalid_argument{"Invalid hot key detector configuration"};
+        }
+    }
+
+    void OnAccess(const Key &key) noexcept override
+    {
+        static thread_local std::size_t ticks = 0;
+
+        if (++ticks % sample_rate == 0)
+        {
+            Sample(key);
+        }
+    }
+
+    /**
+     * \brief Keys found hot at the end of the last window, ordered by decreasing count
+     */
+    std::vector<hot_key<Key>> HotKeys() const
+    {
+        std::lock_guard<std::mutex> lock{detector_op};
+
+        return hot;
+    }
+
+    /**
+     * \brief Number of completed windows, changes whenever the hot set is recomputed
+     */
+    std::uint64_t Windows() const noexcept
+    {
+        return windows.load(std::memory_order_acquire);
+    }
+
+  private:
+    void Sample(const Key &key) noexcept
+    {
+        std::lock_guard<std::mutex> lock{detector_op};
+
+        sketch.Offer(key);
+
+        if (++samples < window)
+        {
+            return;
+        }
+
+        samples = 0;
+
+        auto top = sketch.Top(max_hot_keys);
+        const auto min_count = static_cast<std::uint64_t>(min_share * sketch.Total());
+
+        // keys are hot only if even the lower bound of their count is large enough
+        top.erase(std::remove_if(top.begin(), top.end(),
+                                 [min_count](const hot_key<Key> &candidate)
+                                 { return candidate.count - candidate.error < min_count; }),
+                  top.end());
+        hot = std::move(top);
+        sketch.Decay();
+        windows.fetch_add(1, std::memory_order_release);
+    }
+
+    std::size_t max_hot_keys;
+    double min_share;
+    std::size_t sample_rate;
+    std::size_t window;
+    mutable std::mutex detector_op;
+    space_saving_sketch<Key, Hash> sketch;
+    std::size_t samples = 0;
+    std::vector<hot_key<Key>> hot;
+    std::atomic<std::uint64_t> windows{0};
+};
+
+/**
+ * \brief Replicated copies of the hot elements of a cache, read without locks
+ * \details Writers (holding the cache lock) publish a new table and retire the old one to an
+ * epoch_domain. Every hot value is copied into `replicas` separately allocated objects and readers
+ * pick one by their thread, so concurrent readers of a single hot key don't contend on one
+ * reference count. Erasing a key only marks its entry of the published table as invalidated, the
+ * entry's values are released by the next publication, which copies only the values that have
+ * changed since the previous one.
+ * \tparam Key Type of a key
+ * \tparam Value Type of a value
+ */
+template <typename Key, typename Value>
+class hot_table
+{
+  public:
+    using value_type = WrappedValue<Value>;
+
+    /**
+     * \brief Construct empty table
+     * \throw std::invalid_argument
+     * \param[in] replicas Number of copies of every hot value
+     */
+    explicit hot_table(std::size_t replicas) : replicas{replicas}
+    {
+        if (replicas == 0)
+        {
+            throw std::invalid_argument{"Number of replicas should be non-zero"};
+        }
+    }
+
+    hot_table(const hot_table &) = delete;
+    hot_table &operator=(const hot_table &) = delete;
+
+    ~hot_table()
+    {
+        delete current.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief Find a replica of the value of the given key
+     * \return The value or `nullptr` if the key is not hot
+     */
+    value_type Find(const Key &key) const
+    {
+        static thread_local const std::size_t thread_hash =
+            std::hash<std::thread::id>{}(std::this_thread::get_id());
+        epoch_guard guard{domain};
+        const auto *snapshot = current.load(std::memory_order_acquire);
+
+        if (snapshot == nullptr)
+        {
+            return nullptr;
+        }
+
+        const auto position = Position(*snapshot, key);
+
+        if (position == snapshot->keys.size() ||
+            snapshot->invalidated[position].load(std::memory_order_acquire))
+        {
+            return nullptr;
+        }
+
+        const auto replica = thread_hash % replicas;
+
+        return snapshot->values[replica * snapshot->keys.size() + position];
+    }
+
+    /**
+     * \brief Replace the table with copies of the given elements, must be called under the
+     * cache lock
+     */
+    void Publish(const std::vector<std::pair<Key, value_type>> &elements)
+    {
+        const auto *previous = current.load(std::memory_order_relaxed);
+        std::unique_ptr<snapshot_type> snapshot;
+
+        if (!elements.empty())
+        {
+            const auto size = elements.size();
+
+            snapshot.reset(new snapshot_type{size});
+            snapshot->keys.reserve(size);
+            snapshot->values.resize(size * replicas);
+
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                const auto &element = elements[i];
+
+                snapshot->keys.push_back(element.first);
+
+                if (!ReuseReplicas(previous, element, *snapshot, i))
+                {
+                    for (std::size_t replica = 0; replica < replicas; ++replica)
+                    {
+                        // the first replica shares the cached object
+                        snapshot->values[replica * size + i] =
+                            replica == 0 ? element.second
+                                         : std::make_shared<Value>(*element.second);
+                    }
+                }
+            }
+        }
+
+        Replace(snapshot.release());
+    }
+
+    /**
+     * \brief Stop serving the given key from the table, must be called under the cache lock
+     */
+    void Invalidate(const Key &key) noexcept
+    {
+        const auto *snapshot = current.load(std::memory_order_relaxed);
+
+        if (snapshot == nullptr)
+        {
+            return;
+        }
+
+        const auto position = Position(*snapshot, key);
+
+        if (position != snapshot->keys.size())
+        {
+            snapshot->invalidated[position].store(true, std::memory_order_release);
+        }
+    }
+
+    /**
+     * \brief Keys in the table
+     */
+    std::vector<Key> Keys() const
+    {
+        epoch_guard guard{domain};
+        const auto *snapshot = current.load(std::memory_order_acquire);
+        std::vector<Key> keys;
+
+        if (snapshot != nullptr)
+        {
+            for (std::size_t i = 0; i < snapshot->keys.size(); ++i)
+            {
+                if (!snapshot->invalidated[i].load(std::memory_order_acquire))
+                {
+                    keys.push_back(snapshot->keys[i]);
+                }
+            }
+        }
+
+        return keys;
+    }
+
+  private:
+    struct snapshot_type
+    {
+        explicit snapshot_type(std::size_t size) : invalidated(size)
+        {
+        }
+
+        std::vector<Key> keys;
+        // replica r of the key i is at r * keys.size() + i
+        std::vector<value_type> values;
+        // set for the keys erased from the cache after the publication
+        mutable std::vector<std::atomic<bool>> invalidated;
+    };
+
+    static std::size_t Position(const snapshot_type &snapshot, const Key &key)
+    {
+        return static_cast<std::size_t>(
+            std::find(snapshot.keys.begin(), snapshot.keys.end(), key) - snapshot.keys.begin());
+    }
+
+    // copy the replicas of an element that hasn't changed since the previous publication
+    bool ReuseReplicas(const snapshot_type *previous, const std::pair<Key, value_type> &element,
+                       snapshot_type &snapshot, std::size_t position) const
+    {
+        if (previous == nullptr)
+        {
+            return false;
+        }
+
+        const auto previous_position = Position(*previous, element.first);
+        const auto previous_size = previous->keys.size();
+
+        if (previous_position == previous_size ||
+            previous->invalidated[previous_position].load(std::memory_order_relaxed) ||
+            previous->values[previous_position] != element.second)
+        {
+            return false;
+        }
+
+        const auto size = snapshot.values.size() / replicas;
+
+        for (std::size_t replica = 0; replica < replicas; ++replica)
+        {
+            snapshot.values[replica * size + position] =
+                previous->values[replica * previous_size + previous_position];
+        }
+
+        return true;
+    }
+
+    void Replace(const snapshot_type *snapshot)
+    {
+        const auto *old = current.exchange(snapshot, std::memory_order_acq_rel);
+
+        if (old != nullptr)
+        {
+            domain.Retire(std::shared_ptr<const snapshot_type>{old});
+        }
+    }
+
+    std::size_t replicas;
+    epoch_domain domain;
+    std::atomic<const snapshot_type *> current{nullptr};
+};
+
+/**
+ * \brief Value storage that drops erased and detached elements from a hot_table
+ * \tparam Key Type of a key
+ * \tparam Value Type of a value stored in the cache
+ */
+template <typename Key, typename Value>
+class hot_value_storage : public heap_value_storage<Key, Value>
+{
+  public:
+    using value_type = typename heap_value_storage<Key, Value>::value_type;
+
+    explicit hot_value_storage(std::shared_ptr<hot_table<Key, Value>> table)
+        : table{std::move(table)}
+    {
+    }
+
+    void OnErase(const Key &key, const value_type &value)
+    {
+        (void)value;
+        table->Invalidate(key);
+    }
+
+    void OnDetach()
+    {
+        table->Publish({});
+    }
+
+  private:
+    std::shared_ptr<hot_table<Key, Value>> table;
+};
+
+/**
+ * \brief Fixed sized cache that serves its hottest keys without taking the lock
+ * \details Lookups are sampled by a hot_key_detector. Whenever the detector completes a window,
+ * the elements of the hot keys are copied into a hot_table and later lookups of these keys are
+ * served from there without touching the cache lock. Any erasure of a hot element (a Put of a new
+ * value, Remove, eviction or invalidation) drops it from the table under the cache lock, so a
+ * lookup that starts after a modification has returned never sees the old value.
+ *
+ * Lookups served from the table don't touch the policy (hot elements are touched once per window
+ * instead) and are not reported to the access observer. Values have to be copy constructible.
+ * \tparam Key Type of a key (should be hashable)
+ * \tparam Value Type of a value stored in the cache
+ * \tparam Policy Type of a policy to be used with the cache
+ */
+template <typename Key, typename Value, template <typename> class Policy = NoCachePolicy>
+class hot_key_cache
+    : public fixed_sized_cache<Key, Value, Policy, counted_unordered_map<Key, WrappedValue<Value>>,
+                               hot_value_storage<Key, Value>>
+{
+    using base_type =
+        fixed_sized_cache<Key, Value, Policy, counted_unordered_map<Key, WrappedValue<Value>>,
+                          hot_value_storage<Key, Value>>;
+
+  public:
+    using typename base_type::on_erase_cb;
+    using typename base_type::value_type;
+
+    /**
+     * \brief Construct cache
+     * \throw std::invalid_argument
+     * \param[in] max_size Maximum size of the cache
+     * \param[in] detector Configuration of the hot key detection
+     * \param[in] replicas Number of copies of every hot value
+     * \param[in] policy Cache policy to use
+     * \param[in] on_erase on_erase_cb function to be called when cache's element get erased
+     */
+    explicit hot_key_cache(std::size_t max_size,
+                           std::shared_ptr<hot_key_detector<Key>> detector =
+                               std::make_shared<hot_key_detector<Key>>(),
+                           std::size_t replicas = 8, const Policy<Key> &policy = Policy<Key>{},
+                           on_erase_cb on_erase = on_erase_cb{})
+        : hot_key_cache{max_size, std::move(detector),
+                        std::make_shared<hot_table<Key, Value>>(replicas), policy,
+                        std::move(on_erase)}
+    {
+    }
+
+    /**
+     * \brief Try to get an element by the given key from the cache
+     * \param[in] key Get element by key
+     * \return Pair of the value (`nullptr` if it's not found) and whether it has been found
+     */
+    std::pair<value_type, bool> TryGet(const Key &key) const
+    {
+        detector->OnAccess(key);
+        RefreshIfWindowCompleted();
+
+        auto value = table->Find(key);
+
+        if (value != nullptr)
+        {
+            return {std::move(value), true};
+        }
+
+        return base_type::TryGet(key);
+    }
+
+    /**
+     * \brief Get element from the cache if present
+     * \throw std::range_error
+     * \param[in] key Get element by key
+     */
+    value_type Get(const Key &key) const
+    {
+        auto result = TryGet(key);
+
+        if (!result.second)
+        {
+            throw std::range_error{"No such element in the cache"};
+        }
+
+        return std::move(result.first);
+    }
+
+    /// Remove all elements from the cache
+    using base_type::Clear;
+
+    /**
+     * \brief Copy the elements of the current hot keys into the lock-free table
+     * \details Called automatically whenever the detector completes a window. Hot keys that are
+     * not in the cache are skipped, the others are touched in the policy, so they are not evicted
+     * as cold while their lookups are served from the table
+     */
+    void RefreshHotSet() const
+    {
+        const auto hot = detector->HotKeys();
+        typename base_type::profiled_operation_guard lock{this->safe_op, this->lock_profile,
+                                                          cache_operation::lookup};
+        std::vector<std::pair<Key, value_type>> elements;
+
+        elements.reserve(hot.size());
+
+        for (const auto &candidate : hot)
+        {
+            // replicated lookups bypass the policy, the refresh counts as their access
+            const auto result = this->GetInternal(candidate.key);
+
+            if (result.second)
+            {
+                elements.emplace_back(candidate.key, result.first->second);
+            }
+        }
+
+        table->Publish(elements);
+    }
+
+    /**
+     * \brief Keys served without the lock
+     */
+    std::vector<Key> ReplicatedKeys() const
+    {
+        return table->Keys();
+    }
+
+    /**
+     * \brief Keys found hot by the detector with their estimated access counts
+     */
+    std::vector<hot_key<Key>> HotKeys() const
+    {
+        return detector->HotKeys();
+    }
+
+  private:
+    hot_key_cache(std::size_t max_size, std::shared_ptr<hot_key_detector<Key>> detector,
+                  std::shared_ptr<hot_table<Key, Value>> table, const Policy<Key> &policy,
+                  on_erase_cb on_erase)
+        : base_type{max_size, policy, std::move(on_erase), hot_value_storage<Key, Value>{table}},
+          detector{std::move(detector)}, table{std::move(table)}
+    {
+    }
+
+    void RefreshIfWindowCompleted() const
+    {
+        auto refreshed = refreshed_windows.load(std::memory_order_relaxed);
+        const auto windows = detector->Windows();
+
+        // only the thread that claims the new window copies the elements
+        if (refreshed != windows &&
+            refreshed_windows.compare_exchange_strong(refreshed, windows,
+                                                      std::memory_order_relaxed))
+        {
+            RefreshHotSet();
+        }
+    }
+
+    std::shared_ptr<hot_key_detector<Key>> detector;
+    std::shared_ptr<hot_table<Key, Value>> table;
+    mutable std::atomic<std::uint64_t> refreshed_windows{0};
+};
+} // namespace caches
+
+#endif // HOT_KEY_CACHE_HPP
@@ -7,9 +7,10 @@
 
 #include "cache_policy.hpp"
 #include <cstddef>
+#include <functional>
 #include <iostream>
 #include <map>
-#include <unordered_map>
+#include <utility>
 
 namespace caches
 {
@@ -30,10 +31,18 @@ template <typename Key>
 class LFUCachePolicy : public ICachePolicy<Key>
 {
   public:
-    using lfu_iterator = typename std::multimap<std::size_t, Key>::iterator;
+    using frequency_storage_type =
+        std::multimap<std::size_t, Key, std::less<std::size_t>,
+                      counting_allocator<std::pair<const std::size_t, Key>>>;
+    using lfu_iterator = typename frequency_storage_type::iterator;
+    using lfu_storage_type = counted_unordered_map<Key, lfu_iterator>;
 
     LFUCachePolicy() = default;
     ~LFUCachePolicy() override = default;
+    LFUCachePolicy(const LFUCachePolicy &) = default;
+    LFUCachePolicy(LFUCachePolicy &&) = default;
+    LFUCachePolicy &operator=(const LFUCachePolicy &) = default;
+    LFUCachePolicy &operator=(LFUCachePolicy &&) = default;
 
     void Insert(const Key &key) override
     {
@@ -67,9 +76,21 @@ class LFUCachePolicy : public ICachePolicy<Key>
         return frequency_storage.cbegin()->second;
     }
 
+    /**
+     * \brief Count the memory of the policy's containers in the given counter
+     * \details Must be called while the policy is empty
+     */
+    void CountMemory(std::size_t *counter)
+    {
+        const counting_allocator<Key> allocator{counter};
+
+        frequency_storage = frequency_storage_type(std::less<std::size_t>{}, allocator);
+        lfu_storage = lfu_storage_type(0, std::hash<Key>{}, std::equal_to<Key>{}, allocator);
+    }
+
   private:
-    std::multimap<std::size_t, Key> frequency_storage;
-    std::unordered_map<Key, lfu_iterator> lfu_storage;
+    frequency_storage_type frequency_storage;
+    lfu_storage_type lfu_storage;
 };
 } // namespace caches
 
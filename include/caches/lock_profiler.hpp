@@ -0,0 +1,489 @@
+/**
+ * \file
+ * \brief Sampled lock wait and hold time histograms of cache operations
+ */
+#ifndef LOCK_PROFILER_HPP
+#define LOCK_PROFILER_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+#include <utility>
+
+namespace caches
+{
+/**
+ * \brief Operation of a cache, as recorded by lock_profiler
+ */
+enum class cache_operation
+{
+    /// Get, TryGet
+    lookup,
+    /// Cached
+    contains,
+    /// Prefetch
+    prefetch,
+    /// Size, MaxSize, MemoryUsage
+    size,
+    /// A chunk of a walk over the cache: NextChunk, ForEach, MemoryUsage with a value sizer
+    walk,
+    /// Put
+    put,
+    /// Remove
+    remove,
+    /// A batch of SetMaxSize evictions
+    resize,
+    /// InvalidateAll, a chunk of InvalidateIf, Clear
+    invalidate,
+    /// A batch of ReclaimInvalidated
+    reclaim,
+    /// SetAccessObserver
+    configure,
+    /// A batch of queued operations (see async_cache)
+    batch
+};
+
+/**
+ * \brief Part of an operation, as recorded by lock_profiler
+ */
+enum class lock_phase
+{
+    /// Waiting for the cache lock
+    wait,
+    /// Holding the cache lock: hash map lookup, policy update, value storage hooks
+    hold,
+    /// Delivering erase notifications after the lock is released
+    notify
+};
+
+/**
+ * \brief Concurrent log-linear histogram of latencies in nanoseconds
+ * \details Every power of two is split into 4 linear buckets, so a recorded latency is reported
+ * with an error below 25% over the whole range. Latencies above 2^40 ns (about 18 minutes) fall
+ * into the last bucket. Recording is a few relaxed atomic operations
+ */
+class latency_histogram
+{
+  public:
+    static constexpr std::size_t SUB_BUCKET_BITS = 2;
+    static constexpr std::size_t SUB_BUCKETS = std::size_t{1} << SUB_BUCKET_BITS;
+    static constexpr std::size_t MAX_BIT = 40;
+    static constexpr std::size_t BUCKETS = (MAX_BIT - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+
+    /**
+     * \brief Index of the bucket that holds the given latency
+     */
+    static std::size_t BucketIndex(std::uint64_t nanoseconds) noexcept
+    {
+        if (nanoseconds < SUB_BUCKETS)
+        {
+            return static_cast<std::size_t>(nanoseconds);
+        }
+
+        std::size_t msb = 0;
+
+        for (auto rest = nanoseconds; rest > 1; rest >>= 1)
+        {
+            ++msb;
+        }
+
+        if (msb > MAX_BIT)
+        {
+            return BUCKETS - 1;
+        }
+
+        const auto shift = msb - SUB_BUCKET_BITS;
+        const auto sub_bucket = static_cast<std::size_t>(nanoseconds >> shift) & (SUB_BUCKETS - 1);
+
+        return (shift + 1) * SUB_BUCKETS + sub_bucket;
+    }
+
+    /**
+     * \brief Smallest latency that falls into the bucket with the given index
+     */
+    static std::uint64_t BucketLowerBound(std::size_t index) noexcept
+    {
+        if (index < SUB_BUCKETS)
+        {
+            return index;
+        }
+
+        const auto shift = index / SUB_BUCKETS - 1;
+
+        return static_cast<std::uint64_t>(SUB_BUCKETS + index % SUB_BUCKETS) << shift;
+    }
+
+    /**
+     * \brief Largest latency that falls into the bucket with the given index
+     */
+    static std::uint64_t BucketUpperBound(std::size_t index) noexcept
+    {
+        return index + 1 < BUCKETS ? BucketLowerBound(index + 1) - 1
+                                   : std::numeric_limits<std::uint64_t>::max();
+    }
+
+    void Record(std::uint64_t nanoseconds) noexcept
+    {
+        buckets[BucketIndex(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+        sum.fetch_add(nanoseconds, std::memory_order_relaxed);
+
+        auto current = max.load(std::memory_order_relaxed);
+
+        while (current < nanoseconds &&
+               !max.compare_exchange_weak(current, nanoseconds, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    /**
+     * \brief Number of recorded latencies
+     */
+    std::uint64_t Count() const noexcept
+    {
+        return count.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief Sum of the recorded latencies
+     */
+    std::uint64_t Sum() const noexcept
+    {
+        return sum.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief Largest recorded latency
+     */
+    std::uint64_t Max() const noexcept
+    {
+        return max.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief Number of recorded latencies in the bucket with the given index
+     */
+    std::uint64_t BucketCount(std::size_t index) const noexcept
+    {
+        return buckets[index].load(std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief Latency below which the given share of the recorded latencies falls
+     * \details Reported as the upper bound of the bucket that holds the quantile (at most the
+     * largest recorded latency)
+     * \param[in] quantile Share of the recorded latencies [0, 1]
+     * \return Latency in nanoseconds, 0 if nothing has been recorded
+     */
+    std::uint64_t ValueAt(double quantile) const noexcept
+    {
+        std::uint64_t total = 0;
+
+        for (const auto &bucket : buckets)
+        {
+            total += bucket.load(std::memory_order_relaxed);
+        }
+
+        if (total == 0)
+        {
+            return 0;
+        }
+
+        const auto rank = static_cast<std::uint64_t>(quantile * static_cast<double>(total));
+        std::uint64_t seen = 0;
+
+        for (std::size_t i = 0; i < BUCKETS; ++i)
+        {
+            seen += buckets[i].load(std::memory_order_relaxed);
+
+            if (seen > rank || seen == total)
+            {
+                return std::min(BucketUpperBound(i), Max());
+            }
+        }
+
+        return Max();
+    }
+
+    /**
+     * \brief Forget all recorded latencies
+     * \details Latencies recorded concurrently may be partially forgotten
+     */
+    void Reset() noexcept
+    {
+        for (auto &bucket : buckets)
+        {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+
+        count.store(0, std::memory_order_relaxed);
+        sum.store(0, std::memory_order_relaxed);
+        max.store(0, std::memory_order_relaxed);
+    }
+
+  private:
+    std::array<std::atomic<std::uint64_t>, BUCKETS> buckets{};
+    std::atomic<std::uint64_t> count{0};
+    std::atomic<std::uint64_t> sum{0};
+    std::atomic<std::uint64_t> max{0};
+};
+
+/**
+ * \brief Sampled latency histograms of the operations of a cache, one per operation and phase
+ * \details One of `sample_rate` operations of a thread is timed, so operations that are not
+ * sampled cost a thread-local increment. All methods may be called concurrently with the cache
+ * operations
+ */
+class lock_profiler
+{
+  public:
+    static constexpr bool enabled = true;
+    static constexpr std::size_t OPERATIONS = static_cast<std::size_t>(cache_operation::batch) + 1;
+    static constexpr std::size_t PHASES = static_cast<std::size_t>(lock_phase::notify) + 1;
+
+    using clock = std::chrono::steady_clock;
+
+    /**
+     * \brief Construct profiler
+     * \param[in] sample_rate One of `sample_rate` operations of a thread is timed, 0 pauses
+     * profiling
+     */
+    explicit lock_profiler(std::size_t sample_rate = 64) noexcept : sample_rate{sample_rate}
+    {
+    }
+
+    void SetSampleRate(std::size_t rate) noexcept
+    {
+        sample_rate.store(rate, std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief Decide whether the current operation of the calling thread is timed
+     * \details Called once per operation, all phases of a sampled operation are timed
+     */
+    bool Sample() const noexcept
+    {
+        static thread_local std::size_t ticks = 0;
+        const auto rate = sample_rate.load(std::memory_order_relaxed);
+
+        return rate != 0 && ++ticks % rate == 0;
+    }
+
+    latency_histogram &Histogram(cache_operation operation, lock_phase phase) noexcept
+    {
+        return histograms[Index(operation, phase)];
+    }
+
+    const latency_histogram &Histogram(cache_operation operation, lock_phase phase) const noexcept
+    {
+        return histograms[Index(operation, phase)];
+    }
+
+    /**
+     * \brief Record the latency of a phase of an operation
+     */
+    void Record(cache_operation operation, lock_phase phase, clock::duration latency) noexcept
+    {
+        const auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(latency);
+
+        Histogram(operation, phase).Record(static_cast<std::uint64_t>(nanoseconds.count()));
+    }
+
+    /**
+     * \brief Run the given phase of an operation outside the lock, timing it if sampled
+     * \param[in] sampled Sampling decision of the operation (see profiled_lock::Sampled)
+     */
+    template <typename F>
+    void Time(cache_operation operation, lock_phase phase, bool sampled, F &&work)
+    {
+        if (!sampled)
+        {
+            work();
+            return;
+        }
+
+        const auto started = clock::now();
+
+        work();
+        Record(operation, phase, clock::now() - started);
+    }
+
+    /**
+     * \brief Write a line per recorded operation phase: operation, phase, number of samples,
+     * mean, 50th, 90th, 99th, 99.9th percentile and maximum latency in nanoseconds
+     */
+    void Dump(std::ostream &stream) const
+    {
+        stream << "operation phase samples mean p50 p90 p99 p999 max\n";
+
+        for (std::size_t i = 0; i < OPERATIONS; ++i)
+        {
+            for (std::size_t j = 0; j < PHASES; ++j)
+            {
+                const auto operation = static_cast<cache_operation>(i);
+                const auto phase = static_cast<lock_phase>(j);
+                const auto &histogram = Histogram(operation, phase);
+                const auto samples = histogram.Count();
+
+                if (samples == 0)
+                {
+                    continue;
+                }
+
+                stream << Name(operation) << ' ' << Name(phase) << ' ' << samples << ' '
+                       << histogram.Sum() / samples << ' ' << histogram.ValueAt(0.5) << ' '
+                       << histogram.ValueAt(0.9) << ' ' << histogram.ValueAt(0.99) << ' '
+                       << histogram.ValueAt(0.999) << ' ' << histogram.Max() << '\n';
+            }
+        }
+    }
+
+    /**
+     * \brief Forget all recorded latencies
+     */
+    void Reset() noexcept
+    {
+        for (auto &histogram : histograms)
+        {
+            histogram.Reset();
+        }
+    }
+
+    static const char *Name(cache_operation operation) noexcept
+    {
+        static const char *const names[] = {"lookup", "contains", "prefetch",   "size",
+                                            "walk",   "put",      "remove",     "resize",
+                                            "invalidate", "reclaim", "configure", "batch"};
+
+        return names[static_cast<std::size_t>(operation)];
+    }
+
+    static const char *Name(lock_phase phase) noexcept
+    {
+        static const char *const names[] = {"wait", "hold", "notify"};
+
+        return names[static_cast<std::size_t>(phase)];
+    }
+
+  private:
+    static std::size_t Index(cache_operation operation, lock_phase phase) noexcept
+    {
+        return static_cast<std::size_t>(operation) * PHASES + static_cast<std::size_t>(phase);
+    }
+
+    std::atomic<std::size_t> sample_rate;
+    std::array<latency_histogram, OPERATIONS * PHASES> histograms;
+};
+
+/**
+ * \brief Profile of a cache built without lock profiling, every operation on it does nothing
+ */
+class no_lock_profile
+{
+  public:
+    static constexpr bool enabled = false;
+
+    void SetSampleRate(std::size_t) noexcept
+    {
+    }
+
+    template <typename F>
+    void Time(cache_operation, lock_phase, bool, F &&work)
+    {
+        work();
+    }
+
+    void Dump(std::ostream &) const
+    {
+    }
+
+    void Reset() noexcept
+    {
+    }
+};
+
+#ifdef CACHES_PROFILE_LOCKS
+/**
+ * \brief Lock profile of fixed_sized_cache: lock_profiler if `CACHES_PROFILE_LOCKS` is defined,
+ * no_lock_profile otherwise
+ * \details The macro has to be defined the same way in every translation unit of a program
+ */
+using cache_lock_profile = lock_profiler;
+#else
+using cache_lock_profile = no_lock_profile;
+#endif
+
+/**
+ * \brief Lock guard that records its wait and hold times in the given profile when sampled
+ * \tparam Guard Type of the underlying lock guard
+ * \tparam Profile lock_profiler or no_lock_profile
+ */
+template <typename Guard, typename Profile>
+class profiled_lock
+{
+  public:
+    template <typename Mutex>
+    profiled_lock(Mutex &mutex, Profile &profile, cache_operation operation)
+        : profile(profile), operation{operation}, sampled{profile.Sample()},
+          requested{sampled ? clock::now() : time_point{}}, guard{mutex},
+          acquired{sampled ? clock::now() : time_point{}}
+    {
+    }
+
+    profiled_lock(const profiled_lock &) = delete;
+    profiled_lock &operator=(const profiled_lock &) = delete;
+
+    /**
+     * \brief Whether the operation is sampled, so its phases after the lock are timed as well
+     */
+    bool Sampled() const noexcept
+    {
+        return sampled;
+    }
+
+    ~profiled_lock()
+    {
+        if (sampled)
+        {
+            profile.Record(operation, lock_phase::wait, acquired - requested);
+            profile.Record(operation, lock_phase::hold, clock::now() - acquired);
+        }
+    }
+
+  private:
+    using clock = typename Profile::clock;
+    using time_point = typename clock::time_point;
+
+    Profile &profile;
+    cache_operation operation;
+    bool sampled;
+    time_point requested;
+    Guard guard;
+    time_point acquired;
+};
+
+template <typename Guard>
+class profiled_lock<Guard, no_lock_profile>
+{
+  public:
+    template <typename Mutex>
+    profiled_lock(Mutex &mutex, no_lock_profile &, cache_operation) : guard{mutex}
+    {
+    }
+
+    bool Sampled() const noexcept
+    {
+        return false;
+    }
+
+  private:
+    Guard guard;
+};
+} // namespace caches
+
+#endif // LOCK_PROFILER_HPP
@@ -6,8 +6,9 @@
 #define LRU_CACHE_POLICY_HPP
 
 #include "cache_policy.hpp"
+#include <cstddef>
+#include <functional>
 #include <list>
-#include <unordered_map>
 
 namespace caches
 {
@@ -37,10 +38,16 @@ template <typename Key>
 class LRUCachePolicy : public ICachePolicy<Key>
 {
   public:
-    using lru_iterator = typename std::list<Key>::iterator;
+    using lru_queue_type = std::list<Key, counting_allocator<Key>>;
+    using lru_iterator = typename lru_queue_type::iterator;
+    using key_finder_type = counted_unordered_map<Key, lru_iterator>;
 
     LRUCachePolicy() = default;
     ~LRUCachePolicy() override = default;
+    LRUCachePolicy(const LRUCachePolicy &) = default;
+    LRUCachePolicy(LRUCachePolicy &&) = default;
+    LRUCachePolicy &operator=(const LRUCachePolicy &) = default;
+    LRUCachePolicy &operator=(LRUCachePolicy &&) = default;
 
     void Insert(const Key &key) override
     {
@@ -67,9 +74,21 @@ class LRUCachePolicy : public ICachePolicy<Key>
         return lru_queue.back();
     }
 
+    /**
+     * \brief Count the memory of the policy's containers in the given counter
+     * \details Must be called while the policy is empty
+     */
+    void CountMemory(std::size_t *counter)
+    {
+        const counting_allocator<Key> allocator{counter};
+
+        lru_queue = lru_queue_type(allocator);
+        key_finder = key_finder_type(0, std::hash<Key>{}, std::equal_to<Key>{}, allocator);
+    }
+
   private:
-    std::list<Key> lru_queue;
-    std::unordered_map<Key, lru_iterator> key_finder;
+    lru_queue_type lru_queue;
+    key_finder_type key_finder;
 };
 } // namespace caches
 
@@ -0,0 +1,323 @@
+/**
+ * \file
+ * \brief Dependency-free LZ77 family codec
+ */
+#ifndef LZ_CODEC_HPP
+#define LZ_CODEC_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace caches
+{
+/**
+ * \brief Fast byte-oriented LZ77 codec in the spirit of LZ4
+ * \details The compressed block starts with the uncompressed size (LEB128 varint) followed by a
+ * sequence of tokens. Every token holds a run of literals and a back reference (offset up to
+ * 64 KiB, length of at least 4 bytes) to the already decompressed data. The last token holds
+ * literals only. Matches are found with a single-probe hash table of 4-byte sequences, so
+ * compression is a single pass over the input and decompression is a sequence of memory copies.
+ * The hash table is kept per thread and only the part proportional to the input is cleared, so
+ * compressing a small value costs no allocation and a few hundred bytes of clearing.
+ *
+ * Any codec used with compressed_cache has to provide the same `Compress`/`Decompress` interface.
+ * Decompression validates the block and fails on malformed input instead of reading or writing
+ * out of bounds
+ */
+class lz_codec
+{
+  public:
+    /**
+     * \brief Compress the given bytes
+     * \param[in] data Bytes to compress
+     * \param[in] size Number of bytes to compress
+     * \param[out] out Compressed block
+     */
+    void Compress(const char *data, std::size_t size, std::string &out) const
+    {
+        out.clear();
+        out.reserve(size + size / 255 + 16);
+        PutVarint(size, out);
+
+        const auto *in = reinterpret_cast<const unsigned char *>(data);
+        const unsigned hash_log = HashLog(size);
+        auto *const table = Table();
+        std::size_t anchor = 0;
+
+        std::fill(table, table + (std::size_t{1} << hash_log), 0);
+
+        std::size_t pos = 0;
+
+        while (pos + MIN_MATCH <= size)
+        {
+            const std::uint32_t sequence = Read32(in + pos);
+            auto &slot = table[Hash(sequence, hash_log)];
+            // slots keep position + 1, so 0 means empty
+            const std::size_t candidate = slot;
+
+            slot = static_cast<std::uint32_t>(pos + 1);
+
+            if (candidate == 0 || pos - (candidate - 1) > MAX_OFFSET ||
+                Read32(in + candidate - 1) != sequence)
+            {
+                // step over incompressible data faster the longer it lasts
+                pos += 1 + ((pos - anchor) >> SKIP_SHIFT);
+                continue;
+            }
+
+            const std::size_t match = candidate - 1;
+            std::size_t length = MIN_MATCH;
+
+            while (pos + length < size && in[match + length] == in[pos + length])
+            {
+                ++length;
+            }
+
+            PutSequence(in + anchor, pos - anchor, pos - match, length, out);
+            pos += length;
+            anchor = pos;
+        }
+
+        PutSequence(in + anchor, size - anchor, 0, 0, out);
+    }
+
+    /**
+     * \brief Decompress the given block
+     * \param[in] data Compressed block
+     * \param[in] size Size of the compressed block
+     * \param[out] out Decompressed bytes
+     * \retval true The block has been decompressed
+     * \retval false The block is malformed
+     */
+    bool Decompress(const char *data, std::size_t size, std::string &out) const
+    {
+        const auto *in = reinterpret_cast<const unsigned char *>(data);
+        const auto *const end = in + size;
+        std::uint64_t original_size;
+
+        if (!GetVarint(in, end, original_size) || original_size > MAX_BLOCK)
+        {
+            return false;
+        }
+
+        out.resize(static_cast<std::size_t>(original_size));
+
+        char *const dst = &out[0];
+        std::size_t written = 0;
+
+        for (;;)
+        {
+            if (in == end)
+            {
+                return false;
+            }
+
+            const unsigned token = *in++;
+            std::size_t literals = token >> 4;
+
+            if (literals == RUN_MASK && !GetLength(in, end, literals))
+            {
+                return false;
+            }
+
+            if (static_cast<std::size_t>(end - in) < literals ||
+                out.size() - written < literals)
+            {
+                return false;
+            }
+
+            std::memcpy(dst + written, in, literals);
+            in += literals;
+            written += literals;
+
+            if (in == end)
+            {
+                return written == out.size();
+            }
+
+            if (end - in < 2)
+            {
+                return false;
+            }
+
+            const std::size_t offset = in[0] | (static_cast<std::size_t>(in[1]) << 8);
+            std::size_t length = token & RUN_MASK;
+
+            in += 2;
+
+            if (length == RUN_MASK && !GetLength(in, end, length))
+            {
+                return false;
+            }
+
+            length += MIN_MATCH;
+
+            if (offset == 0 || offset > written || out.size() - written < length)
+            {
+                return false;
+            }
+
+            const char *src = dst + written - offset;
+
+            if (offset >= length)
+            {
+                std::memcpy(dst + written, src, length);
+            }
+            else
+            {
+                // overlapping match repeats the last `offset` bytes
+                for (std::size_t i = 0; i < length; ++i)
+                {
+                    dst[written + i] = src[i];
+                }
+            }
+
+            written += length;
+        }
+    }
+
+  private:
+    static constexpr std::size_t MIN_MATCH = 4;
+    static constexpr std::size_t MAX_OFFSET = 65535;
+    static constexpr std::size_t RUN_MASK = 15;
+    // the hash table has 2^HASH_LOG slots, inputs shorter than that use a part of it
+    static constexpr unsigned HASH_LOG = 12;
+    static constexpr unsigned MIN_HASH_LOG = 6;
+    static constexpr unsigned SKIP_SHIFT = 5;
+    // refuse to allocate absurd sizes announced by a corrupted header
+    static constexpr std::uint64_t MAX_BLOCK = std::uint64_t{1} << 32;
+
+    static std::uint32_t Read32(const unsigned char *data) noexcept
+    {
+        std::uint32_t value;
+
+        std::memcpy(&value, data, sizeof(value));
+
+        return value;
+    }
+
+    static std::uint32_t *Table()
+    {
+        static thread_local std::array<std::uint32_t, std::size_t{1} << HASH_LOG> table;
+
+        return table.data();
+    }
+
+    // about one slot per input byte, more slots wouldn't find more matches
+    static unsigned HashLog(std::size_t size) noexcept
+    {
+        unsigned hash_log = MIN_HASH_LOG;
+
+        while (hash_log < HASH_LOG && (std::size_t{1} << (hash_log + 1)) <= size)
+        {
+            ++hash_log;
+        }
+
+        return hash_log;
+    }
+
+    static std::size_t Hash(std::uint32_t sequence, unsigned hash_log) noexcept
+    {
+        return (sequence * 2654435761U) >> (32 - hash_log);
+    }
+
+    static void PutVarint(std::uint64_t value, std::string &out)
+    {
+        while (value >= 0x80)
+        {
+            out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+
+        out.push_back(static_cast<char>(value));
+    }
+
+    static bool GetVarint(const unsigned char *&in, const unsigned char *end,
+                          std::uint64_t &value) noexcept
+    {
+        value = 0;
+
+        for (unsigned shift = 0; shift < 64 && in != end; shift += 7)
+        {
+            const unsigned byte = *in++;
+
+            value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+
+            if ((byte & 0x80) == 0)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    static void PutLength(std::size_t length, std::string &out)
+    {
+        for (; length >= 255; length -= 255)
+        {
+            out.push_back(static_cast<char>(255));
+        }
+
+        out.push_back(static_cast<char>(length));
+    }
+
+    static bool GetLength(const unsigned char *&in, const unsigned char *end,
+                          std::size_t &length) noexcept
+    {
+        for (;;)
+        {
+            if (in == end)
+            {
+                return false;
+            }
+
+            const unsigned byte = *in++;
+
+            length += byte;
+
+            if (byte != 255)
+            {
+                return true;
+            }
+        }
+    }
+
+    // literals followed by a match; a zero length marks the last sequence without a match
+    static void PutSequence(const unsigned char *literals, std::size_t literal_count,
+                            std::size_t offset, std::size_t length, std::string &out)
+    {
+        const std::size_t match_code = length == 0 ? 0 : length - MIN_MATCH;
+        const auto literal_nibble = literal_count < RUN_MASK ? literal_count : RUN_MASK;
+        const auto match_nibble = match_code < RUN_MASK ? match_code : RUN_MASK;
+
+        out.push_back(static_cast<char>((literal_nibble << 4) | match_nibble));
+
+        if (literal_count >= RUN_MASK)
+        {
+            PutLength(literal_count - RUN_MASK, out);
+        }
+
+        out.append(reinterpret_cast<const char *>(literals), literal_count);
+
+        if (length == 0)
+        {
+            return;
+        }
+
+        out.push_back(static_cast<char>(offset & 0xFF));
+        out.push_back(static_cast<char>(offset >> 8));
+
+        if (match_code >= RUN_MASK)
+        {
+            PutLength(match_code - RUN_MASK, out);
+        }
+    }
+};
+} // namespace caches
+
+#endif // LZ_CODEC_HPP
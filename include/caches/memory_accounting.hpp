@@ -0,0 +1,211 @@
+/**
+ * \file
+ * \brief Allocators and traits used to account the memory taken by caches
+ */
+#ifndef MEMORY_ACCOUNTING_HPP
+#define MEMORY_ACCOUNTING_HPP
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+namespace caches
+{
+/**
+ * \brief Memory taken by a cache, in bytes
+ */
+struct memory_usage
+{
+    /// Hash map nodes and buckets
+    std::size_t index = 0;
+    /// Policy metadata: queues, frequency maps and the policies' own key indexes
+    std::size_t policy = 0;
+    /// Value objects with their reference counts, and the memory owned by the values if a value
+    /// sizer has been given
+    std::size_t values = 0;
+
+    std::size_t Total() const noexcept
+    {
+        return index + policy + values;
+    }
+};
+
+/**
+ * \brief Allocator that adds the size of every live allocation to a counter
+ * \details The counter is not synchronized: containers of a cache allocate under the cache lock
+ * only. A default constructed allocator counts nothing, so containers using it behave as with
+ * `std::allocator` until a counter is assigned (see `LRUCachePolicy::CountMemory`). The counter
+ * must outlive the allocations
+ * \tparam T Type of allocated objects
+ */
+template <typename T>
+class counting_allocator
+{
+  public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    counting_allocator() noexcept = default;
+
+    explicit counting_allocator(std::size_t *counter) noexcept : counter{counter}
+    {
+    }
+
+    template <typename U>
+    counting_allocator(const counting_allocator<U> &other) noexcept : counter{other.Counter()}
+    {
+    }
+
+    T *allocate(std::size_t n)
+    {
+        auto *allocated = std::allocator<T>{}.allocate(n);
+
+        if (counter != nullptr)
+        {
+            *counter += n * sizeof(T);
+        }
+
+        return allocated;
+    }
+
+    void deallocate(T *allocated, std::size_t n) noexcept
+    {
+        if (counter != nullptr)
+        {
+            *counter -= n * sizeof(T);
+        }
+
+        std::allocator<T>{}.deallocate(allocated, n);
+    }
+
+    std::size_t *Counter() const noexcept
+    {
+        return counter;
+    }
+
+  private:
+    std::size_t *counter = nullptr;
+};
+
+template <typename T, typename U>
+bool operator==(const counting_allocator<T> &lhs, const counting_allocator<U> &rhs) noexcept
+{
+    return lhs.Counter() == rhs.Counter();
+}
+
+template <typename T, typename U>
+bool operator!=(const counting_allocator<T> &lhs, const counting_allocator<U> &rhs) noexcept
+{
+    return !(lhs == rhs);
+}
+
+/**
+ * \brief `std::unordered_map` whose memory can be counted by a cache
+ */
+template <typename Key, typename T>
+using counted_unordered_map =
+    std::unordered_map<Key, T, std::hash<Key>, std::equal_to<Key>,
+                       counting_allocator<std::pair<const Key, T>>>;
+
+/**
+ * \brief Bytes allocated by measuring_allocator on the calling thread
+ */
+inline std::size_t &measured_bytes() noexcept
+{
+    static thread_local std::size_t bytes = 0;
+
+    return bytes;
+}
+
+/**
+ * \brief Stateless allocator that adds the size of every allocation to measured_bytes()
+ * \details Used with `std::allocate_shared` to learn the size of a control block with the value
+ * without making the control block any larger
+ * \tparam T Type of allocated objects
+ */
+template <typename T>
+class measuring_allocator
+{
+  public:
+    using value_type = T;
+
+    measuring_allocator() noexcept = default;
+
+    template <typename U>
+    measuring_allocator(const measuring_allocator<U> &) noexcept
+    {
+    }
+
+    T *allocate(std::size_t n)
+    {
+        auto *allocated = std::allocator<T>{}.allocate(n);
+
+        measured_bytes() += n * sizeof(T);
+
+        return allocated;
+    }
+
+    void deallocate(T *allocated, std::size_t n) noexcept
+    {
+        std::allocator<T>{}.deallocate(allocated, n);
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const measuring_allocator<T> &, const measuring_allocator<U> &) noexcept
+{
+    return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const measuring_allocator<T> &, const measuring_allocator<U> &) noexcept
+{
+    return false;
+}
+
+/**
+ * \brief Check whether a policy can count the memory of its containers
+ */
+template <typename T, typename = void>
+struct has_memory_counting : std::false_type
+{
+};
+
+template <typename T>
+struct has_memory_counting<
+    T, decltype(std::declval<T &>().CountMemory(std::declval<std::size_t *>()))>
+    : std::true_type
+{
+};
+
+/**
+ * \brief Check whether a value storage reports the size of its elements
+ */
+template <typename T, typename = void>
+struct has_element_bytes : std::false_type
+{
+};
+
+template <typename T>
+struct has_element_bytes<T, decltype(void(std::declval<const T &>().ElementBytes()))>
+    : std::true_type
+{
+};
+
+/**
+ * \brief Check whether a hash map allocates with counting_allocator
+ */
+template <typename Map>
+struct is_counted_map
+    : std::is_same<typename Map::allocator_type,
+                   counting_allocator<typename Map::allocator_type::value_type>>
+{
+};
+} // namespace caches
+
+#endif // MEMORY_ACCOUNTING_HPP
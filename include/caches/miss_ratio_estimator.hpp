@@ -0,0 +1,335 @@
+/**
+ * \file
+ * \brief Online miss ratio curve estimation based on spatially hashed sampling (SHARDS)
+ */
+#ifndef MISS_RATIO_ESTIMATOR_HPP
+#define MISS_RATIO_ESTIMATOR_HPP
+
+#include "cache.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace caches
+{
+/**
+ * \brief Sampling based hit ratio curve estimator
+ * \details Implementation of the fixed-size SHARDS algorithm. Only keys whose hash falls below a
+ * threshold are tracked, so the sampling is consistent: a sampled key is sampled on every access
+ * and reuse distances can be measured exactly within the sample. Distances are scaled by the
+ * sampling rate and accumulated in a histogram which gives the hit ratio of an LRU cache of any
+ * capacity up to `bucket_width * buckets`.
+ *
+ * The number of tracked keys is bounded by `max_samples`: when it is exceeded the keys with the
+ * largest hashes are dropped and the sampling threshold is lowered accordingly.
+ *
+ * Accesses to keys outside of the sample cost one hash computation and a comparison. The estimator
+ * can be attached to fixed_sized_cache with `SetAccessObserver`, results can be queried from any
+ * thread.
+ * \tparam Key Type of a key
+ * \tparam Hash Hash function used for sampling
+ */
+template <typename Key, typename Hash = std::hash<Key>>
+class shards_estimator : public IAccessObserver<Key>
+{
+  public:
+    using curve_type = std::vector<std::pair<std::size_t, double>>;
+
+    /**
+     * \brief Construct the estimator
+     * \throw std::invalid_argument
+     * \param[in] sampling_rate Initial share of keys to track (0, 1]
+     * \param[in] max_samples Maximum number of tracked keys
+     * \param[in] bucket_width Width of a histogram bucket (in cache entries)
+     * \param[in] buckets Number of histogram buckets
+     */
+    explicit shards_estimator(double sampling_rate = 0.01, std::size_t max_samples = 8192,
+                              std::size_t bucket_width = 64, std::size_t buckets = 4096)
+        : threshold{ThresholdOf(sampling_rate)},
+          max_samples{max_samples}, bucket_width{bucket_width}, histogram(buckets, 0.0),
+          fenwick(2 * max_samples + 2, 0)
+    {
+        if (max_samples == 0 || bucket_width == 0 || buckets == 0)
+        {
+            throw std::invalid_argument{"Invalid SHARDS estimator configuration"};
+        }
+    }
+
+    ~shards_estimator() override = default;
+
+    void OnAccess(const Key &key) noexcept override
+    {
+        const auto hash = static_cast<std::uint32_t>(Mix(hasher(key)) % MODULUS);
+
+        if (hash >= threshold.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock{estimator_op};
+
+        if (hash < threshold.load(std::memory_order_relaxed))
+        {
+            Sample(key, hash);
+        }
+    }
+
+    /**
+     * \brief Estimate hit ratio of an LRU cache with the given capacity
+     * \param[in] capacity Hypothetical cache capacity
+     * \return Hit ratio in [0, 1]
+     */
+    double HitRatio(std::size_t capacity) const
+    {
+        std::lock_guard<std::mutex> lock{estimator_op};
+
+        return HitRatioInternal(capacity);
+    }
+
+    /**
+     * \brief Estimate hit ratios for evenly spaced capacities
+     * \param[in] max_capacity The largest capacity to estimate
+     * \param[in] points Number of capacities to estimate
+     * \return Pairs of capacity and estimated hit ratio
+     */
+    curve_type HitRatioCurve(std::size_t max_capacity, std::size_t points) const
+    {
+        std::lock_guard<std::mutex> lock{estimator_op};
+        curve_type curve;
+
+        curve.reserve(points);
+
+        for (std::size_t i = 1; i <= points; ++i)
+        {
+            const auto capacity = max_capacity * i / points;
+            curve.emplace_back(capacity, HitRatioInternal(capacity));
+        }
+
+        return curve;
+    }
+
+    /**
+     * \brief Current share of keys that are tracked
+     */
+    double SamplingRate() const noexcept
+    {
+        return static_cast<double>(threshold.load(std::memory_order_relaxed)) / MODULUS;
+    }
+
+    /**
+     * \brief Number of accesses that have been sampled
+     */
+    std::size_t SampledAccesses() const
+    {
+        std::lock_guard<std::mutex> lock{estimator_op};
+
+        return sampled_accesses;
+    }
+
+    /**
+     * \brief Drop all collected data
+     */
+    void Reset()
+    {
+        std::lock_guard<std::mutex> lock{estimator_op};
+
+        tracked.clear();
+        by_hash.clear();
+        std::fill(histogram.begin(), histogram.end(), 0.0);
+        std::fill(fenwick.begin(), fenwick.end(), 0);
+        total_weight = 0.0;
+        sampled_accesses = 0;
+        now = 0;
+    }
+
+  private:
+    struct sample
+    {
+        std::size_t time;
+        std::uint32_t hash;
+    };
+
+    static constexpr std::uint32_t MODULUS = 1U << 24;
+
+    // validated before the conversion, which is undefined for negative, NaN or huge rates
+    static std::uint32_t ThresholdOf(double sampling_rate)
+    {
+        if (!(sampling_rate > 0.0 && sampling_rate <= 1.0))
+        {
+            throw std::invalid_argument{"Invalid SHARDS estimator configuration"};
+        }
+
+        return static_cast<std::uint32_t>(sampling_rate * MODULUS);
+    }
+
+    static std::uint64_t Mix(std::uint64_t value) noexcept
+    {
+        // splitmix64 finalizer, decorrelates sampling from the hash map's bucket choice
+        value ^= value >> 30;
+        value *= 0xbf58476d1ce4e5b9ULL;
+        value ^= value >> 27;
+        value *= 0x94d049bb133111ebULL;
+        value ^= value >> 31;
+
+        return value;
+    }
+
+    void Sample(const Key &key, std::uint32_t hash)
+    {
+        if (now + 1 == fenwick.size())
+        {
+            Compact();
+        }
+
+        // every sampled access stands for 1/R accesses of the whole key space
+        const auto weight = 1.0 / SamplingRate();
+
+        ++now;
+        ++sampled_accesses;
+        total_weight += weight;
+
+        auto elem_it = tracked.find(key);
+
+        if (elem_it != tracked.end())
+        {
+            const auto prev = elem_it->second.time;
+            const auto distinct = Prefix(now - 1) - Prefix(prev);
+            const auto distance = static_cast<std::size_t>(distinct * weight);
+            const auto bucket = distance / bucket_width;
+
+            if (bucket < histogram.size())
+            {
+                histogram[bucket] += weight;
+            }
+
+            Add(prev, -1);
+            elem_it->second.time = now;
+            Add(now, 1);
+        }
+        else
+        {
+            tracked.emplace(key, sample{now, hash});
+            by_hash.emplace(hash, key);
+            Add(now, 1);
+
+            if (tracked.size() > max_samples)
+            {
+                Shrink();
+            }
+        }
+    }
+
+    void Shrink()
+    {
+        // lower the threshold to the largest tracked hash and drop every key above it
+        const auto new_threshold = by_hash.rbegin()->first;
+
+        threshold.store(new_threshold, std::memory_order_relaxed);
+
+        while (!by_hash.empty() && by_hash.rbegin()->first >= new_threshold)
+        {
+            auto last = std::prev(by_hash.end());
+            auto elem_it = tracked.find(last->second);
+
+            Add(elem_it->second.time, -1);
+            tracked.erase(elem_it);
+            by_hash.erase(last);
+        }
+    }
+
+    void Compact()
+    {
+        // renumber last access times densely to free the timeline for new accesses
+        std::vector<sample *> order;
+
+        order.reserve(tracked.size());
+
+        for (auto &elem : tracked)
+        {
+            order.push_back(&elem.second);
+        }
+
+        std::sort(order.begin(), order.end(),
+                  [](const sample *lhs, const sample *rhs) { return lhs->time < rhs->time; });
+        std::fill(fenwick.begin(), fenwick.end(), 0);
+        now = 0;
+
+        for (auto elem : order)
+        {
+            elem->time = ++now;
+            Add(now, 1);
+        }
+    }
+
+    void Add(std::size_t index, long delta) noexcept
+    {
+        for (; index < fenwick.size(); index += index & (~index + 1))
+        {
+            fenwick[index] += delta;
+        }
+    }
+
+    long Prefix(std::size_t index) const noexcept
+    {
+        long sum = 0;
+
+        for (; index > 0; index -= index & (~index + 1))
+        {
+            sum += fenwick[index];
+        }
+
+        return sum;
+    }
+
+    double HitRatioInternal(std::size_t capacity) const noexcept
+    {
+        if (total_weight == 0.0)
+        {
+            return 0.0;
+        }
+
+        double hits = 0.0;
+
+        for (std::size_t bucket = 0; bucket < histogram.size(); ++bucket)
+        {
+            const auto lower = bucket * bucket_width;
+
+            if (lower >= capacity)
+            {
+                break;
+            }
+
+            // a reuse at distance d hits in an LRU cache of capacity c if d < c
+            const auto covered = std::min(capacity - lower, bucket_width);
+            hits += histogram[bucket] * static_cast<double>(covered) / bucket_width;
+        }
+
+        return hits / total_weight;
+    }
+
+    Hash hasher;
+    std::atomic<std::uint32_t> threshold;
+    std::size_t max_samples;
+    std::size_t bucket_width;
+    std::vector<double> histogram;
+    double total_weight = 0.0;
+    std::size_t sampled_accesses = 0;
+    std::size_t now = 0;
+    std::vector<long> fenwick;
+    std::unordered_map<Key, sample, Hash> tracked;
+    std::multimap<std::uint32_t, Key> by_hash;
+    mutable std::mutex estimator_op;
+};
+} // namespace caches
+
+#endif // MISS_RATIO_ESTIMATOR_HPP
@@ -0,0 +1,359 @@
+/**
+ * \file
+ * \brief Cache that also remembers keys known to be absent
+ */
+#ifndef NEGATIVE_CACHE_HPP
+#define NEGATIVE_CACHE_HPP
+
+#include "cache.hpp"
+#include "cache_policy.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace caches
+{
+/**
+ * \brief Result of a lookup in a negative_cache
+ */
+enum class lookup_status
+{
+    hit,        ///< The element is in the cache
+    known_miss, ///< The key is known to be absent in the backing store
+    unknown     ///< Nothing is known about the key
+};
+
+/**
+ * \brief Compact set of key hashes with approximate expiration
+ * \details Each hash is stored as a 32-bit fingerprint in one of its two candidate buckets of 4
+ * slots in a fixed-size table with a quarter of spare slots. When both buckets are full, one of
+ * their fingerprints is overwritten, so the set loses entries instead of growing.
+ *
+ * Expiration uses two tables instead of per-entry timestamps: time is split into periods of
+ * `ttl / 2`, new entries go to the table of the current period, and the table of the period
+ * before the previous one is dropped. An entry is therefore reported for at least `ttl / 2` and
+ * less than `ttl` after its insertion.
+ *
+ * Different keys may share a fingerprint, so `Contains` has a false positive rate of about
+ * 4 * 10^-9 per lookup (16 compared fingerprints).
+ * \tparam Clock Type of a clock to measure the time to live with
+ */
+template <typename Clock = std::chrono::steady_clock>
+class negative_filter
+{
+  public:
+    /**
+     * \brief Construct filter
+     * \throw std::invalid_argument
+     * \param[in] capacity Number of hashes a table can hold
+     * \param[in] ttl Maximum time an entry is reported for
+     */
+    negative_filter(std::size_t capacity, typename Clock::duration ttl)
+        : period{ttl / 2}, period_start{Clock::now()}
+    {
+        if (capacity == 0 || period <= Clock::duration::zero())
+        {
+            throw std::invalid_argument{"Capacity and half of time to live should be positive"};
+        }
+
+        std::size_t buckets = 1;
+
+        // a quarter of the slots is kept spare, so few entries are lost at the full capacity
+        while (buckets * SLOTS < capacity + capacity / 4)
+        {
+            buckets <<= 1;
+        }
+
+        mask = buckets - 1;
+        tables[0].assign(buckets * SLOTS, std::uint32_t{EMPTY});
+        tables[1].assign(buckets * SLOTS, std::uint32_t{EMPTY});
+    }
+
+    /**
+     * \brief Add the given hash
+     */
+    void Insert(std::size_t hash)
+    {
+        Rotate();
+
+        const auto mixed = Mix(hash);
+        const auto fingerprint = Fingerprint(mixed);
+        auto &table = tables[current];
+        std::uint32_t *free_slot = nullptr;
+
+        for (auto *bucket : {Bucket(table, mixed, 0), Bucket(table, mixed, 1)})
+        {
+            for (std::size_t i = 0; i < SLOTS; ++i)
+            {
+                if (bucket[i] == fingerprint)
+                {
+                    return;
+                }
+
+                if (bucket[i] == EMPTY && free_slot == nullptr)
+                {
+                    free_slot = bucket + i;
+                }
+            }
+        }
+
+        if (free_slot == nullptr)
+        {
+            // both buckets are full: overwrite a fingerprint picked by the hash
+            free_slot = Bucket(table, mixed, (mixed >> 30) & 1) + ((mixed >> 28) % SLOTS);
+        }
+
+        *free_slot = fingerprint;
+    }
+
+    /**
+     * \brief Check whether the given hash has been added and hasn't expired yet
+     */
+    bool Contains(std::size_t hash)
+    {
+        Rotate();
+
+        const auto mixed = Mix(hash);
+        const auto fingerprint = Fingerprint(mixed);
+
+        for (auto &table : tables)
+        {
+            for (std::size_t choice = 0; choice < 2; ++choice)
+            {
+                const auto *bucket = Bucket(table, mixed, choice);
+
+                if (std::find(bucket, bucket + SLOTS, fingerprint) != bucket + SLOTS)
+                {
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    /**
+     * \brief Remove the given hash
+     */
+    void Erase(std::size_t hash)
+    {
+        const auto mixed = Mix(hash);
+        const auto fingerprint = Fingerprint(mixed);
+
+        for (auto &table : tables)
+        {
+            for (std::size_t choice = 0; choice < 2; ++choice)
+            {
+                auto *bucket = Bucket(table, mixed, choice);
+
+                std::replace(bucket, bucket + SLOTS, fingerprint, std::uint32_t{EMPTY});
+            }
+        }
+    }
+
+    /**
+     * \brief Remove all hashes
+     */
+    void Clear()
+    {
+        Drop(0);
+        Drop(1);
+    }
+
+    /**
+     * \brief Memory taken by the tables in bytes
+     */
+    std::size_t TableBytes() const noexcept
+    {
+        return (tables[0].size() + tables[1].size()) * sizeof(std::uint32_t);
+    }
+
+  private:
+    static constexpr std::size_t SLOTS = 4;
+    static constexpr std::uint32_t EMPTY = 0;
+
+    static std::uint64_t Mix(std::uint64_t hash) noexcept
+    {
+        // finalizer of MurmurHash3, spreads poor hashes (e.g. identity hashes of integers)
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 33;
+        hash *= 0xc4ceb9fe1a85ec53ULL;
+        hash ^= hash >> 33;
+
+        return hash;
+    }
+
+    static std::uint32_t Fingerprint(std::uint64_t mixed) noexcept
+    {
+        const auto fingerprint = static_cast<std::uint32_t>(mixed >> 32);
+
+        return fingerprint == EMPTY ? 1 : fingerprint;
+    }
+
+    // every hash has two candidate buckets, which keeps the table usable at a high load
+    std::uint32_t *Bucket(std::vector<std::uint32_t> &table, std::uint64_t mixed,
+                          std::size_t choice) const noexcept
+    {
+        const auto index = choice == 0 ? mixed : mixed >> 16;
+
+        return table.data() + (static_cast<std::size_t>(index) & mask) * SLOTS;
+    }
+
+    void Rotate()
+    {
+        const auto elapsed = Clock::now() - period_start;
+
+        if (elapsed < period)
+        {
+            return;
+        }
+
+        const auto periods = elapsed / period;
+
+        current ^= 1;
+        Drop(current);
+
+        if (periods > 1)
+        {
+            // the previous period has passed as well
+            Drop(current ^ 1);
+        }
+
+        period_start += period * periods;
+    }
+
+    void Drop(std::size_t table)
+    {
+        std::fill(tables[table].begin(), tables[table].end(), std::uint32_t{EMPTY});
+    }
+
+    typename Clock::duration period;
+    typename Clock::time_point period_start;
+    std::size_t mask;
+    std::size_t current = 0;
+    std::vector<std::uint32_t> tables[2];
+};
+
+/**
+ * \brief Fixed sized cache that also records keys known to be absent in the backing store
+ * \details Known-absent keys are kept in a negative_filter instead of the cache itself, so they
+ * neither take full entries nor push real elements out. `TryGet` reports whether the element has
+ * been found, is known to be absent or nothing is known about it. Putting a value for a key
+ * removes its absence record.
+ * \tparam Key Type of a key (should be hashable)
+ * \tparam Value Type of a value stored in the cache
+ * \tparam Policy Type of a policy to be used with the cache
+ * \tparam Clock Type of a clock to measure the time to live of absence records with
+ */
+template <typename Key, typename Value, template <typename> class Policy = NoCachePolicy,
+          typename Clock = std::chrono::steady_clock>
+class negative_cache : public fixed_sized_cache<Key, Value, Policy>
+{
+    using base_type = fixed_sized_cache<Key, Value, Policy>;
+
+  public:
+    using typename base_type::on_erase_cb;
+    using typename base_type::value_type;
+
+    /**
+     * \brief Construct cache
+     * \throw std::invalid_argument
+     * \param[in] max_size Maximum size of the cache
+     * \param[in] absent_capacity Number of absent keys that can be recorded
+     * \param[in] absent_ttl Maximum time an absent key is reported as a known miss
+     * \param[in] policy Cache policy to use
+     * \param[in] on_erase on_erase_cb function to be called when cache's element get erased
+     */
+    negative_cache(std::size_t max_size, std::size_t absent_capacity,
+                   typename Clock::duration absent_ttl, const Policy<Key> &policy = Policy<Key>{},
+                   on_erase_cb on_erase = on_erase_cb{})
+        : base_type{max_size, policy, std::move(on_erase)}, absent{absent_capacity, absent_ttl}
+    {
+    }
+
+    /**
+     * \brief Put element into the cache
+     * \param[in] key Key value to use
+     * \param[in] value Value to assign to the given key
+     */
+    void Put(const Key &key, const Value &value)
+    {
+        this->Modify(
+            cache_operation::put,
+            [&]
+            {
+                absent.Erase(std::hash<Key>{}(key));
+                this->PutLocked(key, value);
+            });
+    }
+
+    /**
+     * \brief Record that the backing store has no element with the given key
+     * \details The element is removed from the cache if it's there
+     * \param[in] key Key of the absent element
+     */
+    void PutAbsent(const Key &key)
+    {
+        this->Modify(
+            cache_operation::remove,
+            [&]
+            {
+                auto elem_it = this->FindElem(key);
+
+                if (elem_it != this->end())
+                {
+                    this->Erase(elem_it, erase_cause::removed);
+                }
+
+                absent.Insert(std::hash<Key>{}(key));
+            });
+    }
+
+    /**
+     * \brief Try to get an element by the given key from the cache
+     * \param[in] key Get element by key
+     * \return Pair of the value (`nullptr` unless it's a hit) and the status of the lookup
+     */
+    std::pair<value_type, lookup_status> TryGet(const Key &key) const
+    {
+        typename base_type::profiled_operation_guard lock{this->safe_op, this->lock_profile,
+                                                          cache_operation::lookup};
+
+        this->NotifyAccess(key);
+        const auto result = this->GetInternal(key);
+
+        if (result.second)
+        {
+            return {result.first->second, lookup_status::hit};
+        }
+
+        return {nullptr, absent.Contains(std::hash<Key>{}(key)) ? lookup_status::known_miss
+                                                                : lookup_status::unknown};
+    }
+
+    /**
+     * \brief Forget all recorded absent keys
+     */
+    void ClearAbsent()
+    {
+        typename base_type::profiled_operation_guard lock{this->safe_op, this->lock_profile,
+                                                          cache_operation::invalidate};
+
+        absent.Clear();
+    }
+
+  private:
+    mutable negative_filter<Clock> absent;
+};
+} // namespace caches
+
+#endif // NEGATIVE_CACHE_HPP
@@ -0,0 +1,756 @@
+/**
+ * \file
+ * \brief Cache shared by processes through a POSIX shared memory segment
+ */
+#ifndef SHARED_MEMORY_CACHE_HPP
+#define SHARED_MEMORY_CACHE_HPP
+
+#include "cache.hpp"
+#include "value_serializer.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace caches
+{
+/**
+ * \brief Eviction policy of a shared_memory_cache
+ */
+enum class shared_memory_policy : std::uint32_t
+{
+    /// Evict the least recently used element, as LRUCachePolicy does
+    lru,
+    /// Evict the element inserted first, as FIFOCachePolicy does
+    fifo
+};
+
+/**
+ * \brief Fixed sized cache that lives in a POSIX shared memory segment
+ * \details All processes that construct the cache with the same segment name share a single set
+ * of elements: the first one creates and formats the segment, the others attach to it and check
+ * that it has been created with the same parameters.
+ *
+ * The segment is a fixed arena of `max_size` slots with room for a serialized key of at most
+ * `max_key_size` bytes and a serialized value of at most `max_value_size` bytes, a hash index and
+ * the eviction order. All links are slot indexes rather than pointers, so the segment may be
+ * mapped at different addresses in different processes. Policies of fixed_sized_cache keep their
+ * state in the heap of a process, so the eviction order is kept in the segment instead (see
+ * shared_memory_policy).
+ *
+ * Operations are serialized with a process-shared robust mutex. If a process dies while holding
+ * it, the next process that takes the lock clears the cache, since the process might have left it
+ * half modified. Values are copied out of the segment, so a returned value stays valid whatever
+ * other processes do.
+ *
+ * Keys are hashed with `std::hash<Key>` in every process, so all processes have to run the same
+ * build. The segment outlives the processes until it's removed with Unlink. A segment that its
+ * creator has not formatted within a few seconds (e.g. because it has died) is removed and
+ * created again.
+ * \tparam Key Type of a key
+ * \tparam Value Type of a value
+ * \tparam KeySerializer Type that converts keys to bytes and back (see value_serializer). Keys are
+ * compared by their bytes, so equal keys must serialize to equal bytes
+ * \tparam ValueSerializer Type that converts values to bytes and back (see value_serializer)
+ */
+template <typename Key, typename Value, typename KeySerializer = value_serializer<Key>,
+          typename ValueSerializer = value_serializer<Value>>
+class shared_memory_cache
+{
+  public:
+    using value_type = WrappedValue<Value>;
+
+    /**
+     * \brief Create the shared memory segment or attach to the existing one
+     * \throw std::invalid_argument
+     * \throw std::system_error
+     * \param[in] name Name of the segment, e.g. "/my-cache" (see shm_open)
+     * \param[in] max_size Maximum number of elements
+     * \param[in] max_key_size Maximum size of a serialized key in bytes
+     * \param[in] max_value_size Maximum size of a serialized value in bytes
+     * \param[in] policy Eviction policy
+     */
+    shared_memory_cache(std::string name, std::size_t max_size, std::size_t max_key_size,
+                        std::size_t max_value_size,
+                        shared_memory_policy policy = shared_memory_policy::lru)
+        : name{std::move(name)}
+    {
+        if (max_size == 0 || max_size >= NIL || max_key_size == 0 || max_value_size == 0 ||
+            max_key_size > MAX_ITEM_SIZE || max_value_size > MAX_ITEM_SIZE)
+        {
+            throw std::invalid_argument{"Size of the cache and its elements should be non-zero"};
+        }
+
+        layout.max_size = static_cast<std::uint32_t>(max_size);
+        layout.max_key_size = static_cast<std::uint32_t>(max_key_size);
+        layout.max_value_size = static_cast<std::uint32_t>(max_value_size);
+        layout.policy = policy;
+
+        Map();
+    }
+
+    shared_memory_cache(const shared_memory_cache &) = delete;
+    shared_memory_cache &operator=(const shared_memory_cache &) = delete;
+
+    ~shared_memory_cache()
+    {
+        ::munmap(segment, segment_size);
+        ::close(fd);
+    }
+
+    /**
+     * \brief Remove the segment with the given name
+     * \details Processes that have the segment mapped keep using it, processes constructing a
+     * cache with the same name afterwards create a new one
+     * \retval true The segment has been removed
+     * \retval false There is no such segment
+     */
+    static bool Unlink(const std::string &name) noexcept
+    {
+        return ::shm_unlink(name.c_str()) == 0;
+    }
+
+    /**
+     * \brief Put element into the cache
+     * \param[in] key Key value to use
+     * \param[in] value Value to assign to the given key
+     * \retval true The element is stored
+     * \retval false The serialized key or value is larger than the cache allows
+     */
+    bool Put(const Key &key, const Value &value)
+    {
+        std::string key_data;
+        std::string value_data;
+
+        KeySerializer::Serialize(key, key_data);
+        ValueSerializer::Serialize(value, value_data);
+
+        if (key_data.size() > header->max_key_size || value_data.size() > header->max_value_size)
+        {
+            return false;
+        }
+
+        const auto hash = static_cast<std::uint64_t>(std::hash<Key>{}(key));
+        segment_lock lock{*this};
+        auto index = Find(hash, key_data);
+
+        if (index != NIL)
+        {
+            Touch(index);
+        }
+        else
+        {
+            if (header->free_head == NIL)
+            {
+                Erase(header->tail);
+            }
+
+            index = header->free_head;
+            header->free_head = Slot(index).next;
+            Insert(index, hash, key_data);
+        }
+
+        auto &slot = Slot(index);
+
+        slot.value_size = static_cast<std::uint32_t>(value_data.size());
+        std::memcpy(ValueData(index), value_data.data(), value_data.size());
+
+        return true;
+    }
+
+    /**
+     * \brief Try to get an element by the given key from the cache
+     * \param[in] key Get element by key
+     * \return Pair of a copy of the value and boolean value that shows whether the element is in
+     * the cache
+     */
+    std::pair<value_type, bool> TryGet(const Key &key) const
+    {
+        std::string key_data;
+
+        KeySerializer::Serialize(key, key_data);
+
+        const auto hash = static_cast<std::uint64_t>(std::hash<Key>{}(key));
+        segment_lock lock{*this};
+        const auto index = Find(hash, key_data);
+
+        if (index == NIL)
+        {
+            return {nullptr, false};
+        }
+
+        Touch(index);
+
+        auto value = std::make_shared<Value>();
+
+        if (!ValueSerializer::Deserialize(ValueData(index), Slot(index).value_size, *value))
+        {
+            return {nullptr, false};
+        }
+
+        return {std::move(value), true};
+    }
+
+    /**
+     * \brief Get element from the cache if present
+     * \throw std::range_error
+     * \param[in] key Get element by key
+     * \return Copy of the value stored by the specified key in the cache
+     */
+    value_type Get(const Key &key) const
+    {
+        auto elem = TryGet(key);
+
+        if (!elem.second)
+        {
+            throw std::range_error{"No such element in the cache"};
+        }
+
+        return elem.first;
+    }
+
+    /**
+     * \brief Check whether the given key is presented in the cache
+     */
+    bool Cached(const Key &key) const
+    {
+        std::string key_data;
+
+        KeySerializer::Serialize(key, key_data);
+
+        const auto hash = static_cast<std::uint64_t>(std::hash<Key>{}(key));
+        segment_lock lock{*this};
+
+        return Find(hash, key_data) != NIL;
+    }
+
+    /**
+     * \brief Remove an element specified by key
+     * \retval true if an element specified by key was found and deleted
+     * \retval false if an element is not present in a cache
+     */
+    bool Remove(const Key &key)
+    {
+        std::string key_data;
+
+        KeySerializer::Serialize(key, key_data);
+
+        const auto hash = static_cast<std::uint64_t>(std::hash<Key>{}(key));
+        segment_lock lock{*this};
+        const auto index = Find(hash, key_data);
+
+        if (index == NIL)
+        {
+            return false;
+        }
+
+        Erase(index);
+
+        return true;
+    }
+
+    /**
+     * \brief Remove all elements
+     */
+    void Clear()
+    {
+        segment_lock lock{*this};
+
+        Format();
+    }
+
+    /**
+     * \brief Get number of elements in cache
+     */
+    std::size_t Size() const
+    {
+        segment_lock lock{*this};
+
+        return header->size;
+    }
+
+    /**
+     * \brief Get maximum number of elements the cache can hold
+     */
+    std::size_t MaxSize() const noexcept
+    {
+        return header->max_size;
+    }
+
+  private:
+    static constexpr std::uint32_t NIL = std::numeric_limits<std::uint32_t>::max();
+    static constexpr std::uint32_t MAX_ITEM_SIZE = std::uint32_t{1} << 30;
+    static constexpr std::uint64_t MAGIC = 0x63616368657331ull;
+    static constexpr std::chrono::seconds ATTACH_TIMEOUT{5};
+
+    // parameters the segment is created with, all attached processes have to agree on them
+    struct segment_layout
+    {
+        std::uint32_t max_size;
+        std::uint32_t max_key_size;
+        std::uint32_t max_value_size;
+        shared_memory_policy policy;
+    };
+
+    struct segment_header
+    {
+        // MAGIC once the segment is formatted
+        std::atomic<std::uint64_t> ready;
+        pthread_mutex_t mutex;
+        std::uint32_t max_size;
+        std::uint32_t max_key_size;
+        std::uint32_t max_value_size;
+        shared_memory_policy policy;
+        std::uint32_t bucket_count;
+        std::uint32_t size;
+        std::uint32_t free_head;
+        // most recently used (LRU) or inserted (FIFO) element
+        std::uint32_t head;
+        std::uint32_t tail;
+    };
+
+    // followed by the key and the value bytes
+    struct slot_header
+    {
+        std::uint64_t hash;
+        // next slot of the same bucket or of the free list
+        std::uint32_t next;
+        std::uint32_t newer;
+        std::uint32_t older;
+        std::uint32_t key_size;
+        std::uint32_t value_size;
+    };
+
+    static_assert(ATOMIC_LLONG_LOCK_FREE == 2,
+                  "shared_memory_cache needs lock-free atomics to share them between processes");
+
+    class segment_lock
+    {
+      public:
+        explicit segment_lock(const shared_memory_cache &cache) : cache(cache)
+        {
+            const auto locked = ::pthread_mutex_lock(&cache.header->mutex);
+
+            if (locked == EOWNERDEAD)
+            {
+                // the previous owner died in the middle of an operation
+                cache.Format();
+                ::pthread_mutex_consistent(&cache.header->mutex);
+            }
+            else if (locked != 0)
+            {
+                throw std::system_error{locked, std::generic_category(),
+                                        "Unable to lock the shared memory cache"};
+            }
+        }
+
+        segment_lock(const segment_lock &) = delete;
+        segment_lock &operator=(const segment_lock &) = delete;
+
+        ~segment_lock()
+        {
+            ::pthread_mutex_unlock(&cache.header->mutex);
+        }
+
+      private:
+        const shared_memory_cache &cache;
+    };
+
+    static std::size_t AlignUp(std::size_t size) noexcept
+    {
+        return (size + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) *
+               alignof(std::max_align_t);
+    }
+
+    std::size_t SlotSize() const noexcept
+    {
+        return AlignUp(sizeof(slot_header) + layout.max_key_size + layout.max_value_size);
+    }
+
+    std::size_t BucketsOffset() const noexcept
+    {
+        return AlignUp(sizeof(segment_header));
+    }
+
+    std::size_t SlotsOffset() const noexcept
+    {
+        return BucketsOffset() + AlignUp(BucketCount() * sizeof(std::uint32_t));
+    }
+
+    std::uint32_t BucketCount() const noexcept
+    {
+        std::uint32_t count = 1;
+
+        while (count < layout.max_size && count < (std::uint32_t{1} << 31))
+        {
+            count <<= 1;
+        }
+
+        return count;
+    }
+
+    std::size_t SegmentSize() const noexcept
+    {
+        return SlotsOffset() + SlotSize() * layout.max_size;
+    }
+
+    void Map()
+    {
+        auto deadline = std::chrono::steady_clock::now() + ATTACH_TIMEOUT;
+
+        for (;;)
+        {
+            fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+
+            if (fd >= 0)
+            {
+                Create();
+                return;
+            }
+
+            if (errno != EEXIST)
+            {
+                Fail("Unable to create the shared memory segment");
+            }
+
+            fd = ::shm_open(name.c_str(), O_RDWR, 0600);
+
+            if (fd >= 0)
+            {
+                if (Attach(deadline))
+                {
+                    return;
+                }
+
+                // the stale segment has been removed, the next attempt creates a new one
+                deadline = std::chrono::steady_clock::now() + ATTACH_TIMEOUT;
+                continue;
+            }
+
+            // removed after our creation attempt, try again
+            if (errno != ENOENT || std::chrono::steady_clock::now() > deadline)
+            {
+                Fail("Unable to open the shared memory segment");
+            }
+        }
+    }
+
+    void Create()
+    {
+        // a segment that is not formatted would make every other process time out
+        creating = true;
+        segment_size = SegmentSize();
+
+        if (::ftruncate(fd, static_cast<off_t>(segment_size)) != 0)
+        {
+            Fail("Unable to size the shared memory segment");
+        }
+
+        MapSegment();
+
+        header = new (segment) segment_header{};
+        header->max_size = layout.max_size;
+        header->max_key_size = layout.max_key_size;
+        header->max_value_size = layout.max_value_size;
+        header->policy = layout.policy;
+        header->bucket_count = BucketCount();
+
+        pthread_mutexattr_t attributes;
+
+        ::pthread_mutexattr_init(&attributes);
+        ::pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+        ::pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+        ::pthread_mutex_init(&header->mutex, &attributes);
+        ::pthread_mutexattr_destroy(&attributes);
+
+        Format();
+        header->ready.store(MAGIC, std::memory_order_release);
+        creating = false;
+    }
+
+    // returns false if the segment has been left unformatted by its creator and is removed
+    bool Attach(std::chrono::steady_clock::time_point deadline)
+    {
+        // the creator may not have sized or formatted the segment yet
+        struct stat status;
+
+        for (;;)
+        {
+            if (::fstat(fd, &status) != 0)
+            {
+                Fail("Unable to check the shared memory segment");
+            }
+
+            if (static_cast<std::size_t>(status.st_size) >= sizeof(segment_header))
+            {
+                break;
+            }
+
+            if (!WaitForCreator(deadline))
+            {
+                RemoveStale(status);
+                return false;
+            }
+        }
+
+        segment_size = static_cast<std::size_t>(status.st_size);
+        MapSegment();
+        header = static_cast<segment_header *>(segment);
+
+        while (header->ready.load(std::memory_order_acquire) != MAGIC)
+        {
+            if (!WaitForCreator(deadline))
+            {
+                RemoveStale(status);
+                return false;
+            }
+        }
+
+        if (header->max_size != layout.max_size || header->max_key_size != layout.max_key_size ||
+            header->max_value_size != layout.max_value_size || header->policy != layout.policy ||
+            segment_size != SegmentSize())
+        {
+            ::munmap(segment, segment_size);
+            ::close(fd);
+            throw std::invalid_argument{
+                "Shared memory segment has been created with different parameters"};
+        }
+
+        return true;
+    }
+
+    // returns false once the deadline has passed
+    static bool WaitForCreator(std::chrono::steady_clock::time_point deadline)
+    {
+        if (std::chrono::steady_clock::now() > deadline)
+        {
+            return false;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+
+        return true;
+    }
+
+    // the creator has died before formatting the segment, remove it unless another process has
+    // replaced it in the meantime
+    void RemoveStale(const struct stat &stale)
+    {
+        const auto current_fd = ::shm_open(name.c_str(), O_RDWR, 0600);
+        struct stat current;
+
+        if (current_fd >= 0)
+        {
+            if (::fstat(current_fd, &current) == 0 && current.st_ino == stale.st_ino)
+            {
+                ::shm_unlink(name.c_str());
+            }
+
+            ::close(current_fd);
+        }
+
+        if (segment != nullptr)
+        {
+            ::munmap(segment, segment_size);
+            segment = nullptr;
+            header = nullptr;
+        }
+
+        ::close(fd);
+        fd = -1;
+    }
+
+    void MapSegment()
+    {
+        auto *mapped =
+            ::mmap(nullptr, segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+        if (mapped == MAP_FAILED)
+        {
+            Fail("Unable to map the shared memory segment");
+        }
+
+        segment = mapped;
+    }
+
+    [[noreturn]] void Fail(const char *message)
+    {
+        const auto error = errno;
+
+        if (fd >= 0)
+        {
+            ::close(fd);
+        }
+
+        if (creating)
+        {
+            ::shm_unlink(name.c_str());
+        }
+
+        throw std::system_error{error, std::generic_category(), message};
+    }
+
+    // make the cache empty, must be called with the lock held (or before the segment is ready)
+    void Format() const
+    {
+        auto *buckets = Buckets();
+
+        for (std::uint32_t i = 0; i < header->bucket_count; ++i)
+        {
+            buckets[i] = NIL;
+        }
+
+        for (std::uint32_t i = 0; i < header->max_size; ++i)
+        {
+            Slot(i).next = i + 1 < header->max_size ? i + 1 : NIL;
+        }
+
+        header->free_head = 0;
+        header->head = NIL;
+        header->tail = NIL;
+        header->size = 0;
+    }
+
+    std::uint32_t *Buckets() const noexcept
+    {
+        return reinterpret_cast<std::uint32_t *>(static_cast<char *>(segment) + BucketsOffset());
+    }
+
+    std::uint32_t &Bucket(std::uint64_t hash) const noexcept
+    {
+        return Buckets()[hash & (header->bucket_count - 1)];
+    }
+
+    slot_header &Slot(std::uint32_t index) const noexcept
+    {
+        return *reinterpret_cast<slot_header *>(static_cast<char *>(segment) + SlotsOffset() +
+                                                SlotSize() * index);
+    }
+
+    char *KeyData(std::uint32_t index) const noexcept
+    {
+        return reinterpret_cast<char *>(&Slot(index)) + sizeof(slot_header);
+    }
+
+    char *ValueData(std::uint32_t index) const noexcept
+    {
+        return KeyData(index) + header->max_key_size;
+    }
+
+    std::uint32_t Find(std::uint64_t hash, const std::string &key_data) const noexcept
+    {
+        for (auto index = Bucket(hash); index != NIL; index = Slot(index).next)
+        {
+            const auto &slot = Slot(index);
+
+            if (slot.hash == hash && slot.key_size == key_data.size() &&
+                std::memcmp(KeyData(index), key_data.data(), key_data.size()) == 0)
+            {
+                return index;
+            }
+        }
+
+        return NIL;
+    }
+
+    void Insert(std::uint32_t index, std::uint64_t hash, const std::string &key_data) const
+    {
+        auto &slot = Slot(index);
+        auto &bucket = Bucket(hash);
+
+        slot.hash = hash;
+        slot.key_size = static_cast<std::uint32_t>(key_data.size());
+        std::memcpy(KeyData(index), key_data.data(), key_data.size());
+        slot.next = bucket;
+        bucket = index;
+        PushNewest(index);
+        ++header->size;
+    }
+
+    void Erase(std::uint32_t index) const noexcept
+    {
+        auto &slot = Slot(index);
+        auto *link = &Bucket(slot.hash);
+
+        while (*link != index)
+        {
+            link = &Slot(*link).next;
+        }
+
+        *link = slot.next;
+        RemoveFromOrder(index);
+        slot.next = header->free_head;
+        header->free_head = index;
+        --header->size;
+    }
+
+    void Touch(std::uint32_t index) const noexcept
+    {
+        if (header->policy == shared_memory_policy::lru && header->head != index)
+        {
+            RemoveFromOrder(index);
+            PushNewest(index);
+        }
+    }
+
+    void PushNewest(std::uint32_t index) const noexcept
+    {
+        auto &slot = Slot(index);
+
+        slot.newer = NIL;
+        slot.older = header->head;
+
+        if (header->head != NIL)
+        {
+            Slot(header->head).newer = index;
+        }
+        else
+        {
+            header->tail = index;
+        }
+
+        header->head = index;
+    }
+
+    void RemoveFromOrder(std::uint32_t index) const noexcept
+    {
+        const auto &slot = Slot(index);
+
+        (slot.newer != NIL ? Slot(slot.newer).older : header->head) = slot.older;
+        (slot.older != NIL ? Slot(slot.older).newer : header->tail) = slot.newer;
+    }
+
+    std::string name;
+    segment_layout layout;
+    int fd = -1;
+    // the segment has been created by this process and is not formatted yet
+    bool creating = false;
+    void *segment = nullptr;
+    std::size_t segment_size = 0;
+    segment_header *header = nullptr;
+};
+
+template <typename Key, typename Value, typename KeySerializer, typename ValueSerializer>
+constexpr std::chrono::seconds
+    shared_memory_cache<Key, Value, KeySerializer, ValueSerializer>::ATTACH_TIMEOUT;
+} // namespace caches
+
+#endif // SHARED_MEMORY_CACHE_HPP
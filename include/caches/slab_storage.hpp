@@ -0,0 +1,501 @@
+/**
+ * \file
+ * \brief Size-class slab allocator and slab based value storage
+ */
+#ifndef SLAB_STORAGE_HPP
+#define SLAB_STORAGE_HPP
+
+#include "cache.hpp"
+#include "cache_policy.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace caches
+{
+/**
+ * \brief Usage statistics of a single slab class
+ */
+struct slab_class_stats
+{
+    std::size_t chunk_size;  ///< Size of every chunk in the class
+    std::size_t pages;       ///< Number of pages assigned to the class
+    std::size_t used_chunks; ///< Number of chunks handed out to the users
+    std::size_t free_chunks; ///< Number of chunks available for allocation
+};
+
+/**
+ * \brief Memcached-style slab arena with size classes
+ * \details Memory is requested from the system in pages of the same size. Each page is assigned
+ * to a single size class and split into equal chunks of that class' size. Chunk sizes grow
+ * geometrically by the given factor, so a request is served from the smallest class that fits it
+ * and the internal fragmentation is bounded by the growth factor. Freed chunks go back to their
+ * class' free list and are never returned to the system, which keeps the process footprint
+ * stable regardless of the allocation pattern.
+ *
+ * When the memory limit is reached a class can only serve requests from its free list. The limit
+ * is soft: if nothing can be freed (e.g. all values of a class are still referenced by readers),
+ * a new page is allocated anyway and counted as overcommitted.
+ *
+ * Requests larger than a page bypass the arena and are served by the global `operator new`.
+ * The arena is thread-safe.
+ */
+class slab_arena
+{
+  public:
+    /**
+     * \brief Construct slab arena
+     * \throw std::invalid_argument
+     * \param[in] memory_limit Maximum amount of memory to use for pages
+     * \param[in] page_size Size of a single page
+     * \param[in] growth_factor Ratio between sizes of the neighbouring classes
+     * \param[in] min_chunk_size Chunk size of the smallest class
+     */
+    explicit slab_arena(std::size_t memory_limit, std::size_t page_size = 1024 * 1024,
+                        double growth_factor = 1.25, std::size_t min_chunk_size = 64)
+        : page_size{page_size}, memory_limit{memory_limit}
+    {
+        if (page_size < min_chunk_size || min_chunk_size == 0 || growth_factor <= 1.0)
+        {
+            throw std::invalid_argument{"Invalid slab arena configuration"};
+        }
+
+        std::size_t chunk_size = AlignUp(min_chunk_size);
+
+        while (chunk_size <= page_size / 2)
+        {
+            classes.push_back(slab_class{chunk_size});
+
+            const auto next = AlignUp(static_cast<std::size_t>(chunk_size * growth_factor));
+            chunk_size = next > chunk_size ? next : chunk_size + CHUNK_ALIGN;
+        }
+
+        // the largest class holds a single chunk per page
+        classes.push_back(slab_class{page_size});
+    }
+
+    slab_arena(const slab_arena &) = delete;
+    slab_arena &operator=(const slab_arena &) = delete;
+
+    /**
+     * \brief Number of size classes in the arena
+     */
+    std::size_t ClassCount() const noexcept
+    {
+        return classes.size();
+    }
+
+    /**
+     * \brief Get a class that serves requests of the given size
+     * \param[in] bytes Requested size
+     * \return Index of the class or `ClassCount()` if the request bypasses the arena
+     */
+    std::size_t ClassOf(std::size_t bytes) const noexcept
+    {
+        std::size_t low = 0;
+        std::size_t high = classes.size();
+
+        while (low < high)
+        {
+            const auto mid = low + (high - low) / 2;
+
+            if (classes[mid].chunk_size < bytes)
+            {
+                low = mid + 1;
+            }
+            else
+            {
+                high = mid;
+            }
+        }
+
+        return low;
+    }
+
+    /**
+     * \brief Check whether the given class can serve a request without exceeding the limit
+     * \param[in] cls Class index
+     */
+    bool HasRoom(std::size_t cls) const
+    {
+        if (cls >= classes.size())
+        {
+            return true;
+        }
+
+        std::lock_guard<std::mutex> lock{arena_op};
+
+        return classes[cls].free_list != nullptr || CanGrow();
+    }
+
+    /**
+     * \brief Allocate a chunk that fits the given number of bytes
+     * \throw std::bad_alloc
+     * \param[in] bytes Requested size
+     */
+    void *Allocate(std::size_t bytes)
+    {
+        const auto cls = ClassOf(bytes);
+
+        if (cls == classes.size())
+        {
+            return ::operator new(bytes);
+        }
+
+        std::lock_guard<std::mutex> lock{arena_op};
+        auto &slab = classes[cls];
+
+        if (slab.free_list == nullptr)
+        {
+            AddPage(slab);
+        }
+
+        auto chunk = slab.free_list;
+        slab.free_list = chunk->next;
+        --slab.free_chunks;
+        ++slab.used_chunks;
+
+        return chunk;
+    }
+
+    /**
+     * \brief Return a chunk previously obtained from Allocate
+     * \param[in] ptr Chunk pointer
+     * \param[in] bytes Size that was passed to Allocate
+     */
+    void Deallocate(void *ptr, std::size_t bytes) noexcept
+    {
+        const auto cls = ClassOf(bytes);
+
+        if (cls == classes.size())
+        {
+            ::operator delete(ptr);
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock{arena_op};
+        auto &slab = classes[cls];
+        auto chunk = static_cast<free_chunk *>(ptr);
+
+        chunk->next = slab.free_list;
+        slab.free_list = chunk;
+        ++slab.free_chunks;
+        --slab.used_chunks;
+    }
+
+    /**
+     * \brief Get usage statistics of the given class
+     * \param[in] cls Class index
+     */
+    slab_class_stats Stats(std::size_t cls) const
+    {
+        std::lock_guard<std::mutex> lock{arena_op};
+        const auto &slab = classes.at(cls);
+
+        return {slab.chunk_size, slab.pages, slab.used_chunks, slab.free_chunks};
+    }
+
+    /**
+     * \brief Amount of memory allocated for pages
+     */
+    std::size_t MemoryUsed() const
+    {
+        std::lock_guard<std::mutex> lock{arena_op};
+
+        return pages.size() * page_size;
+    }
+
+    /**
+     * \brief Number of pages allocated above the memory limit
+     */
+    std::size_t OvercommittedPages() const
+    {
+        std::lock_guard<std::mutex> lock{arena_op};
+
+        return overcommitted_pages;
+    }
+
+  private:
+    struct free_chunk
+    {
+        free_chunk *next;
+    };
+
+    struct slab_class
+    {
+        explicit slab_class(std::size_t size) noexcept : chunk_size{size}
+        {
+        }
+
+        std::size_t chunk_size;
+        free_chunk *free_list = nullptr;
+        std::size_t pages = 0;
+        std::size_t used_chunks = 0;
+        std::size_t free_chunks = 0;
+    };
+
+    static constexpr std::size_t CHUNK_ALIGN = alignof(std::max_align_t);
+
+    static std::size_t AlignUp(std::size_t size) noexcept
+    {
+        return (size + CHUNK_ALIGN - 1) / CHUNK_ALIGN * CHUNK_ALIGN;
+    }
+
+    bool CanGrow() const noexcept
+    {
+        return (pages.size() + 1) * page_size <= memory_limit;
+    }
+
+    void AddPage(slab_class &slab)
+    {
+        if (!CanGrow())
+        {
+            ++overcommitted_pages;
+        }
+
+        pages.emplace_back(new char[page_size]);
+
+        char *page = pages.back().get();
+        const auto chunks = page_size / slab.chunk_size;
+
+        for (std::size_t i = chunks; i > 0; --i)
+        {
+            auto chunk = reinterpret_cast<free_chunk *>(page + (i - 1) * slab.chunk_size);
+            chunk->next = slab.free_list;
+            slab.free_list = chunk;
+        }
+
+        ++slab.pages;
+        slab.free_chunks += chunks;
+    }
+
+    std::size_t page_size;
+    std::size_t memory_limit;
+    std::size_t overcommitted_pages = 0;
+    std::vector<slab_class> classes;
+    std::vector<std::unique_ptr<char[]>> pages;
+    mutable std::mutex arena_op;
+};
+
+/**
+ * \brief Standard allocator that takes memory from a shared slab arena
+ * \details The allocator keeps the arena alive, so containers allocated from it may outlive the
+ * cache they were stored in
+ * \tparam T Type of allocated objects
+ */
+template <typename T>
+class slab_allocator
+{
+  public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    explicit slab_allocator(std::shared_ptr<slab_arena> arena) noexcept : arena{std::move(arena)}
+    {
+    }
+
+    template <typename U>
+    slab_allocator(const slab_allocator<U> &other) noexcept : arena{other.Arena()}
+    {
+    }
+
+    T *allocate(std::size_t n)
+    {
+        return static_cast<T *>(arena->Allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T *ptr, std::size_t n) noexcept
+    {
+        arena->Deallocate(ptr, n * sizeof(T));
+    }
+
+    const std::shared_ptr<slab_arena> &Arena() const noexcept
+    {
+        return arena;
+    }
+
+  private:
+    std::shared_ptr<slab_arena> arena;
+};
+
+template <typename T, typename U>
+bool operator==(const slab_allocator<T> &lhs, const slab_allocator<U> &rhs) noexcept
+{
+    return lhs.Arena() == rhs.Arena();
+}
+
+template <typename T, typename U>
+bool operator!=(const slab_allocator<T> &lhs, const slab_allocator<U> &rhs) noexcept
+{
+    return !(lhs == rhs);
+}
+
+/**
+ * \brief String type which characters are stored in a slab arena
+ */
+using slab_string = std::basic_string<char, std::char_traits<char>, slab_allocator<char>>;
+
+/**
+ * \brief Number of bytes a copy of the given value requests from its allocator
+ * \details 0 means the copy doesn't allocate. Specialize for value types with a different
+ * allocation pattern
+ * \tparam Value Allocator-aware container type
+ */
+template <typename Value>
+struct slab_payload_size
+{
+    std::size_t operator()(const Value &value) const noexcept
+    {
+        return value.size() * sizeof(typename Value::value_type);
+    }
+};
+
+template <typename CharT, typename Traits, typename Alloc>
+struct slab_payload_size<std::basic_string<CharT, Traits, Alloc>>
+{
+    std::size_t operator()(const std::basic_string<CharT, Traits, Alloc> &value) const noexcept
+    {
+        const std::less<const void *> before{};
+        const auto *object = reinterpret_cast<const char *>(&value);
+
+        // a short string keeps its characters inside the object and allocates nothing
+        if (!before(value.data(), object) && before(value.data(), object + sizeof(value)))
+        {
+            return 0;
+        }
+
+        // the terminating null character is allocated as well
+        return (value.size() + 1) * sizeof(CharT);
+    }
+};
+
+/**
+ * \brief Value storage that places values' payload into a slab arena
+ * \details `Value` must be an allocator-aware container that uses slab_allocator (e.g.
+ * slab_string). The value object itself is kept in a regular `std::shared_ptr` block while its
+ * variable sized payload goes to the arena.
+ *
+ * Keys are tracked per size class with a separate instance of the eviction policy, except for
+ * values whose payload is kept inline (e.g. short strings), which take no chunk. When the arena
+ * has no room left in the class of a new value, the storage asks the cache to evict the
+ * replacement candidate of that class, so the eviction always frees a chunk the new value can use.
+ * A chunk is only reused once nobody references the evicted value. Put delivers the notifications
+ * about such evictions before it creates the new value, so erase listeners don't pin the chunk;
+ * values held by the users still do, and more elements of the class are evicted then.
+ * \tparam Key Type of a key
+ * \tparam Value Type of a value stored in the cache
+ * \tparam Policy Type of a policy to be used for the per class eviction
+ */
+template <typename Key, typename Value, template <typename> class Policy = NoCachePolicy>
+class slab_value_storage
+{
+  public:
+    using value_type = WrappedValue<Value>;
+    using allocator_type = typename Value::allocator_type;
+
+    /**
+     * \brief Construct slab value storage
+     * \param[in] arena Arena to allocate values' payload from
+     * \param[in] policy Policy to use for the per class eviction
+     */
+    explicit slab_value_storage(std::shared_ptr<slab_arena> arena,
+                                const Policy<Key> &policy = Policy<Key>{})
+        : allocator{arena}, class_policies(arena->ClassCount(), policy),
+          class_sizes(arena->ClassCount(), 0)
+    {
+    }
+
+    value_type Create(const Value &value)
+    {
+        return std::make_shared<Value>(value, allocator);
+    }
+
+    const Key *EvictionCandidate(const Value &value) const
+    {
+        const auto cls = ClassOf(value);
+
+        if (cls == class_policies.size() || class_sizes[cls] == 0 ||
+            allocator.Arena()->HasRoom(cls))
+        {
+            return nullptr;
+        }
+
+        return &class_policies[cls].ReplCandidate();
+    }
+
+    void OnInsert(const Key &key, const value_type &value)
+    {
+        const auto cls = ClassOf(*value);
+
+        if (cls == class_policies.size())
+        {
+            return;
+        }
+
+        class_policies[cls].Insert(key);
+        ++class_sizes[cls];
+        key_class.emplace(key, cls);
+    }
+
+    void OnTouch(const Key &key, const value_type &value)
+    {
+        (void)value;
+        auto elem_it = key_class.find(key);
+
+        if (elem_it != key_class.end())
+        {
+            class_policies[elem_it->second].Touch(key);
+        }
+    }
+
+    void OnErase(const Key &key, const value_type &value)
+    {
+        (void)value;
+        auto elem_it = key_class.find(key);
+
+        if (elem_it != key_class.end())
+        {
+            class_policies[elem_it->second].Erase(key);
+            --class_sizes[elem_it->second];
+            key_class.erase(elem_it);
+        }
+    }
+
+    void OnDetach() noexcept
+    {
+    }
+
+    /**
+     * \brief Arena the storage allocates from
+     */
+    const std::shared_ptr<slab_arena> &Arena() const noexcept
+    {
+        return allocator.Arena();
+    }
+
+  private:
+    // values without a payload take no chunk and are not tracked in any class
+    std::size_t ClassOf(const Value &value) const noexcept
+    {
+        const auto bytes = slab_payload_size<Value>{}(value);
+
+        return bytes == 0 ? class_policies.size() : allocator.Arena()->ClassOf(bytes);
+    }
+
+    allocator_type allocator;
+    std::vector<Policy<Key>> class_policies;
+    std::vector<std::size_t> class_sizes;
+    std::unordered_map<Key, std::size_t> key_class;
+};
+} // namespace caches
+
+#endif // SLAB_STORAGE_HPP
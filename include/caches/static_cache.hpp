@@ -0,0 +1,379 @@
+/**
+ * \file
+ * \brief Fixed capacity cache that never allocates
+ */
+#ifndef STATIC_CACHE_HPP
+#define STATIC_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <type_traits>
+
+#if defined(__cpp_constexpr) && __cpp_constexpr >= 201304L
+#define CACHES_CONSTEXPR14 constexpr
+#else
+#define CACHES_CONSTEXPR14
+#endif
+
+namespace caches
+{
+/**
+ * \brief Smallest unsigned type that can index `N` slots and represent an extra "none" value
+ */
+template <std::size_t N>
+using static_index_t = typename std::conditional<
+    (N < 0xFF), std::uint8_t,
+    typename std::conditional<(N < 0xFFFF), std::uint16_t, std::uint32_t>::type>::type;
+
+/**
+ * \brief Doubly linked list of slot indices kept in inline arrays
+ * \tparam N Number of slots
+ */
+template <std::size_t N>
+class static_slot_list
+{
+  public:
+    using index_type = static_index_t<N>;
+
+    /// Index that marks the absence of a slot
+    static constexpr index_type NONE = static_cast<index_type>(N);
+
+    CACHES_CONSTEXPR14 void PushFront(std::size_t slot) noexcept
+    {
+        prev[slot] = NONE;
+        next[slot] = head;
+
+        if (head != NONE)
+        {
+            prev[head] = static_cast<index_type>(slot);
+        }
+        else
+        {
+            tail = static_cast<index_type>(slot);
+        }
+
+        head = static_cast<index_type>(slot);
+    }
+
+    CACHES_CONSTEXPR14 void Unlink(std::size_t slot) noexcept
+    {
+        if (prev[slot] != NONE)
+        {
+            next[prev[slot]] = next[slot];
+        }
+        else
+        {
+            head = next[slot];
+        }
+
+        if (next[slot] != NONE)
+        {
+            prev[next[slot]] = prev[slot];
+        }
+        else
+        {
+            tail = prev[slot];
+        }
+    }
+
+    constexpr std::size_t Back() const noexcept
+    {
+        return tail;
+    }
+
+  private:
+    index_type prev[N]{};
+    index_type next[N]{};
+    index_type head = NONE;
+    index_type tail = NONE;
+};
+
+/**
+ * \brief LRU policy over the slots of static_cache
+ * \details Works with slot indices instead of keys, so it needs neither hashing nor allocations
+ * \tparam N Number of slots
+ */
+template <std::size_t N>
+class static_lru_policy
+{
+  public:
+    CACHES_CONSTEXPR14 void Insert(std::size_t slot) noexcept
+    {
+        order.PushFront(slot);
+    }
+
+    CACHES_CONSTEXPR14 void Touch(std::size_t slot) noexcept
+    {
+        order.Unlink(slot);
+        order.PushFront(slot);
+    }
+
+    CACHES_CONSTEXPR14 void Erase(std::size_t slot) noexcept
+    {
+        order.Unlink(slot);
+    }
+
+    constexpr std::size_t ReplCandidate() const noexcept
+    {
+        return order.Back();
+    }
+
+  private:
+    static_slot_list<N> order;
+};
+
+/**
+ * \brief FIFO policy over the slots of static_cache
+ * \tparam N Number of slots
+ */
+template <std::size_t N>
+class static_fifo_policy
+{
+  public:
+    CACHES_CONSTEXPR14 void Insert(std::size_t slot) noexcept
+    {
+        order.PushFront(slot);
+    }
+
+    CACHES_CONSTEXPR14 void Touch(std::size_t slot) noexcept
+    {
+        // nothing to do here in the FIFO strategy
+        (void)slot;
+    }
+
+    CACHES_CONSTEXPR14 void Erase(std::size_t slot) noexcept
+    {
+        order.Unlink(slot);
+    }
+
+    constexpr std::size_t ReplCandidate() const noexcept
+    {
+        return order.Back();
+    }
+
+  private:
+    static_slot_list<N> order;
+};
+
+/**
+ * \brief Cache with the capacity fixed at compile time and all storage held inline
+ * \details Keys and values are kept in arrays of `Capacity` elements, located through an inline
+ * open addressing table (linear probing with backward shift deletion), and ordered by a policy
+ * that links slot indices instead of allocating list nodes. The cache never touches the heap,
+ * so it can live on the stack, in static storage or in shared memory.
+ *
+ * Unlike fixed_sized_cache, the cache is not synchronized and returns plain pointers and
+ * references to the stored values, which stay valid until the next modification of the cache.
+ * With C++14 and later, a cache of literal types with a constexpr hasher can be used in constant
+ * expressions.
+ * \tparam Key Type of a key (default constructible and copy assignable)
+ * \tparam Value Type of a value (default constructible and copy assignable)
+ * \tparam Capacity Maximum number of elements
+ * \tparam Policy Type of a slot policy (e.g. static_lru_policy, static_fifo_policy)
+ * \tparam Hash Type of a key hasher
+ */
+template <typename Key, typename Value, std::size_t Capacity,
+          template <std::size_t> class Policy = static_lru_policy,
+          typename Hash = std::hash<Key>>
+class static_cache
+{
+    static_assert(Capacity > 0, "Capacity of the cache should be non-zero");
+
+  public:
+    using index_type = static_index_t<Capacity>;
+
+    constexpr static_cache() = default;
+
+    /**
+     * \brief Put element into the cache, evicting the replacement candidate if it's full
+     * \param[in] key Key value to use
+     * \param[in] value Value to assign to the given key
+     */
+    CACHES_CONSTEXPR14 void Put(const Key &key, const Value &value)
+    {
+        auto bucket = FindBucket(key);
+
+        if (table[bucket] != EMPTY)
+        {
+            const std::size_t slot = table[bucket] - 1;
+
+            values[slot] = value;
+            cache_policy.Touch(slot);
+            return;
+        }
+
+        if (size == Capacity)
+        {
+            EraseSlot(cache_policy.ReplCandidate());
+            bucket = FindBucket(key);
+        }
+
+        const std::size_t slot = free_slots[Capacity - size - 1];
+
+        keys[slot] = key;
+        values[slot] = value;
+        table[bucket] = static_cast<index_type>(slot + 1);
+        cache_policy.Insert(slot);
+        ++size;
+    }
+
+    /**
+     * \brief Try to get an element by the given key from the cache
+     * \param[in] key Get element by key
+     * \return Pointer to the value or `nullptr` if the element is not in the cache
+     */
+    CACHES_CONSTEXPR14 const Value *TryGet(const Key &key)
+    {
+        const auto entry = table[FindBucket(key)];
+
+        if (entry == EMPTY)
+        {
+            return nullptr;
+        }
+
+        cache_policy.Touch(entry - 1);
+
+        return &values[entry - 1];
+    }
+
+    /**
+     * \brief Get element from the cache if present
+     * \throw std::range_error
+     * \param[in] key Get element by key
+     */
+    CACHES_CONSTEXPR14 const Value &Get(const Key &key)
+    {
+        const auto *value = TryGet(key);
+
+        if (value == nullptr)
+        {
+            throw std::range_error{"No such element in the cache"};
+        }
+
+        return *value;
+    }
+
+    /**
+     * \brief Check whether the given key is presented in the cache
+     */
+    CACHES_CONSTEXPR14 bool Cached(const Key &key) const
+    {
+        return table[FindBucket(key)] != EMPTY;
+    }
+
+    /**
+     * \brief Remove an element specified by key
+     * \retval true if an element specified by key was found and deleted
+     * \retval false if an element is not present in a cache
+     */
+    CACHES_CONSTEXPR14 bool Remove(const Key &key)
+    {
+        const auto entry = table[FindBucket(key)];
+
+        if (entry == EMPTY)
+        {
+            return false;
+        }
+
+        EraseSlot(entry - 1);
+
+        return true;
+    }
+
+    /**
+     * \brief Get number of elements in cache
+     */
+    constexpr std::size_t Size() const noexcept
+    {
+        return size;
+    }
+
+    /**
+     * \brief Get maximum number of elements the cache can hold
+     */
+    static constexpr std::size_t MaxSize() noexcept
+    {
+        return Capacity;
+    }
+
+  private:
+    static constexpr std::size_t TableSize(std::size_t size = 1) noexcept
+    {
+        // at least twice as many buckets as elements keeps probe sequences short
+        return size >= 2 * Capacity ? size : TableSize(size * 2);
+    }
+
+    static constexpr std::size_t TABLE_SIZE = TableSize();
+    static constexpr std::size_t TABLE_MASK = TABLE_SIZE - 1;
+    static constexpr index_type EMPTY = 0;
+
+    struct free_list
+    {
+        CACHES_CONSTEXPR14 free_list() noexcept
+        {
+            // slots are handed out from the end, so the first element gets slot 0
+            for (std::size_t i = 0; i < Capacity; ++i)
+            {
+                slots[i] = static_cast<index_type>(Capacity - 1 - i);
+            }
+        }
+
+        CACHES_CONSTEXPR14 index_type &operator[](std::size_t i) noexcept
+        {
+            return slots[i];
+        }
+
+        index_type slots[Capacity]{};
+    };
+
+    // bucket holding the key, or the empty bucket where it would be inserted
+    CACHES_CONSTEXPR14 std::size_t FindBucket(const Key &key) const
+    {
+        auto bucket = Hash{}(key) & TABLE_MASK;
+
+        while (table[bucket] != EMPTY && !(keys[table[bucket] - 1] == key))
+        {
+            bucket = (bucket + 1) & TABLE_MASK;
+        }
+
+        return bucket;
+    }
+
+    CACHES_CONSTEXPR14 void EraseSlot(std::size_t slot)
+    {
+        auto hole = FindBucket(keys[slot]);
+
+        // backward shift: move following entries of the probe sequence into the hole
+        for (auto bucket = (hole + 1) & TABLE_MASK; table[bucket] != EMPTY;
+             bucket = (bucket + 1) & TABLE_MASK)
+        {
+            const auto home = Hash{}(keys[table[bucket] - 1]) & TABLE_MASK;
+
+            if (((bucket - home) & TABLE_MASK) >= ((bucket - hole) & TABLE_MASK))
+            {
+                table[hole] = table[bucket];
+                hole = bucket;
+            }
+        }
+
+        table[hole] = EMPTY;
+        cache_policy.Erase(slot);
+        keys[slot] = Key{};
+        values[slot] = Value{};
+        --size;
+        free_slots[Capacity - size - 1] = static_cast<index_type>(slot);
+    }
+
+    Key keys[Capacity]{};
+    Value values[Capacity]{};
+    // slot + 1 of the element in the bucket or EMPTY
+    index_type table[TABLE_SIZE]{};
+    free_list free_slots{};
+    Policy<Capacity> cache_policy{};
+    std::size_t size = 0;
+};
+} // namespace caches
+
+#endif // STATIC_CACHE_HPP
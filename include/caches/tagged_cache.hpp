@@ -0,0 +1,268 @@
+/**
+ * \file
+ * \brief Cache whose elements can be invalidated in groups by tags
+ */
+#ifndef TAGGED_CACHE_HPP
+#define TAGGED_CACHE_HPP
+
+#include "cache.hpp"
+#include "cache_policy.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace caches
+{
+/**
+ * \brief Secondary index from tags to the keys of a cache
+ * \details Tags of a key are staged before the key is inserted and attached by the value storage
+ * (see tagged_value_storage), so the index follows every insertion and erasure of the cache,
+ * including evictions. The index is not synchronized, it's guarded by the cache lock
+ * \tparam Key Type of a key
+ * \tparam Tag Type of a tag (should be hashable)
+ */
+template <typename Key, typename Tag>
+class tag_index
+{
+  public:
+    /**
+     * \brief Set tags for the next attached key
+     */
+    void Stage(std::vector<Tag> tags)
+    {
+        staged = std::move(tags);
+    }
+
+    /**
+     * \brief Attach the staged tags to the given key
+     */
+    void Attach(const Key &key)
+    {
+        if (staged.empty())
+        {
+            return;
+        }
+
+        for (const auto &tag : staged)
+        {
+            tag_keys[tag].insert(key);
+        }
+
+        key_tags[key] = std::move(staged);
+        staged.clear();
+    }
+
+    /**
+     * \brief Remove the given key from all its tags
+     */
+    void Detach(const Key &key)
+    {
+        auto key_it = key_tags.find(key);
+
+        if (key_it == key_tags.end())
+        {
+            return;
+        }
+
+        for (const auto &tag : key_it->second)
+        {
+            auto tag_it = tag_keys.find(tag);
+
+            if (tag_it != tag_keys.end())
+            {
+                tag_it->second.erase(key);
+
+                if (tag_it->second.empty())
+                {
+                    tag_keys.erase(tag_it);
+                }
+            }
+        }
+
+        key_tags.erase(key_it);
+    }
+
+    /**
+     * \brief Remove the given tag from the index
+     * \return Keys the tag has been attached to
+     */
+    std::unordered_set<Key> Take(const Tag &tag)
+    {
+        std::unordered_set<Key> keys;
+        auto tag_it = tag_keys.find(tag);
+
+        if (tag_it != tag_keys.end())
+        {
+            keys.swap(tag_it->second);
+            tag_keys.erase(tag_it);
+        }
+
+        return keys;
+    }
+
+    /**
+     * \brief Number of keys the given tag is attached to
+     */
+    std::size_t Count(const Tag &tag) const
+    {
+        auto tag_it = tag_keys.find(tag);
+
+        return tag_it == tag_keys.end() ? 0 : tag_it->second.size();
+    }
+
+  private:
+    std::vector<Tag> staged;
+    std::unordered_map<Tag, std::unordered_set<Key>> tag_keys;
+    std::unordered_map<Key, std::vector<Tag>> key_tags;
+};
+
+/**
+ * \brief Value storage that keeps a tag_index in sync with the cache
+ * \tparam Key Type of a key
+ * \tparam Value Type of a value stored in the cache
+ * \tparam Tag Type of a tag
+ */
+template <typename Key, typename Value, typename Tag>
+class tagged_value_storage : public heap_value_storage<Key, Value>
+{
+  public:
+    using value_type = typename heap_value_storage<Key, Value>::value_type;
+
+    explicit tagged_value_storage(std::shared_ptr<tag_index<Key, Tag>> index)
+        : index{std::move(index)}
+    {
+    }
+
+    void OnInsert(const Key &key, const value_type &value)
+    {
+        (void)value;
+        index->Attach(key);
+    }
+
+    void OnErase(const Key &key, const value_type &value)
+    {
+        (void)value;
+        index->Detach(key);
+    }
+
+  private:
+    std::shared_ptr<tag_index<Key, Tag>> index;
+};
+
+/**
+ * \brief Fixed sized cache with group invalidation by tags
+ * \details Every element can be put with a set of tags. `InvalidateTag` removes all elements of a
+ * tag under a single lock acquisition, in time proportional to the number of the tag's elements.
+ * Putting an element again replaces its tags
+ * \tparam Key Type of a key (should be hashable)
+ * \tparam Value Type of a value stored in the cache
+ * \tparam Tag Type of a tag (should be hashable)
+ * \tparam Policy Type of a policy to be used with the cache
+ * \tparam OnErase Type of a listener to notify about erased elements (see fixed_sized_cache)
+ */
+template <typename Key, typename Value, typename Tag = std::string,
+          template <typename> class Policy = NoCachePolicy,
+          typename OnErase = std::function<void(const Key &, const WrappedValue<Value> &)>>
+class tagged_cache
+    : public fixed_sized_cache<Key, Value, Policy, counted_unordered_map<Key, WrappedValue<Value>>,
+                               tagged_value_storage<Key, Value, Tag>, OnErase>
+{
+    using base_type =
+        fixed_sized_cache<Key, Value, Policy, counted_unordered_map<Key, WrappedValue<Value>>,
+                          tagged_value_storage<Key, Value, Tag>, OnErase>;
+
+  public:
+    using typename base_type::on_erase_cb;
+
+    /**
+     * \brief Construct cache
+     * \throw std::invalid_argument
+     * \param[in] max_size Maximum size of the cache
+     * \param[in] policy Cache policy to use
+     * \param[in] on_erase on_erase_cb function to be called when cache's element get erased
+     */
+    explicit tagged_cache(std::size_t max_size, const Policy<Key> &policy = Policy<Key>{},
+                          on_erase_cb on_erase = on_erase_cb{})
+        : tagged_cache{max_size, policy, std::move(on_erase),
+                       std::make_shared<tag_index<Key, Tag>>()}
+    {
+    }
+
+    /**
+     * \brief Put element into the cache
+     * \param[in] key Key value to use
+     * \param[in] value Value to assign to the given key
+     * \param[in] tags Tags of the element, replace the tags it has been put with before
+     */
+    void Put(const Key &key, const Value &value, std::vector<Tag> tags = {})
+    {
+        this->Modify(
+            cache_operation::put,
+            [&]
+            {
+                index->Stage(std::move(tags));
+                this->PutLocked(key, value);
+                index->Stage({});
+            });
+    }
+
+    /**
+     * \brief Remove all elements with the given tag
+     * \return Number of removed elements
+     */
+    std::size_t InvalidateTag(const Tag &tag)
+    {
+        std::size_t invalidated = 0;
+
+        this->Modify(
+            cache_operation::invalidate,
+            [&]
+            {
+                for (const auto &key : index->Take(tag))
+                {
+                    auto elem_it = this->FindElem(key);
+
+                    // elements detached by InvalidateAll stay in the index until reclaimed
+                    if (elem_it != this->end())
+                    {
+                        this->Erase(elem_it, erase_cause::invalidated);
+                        ++invalidated;
+                    }
+                }
+            });
+
+        return invalidated;
+    }
+
+    /**
+     * \brief Number of elements with the given tag, including the ones invalidated by
+     * InvalidateAll that are not reclaimed yet
+     */
+    std::size_t TagSize(const Tag &tag) const
+    {
+        typename base_type::profiled_read_guard lock{this->safe_op, this->lock_profile,
+                                                     cache_operation::size};
+
+        return index->Count(tag);
+    }
+
+  private:
+    tagged_cache(std::size_t max_size, const Policy<Key> &policy, on_erase_cb on_erase,
+                 std::shared_ptr<tag_index<Key, Tag>> index)
+        : base_type{max_size, policy, std::move(on_erase),
+                    tagged_value_storage<Key, Value, Tag>{index}},
+          index{std::move(index)}
+    {
+    }
+
+    std::shared_ptr<tag_index<Key, Tag>> index;
+};
+} // namespace caches
+
+#endif // TAGGED_CACHE_HPP
@@ -0,0 +1,359 @@
+/**
+ * \file
+ * \brief Two-tier cache with an in-memory L1 and an on-disk L2
+ */
+#ifndef TIERED_CACHE_HPP
+#define TIERED_CACHE_HPP
+
+#include "cache.hpp"
+#include "cache_policy.hpp"
+#include "disk_log_store.hpp"
+#include "erase_listener.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace caches
+{
+/**
+ * \brief Cache that spills elements evicted from memory to a local disk
+ * \details L1 is a fixed_sized_cache with the given policy. Elements evicted from L1 are demoted
+ * to a disk_log_store (L2) asynchronously on a dedicated thread. A lookup that misses L1 reads the
+ * element from L2 with positional I/O and promotes it back into L1, removing it from L2.
+ *
+ * Elements waiting for the demotion are served from the demotion queue, so they stay visible
+ * while they are written to L2. Evicted elements enter the queue while L1 is still locked, so a
+ * lookup never misses an element that is being demoted. Disk I/O is never performed under the L1
+ * lock. Lookups and updates of the same key are serialized with a striped lock, so a promotion
+ * never overwrites a newer value put concurrently.
+ * \tparam Key Type of a key
+ * \tparam Value Type of a value
+ * \tparam Policy Type of a policy to be used with L1
+ * \tparam Serializer Type that converts values to bytes and back (see value_serializer)
+ */
+template <typename Key, typename Value, template <typename> class Policy = NoCachePolicy,
+          typename Serializer = value_serializer<Value>>
+class tiered_cache
+{
+    struct demotion_state;
+
+  public:
+    using value_type = WrappedValue<Value>;
+    using l2_type = disk_log_store<Key, Value, Serializer>;
+
+    /**
+     * \brief L1 value storage that keeps erased elements visible in the demotion queue
+     * \details Erased elements are added to the queue under the L1 lock, so an evicted element
+     * can be found by a concurrent lookup before its erase notification is delivered. A value
+     * put over an erased one drops it from the queue, the other erasures are dropped by the
+     * demotion_listener
+     */
+    class demotion_storage : public heap_value_storage<Key, Value>
+    {
+      public:
+        explicit demotion_storage(std::shared_ptr<demotion_state> state) : state{std::move(state)}
+        {
+        }
+
+        void OnInsert(const Key &key, const value_type &value)
+        {
+            (void)value;
+            std::lock_guard<std::mutex> lock{state->in_flight_op};
+
+            state->in_flight.erase(key);
+        }
+
+        void OnErase(const Key &key, const value_type &value)
+        {
+            std::lock_guard<std::mutex> lock{state->in_flight_op};
+
+            state->in_flight[key] = value;
+        }
+
+      private:
+        std::shared_ptr<demotion_state> state;
+    };
+
+    /**
+     * \brief L1 erase listener that queues evicted elements for writing to L2
+     */
+    class demotion_listener
+    {
+      public:
+        explicit demotion_listener(std::shared_ptr<demotion_state> state)
+            : state{state}, writer{MakeWriter(state)}
+        {
+        }
+
+        void operator()(const Key &key, const value_type &value, erase_cause cause)
+        {
+            if (cause == erase_cause::evicted)
+            {
+                writer(key, value, cause);
+                return;
+            }
+
+            // only evicted elements are demoted
+            std::lock_guard<std::mutex> lock{state->in_flight_op};
+            auto elem_it = state->in_flight.find(key);
+
+            if (elem_it != state->in_flight.end() && elem_it->second == value)
+            {
+                state->in_flight.erase(elem_it);
+            }
+        }
+
+        void Flush() const
+        {
+            writer.Flush();
+        }
+
+      private:
+        std::shared_ptr<demotion_state> state;
+        threaded_erase_listener<Key, value_type> writer;
+    };
+
+    using l1_type =
+        fixed_sized_cache<Key, Value, Policy, std::unordered_map<Key, value_type>,
+                          demotion_storage, demotion_listener>;
+
+    /**
+     * \brief Construct two-tier cache
+     * \throw std::invalid_argument
+     * \throw std::system_error
+     * \param[in] max_size Maximum number of elements in L1
+     * \param[in] l2_path Path of the L2 log file
+     * \param[in] l2_capacity Maximum size of the L2 log file in bytes
+     * \param[in] policy L1 cache policy to use
+     */
+    tiered_cache(std::size_t max_size, std::string l2_path, std::uint64_t l2_capacity,
+                 const Policy<Key> &policy = Policy<Key>{})
+        : state{std::make_shared<demotion_state>(std::move(l2_path), l2_capacity)},
+          demotion{state}, l1{max_size, policy, demotion, demotion_storage{state}}
+    {
+    }
+
+    /**
+     * \brief Put element into the cache
+     * \param[in] key Key value to use
+     * \param[in] value Value to assign to the given key
+     */
+    void Put(const Key &key, const Value &value)
+    {
+        std::lock_guard<std::mutex> lock{StripeOf(key)};
+
+        // the value in L1 supersedes the demoted one
+        Forget(key);
+        l1.Put(key, value);
+    }
+
+    /**
+     * \brief Try to get an element from L1 or L2
+     * \param[in] key Get element by key
+     * \return Pair of the value and boolean value that shows whether it has been found
+     */
+    std::pair<value_type, bool> TryGet(const Key &key)
+    {
+        auto result = l1.TryGet(key);
+
+        if (result.second)
+        {
+            return result;
+        }
+
+        std::lock_guard<std::mutex> lock{StripeOf(key)};
+
+        result = l1.TryGet(key);
+
+        if (result.second)
+        {
+            return result;
+        }
+
+        value_type value;
+
+        {
+            std::lock_guard<std::mutex> in_flight_lock{state->in_flight_op};
+            auto elem_it = state->in_flight.find(key);
+
+            if (elem_it != state->in_flight.end())
+            {
+                value = elem_it->second;
+            }
+        }
+
+        if (!value)
+        {
+            value = state->l2.Get(key);
+        }
+
+        if (!value)
+        {
+            return {nullptr, false};
+        }
+
+        Forget(key);
+        l1.Put(key, *value);
+
+        return {value, true};
+    }
+
+    /**
+     * \brief Get element from L1 or L2
+     * \throw std::range_error
+     * \param[in] key Get element by key
+     */
+    value_type Get(const Key &key)
+    {
+        auto result = TryGet(key);
+
+        if (!result.second)
+        {
+            throw std::range_error{"No such element in the cache"};
+        }
+
+        return result.first;
+    }
+
+    /**
+     * \brief Check whether the given key is in L1 or L2 without promoting it
+     */
+    bool Cached(const Key &key) const
+    {
+        if (l1.Cached(key) || state->l2.Contains(key))
+        {
+            return true;
+        }
+
+        std::lock_guard<std::mutex> lock{state->in_flight_op};
+
+        return state->in_flight.find(key) != state->in_flight.end();
+    }
+
+    /**
+     * \brief Remove an element from both tiers
+     * \retval true if the element was found in any tier
+     */
+    bool Remove(const Key &key)
+    {
+        std::lock_guard<std::mutex> lock{StripeOf(key)};
+        const bool in_l1 = l1.Remove(key);
+        const bool in_l2 = Forget(key);
+
+        return in_l1 || in_l2;
+    }
+
+    /**
+     * \brief Wait until all pending demotions are written to L2
+     */
+    void Flush() const
+    {
+        demotion.Flush();
+    }
+
+    /**
+     * \brief Number of elements in L1
+     */
+    std::size_t L1Size() const
+    {
+        return l1.Size();
+    }
+
+    /**
+     * \brief Number of elements in L2
+     */
+    std::size_t L2Size() const
+    {
+        return state->l2.Size();
+    }
+
+  private:
+    struct demotion_state
+    {
+        demotion_state(std::string path, std::uint64_t capacity) : l2{std::move(path), capacity}
+        {
+        }
+
+        l2_type l2;
+        // evicted elements that are not written to L2 yet
+        std::unordered_map<Key, value_type> in_flight;
+        std::mutex in_flight_op;
+    };
+
+    static constexpr std::size_t STRIPES = 64;
+
+    static threaded_erase_listener<Key, value_type> MakeWriter(
+        const std::shared_ptr<demotion_state> &state)
+    {
+        std::weak_ptr<demotion_state> weak_state = state;
+
+        return threaded_erase_listener<Key, value_type>{
+            [weak_state](const Key &key, const value_type &value, erase_cause)
+            {
+                auto state = weak_state.lock();
+
+                if (!state)
+                {
+                    return;
+                }
+
+                {
+                    // notifications may be delivered out of order, skip the elements that have
+                    // been updated, promoted, removed or demoted again since their eviction
+                    std::lock_guard<std::mutex> lock{state->in_flight_op};
+                    auto elem_it = state->in_flight.find(key);
+
+                    if (elem_it == state->in_flight.end() || elem_it->second != value)
+                    {
+                        return;
+                    }
+                }
+
+                state->l2.Put(key, *value);
+
+                std::lock_guard<std::mutex> lock{state->in_flight_op};
+                auto elem_it = state->in_flight.find(key);
+
+                if (elem_it != state->in_flight.end() && elem_it->second == value)
+                {
+                    state->in_flight.erase(elem_it);
+                }
+                else
+                {
+                    // the element has been updated, promoted or removed while it was written
+                    state->l2.Remove(key);
+                }
+            }};
+    }
+
+    // drop the element from L2 and from the demotion queue
+    bool Forget(const Key &key)
+    {
+        std::lock_guard<std::mutex> lock{state->in_flight_op};
+        const bool in_flight = state->in_flight.erase(key) != 0;
+        const bool in_l2 = state->l2.Remove(key);
+
+        return in_flight || in_l2;
+    }
+
+    std::mutex &StripeOf(const Key &key) const
+    {
+        return stripes[std::hash<Key>{}(key) % STRIPES];
+    }
+
+    std::shared_ptr<demotion_state> state;
+    demotion_listener demotion;
+    l1_type l1;
+    mutable std::array<std::mutex, STRIPES> stripes;
+};
+} // namespace caches
+
+#endif // TIERED_CACHE_HPP
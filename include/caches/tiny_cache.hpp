@@ -0,0 +1,413 @@
+/**
+ * \file
+ * \brief LRU cache for a few dozen elements with vectorized key search
+ */
+#ifndef TINY_CACHE_HPP
+#define TINY_CACHE_HPP
+
+#include "static_cache.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+#if !defined(CACHES_DISABLE_SIMD) && defined(__AVX2__)
+#define CACHES_TINY_CACHE_AVX2 1
+#include <immintrin.h>
+#elif !defined(CACHES_DISABLE_SIMD) &&                                                            \
+    (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define CACHES_TINY_CACHE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace caches
+{
+/**
+ * \brief Search of a key in an array of up to 64 keys
+ * \details `Scalar` compares the keys one by one. `Vector` compares 4 or 8 byte keys with
+ * AVX2 or SSE2 instructions, depending on the target the code is compiled for, and falls back
+ * to `Scalar` for other key sizes or when no vector instructions are available (or
+ * `CACHES_DISABLE_SIMD` is defined)
+ * \tparam Key Type of a key
+ * \tparam N Number of keys in the array (a multiple of 8)
+ */
+template <typename Key, std::size_t N>
+struct tiny_key_matcher
+{
+    static_assert(N % 8 == 0 && N <= 64, "The array should hold a multiple of 8 up to 64 keys");
+
+    /**
+     * \brief Bit mask of the array positions holding the key
+     */
+    static std::uint64_t Scalar(const Key *keys, const Key &key) noexcept
+    {
+        std::uint64_t mask = 0;
+
+        for (std::size_t i = 0; i < N; ++i)
+        {
+            mask |= static_cast<std::uint64_t>(keys[i] == key) << i;
+        }
+
+        return mask;
+    }
+
+    /**
+     * \brief Bit mask of the array positions holding the key, `keys` has to be 32-byte aligned
+     */
+    static std::uint64_t Vector(const Key *keys, const Key &key) noexcept
+    {
+        return Vector(keys, key, std::integral_constant<std::size_t, sizeof(Key)>{});
+    }
+
+  private:
+    template <std::size_t Size>
+    static std::uint64_t Vector(const Key *keys, const Key &key,
+                                std::integral_constant<std::size_t, Size>) noexcept
+    {
+        return Scalar(keys, key);
+    }
+
+#if defined(CACHES_TINY_CACHE_AVX2)
+    static std::uint64_t Vector(const Key *keys, const Key &key,
+                                std::integral_constant<std::size_t, 4>) noexcept
+    {
+        std::int32_t bits;
+        std::uint64_t mask = 0;
+
+        std::memcpy(&bits, &key, sizeof(bits));
+
+        const __m256i needle = _mm256_set1_epi32(bits);
+
+        for (std::size_t i = 0; i < N; i += 8)
+        {
+            const __m256i lanes = _mm256_load_si256(reinterpret_cast<const __m256i *>(keys + i));
+            const __m256i equal = _mm256_cmpeq_epi32(lanes, needle);
+
+            mask |= static_cast<std::uint64_t>(_mm256_movemask_ps(_mm256_castsi256_ps(equal)))
+                    << i;
+        }
+
+        return mask;
+    }
+
+    static std::uint64_t Vector(const Key *keys, const Key &key,
+                                std::integral_constant<std::size_t, 8>) noexcept
+    {
+        long long bits;
+        std::uint64_t mask = 0;
+
+        std::memcpy(&bits, &key, sizeof(bits));
+
+        const __m256i needle = _mm256_set1_epi64x(bits);
+
+        for (std::size_t i = 0; i < N; i += 4)
+        {
+            const __m256i lanes = _mm256_load_si256(reinterpret_cast<const __m256i *>(keys + i));
+            const __m256i equal = _mm256_cmpeq_epi64(lanes, needle);
+
+            mask |= static_cast<std::uint64_t>(_mm256_movemask_pd(_mm256_castsi256_pd(equal)))
+                    << i;
+        }
+
+        return mask;
+    }
+#elif defined(CACHES_TINY_CACHE_SSE2)
+    static std::uint64_t Vector(const Key *keys, const Key &key,
+                                std::integral_constant<std::size_t, 4>) noexcept
+    {
+        std::int32_t bits;
+        std::uint64_t mask = 0;
+
+        std::memcpy(&bits, &key, sizeof(bits));
+
+        const __m128i needle = _mm_set1_epi32(bits);
+
+        for (std::size_t i = 0; i < N; i += 4)
+        {
+            const __m128i lanes = _mm_load_si128(reinterpret_cast<const __m128i *>(keys + i));
+            const __m128i equal = _mm_cmpeq_epi32(lanes, needle);
+
+            mask |= static_cast<std::uint64_t>(_mm_movemask_ps(_mm_castsi128_ps(equal))) << i;
+        }
+
+        return mask;
+    }
+
+    static std::uint64_t Vector(const Key *keys, const Key &key,
+                                std::integral_constant<std::size_t, 8>) noexcept
+    {
+        std::int32_t halves[2];
+        std::uint64_t mask = 0;
+
+        std::memcpy(halves, &key, sizeof(halves));
+
+        const __m128i needle = _mm_set_epi32(halves[1], halves[0], halves[1], halves[0]);
+
+        for (std::size_t i = 0; i < N; i += 2)
+        {
+            const __m128i lanes = _mm_load_si128(reinterpret_cast<const __m128i *>(keys + i));
+            const __m128i equal = _mm_cmpeq_epi32(lanes, needle);
+            // SSE2 has no 64-bit compare: both halves of a lane have to be equal
+            const __m128i swapped = _mm_shuffle_epi32(equal, _MM_SHUFFLE(2, 3, 0, 1));
+
+            mask |= static_cast<std::uint64_t>(
+                        _mm_movemask_pd(_mm_castsi128_pd(_mm_and_si128(equal, swapped))))
+                    << i;
+        }
+
+        return mask;
+    }
+#endif
+};
+
+/**
+ * \brief LRU cache for up to 64 elements with integral keys, searched with SIMD compares
+ * \details Keys are kept in a packed aligned array (structure of arrays), so a lookup compares
+ * the key against all stored keys with a few vector instructions instead of hashing (see
+ * tiny_key_matcher). Recency is tracked with a 32-bit access stamp per slot; the element with
+ * the oldest stamp is evicted, and it's found with the same vectorized search.
+ *
+ * The interface matches static_cache: the cache never allocates, is not synchronized, and
+ * returns plain pointers/references valid until the next modification.
+ * \tparam Key Type of a key (integral, enumeration or pointer type)
+ * \tparam Value Type of a value (default constructible and copy assignable)
+ * \tparam Capacity Maximum number of elements, up to 64
+ */
+template <typename Key, typename Value, std::size_t Capacity>
+class tiny_cache
+{
+    static_assert(std::is_integral<Key>::value || std::is_enum<Key>::value ||
+                      std::is_pointer<Key>::value,
+                  "Keys are compared bitwise, so they should be integral, enum or pointer types");
+    static_assert(Capacity > 0 && Capacity <= 64, "Capacity of the cache should be 1..64");
+
+  public:
+    tiny_cache() noexcept
+    {
+        for (std::size_t i = Capacity; i < SLOTS; ++i)
+        {
+            stamps[i] = LAST_STAMP;
+        }
+    }
+
+    /**
+     * \brief Put element into the cache, evicting the least recently used one if it's full
+     * \param[in] key Key value to use
+     * \param[in] value Value to assign to the given key
+     */
+    void Put(const Key &key, const Value &value)
+    {
+        const auto found = Find(key);
+        std::size_t slot;
+
+        if (found != 0)
+        {
+            slot = LowestBit(found);
+        }
+        else if (occupied != FULL)
+        {
+            slot = LowestBit(~occupied);
+            keys[slot] = key;
+            occupied |= std::uint64_t{1} << slot;
+            ++size;
+        }
+        else
+        {
+            slot = Oldest();
+            keys[slot] = key;
+        }
+
+        values[slot] = value;
+        Stamp(slot);
+    }
+
+    /**
+     * \brief Try to get an element by the given key from the cache
+     * \return Pointer to the value or `nullptr` if the element is not in the cache
+     */
+    const Value *TryGet(const Key &key) noexcept
+    {
+        const auto found = Find(key);
+
+        if (found == 0)
+        {
+            return nullptr;
+        }
+
+        const auto slot = LowestBit(found);
+
+        Stamp(slot);
+
+        return &values[slot];
+    }
+
+    /**
+     * \brief Get element from the cache if present
+     * \throw std::range_error
+     */
+    const Value &Get(const Key &key)
+    {
+        const auto *value = TryGet(key);
+
+        if (value == nullptr)
+        {
+            throw std::range_error{"No such element in the cache"};
+        }
+
+        return *value;
+    }
+
+    /**
+     * \brief Check whether the given key is presented in the cache
+     */
+    bool Cached(const Key &key) const noexcept
+    {
+        return Find(key) != 0;
+    }
+
+    /**
+     * \brief Remove an element specified by key
+     * \retval true if an element specified by key was found and deleted
+     * \retval false if an element is not present in a cache
+     */
+    bool Remove(const Key &key)
+    {
+        const auto found = Find(key);
+
+        if (found == 0)
+        {
+            return false;
+        }
+
+        const auto slot = LowestBit(found);
+
+        occupied &= ~found;
+        values[slot] = Value{};
+        --size;
+
+        return true;
+    }
+
+    /**
+     * \brief Get number of elements in cache
+     */
+    std::size_t Size() const noexcept
+    {
+        return size;
+    }
+
+    /**
+     * \brief Get maximum number of elements the cache can hold
+     */
+    static constexpr std::size_t MaxSize() noexcept
+    {
+        return Capacity;
+    }
+
+  private:
+    // the key array is padded to whole vectors
+    static constexpr std::size_t SLOTS = (Capacity + 7) / 8 * 8;
+    static constexpr std::uint64_t FULL =
+        Capacity == 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << (Capacity % 64)) - 1;
+    // padding slots keep the last stamp, so they are never the oldest ones
+    static constexpr std::uint32_t LAST_STAMP = 0xFFFFFFFF;
+
+    std::uint64_t Find(const Key &key) const noexcept
+    {
+        return tiny_key_matcher<Key, SLOTS>::Vector(keys, key) & occupied;
+    }
+
+    void Stamp(std::size_t slot) noexcept
+    {
+        if (clock == LAST_STAMP)
+        {
+            Renumber();
+        }
+
+        stamps[slot] = ++clock;
+    }
+
+    // the minimum is found with a vectorizable loop and its position with tiny_key_matcher
+    std::size_t Oldest() const noexcept
+    {
+        auto oldest = stamps[0];
+
+        for (std::size_t i = 1; i < SLOTS; ++i)
+        {
+            oldest = stamps[i] < oldest ? stamps[i] : oldest;
+        }
+
+        return LowestBit(tiny_key_matcher<std::uint32_t, SLOTS>::Vector(stamps, oldest) &
+                         occupied);
+    }
+
+    // keep the order of the stamps, but make them as small as possible when the clock overflows
+    void Renumber() noexcept
+    {
+        std::uint32_t renumbered[Capacity]{};
+
+        for (std::size_t i = 0; i < Capacity; ++i)
+        {
+            for (std::size_t j = 0; j < Capacity; ++j)
+            {
+                renumbered[i] += stamps[j] < stamps[i] ? 1 : 0;
+            }
+        }
+
+        clock = 0;
+
+        for (std::size_t i = 0; i < Capacity; ++i)
+        {
+            stamps[i] = renumbered[i];
+            clock = clock > stamps[i] ? clock : stamps[i];
+        }
+    }
+
+    static std::size_t LowestBit(std::uint64_t bits) noexcept
+    {
+#if defined(_MSC_VER) && defined(_M_X64)
+        unsigned long index;
+
+        _BitScanForward64(&index, bits);
+
+        return index;
+#elif defined(__GNUC__) || defined(__clang__)
+        return static_cast<std::size_t>(__builtin_ctzll(bits));
+#else
+        std::size_t index = 0;
+
+        for (; (bits & 1) == 0; bits >>= 1)
+        {
+            ++index;
+        }
+
+        return index;
+#endif
+    }
+
+    alignas(32) Key keys[SLOTS]{};
+    alignas(32) std::uint32_t stamps[SLOTS]{};
+    std::uint64_t occupied = 0;
+    std::uint32_t clock = 0;
+    std::size_t size = 0;
+    Value values[Capacity]{};
+};
+
+/**
+ * \brief Select the fastest allocation-free cache for the given capacity and key type
+ * \details tiny_cache for up to 64 elements with integral keys, static_cache otherwise
+ */
+template <typename Key, typename Value, std::size_t Capacity>
+using small_cache_t = typename std::conditional<
+    (Capacity <= 64 && (std::is_integral<Key>::value || std::is_enum<Key>::value ||
+                        std::is_pointer<Key>::value)),
+    tiny_cache<Key, Value, Capacity>, static_cache<Key, Value, Capacity>>::type;
+} // namespace caches
+
+#endif // TINY_CACHE_HPP
@@ -0,0 +1,62 @@
+/**
+ * \file
+ * \brief Conversion of values to byte strings
+ */
+#ifndef VALUE_SERIALIZER_HPP
+#define VALUE_SERIALIZER_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+namespace caches
+{
+/**
+ * \brief Conversion of values to and from bytes (e.g. for storing them on disk)
+ * \details The default implementation handles trivially copyable types. Specialize it for other
+ * value types
+ * \tparam Value Type of a value
+ */
+template <typename Value>
+struct value_serializer
+{
+    static_assert(std::is_trivially_copyable<Value>::value,
+                  "value_serializer has to be specialized for non trivially copyable types");
+
+    static void Serialize(const Value &value, std::string &out)
+    {
+        out.assign(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    static bool Deserialize(const char *data, std::size_t size, Value &value)
+    {
+        if (size != sizeof(value))
+        {
+            return false;
+        }
+
+        std::memcpy(&value, data, size);
+
+        return true;
+    }
+};
+
+template <>
+struct value_serializer<std::string>
+{
+    static void Serialize(const std::string &value, std::string &out)
+    {
+        out = value;
+    }
+
+    static bool Deserialize(const char *data, std::size_t size, std::string &value)
+    {
+        value.assign(data, size);
+
+        return true;
+    }
+};
+} // namespace caches
+
+#endif // VALUE_SERIALIZER_HPP
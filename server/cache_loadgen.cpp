@@ -0,0 +1,434 @@
+// Load generator for cache_server (or any memcached text protocol server) over loopback
+//
+// Usage: cache_loadgen [--host 127.0.0.1] [--port 11211] [--connections 4] [--pipeline 16]
+//                      [--duration 5] [--keys 100000] [--value-size 100] [--get-ratio 0.9]
+//
+// Every connection runs on its own thread and sends `pipeline` requests at a time. The latency of
+// a request is the time from sending its batch to receiving its response.
+
+#include "caches/lock_profiler.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace
+{
+using loadgen_clock = std::chrono::steady_clock;
+
+struct loadgen_options
+{
+    std::string host = "127.0.0.1";
+    std::uint16_t port = 11211;
+    unsigned connections = 4;
+    unsigned pipeline = 16;
+    double duration = 5.0;
+    unsigned keys = 100000;
+    std::size_t value_size = 100;
+    double get_ratio = 0.9;
+};
+
+struct loadgen_totals
+{
+    std::atomic<std::uint64_t> hits{0};
+    std::atomic<std::uint64_t> misses{0};
+    std::atomic<std::uint64_t> stores{0};
+    std::atomic<std::uint64_t> errors{0};
+    caches::latency_histogram latencies;
+};
+
+enum class response_kind
+{
+    incomplete,
+    hit,
+    miss,
+    stored,
+    error
+};
+
+[[noreturn]] void Fail(const char *message)
+{
+    throw std::system_error{errno, std::generic_category(), message};
+}
+
+// blocking connection to the server
+class client
+{
+  public:
+    explicit client(const loadgen_options &options)
+    {
+        fd = ::socket(AF_INET, SOCK_STREAM, 0);
+
+        if (fd < 0)
+        {
+            Fail("Unable to create a socket");
+        }
+
+        sockaddr_in address{};
+
+        address.sin_family = AF_INET;
+        address.sin_port = htons(options.port);
+
+        if (::inet_pton(AF_INET, options.host.c_str(), &address.sin_addr) != 1)
+        {
+            ::close(fd);
+            throw std::invalid_argument{"Invalid IPv4 address: " + options.host};
+        }
+
+        if (::connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0)
+        {
+            const auto error = errno;
+
+            ::close(fd);
+            errno = error;
+            Fail("Unable to connect to the server");
+        }
+
+        const int enable = 1;
+
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    }
+
+    client(const client &) = delete;
+    client &operator=(const client &) = delete;
+
+    ~client()
+    {
+        ::close(fd);
+    }
+
+    void Send(const std::string &data)
+    {
+        std::size_t sent = 0;
+
+        while (sent < data.size())
+        {
+            const auto result = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+
+            if (result < 0 && errno == EINTR)
+            {
+                continue;
+            }
+
+            if (result <= 0)
+            {
+                Fail("Unable to send requests");
+            }
+
+            sent += static_cast<std::size_t>(result);
+        }
+    }
+
+    // read the next response, waiting for the server if needed
+    response_kind Receive()
+    {
+        for (;;)
+        {
+            std::size_t consumed = 0;
+            const auto kind = Parse(consumed);
+
+            if (kind != response_kind::incomplete)
+            {
+                buffer.erase(0, consumed);
+                return kind;
+            }
+
+            char chunk[64 * 1024];
+            const auto received = ::recv(fd, chunk, sizeof(chunk), 0);
+
+            if (received < 0 && errno == EINTR)
+            {
+                continue;
+            }
+
+            if (received <= 0)
+            {
+                Fail("Connection to the server is lost");
+            }
+
+            buffer.append(chunk, static_cast<std::size_t>(received));
+        }
+    }
+
+  private:
+    response_kind Parse(std::size_t &consumed) const
+    {
+        const auto line_end = buffer.find("\r\n");
+
+        if (line_end == std::string::npos)
+        {
+            return response_kind::incomplete;
+        }
+
+        if (buffer.compare(0, line_end, "STORED") == 0)
+        {
+            consumed = line_end + 2;
+            return response_kind::stored;
+        }
+
+        if (buffer.compare(0, line_end, "END") == 0)
+        {
+            consumed = line_end + 2;
+            return response_kind::miss;
+        }
+
+        if (buffer.compare(0, 6, "VALUE ") != 0)
+        {
+            consumed = line_end + 2;
+            return response_kind::error;
+        }
+
+        // VALUE <key> <flags> <bytes>\r\n<data>\r\nEND\r\n
+        const auto bytes_begin = buffer.rfind(' ', line_end) + 1;
+        const auto bytes =
+            std::strtoull(buffer.c_str() + bytes_begin, nullptr, 10);
+        const auto end = line_end + 2 + bytes + 2;
+        static const char terminator[] = "END\r\n";
+
+        if (buffer.size() < end + sizeof(terminator) - 1)
+        {
+            return response_kind::incomplete;
+        }
+
+        consumed = end + sizeof(terminator) - 1;
+
+        return buffer.compare(end, sizeof(terminator) - 1, terminator) == 0
+                   ? response_kind::hit
+                   : response_kind::error;
+    }
+
+    int fd;
+    std::string buffer;
+};
+
+void Record(loadgen_totals &totals, response_kind kind)
+{
+    switch (kind)
+    {
+    case response_kind::hit:
+        totals.hits.fetch_add(1, std::memory_order_relaxed);
+        break;
+    case response_kind::miss:
+        totals.misses.fetch_add(1, std::memory_order_relaxed);
+        break;
+    case response_kind::stored:
+        totals.stores.fetch_add(1, std::memory_order_relaxed);
+        break;
+    default:
+        totals.errors.fetch_add(1, std::memory_order_relaxed);
+        break;
+    }
+}
+
+std::string SetRequest(unsigned key, const std::string &value)
+{
+    return "set key:" + std::to_string(key) + " 0 0 " + std::to_string(value.size()) + "\r\n" +
+           value + "\r\n";
+}
+
+// store every key once, so that the measured lookups hit
+void Prefill(const loadgen_options &options)
+{
+    client connection{options};
+    const std::string value(options.value_size, 'v');
+
+    for (unsigned first = 0; first < options.keys; first += options.pipeline)
+    {
+        std::string batch;
+        unsigned count = 0;
+
+        for (auto key = first; key < options.keys && count < options.pipeline; ++key, ++count)
+        {
+            batch += SetRequest(key, value);
+        }
+
+        connection.Send(batch);
+
+        for (unsigned i = 0; i < count; ++i)
+        {
+            connection.Receive();
+        }
+    }
+}
+
+void Drive(const loadgen_options &options, unsigned seed, loadgen_totals &totals)
+{
+    client connection{options};
+    const std::string value(options.value_size, 'v');
+    std::mt19937 random{seed};
+    std::uniform_int_distribution<unsigned> keys{0, options.keys - 1};
+    std::bernoulli_distribution is_get{options.get_ratio};
+    const auto deadline =
+        loadgen_clock::now() + std::chrono::duration_cast<loadgen_clock::duration>(
+                                   std::chrono::duration<double>{options.duration});
+    std::string batch;
+
+    while (loadgen_clock::now() < deadline)
+    {
+        batch.clear();
+
+        for (unsigned i = 0; i < options.pipeline; ++i)
+        {
+            const auto key = keys(random);
+
+            batch += is_get(random) ? "get key:" + std::to_string(key) + "\r\n"
+                                    : SetRequest(key, value);
+        }
+
+        const auto sent = loadgen_clock::now();
+
+        connection.Send(batch);
+
+        for (unsigned i = 0; i < options.pipeline; ++i)
+        {
+            Record(totals, connection.Receive());
+
+            const auto latency = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                loadgen_clock::now() - sent);
+
+            totals.latencies.Record(static_cast<std::uint64_t>(latency.count()));
+        }
+    }
+}
+
+loadgen_options ParseOptions(int argc, char **argv)
+{
+    loadgen_options options;
+
+    if (argc % 2 == 0)
+    {
+        throw std::invalid_argument{std::string{"Option without a value: "} + argv[argc - 1]};
+    }
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        const std::string name = argv[i];
+        const std::string value = argv[i + 1];
+
+        if (name == "--host")
+        {
+            options.host = value;
+        }
+        else if (name == "--port")
+        {
+            options.port = static_cast<std::uint16_t>(std::stoul(value));
+        }
+        else if (name == "--connections")
+        {
+            options.connections = static_cast<unsigned>(std::stoul(value));
+        }
+        else if (name == "--pipeline")
+        {
+            options.pipeline = static_cast<unsigned>(std::stoul(value));
+        }
+        else if (name == "--duration")
+        {
+            options.duration = std::stod(value);
+        }
+        else if (name == "--keys")
+        {
+            options.keys = static_cast<unsigned>(std::stoul(value));
+        }
+        else if (name == "--value-size")
+        {
+            options.value_size = std::stoull(value);
+        }
+        else if (name == "--get-ratio")
+        {
+            options.get_ratio = std::stod(value);
+        }
+        else
+        {
+            throw std::invalid_argument{"Unknown option: " + name};
+        }
+    }
+
+    if (options.connections == 0 || options.pipeline == 0 || options.keys == 0 ||
+        options.get_ratio < 0.0 || options.get_ratio > 1.0)
+    {
+        throw std::invalid_argument{"Connections, pipeline and keys should be non-zero, get ratio "
+                                    "should be within [0, 1]"};
+    }
+
+    return options;
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        const auto options = ParseOptions(argc, argv);
+        loadgen_totals totals;
+        std::vector<std::thread> threads;
+        std::atomic<bool> failed{false};
+
+        Prefill(options);
+
+        const auto begin = loadgen_clock::now();
+
+        for (unsigned i = 0; i < options.connections; ++i)
+        {
+            threads.emplace_back(
+                [&, i]
+                {
+                    try
+                    {
+                        Drive(options, i + 1, totals);
+                    }
+                    catch (const std::exception &e)
+                    {
+                        std::fprintf(stderr, "cache_loadgen: %s\n", e.what());
+                        failed = true;
+                    }
+                });
+        }
+
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+
+        const auto elapsed = std::chrono::duration<double>(loadgen_clock::now() - begin).count();
+        const auto &latencies = totals.latencies;
+        const auto requests = latencies.Count();
+
+        std::printf("%u connections, pipeline %u, %zu byte values, %.0f%% gets\n",
+                    options.connections, options.pipeline, options.value_size,
+                    options.get_ratio * 100);
+        std::printf("requests %llu, %.0f requests/s, hits %llu, misses %llu, stores %llu, "
+                    "errors %llu\n",
+                    static_cast<unsigned long long>(requests), requests / elapsed,
+                    static_cast<unsigned long long>(totals.hits.load()),
+                    static_cast<unsigned long long>(totals.misses.load()),
+                    static_cast<unsigned long long>(totals.stores.load()),
+                    static_cast<unsigned long long>(totals.errors.load()));
+        std::printf("latency us: p50 %.1f, p90 %.1f, p99 %.1f, p99.9 %.1f, max %.1f\n",
+                    latencies.ValueAt(0.5) / 1000.0, latencies.ValueAt(0.9) / 1000.0,
+                    latencies.ValueAt(0.99) / 1000.0, latencies.ValueAt(0.999) / 1000.0,
+                    latencies.Max() / 1000.0);
+
+        return failed ? 1 : 0;
+    }
+    catch (const std::exception &e)
+    {
+        std::fprintf(stderr, "cache_loadgen: %s\n", e.what());
+        return 1;
+    }
+}
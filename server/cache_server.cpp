@@ -0,0 +1,760 @@
+// memcached text protocol server serving a fixed_sized_cache
+//
+// Usage: cache_server [--port 11211] [--threads <cores>] [--size 1000000]
+//                     [--policy lru|lfu|fifo|none] [--max-value-size 1048576]
+
+#include "memcached_protocol.hpp"
+
+#include "caches/cache.hpp"
+#include "caches/fifo_cache_policy.hpp"
+#include "caches/lfu_cache_policy.hpp"
+#include "caches/lru_cache_policy.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace
+{
+using server_clock = std::chrono::steady_clock;
+
+// stop reading requests of a connection while this much of its responses is unsent
+constexpr std::size_t MAX_PENDING_OUTPUT = 4 * 1024 * 1024;
+constexpr std::size_t READ_SIZE = 64 * 1024;
+constexpr int MAX_EVENTS = 256;
+// exptime above 30 days is an absolute unix time (see the memcached protocol)
+constexpr std::int64_t MAX_RELATIVE_EXPTIME = 60 * 60 * 24 * 30;
+
+std::atomic<bool> stopped{false};
+
+struct item
+{
+    std::uint32_t flags;
+    // 0 if the item never expires
+    server_clock::time_point::rep expires;
+    std::string data;
+};
+
+server_clock::time_point::rep Now() noexcept
+{
+    return server_clock::now().time_since_epoch().count();
+}
+
+server_clock::time_point::rep ExpirationTime(std::int64_t exptime)
+{
+    if (exptime == 0)
+    {
+        return 0;
+    }
+
+    if (exptime > MAX_RELATIVE_EXPTIME)
+    {
+        exptime -= static_cast<std::int64_t>(std::time(nullptr));
+    }
+
+    // negative times expire the item at once
+    const auto lifetime = std::chrono::seconds{exptime > 0 ? exptime : -1};
+
+    return (server_clock::now() + lifetime).time_since_epoch().count();
+}
+
+bool Expired(const item &value, server_clock::time_point::rep now) noexcept
+{
+    return value.expires != 0 && value.expires <= now;
+}
+
+// operations of the cache needed by the protocol, independent of the policy
+class cache_backend
+{
+  public:
+    virtual ~cache_backend() = default;
+
+    virtual caches::WrappedValue<item> Find(const std::string &key) = 0;
+    virtual void Set(const std::string &key, const item &value) = 0;
+    virtual bool Add(const std::string &key, const item &value) = 0;
+    virtual bool Replace(const std::string &key, const item &value) = 0;
+    virtual bool Delete(const std::string &key) = 0;
+    virtual void Flush() = 0;
+    virtual std::size_t Items() const = 0;
+    virtual std::size_t Limit() const = 0;
+};
+
+// conditional stores check and put under one lock acquisition
+template <template <typename> class Policy>
+class policy_backend : public cache_backend,
+                       private caches::fixed_sized_cache<std::string, item, Policy>
+{
+    using base_type = caches::fixed_sized_cache<std::string, item, Policy>;
+
+  public:
+    explicit policy_backend(std::size_t max_size) : base_type{max_size}
+    {
+    }
+
+    caches::WrappedValue<item> Find(const std::string &key) override
+    {
+        auto value = this->TryGet(key).first;
+
+        if (value == nullptr || !Expired(*value, Now()))
+        {
+            return value;
+        }
+
+        // expired items are erased lazily, unless they have been replaced meanwhile
+        this->Modify(caches::cache_operation::remove,
+                     [&]
+                     {
+                         const auto elem_it = this->FindElem(key);
+
+                         if (elem_it != this->end() && elem_it->second == value)
+                         {
+                             this->Erase(elem_it, caches::erase_cause::expired);
+                         }
+                     });
+
+        return nullptr;
+    }
+
+    void Set(const std::string &key, const item &value) override
+    {
+        this->Put(key, value);
+    }
+
+    bool Add(const std::string &key, const item &value) override
+    {
+        return PutIf(key, value, false);
+    }
+
+    bool Replace(const std::string &key, const item &value) override
+    {
+        return PutIf(key, value, true);
+    }
+
+    bool Delete(const std::string &key) override
+    {
+        return this->Remove(key);
+    }
+
+    void Flush() override
+    {
+        this->InvalidateAll();
+    }
+
+    std::size_t Items() const override
+    {
+        return this->Size();
+    }
+
+    std::size_t Limit() const override
+    {
+        return this->MaxSize();
+    }
+
+  private:
+    bool PutIf(const std::string &key, const item &value, bool present)
+    {
+        bool stored = false;
+
+        this->Modify(caches::cache_operation::put,
+                     [&]
+                     {
+                         const auto elem_it = this->FindElem(key);
+                         const auto found =
+                             elem_it != this->end() && !Expired(*elem_it->second, Now());
+
+                         if (found == present)
+                         {
+                             this->PutLocked(key, value);
+                             stored = true;
+                         }
+                     });
+
+        return stored;
+    }
+};
+
+std::unique_ptr<cache_backend> MakeBackend(const std::string &policy, std::size_t max_size)
+{
+    if (policy == "lru")
+    {
+        return std::unique_ptr<cache_backend>{new policy_backend<caches::LRUCachePolicy>{max_size}};
+    }
+
+    if (policy == "lfu")
+    {
+        return std::unique_ptr<cache_backend>{new policy_backend<caches::LFUCachePolicy>{max_size}};
+    }
+
+    if (policy == "fifo")
+    {
+        return std::unique_ptr<cache_backend>{
+            new policy_backend<caches::FIFOCachePolicy>{max_size}};
+    }
+
+    if (policy == "none")
+    {
+        return std::unique_ptr<cache_backend>{new policy_backend<caches::NoCachePolicy>{max_size}};
+    }
+
+    throw std::invalid_argument{"Unknown policy: " + policy};
+}
+
+struct server_options
+{
+    std::uint16_t port = 11211;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    std::size_t size = 1000000;
+    std::string policy = "lru";
+    std::size_t max_value_size = 1024 * 1024;
+};
+
+struct server_stats
+{
+    std::atomic<std::uint64_t> get_hits{0};
+    std::atomic<std::uint64_t> get_misses{0};
+    std::atomic<std::uint64_t> sets{0};
+    std::atomic<std::uint64_t> connections{0};
+};
+
+struct connection
+{
+    int fd = -1;
+    std::string input;
+    std::string output;
+    std::size_t output_sent = 0;
+    // events the socket is watched for
+    std::uint32_t events = EPOLLIN;
+    bool closing = false;
+
+    std::size_t PendingOutput() const noexcept
+    {
+        return output.size() - output_sent;
+    }
+};
+
+[[noreturn]] void Fail(const char *message)
+{
+    throw std::system_error{errno, std::generic_category(), message};
+}
+
+// one per thread: its own listening socket (SO_REUSEPORT spreads the connections) and epoll set
+class event_loop
+{
+  public:
+    event_loop(cache_backend &cache, server_stats &stats, const server_options &options)
+        : cache(cache), stats(stats), options(options), parser{options.max_value_size}
+    {
+        listener = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+
+        if (listener < 0)
+        {
+            Fail("Unable to create a socket");
+        }
+
+        const int enable = 1;
+
+        ::setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+        if (::setsockopt(listener, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) != 0)
+        {
+            Fail("Unable to share the port between event loops");
+        }
+
+        sockaddr_in address{};
+
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        address.sin_port = htons(options.port);
+
+        if (::bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+            ::listen(listener, SOMAXCONN) != 0)
+        {
+            Fail("Unable to listen on the port");
+        }
+
+        epoll = ::epoll_create1(0);
+
+        if (epoll < 0)
+        {
+            Fail("Unable to create an epoll instance");
+        }
+
+        Watch(listener, EPOLLIN, EPOLL_CTL_ADD);
+    }
+
+    event_loop(const event_loop &) = delete;
+    event_loop &operator=(const event_loop &) = delete;
+
+    ~event_loop()
+    {
+        for (auto &elem : connections)
+        {
+            ::close(elem.first);
+        }
+
+        ::close(epoll);
+        ::close(listener);
+    }
+
+    void Run()
+    {
+        epoll_event events[MAX_EVENTS];
+
+        while (!stopped)
+        {
+            // wake up now and then to check whether the server is stopped
+            const auto count = ::epoll_wait(epoll, events, MAX_EVENTS, 100);
+
+            if (count < 0 && errno != EINTR)
+            {
+                Fail("Unable to wait for events");
+            }
+
+            for (int i = 0; i < count; ++i)
+            {
+                if (events[i].data.fd == listener)
+                {
+                    Accept();
+                    continue;
+                }
+
+                auto elem_it = connections.find(events[i].data.fd);
+
+                if (elem_it == connections.end())
+                {
+                    continue;
+                }
+
+                auto &client = elem_it->second;
+
+                if (events[i].events & (EPOLLERR | EPOLLHUP))
+                {
+                    client.closing = true;
+                    client.output.clear();
+                    client.output_sent = 0;
+                }
+                else
+                {
+                    if (events[i].events & EPOLLIN)
+                    {
+                        Read(client);
+                    }
+
+                    Write(client);
+                }
+
+                if (client.closing && client.PendingOutput() == 0)
+                {
+                    ::close(client.fd);
+                    connections.erase(elem_it);
+                }
+            }
+        }
+    }
+
+  private:
+    void Watch(int fd, std::uint32_t events, int operation)
+    {
+        epoll_event event{};
+
+        event.events = events;
+        event.data.fd = fd;
+
+        if (::epoll_ctl(epoll, operation, fd, &event) != 0)
+        {
+            Fail("Unable to watch a socket");
+        }
+    }
+
+    void Accept()
+    {
+        for (;;)
+        {
+            const auto fd = ::accept4(listener, nullptr, nullptr, SOCK_NONBLOCK);
+
+            if (fd < 0)
+            {
+                return;
+            }
+
+            const int enable = 1;
+
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+            connections[fd].fd = fd;
+            Watch(fd, EPOLLIN, EPOLL_CTL_ADD);
+            stats.connections.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void Read(connection &client)
+    {
+        char buffer[READ_SIZE];
+
+        for (;;)
+        {
+            const auto received = ::recv(client.fd, buffer, sizeof(buffer), 0);
+
+            if (received > 0)
+            {
+                client.input.append(buffer, static_cast<std::size_t>(received));
+                continue;
+            }
+
+            if (received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+            {
+                // the peer is gone, answer what has been received anyway
+                client.closing = true;
+            }
+
+            if (received < 0 && errno == EINTR)
+            {
+                continue;
+            }
+
+            break;
+        }
+
+        Process(client);
+    }
+
+    // handle all complete requests received so far, responses are sent together
+    void Process(connection &client)
+    {
+        std::size_t offset = 0;
+
+        while (offset < client.input.size() && client.PendingOutput() < MAX_PENDING_OUTPUT)
+        {
+            std::size_t consumed;
+            std::string error;
+            const auto status = parser.Parse(client.input.data() + offset,
+                                             client.input.size() - offset, request, consumed,
+                                             error);
+
+            if (status == caches::memcached_parse_status::incomplete)
+            {
+                break;
+            }
+
+            offset += consumed;
+
+            if (status == caches::memcached_parse_status::complete)
+            {
+                Handle(client);
+            }
+            else
+            {
+                client.output += error;
+            }
+
+            if (status == caches::memcached_parse_status::fatal ||
+                (status == caches::memcached_parse_status::complete &&
+                 request.command == caches::memcached_command::quit))
+            {
+                client.closing = true;
+                offset = client.input.size();
+                break;
+            }
+        }
+
+        client.input.erase(0, offset);
+    }
+
+    void Handle(connection &client)
+    {
+        auto &out = client.output;
+
+        switch (request.command)
+        {
+        case caches::memcached_command::get:
+        case caches::memcached_command::gets:
+            for (const auto &key : request.keys)
+            {
+                const auto value = cache.Find(key);
+
+                if (value == nullptr)
+                {
+                    stats.get_misses.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+
+                stats.get_hits.fetch_add(1, std::memory_order_relaxed);
+                out += "VALUE ";
+                out += key;
+                out += ' ';
+                out += std::to_string(value->flags);
+                out += ' ';
+                out += std::to_string(value->data.size());
+
+                if (request.command == caches::memcached_command::gets)
+                {
+                    // items are never modified in place, so the address identifies the version
+                    out += ' ';
+                    out += std::to_string(reinterpret_cast<std::uintptr_t>(value.get()));
+                }
+
+                out += "\r\n";
+                out += value->data;
+                out += "\r\n";
+            }
+
+            out += "END\r\n";
+            break;
+        case caches::memcached_command::set:
+        case caches::memcached_command::add:
+        case caches::memcached_command::replace:
+        {
+            const item value{request.flags, ExpirationTime(request.exptime),
+                             std::move(request.data)};
+            const auto &key = request.keys.front();
+            bool stored = true;
+
+            if (request.command == caches::memcached_command::set)
+            {
+                cache.Set(key, value);
+            }
+            else if (request.command == caches::memcached_command::add)
+            {
+                stored = cache.Add(key, value);
+            }
+            else
+            {
+                stored = cache.Replace(key, value);
+            }
+
+            stats.sets.fetch_add(1, std::memory_order_relaxed);
+            Reply(out, stored ? "STORED\r\n" : "NOT_STORED\r\n");
+            break;
+        }
+        case caches::memcached_command::remove:
+            Reply(out, cache.Delete(request.keys.front()) ? "DELETED\r\n" : "NOT_FOUND\r\n");
+            break;
+        case caches::memcached_command::flush_all:
+            cache.Flush();
+            Reply(out, "OK\r\n");
+            break;
+        case caches::memcached_command::stats:
+            out += "STAT pid " + std::to_string(::getpid()) + "\r\n";
+            out += "STAT threads " + std::to_string(options.threads) + "\r\n";
+            out += "STAT curr_items " + std::to_string(cache.Items()) + "\r\n";
+            out += "STAT limit_maxitems " + std::to_string(cache.Limit()) + "\r\n";
+            out += "STAT total_connections " + std::to_string(stats.connections.load()) + "\r\n";
+            out += "STAT get_hits " + std::to_string(stats.get_hits.load()) + "\r\n";
+            out += "STAT get_misses " + std::to_string(stats.get_misses.load()) + "\r\n";
+            out += "STAT cmd_set " + std::to_string(stats.sets.load()) + "\r\n";
+            out += "STAT policy " + options.policy + "\r\nEND\r\n";
+            break;
+        case caches::memcached_command::version:
+            out += "VERSION caches-0.1.1\r\n";
+            break;
+        case caches::memcached_command::quit:
+            client.closing = true;
+            break;
+        }
+    }
+
+    void Reply(std::string &out, const char *response) const
+    {
+        if (!request.noreply)
+        {
+            out += response;
+        }
+    }
+
+    void Write(connection &client)
+    {
+        while (client.PendingOutput() > 0)
+        {
+            const auto sent = ::send(client.fd, client.output.data() + client.output_sent,
+                                     client.PendingOutput(), MSG_NOSIGNAL);
+
+            if (sent < 0 && errno == EINTR)
+            {
+                continue;
+            }
+
+            if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            {
+                break;
+            }
+
+            if (sent < 0)
+            {
+                client.closing = true;
+                client.output.clear();
+                client.output_sent = 0;
+                return;
+            }
+
+            client.output_sent += static_cast<std::size_t>(sent);
+        }
+
+        if (client.PendingOutput() == 0)
+        {
+            client.output.clear();
+            client.output_sent = 0;
+
+            // requests left unparsed while the output was full
+            if (!client.input.empty() && !client.closing)
+            {
+                Process(client);
+
+                if (client.PendingOutput() > 0)
+                {
+                    Write(client);
+                    return;
+                }
+            }
+        }
+
+        // stop reading requests while the client doesn't read the responses, a closing connection
+        // only flushes its output (its input may be at EOF, which would be reported forever)
+        const auto pending = client.PendingOutput();
+        const bool reading = pending < MAX_PENDING_OUTPUT && !client.closing;
+        const std::uint32_t events = (reading ? EPOLLIN : 0u) | (pending > 0 ? EPOLLOUT : 0u);
+
+        // a connection without pending output is closed by the caller
+        if (events != client.events && events != 0)
+        {
+            client.events = events;
+            Watch(client.fd, events, EPOLL_CTL_MOD);
+        }
+    }
+
+    cache_backend &cache;
+    server_stats &stats;
+    const server_options &options;
+    caches::memcached_parser parser;
+    caches::memcached_request request;
+    int listener = -1;
+    int epoll = -1;
+    std::unordered_map<int, connection> connections;
+};
+
+server_options ParseOptions(int argc, char **argv)
+{
+    server_options options;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        const std::string name = argv[i];
+        const std::string value = argv[i + 1];
+
+        if (name == "--port")
+        {
+            options.port = static_cast<std::uint16_t>(std::stoul(value));
+        }
+        else if (name == "--threads")
+        {
+            options.threads = static_cast<unsigned>(std::stoul(value));
+        }
+        else if (name == "--size")
+        {
+            options.size = std::stoull(value);
+        }
+        else if (name == "--policy")
+        {
+            options.policy = value;
+        }
+        else if (name == "--max-value-size")
+        {
+            options.max_value_size = std::stoull(value);
+        }
+        else
+        {
+            throw std::invalid_argument{"Unknown option: " + name};
+        }
+    }
+
+    if (argc % 2 == 0)
+    {
+        throw std::invalid_argument{std::string{"Option without a value: "} + argv[argc - 1]};
+    }
+
+    if (options.threads == 0)
+    {
+        throw std::invalid_argument{"Number of threads should be non-zero"};
+    }
+
+    return options;
+}
+
+void Stop(int)
+{
+    stopped = true;
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        const auto options = ParseOptions(argc, argv);
+        const auto cache = MakeBackend(options.policy, options.size);
+        server_stats stats;
+        std::vector<std::unique_ptr<event_loop>> loops;
+        std::vector<std::thread> threads;
+
+        for (unsigned i = 0; i < options.threads; ++i)
+        {
+            loops.emplace_back(new event_loop{*cache, stats, options});
+        }
+
+        std::signal(SIGINT, Stop);
+        std::signal(SIGTERM, Stop);
+        std::printf("cache_server: port %u, %u threads, %zu elements, %s policy\n",
+                    static_cast<unsigned>(options.port), options.threads, options.size,
+                    options.policy.c_str());
+        std::fflush(stdout);
+
+        for (auto &loop : loops)
+        {
+            threads.emplace_back(
+                [&loop]
+                {
+                    try
+                    {
+                        loop->Run();
+                    }
+                    catch (const std::exception &e)
+                    {
+                        std::fprintf(stderr, "cache_server: %s\n", e.what());
+                        stopped = true;
+                    }
+                });
+        }
+
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::fprintf(stderr, "cache_server: %s\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,334 @@
+/**
+ * \file
+ * \brief Parser of the memcached text protocol requests
+ */
+#ifndef MEMCACHED_PROTOCOL_HPP
+#define MEMCACHED_PROTOCOL_HPP
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace caches
+{
+/**
+ * \brief Commands of the memcached text protocol handled by the server
+ */
+enum class memcached_command
+{
+    get,
+    gets,
+    set,
+    add,
+    replace,
+    remove,
+    flush_all,
+    stats,
+    version,
+    quit
+};
+
+/**
+ * \brief Parsed request
+ */
+struct memcached_request
+{
+    memcached_command command = memcached_command::get;
+    /// Keys of `get`/`gets`, a single key of the other commands that take one
+    std::vector<std::string> keys;
+    std::uint32_t flags = 0;
+    /// Expiration time as sent by the client (see the memcached protocol)
+    std::int64_t exptime = 0;
+    /// Data block of a storage command
+    std::string data;
+    bool noreply = false;
+};
+
+/**
+ * \brief Outcome of parsing a request
+ */
+enum class memcached_parse_status
+{
+    /// A request has been parsed
+    complete,
+    /// The buffer doesn't hold a whole request yet
+    incomplete,
+    /// The request is invalid and has been skipped, the error has to be sent to the client
+    error,
+    /// The input can't be parsed any further, the connection has to be closed after sending the
+    /// error
+    fatal
+};
+
+/**
+ * \brief Parser of the memcached text protocol
+ * \details Parses one request at a time from the beginning of a connection buffer, so pipelined
+ * requests are handled by calling Parse until it reports an incomplete request
+ */
+class memcached_parser
+{
+  public:
+    static constexpr std::size_t MAX_KEY_SIZE = 250;
+    static constexpr std::size_t MAX_LINE_SIZE = 4096;
+
+    /**
+     * \brief Construct parser
+     * \param[in] max_value_size Maximum size of a data block
+     */
+    explicit memcached_parser(std::size_t max_value_size = 1024 * 1024)
+        : max_value_size{max_value_size}
+    {
+    }
+
+    /**
+     * \brief Parse a request from the beginning of the buffer
+     * \param[in] data Beginning of the buffer
+     * \param[in] size Size of the buffer
+     * \param[out] request Parsed request
+     * \param[out] consumed Number of bytes of the request (or of the skipped invalid request)
+     * \param[out] error Response to send if the request is invalid
+     */
+    memcached_parse_status Parse(const char *data, std::size_t size, memcached_request &request,
+                                 std::size_t &consumed, std::string &error) const
+    {
+        consumed = 0;
+
+        const auto *line_end = FindLineEnd(data, size);
+
+        if (line_end == nullptr)
+        {
+            if (size > MAX_LINE_SIZE)
+            {
+                error = "CLIENT_ERROR line too long\r\n";
+                return memcached_parse_status::fatal;
+            }
+
+            return memcached_parse_status::incomplete;
+        }
+
+        const auto line_size = static_cast<std::size_t>(line_end - data);
+        const auto tokens = Split(data, line_size);
+
+        if (tokens.empty())
+        {
+            consumed = line_size + 2;
+            error = "ERROR\r\n";
+            return memcached_parse_status::error;
+        }
+
+        request = memcached_request{};
+
+        const auto &name = tokens.front();
+
+        if (name == "get" || name == "gets")
+        {
+            consumed = line_size + 2;
+            request.command = name == "get" ? memcached_command::get : memcached_command::gets;
+
+            if (tokens.size() < 2)
+            {
+                error = "ERROR\r\n";
+                return memcached_parse_status::error;
+            }
+
+            request.keys.assign(tokens.begin() + 1, tokens.end());
+
+            return CheckKeys(request, error);
+        }
+
+        if (name == "set" || name == "add" || name == "replace")
+        {
+            request.command = name == "set"   ? memcached_command::set
+                              : name == "add" ? memcached_command::add
+                                              : memcached_command::replace;
+
+            return ParseStorage(tokens, data, size, line_size, request, consumed, error);
+        }
+
+        consumed = line_size + 2;
+
+        if (name == "delete" && (tokens.size() == 2 || tokens.size() == 3))
+        {
+            request.command = memcached_command::remove;
+            request.keys.push_back(tokens[1]);
+            request.noreply = tokens.size() == 3 && tokens[2] == "noreply";
+
+            return tokens.size() == 3 && !request.noreply ? Fail("bad command line format", error)
+                                                          : CheckKeys(request, error);
+        }
+
+        if (name == "flush_all" && tokens.size() <= 2)
+        {
+            request.command = memcached_command::flush_all;
+            request.noreply = tokens.size() == 2 && tokens[1] == "noreply";
+
+            return memcached_parse_status::complete;
+        }
+
+        if (tokens.size() == 1)
+        {
+            if (name == "stats" || name == "version" || name == "quit")
+            {
+                request.command = name == "stats"     ? memcached_command::stats
+                                  : name == "version" ? memcached_command::version
+                                                      : memcached_command::quit;
+
+                return memcached_parse_status::complete;
+            }
+        }
+
+        error = "ERROR\r\n";
+
+        return memcached_parse_status::error;
+    }
+
+  private:
+    static const char *FindLineEnd(const char *data, std::size_t size) noexcept
+    {
+        const auto *end = data + size;
+
+        for (const auto *it = data; it + 1 < end; ++it)
+        {
+            const auto searched = static_cast<std::size_t>(end - it - 1);
+
+            it = static_cast<const char *>(std::memchr(it, '\r', searched));
+
+            if (it == nullptr)
+            {
+                return nullptr;
+            }
+
+            if (it[1] == '\n')
+            {
+                return it;
+            }
+        }
+
+        return nullptr;
+    }
+
+    static std::vector<std::string> Split(const char *data, std::size_t size)
+    {
+        std::vector<std::string> tokens;
+        std::size_t begin = 0;
+
+        while (begin < size)
+        {
+            while (begin < size && data[begin] == ' ')
+            {
+                ++begin;
+            }
+
+            auto end = begin;
+
+            while (end < size && data[end] != ' ')
+            {
+                ++end;
+            }
+
+            if (end > begin)
+            {
+                tokens.emplace_back(data + begin, end - begin);
+            }
+
+            begin = end;
+        }
+
+        return tokens;
+    }
+
+    static bool ParseNumber(const std::string &token, std::int64_t &value) noexcept
+    {
+        if (token.empty())
+        {
+            return false;
+        }
+
+        char *end = nullptr;
+
+        errno = 0;
+        value = std::strtoll(token.c_str(), &end, 10);
+
+        return errno == 0 && *end == '\0';
+    }
+
+    static memcached_parse_status Fail(const char *message, std::string &error)
+    {
+        error = std::string{"CLIENT_ERROR "} + message + "\r\n";
+
+        return memcached_parse_status::error;
+    }
+
+    static memcached_parse_status CheckKeys(const memcached_request &request, std::string &error)
+    {
+        for (const auto &key : request.keys)
+        {
+            if (key.size() > MAX_KEY_SIZE)
+            {
+                return Fail("key too long", error);
+            }
+        }
+
+        return memcached_parse_status::complete;
+    }
+
+    // <command> <key> <flags> <exptime> <bytes> [noreply]\r\n<data block>\r\n
+    memcached_parse_status ParseStorage(const std::vector<std::string> &tokens, const char *data,
+                                        std::size_t size, std::size_t line_size,
+                                        memcached_request &request, std::size_t &consumed,
+                                        std::string &error) const
+    {
+        std::int64_t flags;
+        std::int64_t bytes;
+
+        if (tokens.size() < 5 || tokens.size() > 6 || !ParseNumber(tokens[2], flags) ||
+            !ParseNumber(tokens[3], request.exptime) || !ParseNumber(tokens[4], bytes) ||
+            flags < 0 || flags > std::numeric_limits<std::uint32_t>::max() || bytes < 0 ||
+            (tokens.size() == 6 && tokens[5] != "noreply"))
+        {
+            // the length of the data block is unknown, so it can't be skipped
+            error = "CLIENT_ERROR bad command line format\r\n";
+            return memcached_parse_status::fatal;
+        }
+
+        if (static_cast<std::uint64_t>(bytes) > max_value_size)
+        {
+            error = "SERVER_ERROR object too large for cache\r\n";
+            return memcached_parse_status::fatal;
+        }
+
+        const auto block_size = static_cast<std::size_t>(bytes);
+        const auto total_size = line_size + 2 + block_size + 2;
+
+        if (size < total_size)
+        {
+            return memcached_parse_status::incomplete;
+        }
+
+        consumed = total_size;
+
+        const auto *block = data + line_size + 2;
+
+        if (block[block_size] != '\r' || block[block_size + 1] != '\n')
+        {
+            return Fail("bad data chunk", error);
+        }
+
+        request.keys.push_back(tokens[1]);
+        request.flags = static_cast<std::uint32_t>(flags);
+        request.data.assign(block, block_size);
+        request.noreply = tokens.size() == 6;
+
+        return CheckKeys(request, error);
+    }
+
+    std::size_t max_value_size;
+};
+} // namespace caches
+
+#endif // MEMCACHED_PROTOCOL_HPP
@@ -0,0 +1,217 @@
+#include "caches/adaptive_cache.hpp"
+
+#include <gtest/gtest.h>
+
+#include <limits>
+#include <memory>
+#include <stdexcept>
+
+namespace
+{
+using caches::adaptive_policy;
+
+template <typename Key>
+using selector_t = caches::policy_selector<Key>;
+
+// selector that simulates every key and compares the shadows every `window` accesses
+std::shared_ptr<selector_t<int>> FullSelector(std::size_t capacity, std::size_t window)
+{
+    return std::make_shared<selector_t<int>>(capacity, 1.0, window, 0.02);
+}
+
+// a small set of frequently used keys mixed with a scan of keys used once
+template <typename Access>
+void HotSetWithScan(int rounds, int &next_scan_key, Access &&access)
+{
+    for (int round = 0; round < rounds; ++round)
+    {
+        for (int key = 0; key < 20; ++key)
+        {
+            access(key);
+        }
+
+        for (int i = 0; i < 40; ++i)
+        {
+            access(next_scan_key++);
+        }
+    }
+}
+
+// a working set that slowly moves to new keys, old keys are never used again
+template <typename Access>
+void ShiftingWorkingSet(int rounds, int &first_key, Access &&access)
+{
+    for (int round = 0; round < rounds; ++round)
+    {
+        for (int repeat = 0; repeat < 3; ++repeat)
+        {
+            for (int key = first_key; key < first_key + 30; ++key)
+            {
+                access(key);
+            }
+        }
+
+        first_key += 10;
+    }
+}
+} // namespace
+
+TEST(AdaptiveCachePolicy, FollowsSelectorAndKeepsEvictionOrder)
+{
+    constexpr std::size_t capacity = 4;
+    auto selector = FullSelector(capacity, 100);
+    caches::AdaptiveCachePolicy<int> policy{selector};
+
+    for (int key = 1; key <= 4; ++key)
+    {
+        policy.Insert(key);
+    }
+
+    policy.Touch(1);
+    EXPECT_EQ(policy.Active(), adaptive_policy::lru);
+    EXPECT_EQ(policy.ReplCandidate(), 2);
+
+    // make LFU win: frequent keys 0..1 and a scan that an LRU shadow of 4 keys can't survive
+    int scan_key = 1000;
+
+    for (int i = 0; i < 50; ++i)
+    {
+        selector->OnAccess(0);
+        selector->OnAccess(1);
+        selector->OnAccess(scan_key++);
+        selector->OnAccess(scan_key++);
+        selector->OnAccess(scan_key++);
+        selector->OnAccess(scan_key++);
+    }
+
+    ASSERT_EQ(selector->Chosen(), adaptive_policy::lfu);
+
+    // the switch happens on the next modification and keeps the LRU order: 2, 3, 4, 1
+    policy.Touch(3);
+    EXPECT_EQ(policy.Active(), adaptive_policy::lfu);
+
+    for (int expected : {2, 4, 1})
+    {
+        ASSERT_EQ(policy.ReplCandidate(), expected);
+        policy.Erase(expected);
+    }
+
+    EXPECT_EQ(policy.ReplCandidate(), 3);
+}
+
+TEST(AdaptiveCachePolicy, WorksAsLRUWithoutSelector)
+{
+    caches::fixed_sized_cache<int, int, caches::AdaptiveCachePolicy> cache{2};
+
+    cache.Put(1, 1);
+    cache.Put(2, 2);
+    cache.Get(1);
+    cache.Put(3, 3);
+
+    EXPECT_TRUE(cache.Cached(1));
+    EXPECT_FALSE(cache.Cached(2));
+    EXPECT_TRUE(cache.Cached(3));
+}
+
+TEST(PolicySelector, SwitchesToWinningShadow)
+{
+    auto selector = FullSelector(40, 600);
+    int scan_key = 100000;
+    int first_key = 0;
+    const auto access = [&selector](int key) { selector->OnAccess(key); };
+
+    HotSetWithScan(20, scan_key, access);
+
+    EXPECT_EQ(selector->Windows(), 2);
+    EXPECT_EQ(selector->Chosen(), adaptive_policy::lfu);
+
+    const auto ratios = selector->HitRatios();
+
+    EXPECT_GT(ratios[static_cast<std::size_t>(adaptive_policy::lfu)],
+              ratios[static_cast<std::size_t>(adaptive_policy::lru)] + 0.2);
+
+    // LFU keeps the stale frequent keys, LRU follows the working set
+    ShiftingWorkingSet(40, first_key, access);
+
+    EXPECT_EQ(selector->Chosen(), adaptive_policy::lru);
+    EXPECT_EQ(selector->SwitchCount(), 2);
+
+    const auto switches = selector->Switches();
+
+    ASSERT_EQ(switches.size(), 2);
+    EXPECT_EQ(switches[0].from, adaptive_policy::lru);
+    EXPECT_EQ(switches[0].to, adaptive_policy::lfu);
+    EXPECT_EQ(switches[1].from, adaptive_policy::lfu);
+    EXPECT_EQ(switches[1].to, adaptive_policy::lru);
+    EXPECT_LT(switches[0].window, switches[1].window);
+    EXPECT_LE(switches[0].time, switches[1].time);
+    EXPECT_STREQ(caches::PolicyName(switches[1].to), "LRU");
+}
+
+TEST(PolicySelector, SamplesSubsetOfKeys)
+{
+    caches::policy_selector<int> selector{1000, 0.1, 100};
+
+    for (int key = 0; key < 10000; ++key)
+    {
+        selector.OnAccess(key);
+    }
+
+    // about 1000 of the keys are sampled
+    EXPECT_GE(selector.Windows(), 7);
+    EXPECT_LE(selector.Windows(), 13);
+    EXPECT_EQ(selector.SwitchCount(), 0);
+
+    EXPECT_THROW(caches::policy_selector<int>(0), std::invalid_argument);
+    EXPECT_THROW(caches::policy_selector<int>(10, 0.0), std::invalid_argument);
+    EXPECT_THROW(caches::policy_selector<int>(10, -0.5), std::invalid_argument);
+    EXPECT_THROW(caches::policy_selector<int>(10, 1e30), std::invalid_argument);
+    EXPECT_THROW(caches::policy_selector<int>(10, std::numeric_limits<double>::quiet_NaN()),
+                 std::invalid_argument);
+    EXPECT_THROW(caches::policy_selector<int>(10, 0.1, 0), std::invalid_argument);
+}
+
+TEST(AdaptiveCache, AdaptsToWorkload)
+{
+    constexpr std::size_t capacity = 40;
+    caches::adaptive_cache<int, int> cache{capacity, FullSelector(capacity, 600)};
+    std::size_t hits = 0;
+    const auto access = [&cache, &hits](int key)
+    {
+        if (cache.TryGet(key).second)
+        {
+            ++hits;
+        }
+        else
+        {
+            cache.Put(key, key);
+        }
+    };
+    int scan_key = 100000;
+    int first_key = 0;
+
+    HotSetWithScan(20, scan_key, access);
+    EXPECT_EQ(cache.ActivePolicy(), adaptive_policy::lfu);
+
+    // once LFU is active a refilled cache keeps the hot set despite the scans
+    cache.InvalidateAll();
+    HotSetWithScan(1, scan_key, access);
+    hits = 0;
+    HotSetWithScan(10, scan_key, access);
+    EXPECT_GE(hits, 10 * 20 * 9 / 10);
+
+    ShiftingWorkingSet(40, first_key, access);
+    EXPECT_EQ(cache.ActivePolicy(), adaptive_policy::lru);
+    EXPECT_EQ(cache.Switches().size(), 2);
+    EXPECT_EQ(cache.Size(), capacity);
+
+    // the working set moved to LRU in order and keeps hitting
+    hits = 0;
+    ShiftingWorkingSet(5, first_key, access);
+    EXPECT_GE(hits, 5 * 70);
+
+    const auto ratios = cache.ShadowHitRatios();
+
+    EXPECT_GT(ratios[static_cast<std::size_t>(adaptive_policy::lru)], 0.5);
+    EXPECT_EQ(cache.Selector().SwitchCount(), 2);
+}
@@ -0,0 +1,199 @@
+#include "caches/async_cache.hpp"
+#include "caches/lru_cache_policy.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+// runs tasks only when asked to, so tests control the batching
+class manual_executor
+{
+  public:
+    void operator()(std::function<void()> task)
+    {
+        tasks->push_back(std::move(task));
+    }
+
+    std::size_t RunAll()
+    {
+        std::size_t run = 0;
+
+        while (!tasks->empty())
+        {
+            auto task = std::move(tasks->front());
+
+            tasks->erase(tasks->begin());
+            task();
+            ++run;
+        }
+
+        return run;
+    }
+
+    std::shared_ptr<std::vector<std::function<void()>>> tasks =
+        std::make_shared<std::vector<std::function<void()>>>();
+};
+
+using async_lru_cache_t = caches::async_cache<int, std::string, caches::LRUCachePolicy>;
+
+// value whose copies throw once the shared budget of copies is used up
+struct fragile_value
+{
+    fragile_value(std::string text, std::shared_ptr<int> copies_left)
+        : text{std::move(text)}, copies_left{std::move(copies_left)}
+    {
+    }
+
+    fragile_value(const fragile_value &other) : text{other.text}, copies_left{other.copies_left}
+    {
+        if (copies_left && (*copies_left)-- == 0)
+        {
+            throw std::runtime_error{"copy failed"};
+        }
+    }
+
+    std::string text;
+    std::shared_ptr<int> copies_left;
+};
+} // namespace
+
+TEST(AsyncCache, Futures)
+{
+    async_lru_cache_t cache{4};
+
+    cache.PutAsync(1, "one").get();
+
+    EXPECT_EQ(*cache.GetAsync(1).get(), "one");
+    EXPECT_EQ(*cache.Get(1), "one");
+    EXPECT_THROW(cache.GetAsync(2).get(), std::range_error);
+}
+
+TEST(AsyncCache, QueuedRequestsShareBatch)
+{
+    manual_executor executor;
+    async_lru_cache_t cache{100, executor};
+    std::vector<std::string> results;
+
+    for (int i = 0; i < 50; ++i)
+    {
+        cache.PutAsync(i, std::to_string(i), nullptr);
+    }
+
+    // a lookup queued after the puts sees them
+    cache.GetAsync(7, [&results](caches::WrappedValue<std::string> value, std::exception_ptr)
+                   { results.push_back(*value); });
+
+    EXPECT_EQ(executor.tasks->size(), 1);
+    EXPECT_EQ(cache.Size(), 0);
+    EXPECT_EQ(executor.RunAll(), 1);
+    EXPECT_EQ(cache.Size(), 50);
+    ASSERT_EQ(results.size(), 1);
+    EXPECT_EQ(results.front(), "7");
+}
+
+TEST(AsyncCache, ConcurrentLoadsShareLoader)
+{
+    manual_executor executor;
+    async_lru_cache_t cache{4, executor};
+    std::size_t loads = 0;
+    std::vector<std::string> results;
+    const auto loader = [&loads](const int &key)
+    {
+        ++loads;
+        return "loaded " + std::to_string(key);
+    };
+    const auto collect = [&results](caches::WrappedValue<std::string> value, std::exception_ptr)
+    { results.push_back(*value); };
+
+    cache.GetOrLoadAsync(1, loader, collect);
+    cache.GetOrLoadAsync(1, loader, collect);
+    executor.RunAll();
+
+    EXPECT_EQ(loads, 1);
+    ASSERT_EQ(results.size(), 2);
+    EXPECT_EQ(results[0], "loaded 1");
+    EXPECT_EQ(results[1], "loaded 1");
+
+    // now it's a hit
+    cache.GetOrLoadAsync(1, loader, collect);
+    executor.RunAll();
+
+    EXPECT_EQ(loads, 1);
+    EXPECT_EQ(results.size(), 3);
+}
+
+TEST(AsyncCache, LoaderErrorsAreNotCached)
+{
+    async_lru_cache_t cache{4};
+    auto failed = cache.GetOrLoadAsync(
+        1, [](const int &) -> std::string { throw std::runtime_error{"backend is down"}; });
+
+    EXPECT_THROW(failed.get(), std::runtime_error);
+    EXPECT_FALSE(cache.Cached(1));
+    EXPECT_EQ(*cache.GetOrLoadAsync(1, [](const int &) { return std::string{"up"}; }).get(), "up");
+}
+
+TEST(AsyncCache, DestructorWaitsForQueuedRequests)
+{
+    std::atomic<int> completed{0};
+    {
+        async_lru_cache_t cache{1000};
+
+        for (int i = 0; i < 1000; ++i)
+        {
+            cache.PutAsync(i, "value",
+                           [&completed](caches::WrappedValue<std::string>, std::exception_ptr)
+                           { ++completed; });
+        }
+    }
+
+    EXPECT_EQ(completed, 1000);
+}
+
+TEST(AsyncCache, FailedRequestGetsItsOwnError)
+{
+    manual_executor executor;
+    caches::async_cache<int, fragile_value, caches::LRUCachePolicy> cache{4, executor};
+    std::vector<std::string> results;
+    std::vector<std::string> errors;
+    const auto collect = [&](caches::WrappedValue<fragile_value> value, std::exception_ptr error)
+    {
+        if (error)
+        {
+            try
+            {
+                std::rethrow_exception(error);
+            }
+            catch (const std::exception &e)
+            {
+                errors.push_back(e.what());
+            }
+        }
+        else
+        {
+            results.push_back(value->text);
+        }
+    };
+
+    cache.PutAsync(1, fragile_value{"one", nullptr}, collect);
+    // the copy queued with the request succeeds, the copy stored in the cache throws
+    cache.PutAsync(2, fragile_value{"two", std::make_shared<int>(1)}, collect);
+    cache.GetAsync(1, collect);
+    cache.GetAsync(2, collect);
+    EXPECT_EQ(executor.RunAll(), 1);
+
+    EXPECT_EQ(results, (std::vector<std::string>{"one", "one"}));
+    EXPECT_EQ(errors, (std::vector<std::string>{"copy failed", "No such element in the cache"}));
+
+    // the failure doesn't stall the queue
+    cache.PutAsync(3, fragile_value{"three", nullptr}, collect);
+    EXPECT_EQ(executor.RunAll(), 1);
+    EXPECT_EQ(results.back(), "three");
+}
@@ -0,0 +1,368 @@
+#include "caches/compressed_cache.hpp"
+#include "caches/lru_cache_policy.hpp"
+#include "caches/lz_codec.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <functional>
+#include <limits>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+std::string JsonBlob(int id)
+{
+    std::string blob = "{\"id\":" + std::to_string(id) + ",\"items\":[";
+
+    for (int i = 0; i < 16; ++i)
+    {
+        blob += "{\"name\":\"item-" + std::to_string(i) + "\",\"enabled\":true,\"weight\":" +
+                std::to_string((id + i) % 7) + "},";
+    }
+
+    return blob + "]}";
+}
+
+std::string RoundTrip(const std::string &input)
+{
+    caches::lz_codec codec;
+    std::string compressed;
+    std::string output;
+
+    codec.Compress(input.data(), input.size(), compressed);
+    EXPECT_TRUE(codec.Decompress(compressed.data(), compressed.size(), output));
+
+    return output;
+}
+
+template <typename Key, typename Value>
+using lru_compressed_cache_t = caches::compressed_cache<Key, Value, caches::LRUCachePolicy>;
+} // namespace
+
+TEST(LZCodec, RoundTrip)
+{
+    std::mt19937 gen{42};
+    std::string random(100000, '\0');
+
+    for (auto &c : random)
+    {
+        c = static_cast<char>(gen());
+    }
+
+    const std::vector<std::string> inputs = {
+        "", "a", "abc", "abcd", "abcdabcd", std::string(1000, 'x'), JsonBlob(1),
+        random, std::string(70000, 'y') + random.substr(0, 100) + std::string(70000, 'y')};
+
+    for (const auto &input : inputs)
+    {
+        EXPECT_EQ(RoundTrip(input), input);
+    }
+}
+
+TEST(LZCodec, CompressesRepetitiveData)
+{
+    caches::lz_codec codec;
+    std::string input;
+    std::string compressed;
+
+    for (int i = 0; i < 100; ++i)
+    {
+        input += JsonBlob(i);
+    }
+
+    codec.Compress(input.data(), input.size(), compressed);
+
+    EXPECT_LT(compressed.size() * 4, input.size());
+}
+
+TEST(LZCodec, RejectsMalformedInput)
+{
+    caches::lz_codec codec;
+    const std::string input = JsonBlob(3);
+    std::string compressed;
+    std::string output;
+
+    codec.Compress(input.data(), input.size(), compressed);
+
+    EXPECT_FALSE(codec.Decompress(compressed.data(), compressed.size() / 2, output));
+    EXPECT_FALSE(codec.Decompress(compressed.data(), 0, output));
+
+    // back reference before the beginning of the output
+    const std::string bad_offset = {'\x08', '\x10', 'a', '\x05', '\x00'};
+    EXPECT_FALSE(codec.Decompress(bad_offset.data(), bad_offset.size(), output));
+
+    // literals beyond the announced size
+    const std::string too_long = {'\x01', '\x20', 'a', 'b'};
+    EXPECT_FALSE(codec.Decompress(too_long.data(), too_long.size(), output));
+}
+
+TEST(CompressedCache, PutGet)
+{
+    lru_compressed_cache_t<int, std::string> cache{10, 2};
+
+    for (int i = 0; i < 10; ++i)
+    {
+        cache.Put(i, JsonBlob(i));
+    }
+
+    EXPECT_EQ(cache.Stats().hot_entries, 2);
+
+    for (int i = 0; i < 10; ++i)
+    {
+        EXPECT_EQ(*cache.Get(i), JsonBlob(i));
+    }
+
+    const auto stats = cache.Stats();
+
+    EXPECT_EQ(stats.entries, 10);
+    EXPECT_EQ(stats.hot_entries, 2);
+    EXPECT_GT(stats.Ratio(), 2.0);
+    EXPECT_THROW(cache.Get(10), std::range_error);
+}
+
+TEST(CompressedCache, HotValueIsShared)
+{
+    lru_compressed_cache_t<int, std::string> cache{4, 1};
+
+    cache.Put(1, "one");
+    cache.Put(2, "two");
+
+    // 1 is cold: the first read decompresses it and promotes it to the hot elements
+    const auto cold = cache.Get(1);
+    const auto hot = cache.Get(1);
+
+    EXPECT_EQ(cold, hot);
+    EXPECT_EQ(*cache.Get(2), "two");
+    EXPECT_EQ(*hot, "one");
+}
+
+TEST(CompressedCache, EvictsByPolicy)
+{
+    lru_compressed_cache_t<int, std::string> cache{2, 1};
+
+    cache.Put(1, "one");
+    cache.Put(2, "two");
+    cache.Get(1);
+    cache.Put(3, "three");
+
+    EXPECT_TRUE(cache.Cached(1));
+    EXPECT_FALSE(cache.Cached(2));
+    EXPECT_TRUE(cache.Cached(3));
+
+    EXPECT_TRUE(cache.Remove(1));
+    EXPECT_FALSE(cache.Remove(1));
+
+    cache.Get(3);
+    EXPECT_TRUE(cache.Remove(3));
+
+    const auto stats = cache.Stats();
+
+    EXPECT_EQ(stats.entries, 0);
+    EXPECT_EQ(stats.hot_entries, 0);
+    EXPECT_EQ(stats.raw_bytes, 0);
+    EXPECT_EQ(stats.bytes, 0);
+}
+
+TEST(CompressedCache, EvictsStringKeys)
+{
+    lru_compressed_cache_t<std::string, std::string> cache{2, 1};
+    // longer than the small string buffer, so the keys live on the heap
+    const std::string prefix(32, 'k');
+
+    for (int i = 0; i < 8; ++i)
+    {
+        cache.Put(prefix + std::to_string(i), JsonBlob(i));
+        EXPECT_EQ(*cache.Get(prefix + std::to_string(i)), JsonBlob(i));
+    }
+
+    EXPECT_FALSE(cache.Cached(prefix + "5"));
+    EXPECT_TRUE(cache.Cached(prefix + "6"));
+    EXPECT_TRUE(cache.Cached(prefix + "7"));
+    EXPECT_EQ(cache.Stats().entries, 2);
+}
+
+TEST(CompressedCache, UpdateReplacesValue)
+{
+    lru_compressed_cache_t<int, std::string> cache{4, 0};
+
+    cache.Put(1, "old");
+    cache.Put(1, "new value");
+
+    EXPECT_EQ(*cache.Get(1), "new value");
+    EXPECT_EQ(cache.Stats().hot_entries, 0);
+    EXPECT_EQ(cache.Stats().raw_bytes, 9);
+}
+
+TEST(CompressedCache, TriviallyCopyableValues)
+{
+    lru_compressed_cache_t<int, double> cache{4, 1};
+
+    cache.Put(1, 1.5);
+    cache.Put(2, 2.5);
+
+    EXPECT_EQ(*cache.Get(1), 1.5);
+    EXPECT_EQ(*cache.Get(2), 2.5);
+}
+
+TEST(CompressedCache, ConcurrentAccess)
+{
+    constexpr int KEYS = 64;
+    lru_compressed_cache_t<int, std::string> cache{KEYS, 8};
+    std::atomic<int> mismatches{0};
+    std::vector<std::thread> workers;
+
+    for (int t = 0; t < 4; ++t)
+    {
+        workers.emplace_back(
+            [&cache, &mismatches, t]
+            {
+                for (int i = 0; i < 2000; ++i)
+                {
+                    const int key = (i * 5 + t) % KEYS;
+
+                    if (i % 4 == 0)
+                    {
+                        cache.Put(key, JsonBlob(key));
+                    }
+
+                    const auto result = cache.TryGet(key);
+
+                    if (result.second && *result.first != JsonBlob(key))
+                    {
+                        ++mismatches;
+                    }
+                }
+            });
+    }
+
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+
+    EXPECT_EQ(mismatches, 0);
+    EXPECT_LE(cache.Stats().hot_entries, 8);
+}
+
+TEST(CompressedCache, KeepsHotValuesDecompressedOnly)
+{
+    lru_compressed_cache_t<int, std::string> cache{4, 1};
+
+    cache.Put(1, JsonBlob(1));
+
+    // the put value is hot, so nothing is compressed yet
+    EXPECT_EQ(cache.Stats().compressed_bytes, 0);
+
+    cache.Put(2, JsonBlob(2));
+
+    auto stats = cache.Stats();
+
+    EXPECT_EQ(stats.hot_entries, 1);
+    EXPECT_EQ(stats.raw_bytes, JsonBlob(1).size());
+    EXPECT_GT(stats.compressed_bytes, 0);
+
+    // promotion of 1 drops its compressed form and demotes 2
+    cache.Get(1);
+    stats = cache.Stats();
+
+    EXPECT_EQ(stats.hot_entries, 1);
+    EXPECT_EQ(stats.raw_bytes, JsonBlob(2).size());
+    EXPECT_EQ(*cache.Get(2), JsonBlob(2));
+}
+
+TEST(CompressedCache, EvictsByByteBudget)
+{
+    constexpr std::size_t BUDGET = 16 * 1024;
+    caches::compressed_cache<int, std::string, caches::LRUCachePolicy> cache{1000, 4, BUDGET};
+
+    for (int i = 0; i < 200; ++i)
+    {
+        cache.Put(i, JsonBlob(i));
+        EXPECT_LE(cache.Stats().bytes, BUDGET);
+    }
+
+    const auto stats = cache.Stats();
+
+    EXPECT_LT(stats.entries, 200);
+    // much more values fit than their serialized size allows
+    EXPECT_GT(stats.entries, 2 * BUDGET / JsonBlob(0).size());
+    EXPECT_EQ(cache.Size(), stats.entries);
+    EXPECT_TRUE(cache.Cached(199));
+    EXPECT_FALSE(cache.Cached(0));
+    EXPECT_EQ(*cache.Get(199 - static_cast<int>(stats.entries) + 1),
+              JsonBlob(199 - static_cast<int>(stats.entries) + 1));
+    EXPECT_EQ(cache.MemoryUsage().values, stats.bytes / stats.entries * stats.entries);
+}
+
+TEST(CompressedCache, NotifiesAboutErasedValues)
+{
+    using listener_t = std::function<void(const int &, const std::shared_ptr<std::string> &,
+                                          caches::erase_cause)>;
+    std::map<int, std::pair<std::string, caches::erase_cause>> erased;
+    caches::compressed_cache<int, std::string, caches::LRUCachePolicy, caches::lz_codec,
+                             caches::value_serializer<std::string>, listener_t>
+        cache{
+        2,
+        1,
+        std::numeric_limits<std::size_t>::max(),
+        caches::LRUCachePolicy<int>{},
+        [&erased](const int &key, const std::shared_ptr<std::string> &value,
+                  caches::erase_cause cause) { erased[key] = {*value, cause}; }};
+
+    cache.Put(1, "one");
+    cache.Put(2, "two");
+    // 1 is compressed, the notification decompresses it
+    cache.Put(3, "three");
+    cache.Put(3, "four");
+
+    ASSERT_EQ(erased.size(), 2);
+    EXPECT_EQ(erased[1].first, "one");
+    EXPECT_EQ(erased[1].second, caches::erase_cause::evicted);
+    EXPECT_EQ(erased[3].first, "three");
+    EXPECT_EQ(erased[3].second, caches::erase_cause::replaced);
+
+    erased.clear();
+    cache.InvalidateAll();
+
+    EXPECT_FALSE(cache.Cached(2));
+    EXPECT_EQ(cache.ReclaimInvalidated(), 2);
+    EXPECT_EQ(erased[2].first, "two");
+    EXPECT_EQ(erased[3].first, "four");
+    EXPECT_EQ(erased[3].second, caches::erase_cause::invalidated);
+    EXPECT_EQ(cache.Stats().entries, 0);
+}
+
+TEST(CompressedCache, WalksAndInvalidatesDecompressedValues)
+{
+    lru_compressed_cache_t<int, std::string> cache{16, 2};
+    std::map<int, std::string> walked;
+
+    for (int i = 0; i < 10; ++i)
+    {
+        cache.Put(i, JsonBlob(i));
+    }
+
+    cache.ForEach([&walked](const int &key, const std::shared_ptr<std::string> &value)
+                  { walked[key] = *value; });
+
+    ASSERT_EQ(walked.size(), 10);
+
+    for (const auto &elem : walked)
+    {
+        EXPECT_EQ(elem.second, JsonBlob(elem.first));
+    }
+
+    // walks don't promote the values
+    EXPECT_EQ(cache.Stats().hot_entries, 2);
+    EXPECT_TRUE(cache.Cached(8));
+    EXPECT_EQ(cache.InvalidateIf([](const int &, const std::shared_ptr<std::string> &value)
+                                 { return value->find("\"id\":3,") != std::string::npos; }),
+              1);
+    EXPECT_FALSE(cache.Cached(3));
+    EXPECT_EQ(cache.Size(), 9);
+}
@@ -0,0 +1,198 @@
+#include "caches/concurrent_cache.hpp"
+#include "caches/concurrent_hash_index.hpp"
+#include "caches/fifo_cache_policy.hpp"
+#include "caches/lru_cache_policy.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+template <typename Key, typename Value>
+using lru_concurrent_cache_t = caches::concurrent_cache<Key, Value, caches::LRUCachePolicy>;
+
+// every key collides into the same bucket
+struct constant_hash
+{
+    std::size_t operator()(int) const noexcept
+    {
+        return 7;
+    }
+};
+} // namespace
+
+TEST(ConcurrentHashIndex, InsertReplaceErase)
+{
+    caches::concurrent_hash_index<int, int, constant_hash> index{4};
+
+    for (int i = 0; i < 8; ++i)
+    {
+        EXPECT_EQ(index.InsertOrReplace(i, i * 10), nullptr);
+    }
+
+    for (int i = 0; i < 8; ++i)
+    {
+        ASSERT_NE(index.Find(i), nullptr);
+        EXPECT_EQ(index.Find(i)->value, i * 10);
+    }
+
+    std::unique_ptr<const caches::concurrent_hash_index<int, int, constant_hash>::node> replaced{
+        index.InsertOrReplace(3, 33)};
+
+    ASSERT_NE(replaced, nullptr);
+    EXPECT_EQ(replaced->value, 30);
+    EXPECT_TRUE(replaced->unlinked);
+    EXPECT_EQ(index.Find(3)->value, 33);
+
+    std::unique_ptr<const caches::concurrent_hash_index<int, int, constant_hash>::node> erased{
+        index.Erase(5)};
+
+    ASSERT_NE(erased, nullptr);
+    EXPECT_EQ(index.Find(5), nullptr);
+    EXPECT_EQ(index.Erase(5), nullptr);
+
+    for (int i : {0, 1, 2, 4, 6, 7})
+    {
+        EXPECT_EQ(index.Find(i)->value, i * 10);
+    }
+}
+
+TEST(ConcurrentCache, SimplePut)
+{
+    lru_concurrent_cache_t<std::string, int> cache{2};
+
+    cache.Put("A", 1);
+    cache.Put("B", 2);
+    cache.Put("A", 10);
+
+    EXPECT_EQ(*cache.Get("A"), 10);
+    EXPECT_EQ(*cache.Get("B"), 2);
+    EXPECT_EQ(cache.Size(), 2);
+    EXPECT_THROW(cache.Get("C"), std::range_error);
+}
+
+TEST(ConcurrentCache, EvictsByPolicy)
+{
+    caches::concurrent_cache<int, int, caches::FIFOCachePolicy> cache{3};
+
+    for (int i = 0; i < 10; ++i)
+    {
+        cache.Put(i, i);
+    }
+
+    EXPECT_EQ(cache.Size(), 3);
+
+    for (int i = 0; i < 7; ++i)
+    {
+        EXPECT_FALSE(cache.Cached(i));
+    }
+
+    for (int i = 7; i < 10; ++i)
+    {
+        EXPECT_EQ(*cache.Get(i), i);
+    }
+}
+
+TEST(ConcurrentCache, BufferedTouchesReachPolicy)
+{
+    lru_concurrent_cache_t<int, int> cache{2};
+
+    cache.Put(1, 1);
+    cache.Put(2, 2);
+    // the touch is buffered and applied by the next write
+    cache.Get(1);
+    cache.Put(3, 3);
+
+    EXPECT_TRUE(cache.Cached(1));
+    EXPECT_FALSE(cache.Cached(2));
+    EXPECT_TRUE(cache.Cached(3));
+}
+
+TEST(ConcurrentCache, Remove)
+{
+    lru_concurrent_cache_t<int, int> cache{4};
+
+    cache.Put(1, 1);
+    cache.Get(1);
+
+    EXPECT_TRUE(cache.Remove(1));
+    EXPECT_FALSE(cache.Remove(1));
+    EXPECT_EQ(cache.Size(), 0);
+
+    // the buffered touch of the removed element is dropped
+    cache.Put(2, 2);
+    EXPECT_EQ(cache.Size(), 1);
+}
+
+TEST(ConcurrentCache, GuardedReads)
+{
+    lru_concurrent_cache_t<int, std::string> cache{1};
+
+    cache.Put(1, "one");
+
+    auto guard = cache.Pin();
+    const auto *value = cache.TryGet(1, guard);
+
+    ASSERT_NE(value, nullptr);
+
+    for (int i = 2; i < 200; ++i)
+    {
+        cache.Put(i, std::to_string(i));
+    }
+
+    EXPECT_EQ(*value, "one");
+    EXPECT_EQ(cache.TryGet(1, guard), nullptr);
+}
+
+TEST(ConcurrentCache, ConcurrentReadsAndWrites)
+{
+    constexpr int KEYS = 64;
+    lru_concurrent_cache_t<int, std::string> cache{KEYS / 2};
+    std::atomic<bool> stop{false};
+    std::atomic<int> mismatches{0};
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back(
+            [&cache, &stop, &mismatches, t]
+            {
+                for (int i = t; !stop; ++i)
+                {
+                    const auto result = cache.TryGet(i % KEYS);
+
+                    if (result.second && *result.first != std::to_string(i % KEYS))
+                    {
+                        ++mismatches;
+                    }
+                }
+            });
+    }
+
+    for (int i = 0; i < 50000; ++i)
+    {
+        if (i % 10 == 0)
+        {
+            cache.Remove((i * 3) % KEYS);
+        }
+        else
+        {
+            cache.Put(i % KEYS, std::to_string(i % KEYS));
+        }
+    }
+
+    stop = true;
+
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+
+    EXPECT_EQ(mismatches, 0);
+    EXPECT_LE(cache.Size(), KEYS / 2);
+}
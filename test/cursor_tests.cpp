@@ -0,0 +1,125 @@
+#include "caches/cache.hpp"
+#include "caches/lru_cache_policy.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <map>
+#include <thread>
+#include <vector>
+
+namespace
+{
+using lru_cache_t = caches::fixed_sized_cache<int, int, caches::LRUCachePolicy>;
+} // namespace
+
+TEST(Cursor, VisitsEveryElementOnce)
+{
+    lru_cache_t cache{1000};
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        cache.Put(i, i * 2);
+    }
+
+    std::map<int, int> visited;
+    std::size_t chunks = 0;
+
+    for (lru_cache_t::cursor position; !position.Finished(); ++chunks)
+    {
+        const auto chunk = cache.NextChunk(position, 64);
+
+        EXPECT_LE(chunk.size(), 64 + 16);
+
+        for (const auto &elem : chunk)
+        {
+            EXPECT_TRUE(visited.emplace(elem.first, *elem.second).second);
+        }
+    }
+
+    EXPECT_EQ(visited.size(), 1000);
+    EXPECT_GE(chunks, 1000 / (64 + 16));
+
+    for (const auto &elem : visited)
+    {
+        EXPECT_EQ(elem.second, elem.first * 2);
+    }
+}
+
+TEST(Cursor, EmptyCache)
+{
+    lru_cache_t cache{10};
+    lru_cache_t::cursor position;
+
+    EXPECT_TRUE(cache.NextChunk(position).empty());
+    EXPECT_TRUE(position.Finished());
+    EXPECT_THROW(cache.NextChunk(position, 0), std::invalid_argument);
+}
+
+TEST(Cursor, ForEachMayAccessCache)
+{
+    lru_cache_t cache{100};
+
+    for (int i = 0; i < 100; ++i)
+    {
+        cache.Put(i, i);
+    }
+
+    int sum = 0;
+
+    // the visitor is called without the lock held
+    cache.ForEach(
+        [&](const int &key, const caches::WrappedValue<int> &value)
+        {
+            EXPECT_TRUE(cache.Cached(key));
+            sum += *value;
+        },
+        10);
+
+    EXPECT_EQ(sum, 99 * 100 / 2);
+}
+
+TEST(Cursor, ConcurrentModification)
+{
+    lru_cache_t cache{4096};
+    std::atomic<bool> stop{false};
+
+    for (int i = 0; i < 1024; ++i)
+    {
+        cache.Put(i, i);
+    }
+
+    // elements above 1024 come and go during the walk
+    std::thread writer{[&cache, &stop]
+                       {
+                           for (int i = 0; !stop; ++i)
+                           {
+                               const int key = 1024 + i % 2048;
+
+                               cache.Put(key, key);
+                               cache.Remove(1024 + (i + 1024) % 2048);
+                           }
+                       }};
+
+    std::vector<bool> visited(1024, false);
+
+    cache.ForEach(
+        [&visited](const int &key, const caches::WrappedValue<int> &value)
+        {
+            EXPECT_EQ(key, *value);
+
+            if (key < 1024)
+            {
+                visited[key] = true;
+            }
+        },
+        32);
+
+    stop = true;
+    writer.join();
+
+    for (int i = 0; i < 1024; ++i)
+    {
+        EXPECT_TRUE(visited[i]) << i;
+    }
+}
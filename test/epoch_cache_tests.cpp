@@ -0,0 +1,252 @@
+#include "caches/epoch_cache.hpp"
+#include "caches/epoch_reclamation.hpp"
+#include "caches/lru_cache_policy.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+struct tracked_value
+{
+    static constexpr int MAGIC = 0x5eed;
+
+    explicit tracked_value(int value = 0) : value{value}
+    {
+    }
+
+    tracked_value(const tracked_value &other) : value{other.value}
+    {
+    }
+
+    ~tracked_value()
+    {
+        magic = 0;
+        ++destroyed;
+    }
+
+    int magic = MAGIC;
+    int value;
+    static std::atomic<int> destroyed;
+};
+
+std::atomic<int> tracked_value::destroyed{0};
+
+template <typename Key, typename Value>
+using lru_epoch_cache_t = caches::epoch_cache<Key, Value, caches::LRUCachePolicy>;
+} // namespace
+
+TEST(EpochDomain, RetiredObjectOutlivesGuard)
+{
+    caches::epoch_domain domain;
+    std::weak_ptr<int> observer;
+
+    {
+        auto object = std::make_shared<int>(42);
+        observer = object;
+
+        caches::epoch_guard guard{domain};
+
+        domain.Retire(std::move(object));
+
+        for (int i = 0; i < 4; ++i)
+        {
+            EXPECT_EQ(domain.Collect(), 1);
+        }
+
+        EXPECT_FALSE(observer.expired());
+    }
+
+    domain.Collect();
+    domain.Collect();
+
+    EXPECT_EQ(domain.Collect(), 0);
+    EXPECT_TRUE(observer.expired());
+}
+
+TEST(EpochDomain, NestedGuards)
+{
+    caches::epoch_domain domain;
+    auto object = std::make_shared<int>(1);
+    std::weak_ptr<int> observer = object;
+
+    {
+        caches::epoch_guard outer{domain};
+        {
+            caches::epoch_guard inner{domain};
+        }
+
+        domain.Retire(std::move(object));
+        domain.Collect();
+        domain.Collect();
+        EXPECT_FALSE(observer.expired());
+    }
+
+    for (int i = 0; i < 3; ++i)
+    {
+        domain.Collect();
+    }
+
+    EXPECT_TRUE(observer.expired());
+}
+
+TEST(EpochDomain, ExitedThreadDoesNotBlockReclamation)
+{
+    caches::epoch_domain domain;
+
+    std::thread{[&domain] { caches::epoch_guard guard{domain}; }}.join();
+
+    domain.Retire(std::make_shared<int>(1));
+
+    for (int i = 0; i < 3; ++i)
+    {
+        domain.Collect();
+    }
+
+    EXPECT_EQ(domain.Pending(), 0);
+}
+
+TEST(EpochCache, GuardedReads)
+{
+    lru_epoch_cache_t<std::string, int> cache{2};
+
+    cache.Put("A", 1);
+    cache.Put("B", 2);
+
+    auto guard = cache.Pin();
+
+    EXPECT_EQ(cache.Get("A", guard), 1);
+    EXPECT_EQ(cache.TryGet("C", guard), nullptr);
+    EXPECT_THROW(cache.Get("C", guard), std::range_error);
+    // regular API is still available
+    EXPECT_EQ(*cache.Get("B"), 2);
+}
+
+TEST(EpochCache, ErasedValueStaysValidUnderGuard)
+{
+    tracked_value::destroyed = 0;
+    lru_epoch_cache_t<int, tracked_value> cache{1};
+
+    cache.Put(1, tracked_value{10});
+
+    const int destroyed_before = tracked_value::destroyed;
+    {
+        auto guard = cache.Pin();
+        const auto &value = cache.Get(1, guard);
+
+        cache.Put(2, tracked_value{20});
+        cache.Put(1, tracked_value{30});
+        cache.Domain().Collect();
+        cache.Domain().Collect();
+
+        EXPECT_FALSE(cache.Cached(2));
+        EXPECT_EQ(value.magic, tracked_value::MAGIC);
+        EXPECT_EQ(value.value, 10);
+    }
+
+    for (int i = 0; i < 3; ++i)
+    {
+        cache.Domain().Collect();
+    }
+
+    // values 10 and 20 as well as the temporaries
+    EXPECT_EQ(tracked_value::destroyed - destroyed_before, 4);
+    EXPECT_EQ(cache.Domain().Pending(), 0);
+}
+
+TEST(EpochCache, ConcurrentReadsAndUpdates)
+{
+    constexpr int KEYS = 16;
+    lru_epoch_cache_t<int, tracked_value> cache{KEYS / 2};
+    std::atomic<bool> stop{false};
+    std::atomic<int> corrupted{0};
+    std::vector<std::thread> readers;
+
+    for (int t = 0; t < 4; ++t)
+    {
+        readers.emplace_back(
+            [&cache, &stop, &corrupted]
+            {
+                for (int i = 0; !stop; ++i)
+                {
+                    auto guard = cache.Pin();
+                    const auto *value = cache.TryGet(i % KEYS, guard);
+
+                    std::this_thread::yield();
+
+                    if (value != nullptr &&
+                        (value->magic != tracked_value::MAGIC || value->value % KEYS != i % KEYS))
+                    {
+                        ++corrupted;
+                    }
+                }
+            });
+    }
+
+    for (int i = 0; i < 20000; ++i)
+    {
+        cache.Put(i % KEYS, tracked_value{i});
+    }
+
+    stop = true;
+
+    for (auto &reader : readers)
+    {
+        reader.join();
+    }
+
+    EXPECT_EQ(corrupted, 0);
+}
+
+TEST(EpochCache, GuardedReadsFollowInvalidation)
+{
+    lru_epoch_cache_t<int, int> cache{4};
+
+    for (int i = 0; i < 4; ++i)
+    {
+        cache.Put(i, i);
+    }
+
+    auto guard = cache.Pin();
+
+    cache.InvalidateAll();
+    EXPECT_EQ(cache.TryGet(1, guard), nullptr);
+
+    // reclaiming the detached elements keeps the new ones visible
+    cache.Put(1, 10);
+    cache.Put(2, 20);
+    EXPECT_EQ(cache.Get(1, guard), 10);
+    EXPECT_EQ(cache.Get(2, guard), 20);
+    EXPECT_EQ(cache.TryGet(0, guard), nullptr);
+    EXPECT_EQ(cache.TryGet(3, guard), nullptr);
+}
+
+TEST(EpochCache, GuardedReadsTouchPolicy)
+{
+    using cache_t = lru_epoch_cache_t<int, int>;
+    cache_t cache{2};
+
+    cache.Put(1, 1);
+    cache.Put(2, 2);
+
+    {
+        auto guard = cache.Pin();
+
+        // only a sample of the guarded lookups reaches the policy
+        for (std::uint32_t i = 0; i < cache_t::TOUCH_INTERVAL; ++i)
+        {
+            EXPECT_EQ(cache.Get(1, guard), 1);
+        }
+    }
+
+    cache.Put(3, 3);
+
+    EXPECT_TRUE(cache.Cached(1));
+    EXPECT_FALSE(cache.Cached(2));
+}
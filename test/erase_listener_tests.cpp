@@ -0,0 +1,174 @@
+#include "caches/cache.hpp"
+#include "caches/erase_listener.hpp"
+#include "caches/lru_cache_policy.hpp"
+
+#include <gtest/gtest.h>
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+template <typename Key, typename Value, typename OnErase>
+using lru_cache_t =
+    caches::fixed_sized_cache<Key, Value, caches::LRUCachePolicy,
+                              std::unordered_map<Key, caches::WrappedValue<Value>>,
+                              caches::heap_value_storage<Key, Value>, OnErase>;
+
+using cause_listener_t = std::function<void(const std::string &, const caches::WrappedValue<int> &,
+                                            caches::erase_cause)>;
+} // namespace
+
+TEST(EraseListener, ReportsCauses)
+{
+    std::vector<std::pair<std::string, caches::erase_cause>> notifications;
+    {
+        lru_cache_t<std::string, int, cause_listener_t> cache{
+            2, caches::LRUCachePolicy<std::string>{},
+            [&notifications](const std::string &key, const caches::WrappedValue<int> &,
+                             caches::erase_cause cause)
+            { notifications.emplace_back(key, cause); }};
+
+        cache.Put("A", 1);
+        cache.Put("B", 2);
+        cache.Put("A", 10);
+        cache.Put("C", 3);
+        cache.Remove("C");
+    }
+
+    const std::vector<std::pair<std::string, caches::erase_cause>> expected = {
+        {"A", caches::erase_cause::replaced},
+        {"B", caches::erase_cause::evicted},
+        {"C", caches::erase_cause::removed},
+        {"A", caches::erase_cause::cleared},
+    };
+
+    EXPECT_EQ(notifications, expected);
+}
+
+TEST(EraseListener, ReplacedValueIsTheOldOne)
+{
+    int replaced_value = 0;
+    lru_cache_t<std::string, int, cause_listener_t> cache{
+        2, caches::LRUCachePolicy<std::string>{},
+        [&replaced_value](const std::string &, const caches::WrappedValue<int> &value,
+                          caches::erase_cause) { replaced_value = *value; }};
+
+    cache.Put("A", 1);
+    cache.Put("A", 2);
+
+    EXPECT_EQ(replaced_value, 1);
+    EXPECT_EQ(*cache.Get("A"), 2);
+}
+
+TEST(EraseListener, DeliveredOutsideOfLock)
+{
+    using cache_t = caches::fixed_sized_cache<int, int, caches::LRUCachePolicy>;
+    cache_t *cache_ptr = nullptr;
+    std::vector<std::size_t> sizes;
+    cache_t cache{1, caches::LRUCachePolicy<int>{},
+                  [&](const int &, const caches::WrappedValue<int> &)
+                  {
+                      // would deadlock if called with the cache lock held
+                      sizes.push_back(cache_ptr->Size());
+                  }};
+
+    cache_ptr = &cache;
+    cache.Put(1, 1);
+    cache.Put(2, 2);
+    cache.Remove(2);
+
+    EXPECT_EQ(sizes, (std::vector<std::size_t>{1, 0}));
+}
+
+TEST(EraseListener, LegacyCallbackSkipsReplacements)
+{
+    std::vector<int> erased;
+    caches::fixed_sized_cache<int, int, caches::LRUCachePolicy> cache{
+        2, caches::LRUCachePolicy<int>{},
+        [&erased](const int &key, const caches::WrappedValue<int> &) { erased.push_back(key); }};
+
+    cache.Put(1, 1);
+    cache.Put(1, 2);
+    cache.Put(2, 2);
+    cache.Put(3, 3);
+
+    EXPECT_EQ(erased, std::vector<int>{1});
+}
+
+TEST(EraseListener, ReportsDestruction)
+{
+    std::vector<int> legacy_erased;
+    std::vector<std::pair<std::string, caches::erase_cause>> notifications;
+    {
+        caches::fixed_sized_cache<int, int, caches::LRUCachePolicy> legacy{
+            2, caches::LRUCachePolicy<int>{},
+            [&legacy_erased](const int &key, const caches::WrappedValue<int> &)
+            { legacy_erased.push_back(key); }};
+        lru_cache_t<std::string, int, cause_listener_t> cache{
+            2, caches::LRUCachePolicy<std::string>{},
+            [&notifications](const std::string &key, const caches::WrappedValue<int> &,
+                             caches::erase_cause cause)
+            { notifications.emplace_back(key, cause); }};
+
+        legacy.Put(1, 1);
+        legacy.Put(2, 2);
+        legacy.Put(3, 3);
+        cache.Put("A", 1);
+        cache.InvalidateAll();
+        cache.Put("B", 2);
+    }
+
+    // listeners without the cause argument are not called when the cache is destroyed
+    EXPECT_EQ(legacy_erased, std::vector<int>{1});
+
+    // the invalidated element is reclaimed by the next insertion
+    const std::vector<std::pair<std::string, caches::erase_cause>> expected = {
+        {"A", caches::erase_cause::invalidated},
+        {"B", caches::erase_cause::cleared},
+    };
+
+    EXPECT_EQ(notifications, expected);
+}
+
+TEST(EraseListener, NoCallback)
+{
+    lru_cache_t<int, int, caches::no_erase_callback> cache{2};
+
+    for (int i = 0; i < 10; ++i)
+    {
+        cache.Put(i, i);
+    }
+
+    EXPECT_EQ(cache.Size(), 2);
+    EXPECT_TRUE(cache.Remove(9));
+}
+
+TEST(EraseListener, ThreadedListener)
+{
+    using listener_t = caches::threaded_erase_listener<int, caches::WrappedValue<int>>;
+    std::vector<std::pair<int, caches::erase_cause>> notifications;
+    listener_t listener{[&notifications](const int &key, const caches::WrappedValue<int> &,
+                                         caches::erase_cause cause)
+                        { notifications.emplace_back(key, cause); }};
+    lru_cache_t<int, int, listener_t> cache{4, caches::LRUCachePolicy<int>{}, listener};
+
+    for (int i = 0; i < 8; ++i)
+    {
+        cache.Put(i, i);
+    }
+
+    cache.Remove(7);
+    listener.Flush();
+
+    ASSERT_EQ(notifications.size(), 5);
+
+    for (int i = 0; i < 4; ++i)
+    {
+        EXPECT_EQ(notifications[i], std::make_pair(i, caches::erase_cause::evicted));
+    }
+
+    EXPECT_EQ(notifications.back(), std::make_pair(7, caches::erase_cause::removed));
+}
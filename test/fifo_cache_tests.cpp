@@ -1,5 +1,6 @@
 #include "caches/cache.hpp"
 #include "caches/fifo_cache_policy.hpp"
+#include "caches/lru_cache_policy.hpp"
 
 #include <gtest/gtest.h>
 #ifdef CUSTOM_HASHMAP
@@ -7,6 +8,11 @@
 #endif /* CUSTOM_HASHMAP */
 
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
 
 #ifndef CUSTOM_HASHMAP
 template <typename Key, typename Value>
@@ -226,3 +232,52 @@ TEST(FIFOCache, InvalidSize)
     using test_type = fifo_cache_t<std::string, int>;
     EXPECT_THROW(test_type cache{0}, std::invalid_argument);
 }
+
+TEST(FIFOCache, SharedLookups)
+{
+    static_assert(fifo_cache_t<int, int>::shared_lookups, "FIFO lookups modify nothing");
+    static_assert(!caches::fixed_sized_cache<int, int, caches::LRUCachePolicy>::shared_lookups,
+                  "LRU lookups reorder the policy");
+
+    // both readers have to be inside the cache at the same time to leave the observer
+    class rendezvous_observer : public caches::IAccessObserver<int>
+    {
+      public:
+        void OnAccess(const int &) noexcept override
+        {
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{5};
+
+            ++inside;
+
+            while (inside < 2 && std::chrono::steady_clock::now() < deadline)
+            {
+                std::this_thread::yield();
+            }
+
+            met = met || inside >= 2;
+        }
+
+        std::atomic<int> inside{0};
+        std::atomic<bool> met{false};
+    };
+
+    fifo_cache_t<int, int> cache{4};
+    auto observer = std::make_shared<rendezvous_observer>();
+
+    cache.Put(1, 1);
+    cache.SetAccessObserver(observer);
+
+    std::vector<std::thread> readers;
+
+    for (int i = 0; i < 2; ++i)
+    {
+        readers.emplace_back([&cache] { EXPECT_EQ(*cache.Get(1), 1); });
+    }
+
+    for (auto &reader : readers)
+    {
+        reader.join();
+    }
+
+    EXPECT_TRUE(observer->met);
+}
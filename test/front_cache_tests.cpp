@@ -0,0 +1,191 @@
+#include "caches/front_cache.hpp"
+#include "caches/lru_cache_policy.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+template <typename Key, typename Value>
+using lru_front_cache_t = caches::front_cache<Key, Value, caches::LRUCachePolicy, 16>;
+
+class access_counter : public caches::IAccessObserver<int>
+{
+  public:
+    void OnAccess(const int &) noexcept override
+    {
+        ++accesses;
+    }
+
+    std::atomic<int> accesses{0};
+};
+} // namespace
+
+TEST(FrontCache, RepeatedReadsBypassBackingCache)
+{
+    lru_front_cache_t<int, std::string> cache{8};
+    auto counter = std::make_shared<access_counter>();
+
+    cache.Backing().SetAccessObserver(counter);
+    cache.Put(1, "one");
+
+    for (int i = 0; i < 10; ++i)
+    {
+        EXPECT_EQ(*cache.Get(1), "one");
+    }
+
+    EXPECT_EQ(counter->accesses, 1);
+}
+
+TEST(FrontCache, WritesInvalidateFrontCache)
+{
+    lru_front_cache_t<int, std::string> cache{8};
+
+    cache.Put(1, "one");
+    EXPECT_EQ(*cache.Get(1), "one");
+
+    cache.Put(1, "uno");
+    EXPECT_EQ(*cache.Get(1), "uno");
+
+    cache.Remove(1);
+    EXPECT_FALSE(cache.TryGet(1).second);
+    EXPECT_THROW(cache.Get(1), std::range_error);
+}
+
+TEST(FrontCache, EvictionInvalidatesFrontCache)
+{
+    lru_front_cache_t<int, int> cache{2};
+
+    cache.Put(1, 1);
+    EXPECT_EQ(*cache.Get(1), 1);
+
+    cache.Put(2, 2);
+    cache.Put(3, 3);
+
+    EXPECT_FALSE(cache.Cached(1));
+    EXPECT_FALSE(cache.TryGet(1).second);
+}
+
+TEST(FrontCache, FrontHitsTouchBackingPolicy)
+{
+    lru_front_cache_t<int, int> cache{2};
+    auto counter = std::make_shared<access_counter>();
+
+    cache.Backing().SetAccessObserver(counter);
+    cache.Put(1, 1);
+    EXPECT_EQ(*cache.Get(1), 1);
+    cache.Put(2, 2);
+
+    // 1 is the least recently used key of the backing cache, until the front hits reach it
+    for (std::uint32_t i = 0; i < lru_front_cache_t<int, int>::TOUCH_INTERVAL; ++i)
+    {
+        EXPECT_EQ(*cache.Get(1), 1);
+    }
+
+    EXPECT_EQ(counter->accesses, 2);
+
+    cache.Put(3, 3);
+
+    EXPECT_TRUE(cache.Cached(1));
+    EXPECT_FALSE(cache.Cached(2));
+}
+
+TEST(FrontCache, SlotsAreNotSharedBetweenCaches)
+{
+    lru_front_cache_t<int, int> first{4};
+    lru_front_cache_t<int, int> second{4};
+
+    first.Put(1, 10);
+    second.Put(1, 20);
+
+    EXPECT_EQ(*first.Get(1), 10);
+    EXPECT_EQ(*second.Get(1), 20);
+    EXPECT_EQ(*first.Get(1), 10);
+}
+
+TEST(FrontCache, DestructionReleasesSlotsOfAllThreads)
+{
+    std::weak_ptr<std::string> local;
+    std::weak_ptr<std::string> remote;
+    std::atomic<bool> read{false};
+    std::atomic<bool> destroyed{false};
+    std::thread reader;
+
+    {
+        lru_front_cache_t<int, std::string> cache{4};
+
+        cache.Put(1, "one");
+        cache.Put(2, "two");
+        local = cache.Get(1);
+        reader = std::thread{[&]
+                             {
+                                 remote = cache.Get(2);
+                                 read = true;
+
+                                 while (!destroyed)
+                                 {
+                                     std::this_thread::yield();
+                                 }
+                             }};
+
+        while (!read)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    // the reader is still running, its slots don't keep the values alive
+    EXPECT_TRUE(local.expired());
+    EXPECT_TRUE(remote.expired());
+
+    destroyed = true;
+    reader.join();
+
+    // slots of a new cache of the same type start empty
+    lru_front_cache_t<int, std::string> cache{4};
+
+    EXPECT_FALSE(cache.TryGet(1).second);
+    cache.Put(1, "uno");
+    EXPECT_EQ(*cache.Get(1), "uno");
+}
+
+TEST(FrontCache, OtherThreadsSeeWrites)
+{
+    lru_front_cache_t<int, int> cache{8};
+    std::atomic<int> published{0};
+    std::atomic<int> stale{0};
+
+    cache.Put(1, 0);
+
+    std::thread reader{[&]
+                       {
+                           for (int i = 0; i < 100000 && published.load() < 1000; ++i)
+                           {
+                               const int before = published.load();
+                               const int value = *cache.Get(1);
+
+                               // the value read after a write has returned can't be older
+                               if (value < before)
+                               {
+                                   ++stale;
+                               }
+                           }
+                       }};
+
+    for (int i = 1; i <= 1000; ++i)
+    {
+        cache.Put(1, i);
+        published.store(i);
+    }
+
+    reader.join();
+
+    EXPECT_EQ(stale, 0);
+    EXPECT_EQ(*cache.Get(1), 1000);
+}
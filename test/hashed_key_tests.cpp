@@ -0,0 +1,86 @@
+#include "caches/cache.hpp"
+#include "caches/hashed_key.hpp"
+#include "caches/lfu_cache_policy.hpp"
+#include "caches/lru_cache_policy.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+namespace
+{
+struct counting_hash
+{
+    std::size_t operator()(const std::string &key) const
+    {
+        ++calls;
+        return std::hash<std::string>{}(key);
+    }
+
+    static std::size_t calls;
+};
+
+std::size_t counting_hash::calls = 0;
+
+// every key lands in the same bucket, so lookups have to compare the keys
+struct colliding_hash
+{
+    std::size_t operator()(const std::string &) const noexcept
+    {
+        return 42;
+    }
+};
+
+template <template <typename> class Policy, typename Hash>
+using hashed_cache_t =
+    caches::fixed_sized_cache<caches::hashed_key<std::string, Hash>, int, Policy>;
+} // namespace
+
+TEST(HashedKey, KeyIsHashedOnce)
+{
+    hashed_cache_t<caches::LRUCachePolicy, counting_hash> cache{2};
+    const caches::hashed_key<std::string, counting_hash> first{std::string(100, 'a')};
+    const caches::hashed_key<std::string, counting_hash> second{std::string(100, 'b')};
+    const caches::hashed_key<std::string, counting_hash> third{std::string(100, 'c')};
+
+    EXPECT_EQ(counting_hash::calls, 3);
+
+    cache.Put(first, 1);
+    cache.Put(second, 2);
+    EXPECT_EQ(*cache.Get(first), 1);
+    cache.Put(third, 3);
+    EXPECT_TRUE(cache.Cached(first));
+    EXPECT_FALSE(cache.Cached(second));
+    EXPECT_TRUE(cache.Remove(third));
+
+    EXPECT_EQ(counting_hash::calls, 3);
+}
+
+TEST(HashedKey, PlainKeysConvert)
+{
+    hashed_cache_t<caches::LFUCachePolicy, std::hash<std::string>> cache{4};
+
+    cache.Put("one", 1);
+    cache.Put(std::string{"two"}, 2);
+
+    EXPECT_EQ(*cache.Get("one"), 1);
+    EXPECT_EQ(*cache.Get(caches::hashed_key<std::string>{"two"}), 2);
+    EXPECT_EQ(caches::hashed_key<std::string>{"two"}.Get(), "two");
+    EXPECT_FALSE(cache.Cached("three"));
+}
+
+TEST(HashedKey, CollidingHashesCompareKeys)
+{
+    hashed_cache_t<caches::LRUCachePolicy, colliding_hash> cache{4};
+
+    cache.Put("one", 1);
+    cache.Put("two", 2);
+
+    EXPECT_EQ(*cache.Get("one"), 1);
+    EXPECT_EQ(*cache.Get("two"), 2);
+    EXPECT_NE(caches::hashed_key<std::string>("one"), caches::hashed_key<std::string>("two"));
+    EXPECT_EQ(caches::hashed_key<std::string>("one", std::hash<std::string>{}("one")),
+              caches::hashed_key<std::string>("one"));
+}
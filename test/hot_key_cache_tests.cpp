@@ -0,0 +1,286 @@
+#include "caches/hot_key_cache.hpp"
+#include "caches/lru_cache_policy.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace
+{
+template <typename Key>
+class counting_observer : public caches::IAccessObserver<Key>
+{
+  public:
+    void OnAccess(const Key &) noexcept override
+    {
+        accesses.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::atomic<std::size_t> accesses{0};
+};
+
+template <typename Key>
+bool Contains(const std::vector<Key> &keys, const Key &key)
+{
+    return std::find(keys.begin(), keys.end(), key) != keys.end();
+}
+
+// every access is sampled and the hot set is recomputed after 100 of them
+std::shared_ptr<caches::hot_key_detector<int>> EagerDetector()
+{
+    return std::make_shared<caches::hot_key_detector<int>>(4, 0.1, 1, 100);
+}
+
+using hot_lru_cache_t = caches::hot_key_cache<int, int, caches::LRUCachePolicy>;
+
+struct copy_counting
+{
+    explicit copy_counting(int value) : value{value}
+    {
+    }
+
+    copy_counting(const copy_counting &other) : value{other.value}
+    {
+        ++copies;
+    }
+
+    int value;
+    static std::atomic<int> copies;
+};
+
+std::atomic<int> copy_counting::copies{0};
+} // namespace
+
+TEST(HotKeyCache, SketchFindsHeavyHitters)
+{
+    caches::space_saving_sketch<int> sketch{8};
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        sketch.Offer(i % 2 == 0 ? 42 : i);
+    }
+
+    const auto top = sketch.Top(1);
+
+    ASSERT_EQ(top.size(), 1);
+    EXPECT_EQ(top.front().key, 42);
+    EXPECT_GE(top.front().count, 500);
+    EXPECT_LE(top.front().count - top.front().error, 500);
+    EXPECT_EQ(sketch.Total(), 1000);
+
+    sketch.Decay();
+
+    EXPECT_EQ(sketch.Total(), 500);
+    EXPECT_GE(sketch.Top(1).front().count, 250);
+}
+
+TEST(HotKeyCache, DetectorReportsKeysAboveShare)
+{
+    caches::hot_key_detector<int> detector{4, 0.2, 1, 1000};
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        detector.OnAccess(i % 4 == 0 ? 1 : (i % 4 == 1 ? 2 : i));
+    }
+
+    const auto hot = detector.HotKeys();
+
+    EXPECT_EQ(detector.Windows(), 1);
+    ASSERT_EQ(hot.size(), 2);
+    EXPECT_TRUE(hot[0].key == 1 || hot[0].key == 2);
+    EXPECT_TRUE(hot[1].key == 1 || hot[1].key == 2);
+}
+
+TEST(HotKeyCache, HotKeysBypassTheCache)
+{
+    auto observer = std::make_shared<counting_observer<int>>();
+    hot_lru_cache_t cache{16, EagerDetector()};
+
+    cache.SetAccessObserver(observer);
+
+    for (int i = 0; i < 10; ++i)
+    {
+        cache.Put(i, i);
+    }
+
+    for (int i = 0; i < 100; ++i)
+    {
+        EXPECT_EQ(*cache.Get(3), 3);
+    }
+
+    EXPECT_TRUE(Contains(cache.ReplicatedKeys(), 3));
+    ASSERT_FALSE(cache.HotKeys().empty());
+    EXPECT_EQ(cache.HotKeys().front().key, 3);
+
+    const auto before = observer->accesses.load();
+
+    for (int i = 0; i < 50; ++i)
+    {
+        EXPECT_EQ(*cache.Get(3), 3);
+    }
+
+    EXPECT_EQ(observer->accesses.load(), before);
+    EXPECT_EQ(*cache.Get(4), 4);
+    EXPECT_EQ(observer->accesses.load(), before + 1);
+}
+
+TEST(HotKeyCache, ModificationsInvalidateReplicas)
+{
+    hot_lru_cache_t cache{4, EagerDetector()};
+
+    for (int i = 0; i < 4; ++i)
+    {
+        cache.Put(i, i);
+    }
+
+    const auto make_hot = [&cache](int key)
+    {
+        cache.RefreshHotSet();
+
+        for (int i = 0; i < 100; ++i)
+        {
+            cache.Get(key);
+        }
+
+        return Contains(cache.ReplicatedKeys(), key);
+    };
+
+    ASSERT_TRUE(make_hot(0));
+    cache.Put(0, 100);
+    EXPECT_FALSE(Contains(cache.ReplicatedKeys(), 0));
+    EXPECT_EQ(*cache.Get(0), 100);
+
+    ASSERT_TRUE(make_hot(1));
+    EXPECT_TRUE(cache.Remove(1));
+    EXPECT_FALSE(cache.TryGet(1).second);
+
+    // the least recently used key is evicted while it's still replicated
+    ASSERT_TRUE(make_hot(2));
+    cache.Get(0);
+    cache.Get(3);
+    cache.Put(10, 10);
+    cache.Put(11, 11);
+    EXPECT_FALSE(cache.TryGet(2).second);
+
+    ASSERT_TRUE(make_hot(3));
+    cache.InvalidateAll();
+    EXPECT_TRUE(cache.ReplicatedKeys().empty());
+    EXPECT_FALSE(cache.TryGet(3).second);
+}
+
+TEST(HotKeyCache, InvalidationDropsReplicasThroughBaseClass)
+{
+    hot_lru_cache_t cache{4, EagerDetector()};
+    caches::fixed_sized_cache<int, int, caches::LRUCachePolicy,
+                              caches::counted_unordered_map<int, std::shared_ptr<int>>,
+                              caches::hot_value_storage<int, int>> &base = cache;
+
+    cache.Put(1, 1);
+
+    for (int i = 0; i < 100; ++i)
+    {
+        cache.Get(1);
+    }
+
+    cache.RefreshHotSet();
+    ASSERT_TRUE(Contains(cache.ReplicatedKeys(), 1));
+
+    base.InvalidateAll();
+    EXPECT_TRUE(cache.ReplicatedKeys().empty());
+    EXPECT_FALSE(cache.TryGet(1).second);
+
+    cache.Put(1, 2);
+    cache.RefreshHotSet();
+    ASSERT_TRUE(Contains(cache.ReplicatedKeys(), 1));
+    EXPECT_EQ(*cache.Get(1), 2);
+
+    cache.Clear();
+    EXPECT_TRUE(cache.ReplicatedKeys().empty());
+    EXPECT_FALSE(cache.TryGet(1).second);
+}
+
+TEST(HotKeyCache, ReplicasAreCopiedOnlyForChangedValues)
+{
+    caches::hot_key_cache<int, copy_counting, caches::LRUCachePolicy> cache{8, EagerDetector(),
+                                                                             4};
+
+    cache.Put(1, copy_counting{1});
+    cache.Put(2, copy_counting{2});
+
+    for (int i = 0; i < 100; ++i)
+    {
+        cache.Get(i % 2 + 1);
+    }
+
+    cache.RefreshHotSet();
+    ASSERT_TRUE(Contains(cache.ReplicatedKeys(), 1));
+    ASSERT_TRUE(Contains(cache.ReplicatedKeys(), 2));
+
+    copy_counting::copies = 0;
+    // invalidation of a hot key doesn't republish the others
+    EXPECT_TRUE(cache.Remove(1));
+    EXPECT_EQ(copy_counting::copies, 0);
+    EXPECT_FALSE(Contains(cache.ReplicatedKeys(), 1));
+    EXPECT_FALSE(cache.TryGet(1).second);
+    EXPECT_EQ(cache.Get(2)->value, 2);
+
+    // a refresh reuses the replicas of the unchanged value
+    cache.RefreshHotSet();
+    EXPECT_EQ(copy_counting::copies, 0);
+    EXPECT_EQ(cache.Get(2)->value, 2);
+
+    cache.Put(2, copy_counting{3});
+    copy_counting::copies = 0;
+    cache.RefreshHotSet();
+    EXPECT_EQ(copy_counting::copies, 3);
+    EXPECT_EQ(cache.Get(2)->value, 3);
+}
+
+TEST(HotKeyCache, ReadersNeverGoBackInTime)
+{
+    hot_lru_cache_t cache{16, EagerDetector(), 4};
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> readers;
+
+    cache.Put(0, 0);
+
+    for (int t = 0; t < 4; ++t)
+    {
+        readers.emplace_back(
+            [&cache, &stop]
+            {
+                int last = 0;
+
+                while (!stop)
+                {
+                    const auto value = *cache.Get(0);
+
+                    EXPECT_GE(value, last);
+                    last = value;
+                }
+            });
+    }
+
+    for (int i = 1; i <= 2000; ++i)
+    {
+        cache.Put(0, i);
+
+        if (i % 100 == 0)
+        {
+            cache.RefreshHotSet();
+        }
+    }
+
+    stop = true;
+
+    for (auto &reader : readers)
+    {
+        reader.join();
+    }
+
+    EXPECT_EQ(*cache.Get(0), 2000);
+}
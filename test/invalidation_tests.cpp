@@ -0,0 +1,237 @@
+#include "caches/cache.hpp"
+#include "caches/lru_cache_policy.hpp"
+#include "caches/slab_storage.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace
+{
+constexpr std::size_t PAGE_SIZE = 4096;
+
+using cause_listener_t =
+    std::function<void(const int &, const caches::WrappedValue<int> &, caches::erase_cause)>;
+
+using lru_cache_t =
+    caches::fixed_sized_cache<int, int, caches::LRUCachePolicy,
+                              std::unordered_map<int, caches::WrappedValue<int>>,
+                              caches::heap_value_storage<int, int>, cause_listener_t>;
+
+using slab_lru_cache_t = caches::fixed_sized_cache<
+    int, caches::slab_string, caches::LRUCachePolicy,
+    std::unordered_map<int, caches::WrappedValue<caches::slab_string>>,
+    caches::slab_value_storage<int, caches::slab_string, caches::LRUCachePolicy>>;
+} // namespace
+
+TEST(Invalidation, InvalidateAllReadsAsMisses)
+{
+    std::vector<std::pair<int, caches::erase_cause>> notifications;
+    lru_cache_t cache{8, caches::LRUCachePolicy<int>{},
+                      [&notifications](const int &key, const caches::WrappedValue<int> &,
+                                       caches::erase_cause cause)
+                      { notifications.emplace_back(key, cause); }};
+
+    for (int i = 0; i < 8; ++i)
+    {
+        cache.Put(i, i);
+    }
+
+    cache.InvalidateAll();
+
+    EXPECT_EQ(cache.Size(), 0);
+    EXPECT_TRUE(notifications.empty());
+
+    for (int i = 0; i < 8; ++i)
+    {
+        EXPECT_FALSE(cache.Cached(i));
+        EXPECT_FALSE(cache.TryGet(i).second);
+    }
+
+    EXPECT_EQ(cache.ReclaimInvalidated(3), 8);
+    EXPECT_EQ(notifications.size(), 8);
+
+    for (const auto &notification : notifications)
+    {
+        EXPECT_EQ(notification.second, caches::erase_cause::invalidated);
+    }
+
+    EXPECT_EQ(cache.ReclaimInvalidated(), 0);
+}
+
+TEST(Invalidation, PolicyStartsOverAfterInvalidateAll)
+{
+    lru_cache_t cache{3};
+
+    cache.Put(1, 1);
+    cache.Put(2, 2);
+    cache.Put(3, 3);
+    cache.InvalidateAll();
+
+    cache.Put(4, 4);
+    cache.Put(5, 5);
+    cache.Put(6, 6);
+    cache.Get(4);
+    cache.Put(7, 7);
+
+    EXPECT_EQ(cache.Size(), 3);
+    EXPECT_TRUE(cache.Cached(4));
+    EXPECT_FALSE(cache.Cached(5));
+    EXPECT_TRUE(cache.Cached(6));
+    EXPECT_TRUE(cache.Cached(7));
+}
+
+TEST(Invalidation, InsertionsReclaimLazily)
+{
+    std::vector<std::pair<int, caches::erase_cause>> notifications;
+    std::size_t reclaimed = 0;
+    {
+        lru_cache_t cache{16, caches::LRUCachePolicy<int>{},
+                          [&notifications](const int &key, const caches::WrappedValue<int> &,
+                                           caches::erase_cause cause)
+                          { notifications.emplace_back(key, cause); }};
+
+        for (int i = 0; i < 16; ++i)
+        {
+            cache.Put(i, i);
+        }
+
+        cache.InvalidateAll();
+        cache.Put(100, 100);
+
+        // the same key is reclaimed before it's inserted again
+        cache.Put(5, 50);
+
+        EXPECT_EQ(*cache.Get(5), 50);
+        EXPECT_EQ(cache.Size(), 2);
+        EXPECT_GE(notifications.size(), 5);
+        EXPECT_LT(notifications.size(), 16);
+        EXPECT_NE(std::find(notifications.begin(), notifications.end(),
+                            std::make_pair(5, caches::erase_cause::invalidated)),
+                  notifications.end());
+
+        reclaimed = notifications.size();
+        cache.InvalidateAll();
+        notifications.clear();
+    }
+
+    // the destructor reports the elements of both generations that have not been reclaimed
+    EXPECT_EQ(notifications.size(), 16 - reclaimed + 2);
+
+    for (const auto &notification : notifications)
+    {
+        EXPECT_EQ(notification.second, caches::erase_cause::invalidated);
+    }
+}
+
+TEST(Invalidation, InvalidateIfErasesMatchingElements)
+{
+    std::vector<std::pair<int, caches::erase_cause>> notifications;
+    lru_cache_t cache{100, caches::LRUCachePolicy<int>{},
+                      [&notifications](const int &key, const caches::WrappedValue<int> &,
+                                       caches::erase_cause cause)
+                      { notifications.emplace_back(key, cause); }};
+
+    for (int i = 0; i < 100; ++i)
+    {
+        cache.Put(i, i);
+    }
+
+    const auto invalidated = cache.InvalidateIf(
+        [](const int &key, const caches::WrappedValue<int> &value)
+        { return key % 2 == 0 && *value < 50; },
+        7);
+
+    EXPECT_EQ(invalidated, 25);
+    EXPECT_EQ(notifications.size(), 25);
+    EXPECT_EQ(cache.Size(), 75);
+
+    for (int i = 0; i < 100; ++i)
+    {
+        EXPECT_EQ(cache.Cached(i), i % 2 != 0 || i >= 50);
+    }
+
+    // the policy has forgotten the invalidated keys
+    for (int i = 100; i < 125; ++i)
+    {
+        cache.Put(i, i);
+    }
+
+    EXPECT_EQ(cache.Size(), 100);
+    EXPECT_TRUE(cache.Cached(1));
+}
+
+TEST(Invalidation, InvalidateIfWithConcurrentWriters)
+{
+    lru_cache_t cache{4096};
+    std::atomic<bool> stop{false};
+
+    for (int i = 0; i < 2048; ++i)
+    {
+        cache.Put(i, i);
+    }
+
+    // the writer grows the cache and forces rehashes during the scan
+    std::thread writer{[&cache, &stop]
+                       {
+                           for (int i = 2048; i < 4096 && !stop; ++i)
+                           {
+                               cache.Put(i, -i);
+                           }
+                       }};
+
+    cache.InvalidateIf([](const int &, const caches::WrappedValue<int> &value)
+                       { return *value >= 0 && *value % 3 == 0; },
+                       16);
+    stop = true;
+    writer.join();
+
+    for (int i = 0; i < 2048; ++i)
+    {
+        EXPECT_EQ(cache.Cached(i), i % 3 != 0) << i;
+    }
+}
+
+TEST(Invalidation, SlabStorageReusesChunksOfInvalidatedValues)
+{
+    // a single page split into 4 chunks of the largest class
+    auto arena = std::make_shared<caches::slab_arena>(PAGE_SIZE, PAGE_SIZE, 4.0, 1024);
+    caches::slab_allocator<char> source_alloc{
+        std::make_shared<caches::slab_arena>(PAGE_SIZE * 4, PAGE_SIZE)};
+    slab_lru_cache_t cache{100, caches::LRUCachePolicy<int>{}, {},
+                           caches::slab_value_storage<int, caches::slab_string,
+                                                      caches::LRUCachePolicy>{arena}};
+
+    for (int i = 0; i < 4; ++i)
+    {
+        cache.Put(i, caches::slab_string(1000, 'a', source_alloc));
+    }
+
+    const auto cls = arena->ClassOf(1001);
+
+    EXPECT_EQ(arena->Stats(cls).used_chunks, 4);
+
+    cache.InvalidateAll();
+
+    for (int i = 10; i < 14; ++i)
+    {
+        cache.Put(i, caches::slab_string(1000, 'b', source_alloc));
+    }
+
+    EXPECT_EQ(cache.Size(), 4);
+    EXPECT_EQ(arena->Stats(cls).used_chunks, 4);
+    EXPECT_EQ(arena->MemoryUsed(), PAGE_SIZE);
+    EXPECT_EQ(cache.ReclaimInvalidated(), 0);
+
+    for (int i = 10; i < 14; ++i)
+    {
+        EXPECT_EQ(*cache.Get(i), caches::slab_string(1000, 'b', source_alloc));
+    }
+}
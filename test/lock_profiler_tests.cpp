@@ -0,0 +1,240 @@
+#define CACHES_PROFILE_LOCKS
+
+#include "caches/cache.hpp"
+#include "caches/lru_cache_policy.hpp"
+#include "caches/negative_cache.hpp"
+#include "caches/tagged_cache.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+namespace
+{
+using caches::cache_operation;
+using caches::lock_phase;
+
+std::atomic<bool> copying{false};
+
+// copying the value takes a while, so a Put holds the cache lock for as long
+struct slow_value
+{
+    slow_value() = default;
+
+    slow_value(const slow_value &)
+    {
+        copying = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds{20});
+    }
+
+    slow_value &operator=(const slow_value &) = default;
+};
+
+// mutex that tells when a thread starts waiting for it
+class signalling_mutex
+{
+  public:
+    void lock()
+    {
+        waiting = true;
+        mutex.lock();
+    }
+
+    void unlock()
+    {
+        mutex.unlock();
+    }
+
+    std::mutex mutex;
+    std::atomic<bool> waiting{false};
+};
+
+using profiled_cache_t = caches::fixed_sized_cache<int, int, caches::LRUCachePolicy>;
+} // namespace
+
+TEST(LockProfiler, HistogramBuckets)
+{
+    using histogram = caches::latency_histogram;
+
+    for (std::uint64_t value : {0ull, 3ull, 4ull, 7ull, 100ull, 12345ull, 1ull << 39})
+    {
+        const auto index = histogram::BucketIndex(value);
+
+        EXPECT_LE(histogram::BucketLowerBound(index), value);
+        EXPECT_GE(histogram::BucketUpperBound(index), value);
+        EXPECT_LT(histogram::BucketUpperBound(index) - histogram::BucketLowerBound(index),
+                  value / 4 + 1);
+    }
+
+    EXPECT_EQ(histogram::BucketIndex(1ull << 60), histogram::BUCKETS - 1);
+
+    histogram latencies;
+
+    for (std::uint64_t i = 1; i <= 1000; ++i)
+    {
+        latencies.Record(i * 1000);
+    }
+
+    EXPECT_EQ(latencies.Count(), 1000);
+    EXPECT_EQ(latencies.Max(), 1000000);
+    EXPECT_NEAR(static_cast<double>(latencies.ValueAt(0.5)), 500000, 125000);
+    EXPECT_NEAR(static_cast<double>(latencies.ValueAt(0.99)), 990000, 10000);
+    EXPECT_EQ(latencies.ValueAt(1.0), 1000000);
+}
+
+TEST(LockProfiler, RecordsOperations)
+{
+    static_assert(std::is_same<caches::cache_lock_profile, caches::lock_profiler>::value,
+                  "lock profiling is enabled by CACHES_PROFILE_LOCKS");
+
+    profiled_cache_t cache{2};
+
+    cache.LockProfile().SetSampleRate(1);
+
+    for (int i = 0; i < 10; ++i)
+    {
+        cache.Put(i, i);
+        cache.TryGet(i);
+    }
+
+    const auto &profile = cache.LockProfile();
+
+    EXPECT_EQ(profile.Histogram(cache_operation::put, lock_phase::wait).Count(), 10);
+    EXPECT_EQ(profile.Histogram(cache_operation::put, lock_phase::hold).Count(), 10);
+    // nothing is delivered without a listener, so there is no notify phase
+    EXPECT_EQ(profile.Histogram(cache_operation::put, lock_phase::notify).Count(), 0);
+    EXPECT_EQ(profile.Histogram(cache_operation::lookup, lock_phase::hold).Count(), 10);
+    EXPECT_EQ(profile.Histogram(cache_operation::remove, lock_phase::hold).Count(), 0);
+
+    std::ostringstream dump;
+
+    profile.Dump(dump);
+
+    EXPECT_NE(dump.str().find("put hold 10 "), std::string::npos);
+    EXPECT_NE(dump.str().find("lookup wait 10 "), std::string::npos);
+    EXPECT_EQ(dump.str().find("remove"), std::string::npos);
+
+    cache.LockProfile().Reset();
+    cache.LockProfile().SetSampleRate(0);
+    cache.Put(1, 1);
+
+    EXPECT_EQ(profile.Histogram(cache_operation::put, lock_phase::hold).Count(), 0);
+}
+
+TEST(LockProfiler, SamplesWholeOperations)
+{
+    constexpr int OPERATIONS = 64 * 64;
+    caches::fixed_sized_cache<int, int, caches::LRUCachePolicy> cache{
+        1, caches::LRUCachePolicy<int>{}, [](const int &, const caches::WrappedValue<int> &) {}};
+
+    // paused, so the first put (the only one that evicts nothing) is not sampled
+    cache.LockProfile().SetSampleRate(0);
+    cache.Put(0, 0);
+    cache.LockProfile().SetSampleRate(64);
+
+    for (int key = 1; key <= OPERATIONS; ++key)
+    {
+        cache.Put(key, key);
+    }
+
+    const auto &profile = cache.LockProfile();
+
+    // every phase of one of 64 puts is timed
+    for (auto phase : {lock_phase::wait, lock_phase::hold, lock_phase::notify})
+    {
+        EXPECT_EQ(profile.Histogram(cache_operation::put, phase).Count(), OPERATIONS / 64);
+    }
+}
+
+TEST(LockProfiler, WaitCoversBlockedTime)
+{
+    caches::lock_profiler profile{1};
+    signalling_mutex mutex;
+    std::unique_lock<std::mutex> holder{mutex.mutex};
+
+    std::thread waiter{[&]
+                       {
+                           caches::profiled_lock<std::lock_guard<signalling_mutex>,
+                                                 caches::lock_profiler>
+                               lock{mutex, profile, cache_operation::put};
+                       }};
+
+    while (!mutex.waiting)
+    {
+        std::this_thread::yield();
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds{5});
+    holder.unlock();
+    waiter.join();
+
+    EXPECT_EQ(profile.Histogram(cache_operation::put, lock_phase::wait).Count(), 1);
+    EXPECT_GE(profile.Histogram(cache_operation::put, lock_phase::wait).Max(), 5000000u);
+}
+
+TEST(LockProfiler, RecordsOperationsOfDerivedCaches)
+{
+    caches::negative_cache<int, int, caches::LRUCachePolicy> negative{2, 16,
+                                                                      std::chrono::seconds{1}};
+    caches::tagged_cache<int, int, std::string, caches::LRUCachePolicy> tagged{2};
+
+    negative.LockProfile().SetSampleRate(1);
+    tagged.LockProfile().SetSampleRate(1);
+
+    for (int i = 0; i < 5; ++i)
+    {
+        negative.TryGet(i);
+        tagged.TagSize("tag");
+    }
+
+    negative.ClearAbsent();
+
+    EXPECT_EQ(negative.LockProfile().Histogram(cache_operation::lookup, lock_phase::hold).Count(),
+              5);
+    EXPECT_EQ(
+        negative.LockProfile().Histogram(cache_operation::invalidate, lock_phase::hold).Count(),
+        1);
+    EXPECT_EQ(tagged.LockProfile().Histogram(cache_operation::size, lock_phase::hold).Count(), 5);
+}
+
+TEST(LockProfiler, SeparatesWaitHoldAndNotify)
+{
+    using slow_cache_t = caches::fixed_sized_cache<int, slow_value, caches::LRUCachePolicy>;
+
+    slow_cache_t cache{4, caches::LRUCachePolicy<int>{},
+                       [](const int &, const slow_cache_t::value_type &)
+                       { std::this_thread::sleep_for(std::chrono::milliseconds{10}); }};
+
+    cache.LockProfile().SetSampleRate(1);
+
+    std::thread writer{[&cache] { cache.Put(1, slow_value{}); }};
+
+    // the writer holds the lock while it copies the value
+    while (!copying)
+    {
+        std::this_thread::yield();
+    }
+
+    // the lookup waits for the put, so it sees the element (see WaitCoversBlockedTime for the
+    // length of the wait)
+    EXPECT_TRUE(cache.Cached(1));
+    writer.join();
+    cache.Remove(1);
+
+    const auto &profile = cache.LockProfile();
+    const auto millisecond = 1000000u;
+
+    EXPECT_GE(profile.Histogram(cache_operation::put, lock_phase::hold).Max(), 15 * millisecond);
+    EXPECT_EQ(profile.Histogram(cache_operation::contains, lock_phase::wait).Count(), 1);
+    EXPECT_GT(profile.Histogram(cache_operation::contains, lock_phase::wait).Max(), 0u);
+    EXPECT_LT(profile.Histogram(cache_operation::remove, lock_phase::hold).Max(),
+              profile.Histogram(cache_operation::remove, lock_phase::notify).Max());
+    EXPECT_GE(profile.Histogram(cache_operation::remove, lock_phase::notify).Max(),
+              10 * millisecond);
+}
@@ -17,6 +17,9 @@ using lru_cache_t =
 #endif /* CUSTOM_HASHMAP */
 
 #include <array>
+#include <atomic>
+#include <thread>
+#include <vector>
 
 TEST(CacheTest, SimplePut)
 {
@@ -171,6 +174,25 @@ TEST(LRUCache, CachedCheck)
     }
 }
 
+TEST(LRUCache, PrefetchKeepsPolicyState)
+{
+    lru_cache_t<std::string, std::size_t> cache{3};
+    const std::vector<std::string> upcoming{"1", "2", "missing"};
+
+    cache.Put("1", 1);
+    cache.Put("2", 2);
+    cache.Put("3", 3);
+
+    // unlike a lookup, a prefetch doesn't make "1" recently used
+    cache.Prefetch("1");
+    cache.Prefetch(upcoming.begin(), upcoming.end());
+    cache.Put("4", 4);
+
+    EXPECT_FALSE(cache.Cached("1"));
+    EXPECT_EQ(*cache.Get("2"), 2);
+    EXPECT_FALSE(cache.Cached("missing"));
+}
+
 TEST(LRUCache, ConstructCache)
 {
     EXPECT_THROW((lru_cache_t<std::string, std::size_t>(0)), std::invalid_argument);
@@ -241,3 +263,78 @@ TEST(LRUCache, InvalidSize)
     using test_type = lru_cache_t<std::string, int>;
     EXPECT_THROW(test_type cache{0}, std::invalid_argument);
 }
+
+TEST(LRUCache, GrowMaxSize)
+{
+    lru_cache_t<int, int> cache{2};
+
+    cache.Put(1, 1);
+    cache.Put(2, 2);
+    cache.SetMaxSize(4);
+    cache.Put(3, 3);
+    cache.Put(4, 4);
+
+    EXPECT_EQ(cache.MaxSize(), 4);
+    EXPECT_EQ(cache.Size(), 4);
+    EXPECT_TRUE(cache.Cached(1));
+    EXPECT_THROW(cache.SetMaxSize(0), std::invalid_argument);
+}
+
+TEST(LRUCache, ShrinkMaxSize)
+{
+    constexpr int TEST_SIZE = 100;
+    std::vector<int> evicted;
+    lru_cache_t<int, int> cache{TEST_SIZE, caches::LRUCachePolicy<int>{},
+                                [&evicted](const int &key, const caches::WrappedValue<int> &)
+                                { evicted.push_back(key); }};
+
+    for (int i = 0; i < TEST_SIZE; ++i)
+    {
+        cache.Put(i, i);
+    }
+
+    EXPECT_EQ(*cache.Get(0), 0);
+    cache.SetMaxSize(10, 7);
+
+    EXPECT_EQ(cache.Size(), 10);
+    ASSERT_EQ(evicted.size(), TEST_SIZE - 10);
+    // eviction follows the policy: the touched key survives
+    EXPECT_EQ(evicted.front(), 1);
+    EXPECT_TRUE(cache.Cached(0));
+
+    for (int i = TEST_SIZE - 9; i < TEST_SIZE; ++i)
+    {
+        EXPECT_TRUE(cache.Cached(i));
+    }
+
+    cache.Put(TEST_SIZE, TEST_SIZE);
+    EXPECT_EQ(cache.Size(), 10);
+}
+
+TEST(LRUCache, ShrinkWithConcurrentOperations)
+{
+    constexpr int TEST_SIZE = 20000;
+    constexpr int NEW_SIZE = 100;
+    lru_cache_t<int, int> cache{TEST_SIZE};
+    std::atomic<bool> stop{false};
+
+    for (int i = 0; i < TEST_SIZE; ++i)
+    {
+        cache.Put(i, i);
+    }
+
+    std::thread worker{[&cache, &stop]
+                       {
+                           for (int i = 0; !stop; ++i)
+                           {
+                               cache.Put(TEST_SIZE + i % 1000, i);
+                               cache.TryGet(i % TEST_SIZE);
+                           }
+                       }};
+
+    cache.SetMaxSize(NEW_SIZE, 64);
+    EXPECT_LE(cache.Size(), NEW_SIZE);
+    stop = true;
+    worker.join();
+    EXPECT_LE(cache.Size(), NEW_SIZE);
+}
@@ -0,0 +1,94 @@
+#include "memcached_protocol.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace
+{
+using caches::memcached_command;
+using caches::memcached_parse_status;
+
+struct parsed
+{
+    memcached_parse_status status;
+    caches::memcached_request request;
+    std::size_t consumed;
+    std::string error;
+};
+
+parsed Parse(const std::string &input, std::size_t max_value_size = 1024)
+{
+    parsed result;
+
+    result.status = caches::memcached_parser{max_value_size}.Parse(
+        input.data(), input.size(), result.request, result.consumed, result.error);
+
+    return result;
+}
+} // namespace
+
+TEST(MemcachedProtocol, RetrievalCommands)
+{
+    const auto get = Parse("get a  bb ccc\r\nget d\r\n");
+
+    ASSERT_EQ(get.status, memcached_parse_status::complete);
+    EXPECT_EQ(get.request.command, memcached_command::get);
+    EXPECT_EQ(get.request.keys, (std::vector<std::string>{"a", "bb", "ccc"}));
+    EXPECT_EQ(get.consumed, 15);
+
+    EXPECT_EQ(Parse("gets a\r\n").request.command, memcached_command::gets);
+    EXPECT_EQ(Parse("get a").status, memcached_parse_status::incomplete);
+    EXPECT_EQ(Parse("get\r\n").status, memcached_parse_status::error);
+    EXPECT_EQ(Parse("get " + std::string(251, 'k') + "\r\n").status,
+              memcached_parse_status::error);
+}
+
+TEST(MemcachedProtocol, StorageCommands)
+{
+    const auto set = Parse("set key 42 100 5 noreply\r\nhello\r\nget key\r\n");
+
+    ASSERT_EQ(set.status, memcached_parse_status::complete);
+    EXPECT_EQ(set.request.command, memcached_command::set);
+    EXPECT_EQ(set.request.keys.front(), "key");
+    EXPECT_EQ(set.request.flags, 42);
+    EXPECT_EQ(set.request.exptime, 100);
+    EXPECT_EQ(set.request.data, "hello");
+    EXPECT_TRUE(set.request.noreply);
+    EXPECT_EQ(set.consumed, 33);
+
+    // data blocks may contain line ends
+    EXPECT_EQ(Parse("add k 0 0 4\r\na\r\nb\r\n").request.data, "a\r\nb");
+    EXPECT_EQ(Parse("replace k 0 -1 1\r\nx\r\n").request.exptime, -1);
+    EXPECT_EQ(Parse("set k 0 0 5\r\nhel").status, memcached_parse_status::incomplete);
+
+    const auto bad_chunk = Parse("set k 0 0 1\r\nxy\r\n");
+
+    EXPECT_EQ(bad_chunk.status, memcached_parse_status::error);
+    EXPECT_EQ(bad_chunk.consumed, 16);
+    EXPECT_EQ(bad_chunk.error, "CLIENT_ERROR bad data chunk\r\n");
+
+    EXPECT_EQ(Parse("set k 0 0 x\r\n").status, memcached_parse_status::fatal);
+    EXPECT_EQ(Parse("set k 0 0 2048\r\n").status, memcached_parse_status::fatal);
+}
+
+TEST(MemcachedProtocol, OtherCommands)
+{
+    const auto remove = Parse("delete k noreply\r\n");
+
+    EXPECT_EQ(remove.request.command, memcached_command::remove);
+    EXPECT_TRUE(remove.request.noreply);
+    EXPECT_EQ(Parse("delete k 0\r\n").status, memcached_parse_status::error);
+    EXPECT_EQ(Parse("flush_all\r\n").request.command, memcached_command::flush_all);
+    EXPECT_EQ(Parse("stats\r\n").request.command, memcached_command::stats);
+    EXPECT_EQ(Parse("version\r\n").request.command, memcached_command::version);
+    EXPECT_EQ(Parse("quit\r\n").request.command, memcached_command::quit);
+
+    const auto unknown = Parse("incr k 1\r\n");
+
+    EXPECT_EQ(unknown.status, memcached_parse_status::error);
+    EXPECT_EQ(unknown.error, "ERROR\r\n");
+    EXPECT_EQ(unknown.consumed, 10);
+
+    EXPECT_EQ(Parse(std::string(5000, 'x')).status, memcached_parse_status::fatal);
+}
@@ -0,0 +1,111 @@
+#include "caches/cache.hpp"
+#include "caches/fifo_cache_policy.hpp"
+#include "caches/lfu_cache_policy.hpp"
+#include "caches/lru_cache_policy.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <unordered_map>
+
+namespace
+{
+template <template <typename> class Policy>
+caches::memory_usage UsageWithElements(int elements)
+{
+    caches::fixed_sized_cache<int, int, Policy> cache{1000};
+
+    for (int i = 0; i < elements; ++i)
+    {
+        cache.Put(i, i);
+    }
+
+    return cache.MemoryUsage();
+}
+} // namespace
+
+TEST(MemoryUsage, GrowsWithElements)
+{
+    const auto small = UsageWithElements<caches::LRUCachePolicy>(10);
+    const auto large = UsageWithElements<caches::LRUCachePolicy>(1000);
+
+    EXPECT_GT(small.index, 0);
+    EXPECT_GT(small.policy, 0);
+    EXPECT_GE(small.values, 10 * sizeof(int));
+    EXPECT_GT(large.index, small.index);
+    EXPECT_GT(large.policy, small.policy);
+    EXPECT_EQ(large.values, small.values / 10 * 1000);
+    EXPECT_EQ(large.Total(), large.index + large.policy + large.values);
+}
+
+TEST(MemoryUsage, ComparesPolicies)
+{
+    const auto lru = UsageWithElements<caches::LRUCachePolicy>(1000);
+    const auto fifo = UsageWithElements<caches::FIFOCachePolicy>(1000);
+    const auto lfu = UsageWithElements<caches::LFUCachePolicy>(1000);
+    const auto none = UsageWithElements<caches::NoCachePolicy>(1000);
+
+    // a queue and a key index take more than a single key set
+    EXPECT_GT(lru.policy, none.policy);
+    EXPECT_GT(fifo.policy, none.policy);
+    EXPECT_GT(lfu.policy, none.policy);
+    EXPECT_EQ(lru.index, none.index);
+    EXPECT_EQ(lru.values, none.values);
+}
+
+TEST(MemoryUsage, ReleasedWithElements)
+{
+    caches::fixed_sized_cache<int, int, caches::LRUCachePolicy> cache{100};
+    const auto empty = cache.MemoryUsage();
+
+    for (int i = 0; i < 100; ++i)
+    {
+        cache.Put(i, i);
+    }
+
+    cache.InvalidateAll();
+
+    // invalidated elements take memory until they are reclaimed
+    EXPECT_GT(cache.MemoryUsage().values, 0);
+    EXPECT_GT(cache.MemoryUsage().policy, empty.policy);
+
+    cache.ReclaimInvalidated();
+
+    const auto reclaimed = cache.MemoryUsage();
+
+    EXPECT_EQ(reclaimed.values, 0);
+    // the buckets of the detached map are freed with it
+    EXPECT_EQ(reclaimed.index, empty.index);
+    EXPECT_LE(reclaimed.policy, UsageWithElements<caches::LRUCachePolicy>(100).policy);
+}
+
+TEST(MemoryUsage, ValueSizer)
+{
+    caches::fixed_sized_cache<int, std::string, caches::FIFOCachePolicy> cache{100};
+
+    for (int i = 0; i < 100; ++i)
+    {
+        cache.Put(i, std::string(1000, 'x'));
+    }
+
+    const auto shallow = cache.MemoryUsage();
+    const auto deep =
+        cache.MemoryUsage([](const std::string &value) { return value.capacity(); }, 7);
+
+    EXPECT_GE(deep.values, shallow.values + 100 * 1000);
+    EXPECT_EQ(deep.index, shallow.index);
+    EXPECT_THROW(cache.MemoryUsage([](const std::string &) { return 0; }, 0),
+                 std::invalid_argument);
+}
+
+TEST(MemoryUsage, UncountedHashMap)
+{
+    caches::fixed_sized_cache<int, int, caches::LRUCachePolicy,
+                              std::unordered_map<int, caches::WrappedValue<int>>>
+        cache{10};
+
+    cache.Put(1, 1);
+
+    EXPECT_EQ(cache.MemoryUsage().index, 0);
+    EXPECT_GT(cache.MemoryUsage().policy, 0);
+}
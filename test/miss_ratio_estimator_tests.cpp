@@ -0,0 +1,134 @@
+#include "caches/cache.hpp"
+#include "caches/lru_cache_policy.hpp"
+#include "caches/miss_ratio_estimator.hpp"
+
+#include <gtest/gtest.h>
+
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+template <typename Key, typename Value>
+using lru_cache_t = typename caches::fixed_sized_cache<Key, Value, caches::LRUCachePolicy>;
+
+TEST(ShardsEstimator, ExactWithFullSampling)
+{
+    constexpr int WORKING_SET = 100;
+    caches::shards_estimator<int> estimator{1.0, 1024, 10, 100};
+
+    for (int round = 0; round < 10; ++round)
+    {
+        for (int key = 0; key < WORKING_SET; ++key)
+        {
+            estimator.OnAccess(key);
+        }
+    }
+
+    // cyclic access: every reuse has distance WORKING_SET - 1
+    EXPECT_DOUBLE_EQ(estimator.HitRatio(WORKING_SET / 2), 0.0);
+    EXPECT_DOUBLE_EQ(estimator.HitRatio(WORKING_SET), 0.9);
+    EXPECT_DOUBLE_EQ(estimator.HitRatio(WORKING_SET * 4), 0.9);
+    EXPECT_EQ(estimator.SampledAccesses(), WORKING_SET * 10);
+}
+
+TEST(ShardsEstimator, SampledEstimateIsClose)
+{
+    constexpr int WORKING_SET = 20000;
+    caches::shards_estimator<int> estimator{0.1, 4096, 100, 1000};
+
+    for (int round = 0; round < 5; ++round)
+    {
+        for (int key = 0; key < WORKING_SET; ++key)
+        {
+            estimator.OnAccess(key);
+        }
+    }
+
+    EXPECT_LT(estimator.HitRatio(WORKING_SET / 2), 0.1);
+    EXPECT_NEAR(estimator.HitRatio(WORKING_SET * 2), 0.8, 0.05);
+    EXPECT_NEAR(estimator.SamplingRate(), 0.1, 0.01);
+}
+
+TEST(ShardsEstimator, BoundedNumberOfSamples)
+{
+    constexpr int WORKING_SET = 50000;
+    caches::shards_estimator<int> estimator{1.0, 512, 256, 1000};
+
+    for (int round = 0; round < 3; ++round)
+    {
+        for (int key = 0; key < WORKING_SET; ++key)
+        {
+            estimator.OnAccess(key);
+        }
+    }
+
+    // the threshold adapts to keep ~512 out of 50000 keys
+    EXPECT_LT(estimator.SamplingRate(), 0.02);
+    EXPECT_NEAR(estimator.HitRatio(WORKING_SET * 2), 2.0 / 3.0, 0.05);
+    EXPECT_LT(estimator.HitRatio(WORKING_SET / 2), 0.1);
+}
+
+TEST(ShardsEstimator, RejectsInvalidConfiguration)
+{
+    using estimator_t = caches::shards_estimator<int>;
+
+    for (double rate : {0.0, -1.0, 1.5, 1e30, std::numeric_limits<double>::quiet_NaN()})
+    {
+        EXPECT_THROW(estimator_t{rate}, std::invalid_argument);
+    }
+
+    EXPECT_THROW((estimator_t{0.5, 0}), std::invalid_argument);
+    EXPECT_THROW((estimator_t{0.5, 16, 0}), std::invalid_argument);
+}
+
+TEST(ShardsEstimator, CurveIsMonotonic)
+{
+    caches::shards_estimator<int> estimator{1.0, 4096, 8, 512};
+
+    for (int i = 0; i < 100000; ++i)
+    {
+        // skewed access pattern: small keys are reused more often
+        estimator.OnAccess((i * 7919) % (1 + i % 1000));
+    }
+
+    const auto curve = estimator.HitRatioCurve(1000, 20);
+
+    ASSERT_EQ(curve.size(), 20);
+    EXPECT_EQ(curve.back().first, 1000);
+
+    for (std::size_t i = 1; i < curve.size(); ++i)
+    {
+        EXPECT_LE(curve[i - 1].second, curve[i].second);
+    }
+}
+
+TEST(ShardsEstimator, AttachedToCache)
+{
+    auto estimator = std::make_shared<caches::shards_estimator<std::string>>(1.0, 64, 1, 64);
+    lru_cache_t<std::string, int> cache{4};
+
+    cache.SetAccessObserver(estimator);
+
+    for (int round = 0; round < 4; ++round)
+    {
+        for (int i = 0; i < 8; ++i)
+        {
+            const auto key = std::to_string(i);
+
+            if (!cache.TryGet(key).second)
+            {
+                cache.Put(key, i);
+            }
+        }
+    }
+
+    // the cache is too small for the working set, the estimator tells the right size
+    EXPECT_EQ(estimator->SampledAccesses(), 32);
+    EXPECT_DOUBLE_EQ(estimator->HitRatio(4), 0.0);
+    EXPECT_DOUBLE_EQ(estimator->HitRatio(8), 0.75);
+
+    cache.SetAccessObserver(nullptr);
+    cache.TryGet("0");
+    EXPECT_EQ(estimator->SampledAccesses(), 32);
+}
@@ -0,0 +1,135 @@
+#include "caches/lru_cache_policy.hpp"
+#include "caches/negative_cache.hpp"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+
+namespace
+{
+struct manual_clock
+{
+    using duration = std::chrono::milliseconds;
+    using rep = duration::rep;
+    using period = duration::period;
+    using time_point = std::chrono::time_point<manual_clock>;
+
+    static constexpr bool is_steady = true;
+
+    static time_point now() noexcept
+    {
+        return time_point{elapsed};
+    }
+
+    static duration elapsed;
+};
+
+manual_clock::duration manual_clock::elapsed{0};
+
+template <typename Key, typename Value>
+using negative_lru_cache_t =
+    caches::negative_cache<Key, Value, caches::LRUCachePolicy, manual_clock>;
+} // namespace
+
+TEST(NegativeCache, ThreeWayLookup)
+{
+    negative_lru_cache_t<std::string, int> cache{4, 1024, std::chrono::seconds{10}};
+
+    cache.Put("present", 1);
+    cache.PutAbsent("absent");
+
+    const auto hit = cache.TryGet("present");
+
+    EXPECT_EQ(hit.second, caches::lookup_status::hit);
+    EXPECT_EQ(*hit.first, 1);
+    EXPECT_EQ(cache.TryGet("absent").second, caches::lookup_status::known_miss);
+    EXPECT_EQ(cache.TryGet("absent").first, nullptr);
+    EXPECT_EQ(cache.TryGet("other").second, caches::lookup_status::unknown);
+    // absent keys don't take entries of the cache
+    EXPECT_EQ(cache.Size(), 1);
+}
+
+TEST(NegativeCache, PutOverridesAbsence)
+{
+    negative_lru_cache_t<int, int> cache{4, 1024, std::chrono::seconds{10}};
+
+    cache.PutAbsent(1);
+    cache.Put(1, 10);
+
+    EXPECT_EQ(cache.TryGet(1).second, caches::lookup_status::hit);
+
+    cache.PutAbsent(1);
+
+    EXPECT_FALSE(cache.Cached(1));
+    EXPECT_EQ(cache.TryGet(1).second, caches::lookup_status::known_miss);
+
+    // an evicted element is unknown again
+    cache.Put(1, 10);
+    for (int i = 2; i < 6; ++i)
+    {
+        cache.Put(i, i);
+    }
+
+    EXPECT_EQ(cache.TryGet(1).second, caches::lookup_status::unknown);
+
+    cache.PutAbsent(7);
+    cache.ClearAbsent();
+    EXPECT_EQ(cache.TryGet(7).second, caches::lookup_status::unknown);
+}
+
+TEST(NegativeCache, AbsenceExpires)
+{
+    manual_clock::elapsed = manual_clock::duration{0};
+    negative_lru_cache_t<int, int> cache{4, 1024, std::chrono::milliseconds{1000}};
+
+    cache.PutAbsent(1);
+    manual_clock::elapsed = std::chrono::milliseconds{400};
+    cache.PutAbsent(2);
+
+    // the first record is in the previous period now
+    manual_clock::elapsed = std::chrono::milliseconds{600};
+    EXPECT_EQ(cache.TryGet(1).second, caches::lookup_status::known_miss);
+    EXPECT_EQ(cache.TryGet(2).second, caches::lookup_status::known_miss);
+
+    manual_clock::elapsed = std::chrono::milliseconds{1000};
+    EXPECT_EQ(cache.TryGet(1).second, caches::lookup_status::unknown);
+    EXPECT_EQ(cache.TryGet(2).second, caches::lookup_status::unknown);
+
+    cache.PutAbsent(3);
+    manual_clock::elapsed = std::chrono::milliseconds{5000};
+    EXPECT_EQ(cache.TryGet(3).second, caches::lookup_status::unknown);
+}
+
+TEST(NegativeFilter, CompactAndLossy)
+{
+    caches::negative_filter<manual_clock> filter{1000, std::chrono::seconds{10}};
+
+    EXPECT_EQ(filter.TableBytes(), 2 * 2048 * sizeof(std::uint32_t));
+
+    for (std::size_t i = 0; i < 1000; ++i)
+    {
+        filter.Insert(i);
+    }
+
+    std::size_t found = 0;
+
+    for (std::size_t i = 0; i < 1000; ++i)
+    {
+        found += filter.Contains(i) ? 1 : 0;
+    }
+
+    // both candidate buckets may be full, so a few records can be lost
+    EXPECT_GT(found, 990);
+
+    std::size_t false_positives = 0;
+
+    for (std::size_t i = 1000; i < 100000; ++i)
+    {
+        false_positives += filter.Contains(i) ? 1 : 0;
+    }
+
+    EXPECT_EQ(false_positives, 0);
+    EXPECT_THROW((caches::negative_filter<manual_clock>{0, std::chrono::seconds{1}}),
+                 std::invalid_argument);
+}
@@ -0,0 +1,251 @@
+#include "caches/shared_memory_cache.hpp"
+
+#include <gtest/gtest.h>
+
+#include <csignal>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+std::string SegmentName(const std::string &name)
+{
+    return "/caches-" + name + "-" + std::to_string(::getpid());
+}
+
+// removes the segment when the test is over
+class scoped_segment
+{
+  public:
+    explicit scoped_segment(const std::string &name) : name{SegmentName(name)}
+    {
+        caches::shared_memory_cache<int, int>::Unlink(this->name);
+    }
+
+    ~scoped_segment()
+    {
+        caches::shared_memory_cache<int, int>::Unlink(name);
+    }
+
+    const std::string name;
+};
+
+bool die_on_read = false;
+
+// kills the process in the middle of a lookup if asked to
+struct fragile_serializer
+{
+    static void Serialize(const int &value, std::string &out)
+    {
+        caches::value_serializer<int>::Serialize(value, out);
+    }
+
+    static bool Deserialize(const char *data, std::size_t size, int &value)
+    {
+        if (die_on_read)
+        {
+            std::raise(SIGKILL);
+        }
+
+        return caches::value_serializer<int>::Deserialize(data, size, value);
+    }
+};
+
+template <typename F>
+int RunChild(F &&child)
+{
+    const auto pid = ::fork();
+
+    if (pid == 0)
+    {
+        // don't let gtest see anything that happens in the child
+        ::_exit(child() ? 0 : 1);
+    }
+
+    int status = 0;
+
+    ::waitpid(pid, &status, 0);
+
+    return status;
+}
+
+using string_cache_t = caches::shared_memory_cache<std::string, std::string>;
+using int_cache_t = caches::shared_memory_cache<int, int>;
+} // namespace
+
+TEST(SharedMemoryCache, PutGetRemove)
+{
+    scoped_segment segment{"put-get"};
+    string_cache_t cache{segment.name, 4, 16, 16};
+
+    EXPECT_TRUE(cache.Put("one", "1"));
+    EXPECT_TRUE(cache.Put("two", "2"));
+    EXPECT_EQ(*cache.Get("one"), "1");
+    EXPECT_FALSE(cache.TryGet("three").second);
+    EXPECT_THROW(cache.Get("three"), std::range_error);
+
+    EXPECT_TRUE(cache.Put("one", "uno"));
+    EXPECT_EQ(*cache.Get("one"), "uno");
+    EXPECT_EQ(cache.Size(), 2);
+    EXPECT_EQ(cache.MaxSize(), 4);
+
+    EXPECT_TRUE(cache.Remove("one"));
+    EXPECT_FALSE(cache.Remove("one"));
+    EXPECT_FALSE(cache.Cached("one"));
+    EXPECT_EQ(cache.Size(), 1);
+
+    EXPECT_FALSE(cache.Put("key", std::string(17, 'x')));
+    EXPECT_FALSE(cache.Put(std::string(17, 'k'), "value"));
+
+    cache.Clear();
+    EXPECT_EQ(cache.Size(), 0);
+    EXPECT_FALSE(cache.Cached("two"));
+}
+
+TEST(SharedMemoryCache, EvictionPolicies)
+{
+    scoped_segment lru_segment{"lru"};
+    scoped_segment fifo_segment{"fifo"};
+    int_cache_t lru{lru_segment.name, 3, sizeof(int), sizeof(int)};
+    int_cache_t fifo{fifo_segment.name, 3, sizeof(int), sizeof(int),
+                     caches::shared_memory_policy::fifo};
+
+    for (auto *cache : {&lru, &fifo})
+    {
+        for (int i = 1; i <= 3; ++i)
+        {
+            cache->Put(i, i);
+        }
+
+        cache->Get(1);
+        cache->Put(4, 4);
+    }
+
+    EXPECT_TRUE(lru.Cached(1));
+    EXPECT_FALSE(lru.Cached(2));
+    EXPECT_FALSE(fifo.Cached(1));
+    EXPECT_TRUE(fifo.Cached(2));
+    EXPECT_EQ(lru.Size(), 3);
+    EXPECT_EQ(fifo.Size(), 3);
+}
+
+TEST(SharedMemoryCache, AttachChecksParameters)
+{
+    scoped_segment segment{"attach"};
+    int_cache_t cache{segment.name, 8, sizeof(int), sizeof(int)};
+    int_cache_t same{segment.name, 8, sizeof(int), sizeof(int)};
+
+    cache.Put(1, 10);
+    EXPECT_EQ(*same.Get(1), 10);
+
+    EXPECT_THROW((int_cache_t{segment.name, 16, sizeof(int), sizeof(int)}),
+                 std::invalid_argument);
+    EXPECT_THROW((int_cache_t{segment.name, 8, sizeof(int), sizeof(int),
+                              caches::shared_memory_policy::fifo}),
+                 std::invalid_argument);
+    EXPECT_THROW((int_cache_t{segment.name, 0, sizeof(int), sizeof(int)}),
+                 std::invalid_argument);
+}
+
+TEST(SharedMemoryCache, ReplacesSegmentLeftUnformatted)
+{
+    scoped_segment segment{"stale"};
+    // a creator that has died right after creating the segment
+    const int fd = ::shm_open(segment.name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(::ftruncate(fd, 4096), 0);
+    ::close(fd);
+
+    int_cache_t cache{segment.name, 8, sizeof(int), sizeof(int)};
+    int_cache_t same{segment.name, 8, sizeof(int), sizeof(int)};
+
+    cache.Put(1, 10);
+    EXPECT_EQ(*same.Get(1), 10);
+}
+
+TEST(SharedMemoryCache, WorkerProcessesShareElements)
+{
+    constexpr int workers = 4;
+    constexpr int keys_per_worker = 200;
+    scoped_segment segment{"workers"};
+    std::vector<pid_t> children;
+
+    for (int worker = 0; worker < workers; ++worker)
+    {
+        const auto pid = ::fork();
+
+        if (pid == 0)
+        {
+            // every worker attaches on its own and fills its own range of keys
+            int_cache_t cache{segment.name, workers * keys_per_worker, sizeof(int), sizeof(int)};
+            bool ok = true;
+
+            for (int i = 0; i < keys_per_worker; ++i)
+            {
+                const auto key = worker * keys_per_worker + i;
+
+                ok = ok && cache.Put(key, key * 2);
+                ok = ok && *cache.Get(key) == key * 2;
+            }
+
+            ::_exit(ok ? 0 : 1);
+        }
+
+        children.push_back(pid);
+    }
+
+    for (const auto pid : children)
+    {
+        int status = 0;
+
+        ::waitpid(pid, &status, 0);
+        EXPECT_TRUE(WIFEXITED(status));
+        EXPECT_EQ(WEXITSTATUS(status), 0);
+    }
+
+    int_cache_t cache{segment.name, workers * keys_per_worker, sizeof(int), sizeof(int)};
+
+    EXPECT_EQ(cache.Size(), workers * keys_per_worker);
+
+    for (int key = 0; key < workers * keys_per_worker; ++key)
+    {
+        ASSERT_TRUE(cache.Cached(key));
+        EXPECT_EQ(*cache.Get(key), key * 2);
+    }
+}
+
+TEST(SharedMemoryCache, RecoversFromDeadLockHolder)
+{
+    using fragile_cache_t = caches::shared_memory_cache<int, int, caches::value_serializer<int>,
+                                                        fragile_serializer>;
+
+    scoped_segment segment{"robust"};
+    fragile_cache_t cache{segment.name, 4, sizeof(int), sizeof(int)};
+
+    cache.Put(1, 1);
+
+    const auto status = RunChild(
+        [&segment]
+        {
+            fragile_cache_t child_cache{segment.name, 4, sizeof(int), sizeof(int)};
+
+            die_on_read = true;
+            child_cache.Get(1);
+
+            return true;
+        });
+
+    ASSERT_TRUE(WIFSIGNALED(status));
+
+    // the child died holding the lock, so the cache is cleared and usable again
+    EXPECT_FALSE(cache.Cached(1));
+    EXPECT_TRUE(cache.Put(2, 2));
+    EXPECT_EQ(*cache.Get(2), 2);
+}
@@ -0,0 +1,253 @@
+#include "caches/cache.hpp"
+#include "caches/lru_cache_policy.hpp"
+#include "caches/slab_storage.hpp"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+constexpr std::size_t PAGE_SIZE = 4096;
+
+template <typename Key>
+using slab_lru_storage_t =
+    caches::slab_value_storage<Key, caches::slab_string, caches::LRUCachePolicy>;
+
+template <typename Key>
+using slab_lru_cache_t =
+    caches::fixed_sized_cache<Key, caches::slab_string, caches::LRUCachePolicy,
+                              std::unordered_map<Key, caches::WrappedValue<caches::slab_string>>,
+                              slab_lru_storage_t<Key>>;
+} // namespace
+
+TEST(SlabArena, SizeClasses)
+{
+    caches::slab_arena arena{PAGE_SIZE * 4, PAGE_SIZE, 2.0, 64};
+
+    EXPECT_EQ(arena.ClassCount(), 7);
+    EXPECT_EQ(arena.ClassOf(1), 0);
+    EXPECT_EQ(arena.ClassOf(64), 0);
+    EXPECT_EQ(arena.ClassOf(65), 1);
+    EXPECT_EQ(arena.ClassOf(PAGE_SIZE), arena.ClassCount() - 1);
+    EXPECT_EQ(arena.ClassOf(PAGE_SIZE + 1), arena.ClassCount());
+    EXPECT_EQ(arena.Stats(1).chunk_size, 128);
+}
+
+TEST(SlabArena, ReusesFreedChunks)
+{
+    caches::slab_arena arena{PAGE_SIZE, PAGE_SIZE, 2.0, 64};
+
+    void *first = arena.Allocate(100);
+    EXPECT_EQ(arena.MemoryUsed(), PAGE_SIZE);
+    EXPECT_EQ(arena.Stats(arena.ClassOf(100)).used_chunks, 1);
+
+    arena.Deallocate(first, 100);
+    void *second = arena.Allocate(120);
+
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(arena.MemoryUsed(), PAGE_SIZE);
+    arena.Deallocate(second, 120);
+    EXPECT_EQ(arena.Stats(arena.ClassOf(100)).used_chunks, 0);
+}
+
+TEST(SlabArena, RespectsMemoryLimit)
+{
+    caches::slab_arena arena{PAGE_SIZE, PAGE_SIZE, 2.0, 64};
+    void *small = arena.Allocate(64);
+
+    EXPECT_TRUE(arena.HasRoom(arena.ClassOf(64)));
+    EXPECT_FALSE(arena.HasRoom(arena.ClassOf(1024)));
+
+    void *large = arena.Allocate(PAGE_SIZE * 2);
+    EXPECT_EQ(arena.MemoryUsed(), PAGE_SIZE);
+    arena.Deallocate(large, PAGE_SIZE * 2);
+    arena.Deallocate(small, 64);
+    EXPECT_EQ(arena.OvercommittedPages(), 0);
+}
+
+TEST(SlabStorage, StoresValuesInArena)
+{
+    auto arena = std::make_shared<caches::slab_arena>(PAGE_SIZE * 4, PAGE_SIZE, 2.0, 64);
+    caches::slab_allocator<char> source_alloc{
+        std::make_shared<caches::slab_arena>(PAGE_SIZE * 4, PAGE_SIZE)};
+    slab_lru_cache_t<int> cache{16, caches::LRUCachePolicy<int>{},
+                                [](const int &, const caches::WrappedValue<caches::slab_string> &) {},
+                                slab_lru_storage_t<int>{arena}};
+
+    cache.Put(1, caches::slab_string(500, 'a', source_alloc));
+    cache.Put(2, caches::slab_string(100, 'b', source_alloc));
+
+    EXPECT_EQ(*cache.Get(1), caches::slab_string(500, 'a', source_alloc));
+    EXPECT_EQ(cache.Get(2)->size(), 100);
+    EXPECT_EQ(cache.Get(1)->get_allocator().Arena(), arena);
+    EXPECT_EQ(arena->Stats(arena->ClassOf(501)).used_chunks, 1);
+    EXPECT_EQ(arena->Stats(arena->ClassOf(101)).used_chunks, 1);
+
+    cache.Put(1, caches::slab_string(100, 'c', source_alloc));
+    EXPECT_EQ(arena->Stats(arena->ClassOf(501)).used_chunks, 0);
+    EXPECT_EQ(arena->Stats(arena->ClassOf(101)).used_chunks, 2);
+
+    cache.Remove(2);
+    EXPECT_EQ(arena->Stats(arena->ClassOf(101)).used_chunks, 1);
+}
+
+TEST(SlabStorage, EvictsWithinSizeClass)
+{
+    auto arena = std::make_shared<caches::slab_arena>(PAGE_SIZE * 2, PAGE_SIZE, 2.0, 64);
+    caches::slab_allocator<char> source_alloc{
+        std::make_shared<caches::slab_arena>(PAGE_SIZE * 4, PAGE_SIZE)};
+    slab_lru_cache_t<std::string> cache{100, caches::LRUCachePolicy<std::string>{},
+                                        [](const std::string &,
+                                           const caches::WrappedValue<caches::slab_string> &) {},
+                                        slab_lru_storage_t<std::string>{arena}};
+
+    // the first page goes to the small class, the second one is split into 4 large chunks
+    cache.Put("small", caches::slab_string(100, 's', source_alloc));
+
+    for (int i = 0; i < 4; ++i)
+    {
+        cache.Put("big" + std::to_string(i), caches::slab_string(1000, 'b', source_alloc));
+    }
+
+    EXPECT_EQ(arena->MemoryUsed(), PAGE_SIZE * 2);
+    EXPECT_NE(cache.Get("big0"), nullptr);
+
+    // no room left in the large class: its LRU entry is evicted, the small one stays intact
+    cache.Put("big4", caches::slab_string(1000, 'b', source_alloc));
+
+    EXPECT_FALSE(cache.Cached("big1"));
+    EXPECT_TRUE(cache.Cached("big0"));
+    EXPECT_TRUE(cache.Cached("big4"));
+    EXPECT_TRUE(cache.Cached("small"));
+    EXPECT_EQ(cache.Size(), 5);
+    EXPECT_EQ(arena->MemoryUsed(), PAGE_SIZE * 2);
+    EXPECT_EQ(arena->OvercommittedPages(), 0);
+
+    // small values keep using their own class
+    for (int i = 0; i < 8; ++i)
+    {
+        cache.Put("small" + std::to_string(i), caches::slab_string(100, 's', source_alloc));
+    }
+
+    EXPECT_EQ(cache.Size(), 13);
+    EXPECT_EQ(arena->MemoryUsed(), PAGE_SIZE * 2);
+}
+
+TEST(SlabStorage, OvercommitsWhenChunksArePinned)
+{
+    auto arena = std::make_shared<caches::slab_arena>(PAGE_SIZE, PAGE_SIZE, 2.0, 64);
+    caches::slab_allocator<char> source_alloc{
+        std::make_shared<caches::slab_arena>(PAGE_SIZE * 4, PAGE_SIZE)};
+    slab_lru_cache_t<int> cache{100, caches::LRUCachePolicy<int>{},
+                                [](const int &, const caches::WrappedValue<caches::slab_string> &) {},
+                                slab_lru_storage_t<int>{arena}};
+
+    cache.Put(0, caches::slab_string(3000, 'x', source_alloc));
+    auto pinned = cache.Get(0);
+
+    cache.Put(1, caches::slab_string(3000, 'y', source_alloc));
+
+    EXPECT_FALSE(cache.Cached(0));
+    EXPECT_EQ(*pinned, caches::slab_string(3000, 'x', source_alloc));
+    EXPECT_EQ(arena->OvercommittedPages(), 1);
+}
+
+TEST(SlabStorage, EvictsOnceWhenNotificationsArePending)
+{
+    auto arena = std::make_shared<caches::slab_arena>(PAGE_SIZE, PAGE_SIZE, 2.0, 64);
+    caches::slab_allocator<char> source_alloc{
+        std::make_shared<caches::slab_arena>(PAGE_SIZE * 4, PAGE_SIZE)};
+    std::vector<int> evicted;
+    slab_lru_cache_t<int> cache{
+        100, caches::LRUCachePolicy<int>{},
+        [&evicted](const int &key, const caches::WrappedValue<caches::slab_string> &value)
+        {
+            // the evicted value is still intact while the listener runs
+            EXPECT_EQ(value->size(), 900);
+            evicted.push_back(key);
+        },
+        slab_lru_storage_t<int>{arena}};
+
+    // a single page split into 4 chunks of the class
+    for (int i = 0; i < 4; ++i)
+    {
+        cache.Put(i, caches::slab_string(900, 'v', source_alloc));
+    }
+
+    cache.Put(4, caches::slab_string(900, 'v', source_alloc));
+
+    EXPECT_EQ(evicted, std::vector<int>{0});
+    EXPECT_EQ(cache.Size(), 4);
+    EXPECT_TRUE(cache.Cached(4));
+    EXPECT_EQ(arena->OvercommittedPages(), 0);
+    EXPECT_EQ(arena->Stats(arena->ClassOf(901)).used_chunks, 4);
+}
+
+TEST(SlabStorage, ShortStringsTakeNoChunks)
+{
+    auto arena = std::make_shared<caches::slab_arena>(PAGE_SIZE, PAGE_SIZE, 2.0, 64);
+    caches::slab_allocator<char> source_alloc{
+        std::make_shared<caches::slab_arena>(PAGE_SIZE * 4, PAGE_SIZE)};
+    const caches::slab_string short_value{"abc", source_alloc};
+    slab_lru_cache_t<int> cache{100, caches::LRUCachePolicy<int>{},
+                                [](const int &, const caches::WrappedValue<caches::slab_string> &) {},
+                                slab_lru_storage_t<int>{arena}};
+
+    EXPECT_EQ(caches::slab_payload_size<caches::slab_string>{}(short_value), 0);
+    EXPECT_EQ(caches::slab_payload_size<caches::slab_string>{}(
+                  caches::slab_string(900, 'v', source_alloc)),
+              901);
+
+    // the arena is full, inline values don't compete for its chunks
+    for (int i = 0; i < 4; ++i)
+    {
+        cache.Put(i, caches::slab_string(900, 'v', source_alloc));
+    }
+
+    for (int i = 4; i < 50; ++i)
+    {
+        cache.Put(i, short_value);
+    }
+
+    EXPECT_EQ(cache.Size(), 50);
+    EXPECT_EQ(*cache.Get(49), short_value);
+    EXPECT_EQ(arena->MemoryUsed(), PAGE_SIZE);
+    EXPECT_EQ(arena->OvercommittedPages(), 0);
+}
+
+TEST(SlabStorage, EvictsPastValuesHeldByUsers)
+{
+    auto arena = std::make_shared<caches::slab_arena>(PAGE_SIZE, PAGE_SIZE, 2.0, 64);
+    caches::slab_allocator<char> source_alloc{
+        std::make_shared<caches::slab_arena>(PAGE_SIZE * 4, PAGE_SIZE)};
+    std::vector<int> evicted;
+    slab_lru_cache_t<int> cache{
+        100, caches::LRUCachePolicy<int>{},
+        [&evicted](const int &key, const caches::WrappedValue<caches::slab_string> &)
+        { evicted.push_back(key); },
+        slab_lru_storage_t<int>{arena}};
+
+    for (int i = 0; i < 4; ++i)
+    {
+        cache.Put(i, caches::slab_string(900, 'v', source_alloc));
+    }
+
+    // the chunk of the first victim stays in use after its notification is delivered
+    const auto held = cache.Get(0);
+
+    for (int i = 1; i < 4; ++i)
+    {
+        cache.Get(i);
+    }
+
+    cache.Put(4, caches::slab_string(900, 'v', source_alloc));
+
+    EXPECT_EQ(evicted, (std::vector<int>{0, 1}));
+    EXPECT_EQ(cache.Size(), 3);
+    EXPECT_TRUE(cache.Cached(4));
+    EXPECT_EQ(arena->OvercommittedPages(), 0);
+    EXPECT_EQ(held->size(), 900);
+}
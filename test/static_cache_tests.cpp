@@ -0,0 +1,214 @@
+#include "caches/static_cache.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+namespace
+{
+std::atomic<std::size_t> allocations{0};
+
+struct scattering_hash
+{
+    constexpr std::size_t operator()(int key) const noexcept
+    {
+        return static_cast<std::size_t>(key) * 2654435761U;
+    }
+};
+
+// all keys collide, so every operation goes through the probe sequences
+struct constant_hash
+{
+    constexpr std::size_t operator()(int) const noexcept
+    {
+        return 3;
+    }
+};
+
+template <typename Key, typename Value, std::size_t Capacity>
+using lru_static_cache_t = caches::static_cache<Key, Value, Capacity, caches::static_lru_policy>;
+
+constexpr int SumOfCachedSquares()
+{
+    caches::static_cache<int, int, 4, caches::static_lru_policy, scattering_hash> cache;
+    int sum = 0;
+
+    for (int i = 0; i < 10; ++i)
+    {
+        cache.Put(i, i * i);
+    }
+
+    for (int i = 0; i < 10; ++i)
+    {
+        if (const auto *value = cache.TryGet(i))
+        {
+            sum += *value;
+        }
+    }
+
+    return sum;
+}
+} // namespace
+
+// the replacements pair malloc with free, GCC can't see that when it inlines them into new/delete
+// expressions
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpragmas"
+#pragma GCC diagnostic ignored "-Wunknown-warning-option"
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void *operator new(std::size_t size)
+{
+    ++allocations;
+
+    if (void *memory = std::malloc(size == 0 ? 1 : size))
+    {
+        return memory;
+    }
+
+    throw std::bad_alloc{};
+}
+
+void operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+#if defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+TEST(StaticCache, SimplePut)
+{
+    lru_static_cache_t<std::string, int, 2> cache;
+
+    cache.Put("A", 1);
+    cache.Put("B", 2);
+    cache.Put("A", 10);
+
+    EXPECT_EQ(cache.Get("A"), 10);
+    EXPECT_EQ(cache.Get("B"), 2);
+    EXPECT_EQ(cache.Size(), 2);
+    EXPECT_EQ(cache.MaxSize(), 2);
+    EXPECT_EQ(cache.TryGet("C"), nullptr);
+    EXPECT_THROW(cache.Get("C"), std::range_error);
+}
+
+TEST(StaticCache, LRUEviction)
+{
+    lru_static_cache_t<int, int, 3> cache;
+
+    cache.Put(1, 1);
+    cache.Put(2, 2);
+    cache.Put(3, 3);
+    cache.Get(1);
+    cache.Put(4, 4);
+
+    EXPECT_TRUE(cache.Cached(1));
+    EXPECT_FALSE(cache.Cached(2));
+    EXPECT_TRUE(cache.Cached(3));
+    EXPECT_TRUE(cache.Cached(4));
+}
+
+TEST(StaticCache, FIFOEviction)
+{
+    caches::static_cache<int, int, 3, caches::static_fifo_policy> cache;
+
+    cache.Put(1, 1);
+    cache.Put(2, 2);
+    cache.Put(3, 3);
+    cache.Get(1);
+    cache.Put(4, 4);
+
+    EXPECT_FALSE(cache.Cached(1));
+    EXPECT_TRUE(cache.Cached(2));
+}
+
+TEST(StaticCache, RemoveWithCollisions)
+{
+    caches::static_cache<int, int, 8, caches::static_lru_policy, constant_hash> cache;
+
+    for (int i = 0; i < 8; ++i)
+    {
+        cache.Put(i, i);
+    }
+
+    EXPECT_TRUE(cache.Remove(2));
+    EXPECT_TRUE(cache.Remove(5));
+    EXPECT_FALSE(cache.Remove(5));
+    EXPECT_EQ(cache.Size(), 6);
+
+    for (int i : {0, 1, 3, 4, 6, 7})
+    {
+        EXPECT_EQ(cache.Get(i), i);
+    }
+
+    // freed slots are reused
+    for (int i = 10; i < 20; ++i)
+    {
+        cache.Put(i, i);
+        EXPECT_EQ(cache.Get(i), i);
+    }
+
+    EXPECT_EQ(cache.Size(), 8);
+}
+
+TEST(StaticCache, RandomizedAgainstModel)
+{
+    lru_static_cache_t<int, int, 16> cache;
+    unsigned state = 1;
+
+    for (int i = 0; i < 100000; ++i)
+    {
+        state = state * 1103515245U + 12345U;
+        const int key = static_cast<int>((state >> 8) % 64);
+
+        if ((state >> 20) % 4 == 0)
+        {
+            cache.Remove(key);
+            EXPECT_FALSE(cache.Cached(key));
+        }
+        else
+        {
+            cache.Put(key, key * 3);
+            ASSERT_EQ(cache.Get(key), key * 3);
+        }
+
+        ASSERT_LE(cache.Size(), 16);
+    }
+}
+
+TEST(StaticCache, NoHeapAllocations)
+{
+    const auto before = allocations.load();
+    lru_static_cache_t<int, long, 64> cache;
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        cache.Put(i % 100, i);
+        cache.TryGet(i % 37);
+
+        if (i % 7 == 0)
+        {
+            cache.Remove(i % 50);
+        }
+    }
+
+    EXPECT_EQ(allocations.load(), before);
+}
+
+TEST(StaticCache, ConstantExpression)
+{
+    static_assert(SumOfCachedSquares() == 36 + 49 + 64 + 81, "computed at compile time");
+    EXPECT_EQ(SumOfCachedSquares(), 230);
+}
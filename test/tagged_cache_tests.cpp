@@ -0,0 +1,124 @@
+#include "caches/lru_cache_policy.hpp"
+#include "caches/tagged_cache.hpp"
+
+#include <gtest/gtest.h>
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+template <typename Key, typename Value>
+using lru_tagged_cache_t = caches::tagged_cache<Key, Value, std::string, caches::LRUCachePolicy>;
+
+using cause_listener_t = std::function<void(const std::string &, const caches::WrappedValue<int> &,
+                                            caches::erase_cause)>;
+
+using listened_cache_t =
+    caches::tagged_cache<std::string, int, std::string, caches::LRUCachePolicy, cause_listener_t>;
+} // namespace
+
+TEST(TaggedCache, InvalidatesElementsOfTag)
+{
+    std::vector<std::string> erased;
+    listened_cache_t cache{10, caches::LRUCachePolicy<std::string>{},
+                           [&erased](const std::string &key, const caches::WrappedValue<int> &,
+                                     caches::erase_cause cause)
+                           {
+                               if (cause == caches::erase_cause::invalidated)
+                               {
+                                   erased.push_back(key);
+                               }
+                           }};
+
+    cache.Put("a:1", 1, {"tenant-a"});
+    cache.Put("a:2", 2, {"tenant-a", "config"});
+    cache.Put("b:1", 3, {"tenant-b", "config"});
+    cache.Put("untagged", 4);
+
+    EXPECT_EQ(cache.TagSize("tenant-a"), 2);
+    EXPECT_EQ(cache.TagSize("config"), 2);
+    EXPECT_EQ(cache.InvalidateTag("tenant-a"), 2);
+    EXPECT_EQ(erased.size(), 2);
+
+    EXPECT_FALSE(cache.Cached("a:1"));
+    EXPECT_FALSE(cache.Cached("a:2"));
+    EXPECT_TRUE(cache.Cached("b:1"));
+    EXPECT_TRUE(cache.Cached("untagged"));
+    EXPECT_EQ(cache.TagSize("tenant-a"), 0);
+    // the removed element has left its other tags as well
+    EXPECT_EQ(cache.TagSize("config"), 1);
+    EXPECT_EQ(cache.InvalidateTag("tenant-a"), 0);
+    EXPECT_EQ(cache.InvalidateTag("unknown"), 0);
+}
+
+TEST(TaggedCache, EvictionKeepsIndexInSync)
+{
+    lru_tagged_cache_t<int, int> cache{2};
+
+    cache.Put(1, 1, {"odd"});
+    cache.Put(2, 2, {"even"});
+    cache.Put(3, 3, {"odd"});
+
+    EXPECT_FALSE(cache.Cached(1));
+    EXPECT_EQ(cache.TagSize("odd"), 1);
+    EXPECT_EQ(cache.InvalidateTag("odd"), 1);
+    EXPECT_EQ(cache.Size(), 1);
+    EXPECT_TRUE(cache.Cached(2));
+
+    cache.Remove(2);
+    EXPECT_EQ(cache.TagSize("even"), 0);
+}
+
+TEST(TaggedCache, PutReplacesTags)
+{
+    lru_tagged_cache_t<int, int> cache{4};
+
+    cache.Put(1, 1, {"old"});
+    cache.Put(1, 10, {"new"});
+
+    EXPECT_EQ(cache.TagSize("old"), 0);
+    EXPECT_EQ(cache.InvalidateTag("old"), 0);
+    EXPECT_EQ(*cache.Get(1), 10);
+
+    cache.Put(1, 100);
+    EXPECT_EQ(cache.TagSize("new"), 0);
+    EXPECT_TRUE(cache.Cached(1));
+}
+
+TEST(TaggedCache, InvalidateAllDetachesTaggedElements)
+{
+    lru_tagged_cache_t<int, int> cache{4};
+
+    cache.Put(1, 1, {"group"});
+    cache.Put(2, 2, {"group"});
+    cache.InvalidateAll();
+
+    // the element is reinserted before its invalidated version has been reclaimed
+    cache.Put(1, 10, {"group"});
+
+    EXPECT_EQ(cache.InvalidateTag("group"), 1);
+    EXPECT_FALSE(cache.Cached(1));
+    cache.ReclaimInvalidated();
+    EXPECT_EQ(cache.TagSize("group"), 0);
+}
+
+TEST(TaggedCache, LargeGroup)
+{
+    lru_tagged_cache_t<int, int> cache{10000};
+
+    for (int i = 0; i < 10000; ++i)
+    {
+        cache.Put(i, i, {"tenant-" + std::to_string(i % 10)});
+    }
+
+    EXPECT_EQ(cache.InvalidateTag("tenant-3"), 1000);
+    EXPECT_EQ(cache.Size(), 9000);
+
+    for (int i = 0; i < 10000; ++i)
+    {
+        EXPECT_EQ(cache.Cached(i), i % 10 != 3);
+    }
+}
@@ -0,0 +1,242 @@
+#include "caches/disk_log_store.hpp"
+#include "caches/lru_cache_policy.hpp"
+#include "caches/tiered_cache.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+namespace
+{
+std::string TempPath(const std::string &name)
+{
+    return testing::TempDir() + name + "." + std::to_string(::getpid());
+}
+
+template <typename Key, typename Value>
+using lru_tiered_cache_t = caches::tiered_cache<Key, Value, caches::LRUCachePolicy>;
+} // namespace
+
+TEST(DiskLogStore, PutGetRemove)
+{
+    caches::disk_log_store<int, std::string> store{TempPath("log_put_get"), 1024};
+
+    EXPECT_TRUE(store.Put(1, "one"));
+    EXPECT_TRUE(store.Put(2, "two"));
+    EXPECT_EQ(*store.Get(1), "one");
+    EXPECT_EQ(*store.Get(2), "two");
+    EXPECT_EQ(store.Get(3), nullptr);
+
+    EXPECT_TRUE(store.Put(1, "uno"));
+    EXPECT_EQ(*store.Get(1), "uno");
+    EXPECT_EQ(store.Size(), 2);
+
+    EXPECT_TRUE(store.Remove(1));
+    EXPECT_FALSE(store.Remove(1));
+    EXPECT_EQ(store.Get(1), nullptr);
+    EXPECT_FALSE(store.Put(4, std::string(2048, 'x')));
+}
+
+TEST(DiskLogStore, WrapsAroundDroppingOldest)
+{
+    constexpr std::size_t RECORD = 100;
+    caches::disk_log_store<int, std::string> store{TempPath("log_wrap"), RECORD * 10};
+
+    for (int i = 0; i < 25; ++i)
+    {
+        EXPECT_TRUE(store.Put(i, std::string(RECORD, static_cast<char>('a' + i))));
+    }
+
+    EXPECT_EQ(store.Size(), 10);
+
+    for (int i = 0; i < 15; ++i)
+    {
+        EXPECT_FALSE(store.Contains(i));
+    }
+
+    for (int i = 15; i < 25; ++i)
+    {
+        EXPECT_EQ(*store.Get(i), std::string(RECORD, static_cast<char>('a' + i)));
+    }
+}
+
+TEST(DiskLogStore, EmptyValuesAreDroppedByWrapAround)
+{
+    caches::disk_log_store<int, std::string> store{TempPath("log_empty"), 16};
+
+    for (int i = 0; i < 100; ++i)
+    {
+        EXPECT_TRUE(store.Put(i, std::string{}));
+    }
+
+    EXPECT_EQ(store.Size(), 16);
+    EXPECT_FALSE(store.Contains(83));
+    ASSERT_NE(store.Get(99), nullptr);
+    EXPECT_TRUE(store.Get(99)->empty());
+}
+
+TEST(DiskLogStore, TriviallyCopyableValues)
+{
+    struct point
+    {
+        double x;
+        double y;
+    };
+
+    caches::disk_log_store<std::string, point> store{TempPath("log_pod"), 4096};
+
+    store.Put("p", point{1.5, -2.0});
+
+    const auto value = store.Get("p");
+    ASSERT_NE(value, nullptr);
+    EXPECT_EQ(value->x, 1.5);
+    EXPECT_EQ(value->y, -2.0);
+}
+
+TEST(TieredCache, DemotesAndPromotes)
+{
+    lru_tiered_cache_t<int, std::string> cache{2, TempPath("tiered_demote"), 1 << 20};
+
+    cache.Put(1, "one");
+    cache.Put(2, "two");
+    cache.Put(3, "three");
+    cache.Flush();
+
+    EXPECT_EQ(cache.L1Size(), 2);
+    EXPECT_EQ(cache.L2Size(), 1);
+    EXPECT_TRUE(cache.Cached(1));
+
+    // L2 hit promotes the element back and demotes the L1 LRU element
+    EXPECT_EQ(*cache.Get(1), "one");
+    cache.Flush();
+
+    EXPECT_EQ(cache.L1Size(), 2);
+    EXPECT_EQ(cache.L2Size(), 1);
+    EXPECT_EQ(*cache.Get(2), "two");
+    EXPECT_EQ(*cache.Get(3), "three");
+    EXPECT_THROW(cache.Get(4), std::range_error);
+}
+
+TEST(TieredCache, PutSupersedesDemotedValue)
+{
+    lru_tiered_cache_t<int, std::string> cache{1, TempPath("tiered_update"), 1 << 20};
+
+    cache.Put(1, "old");
+    cache.Put(2, "two");
+    cache.Flush();
+    cache.Put(1, "new");
+    cache.Flush();
+
+    EXPECT_EQ(*cache.Get(1), "new");
+    EXPECT_EQ(*cache.Get(2), "two");
+}
+
+TEST(TieredCache, RemoveFromBothTiers)
+{
+    lru_tiered_cache_t<int, std::string> cache{1, TempPath("tiered_remove"), 1 << 20};
+
+    cache.Put(1, "one");
+    cache.Put(2, "two");
+    cache.Flush();
+
+    EXPECT_TRUE(cache.Remove(1));
+    EXPECT_TRUE(cache.Remove(2));
+    EXPECT_FALSE(cache.Remove(1));
+    EXPECT_FALSE(cache.TryGet(1).second);
+    EXPECT_FALSE(cache.TryGet(2).second);
+}
+
+TEST(TieredCache, ConcurrentAccess)
+{
+    constexpr int KEYS = 200;
+    lru_tiered_cache_t<int, int> cache{32, TempPath("tiered_concurrent"), 1 << 20};
+    std::atomic<int> mismatches{0};
+    std::vector<std::thread> workers;
+
+    for (int key = 0; key < KEYS; ++key)
+    {
+        cache.Put(key, key * 10);
+    }
+
+    for (int t = 0; t < 4; ++t)
+    {
+        workers.emplace_back(
+            [&cache, &mismatches, t]
+            {
+                for (int i = 0; i < 2000; ++i)
+                {
+                    const int key = (i * 7 + t) % KEYS;
+                    const auto result = cache.TryGet(key);
+
+                    if (result.second && *result.first != key * 10)
+                    {
+                        ++mismatches;
+                    }
+                }
+            });
+    }
+
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+
+    cache.Flush();
+    EXPECT_EQ(mismatches, 0);
+    EXPECT_LE(cache.L1Size(), 32);
+
+    for (int key = 0; key < KEYS; ++key)
+    {
+        EXPECT_EQ(*cache.Get(key), key * 10);
+    }
+}
+
+TEST(TieredCache, EvictedElementsStayVisible)
+{
+    constexpr int KEYS = 20000;
+    constexpr int L1_SIZE = 8;
+    lru_tiered_cache_t<int, int> cache{L1_SIZE, TempPath("tiered_visible"), 16 << 20};
+    std::atomic<int> last{-1};
+    std::atomic<int> misses{0};
+
+    for (int key = 0; key < L1_SIZE; ++key)
+    {
+        cache.Put(key, key);
+    }
+
+    last = L1_SIZE - 1;
+
+    // the reader looks up the element that the next put evicts from L1
+    std::thread reader{[&cache, &last, &misses]
+                       {
+                           for (int current = last; current < KEYS - 1; current = last)
+                           {
+                               const int key = current - L1_SIZE + 1;
+
+                               if (!cache.TryGet(key).second)
+                               {
+                                   ++misses;
+                               }
+                           }
+                       }};
+
+    for (int key = L1_SIZE; key < KEYS; ++key)
+    {
+        cache.Put(key, key);
+        last = key;
+    }
+
+    reader.join();
+    cache.Flush();
+    EXPECT_EQ(misses, 0);
+
+    for (int key = 0; key < KEYS; key += 97)
+    {
+        EXPECT_EQ(*cache.Get(key), key);
+    }
+}
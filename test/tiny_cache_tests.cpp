@@ -0,0 +1,152 @@
+#include "caches/static_cache.hpp"
+#include "caches/tiny_cache.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <type_traits>
+
+namespace
+{
+template <typename Key, std::size_t N>
+void ExpectMatchersAgree(std::mt19937 &gen)
+{
+    alignas(32) Key keys[N];
+
+    for (int round = 0; round < 1000; ++round)
+    {
+        for (auto &key : keys)
+        {
+            // small range to get duplicates and a mix of hits and misses
+            key = static_cast<Key>(gen() % 16);
+        }
+
+        const auto needle = static_cast<Key>(gen() % 16);
+
+        ASSERT_EQ((caches::tiny_key_matcher<Key, N>::Vector(keys, needle)),
+                  (caches::tiny_key_matcher<Key, N>::Scalar(keys, needle)));
+    }
+}
+
+template <std::size_t Capacity>
+void ExpectSameAsStaticLRU()
+{
+    caches::tiny_cache<int, int, Capacity> tiny;
+    caches::static_cache<int, int, Capacity, caches::static_lru_policy> reference;
+    std::mt19937 gen{Capacity};
+
+    for (int i = 0; i < 20000; ++i)
+    {
+        const int key = static_cast<int>(gen() % (Capacity * 2));
+
+        switch (gen() % 4)
+        {
+        case 0:
+            EXPECT_EQ(tiny.Remove(key), reference.Remove(key));
+            break;
+        case 1:
+        {
+            const auto *tiny_value = tiny.TryGet(key);
+            const auto *reference_value = reference.TryGet(key);
+
+            ASSERT_EQ(tiny_value == nullptr, reference_value == nullptr);
+
+            if (tiny_value != nullptr)
+            {
+                EXPECT_EQ(*tiny_value, *reference_value);
+            }
+
+            break;
+        }
+        default:
+            tiny.Put(key, i);
+            reference.Put(key, i);
+        }
+
+        ASSERT_EQ(tiny.Size(), reference.Size());
+    }
+
+    for (int key = 0; key < static_cast<int>(Capacity * 2); ++key)
+    {
+        EXPECT_EQ(tiny.Cached(key), reference.Cached(key));
+    }
+}
+} // namespace
+
+TEST(TinyKeyMatcher, VectorMatchesScalar)
+{
+    std::mt19937 gen{7};
+
+    ExpectMatchersAgree<std::int32_t, 8>(gen);
+    ExpectMatchersAgree<std::uint32_t, 64>(gen);
+    ExpectMatchersAgree<std::int64_t, 16>(gen);
+    ExpectMatchersAgree<std::uint64_t, 64>(gen);
+    ExpectMatchersAgree<std::uint16_t, 24>(gen);
+}
+
+TEST(TinyCache, SimplePut)
+{
+    caches::tiny_cache<int, std::string, 4> cache;
+
+    cache.Put(1, "one");
+    cache.Put(2, "two");
+    cache.Put(1, "uno");
+
+    EXPECT_EQ(cache.Get(1), "uno");
+    EXPECT_EQ(cache.Get(2), "two");
+    EXPECT_EQ(cache.Size(), 2);
+    EXPECT_EQ(cache.TryGet(3), nullptr);
+    EXPECT_THROW(cache.Get(3), std::range_error);
+}
+
+TEST(TinyCache, LRUEviction)
+{
+    caches::tiny_cache<std::uint64_t, int, 3> cache;
+
+    cache.Put(1, 1);
+    cache.Put(2, 2);
+    cache.Put(3, 3);
+    cache.Get(1);
+    cache.Put(4, 4);
+
+    EXPECT_TRUE(cache.Cached(1));
+    EXPECT_FALSE(cache.Cached(2));
+    EXPECT_TRUE(cache.Cached(3));
+    EXPECT_TRUE(cache.Cached(4));
+    EXPECT_TRUE(cache.Remove(3));
+    EXPECT_FALSE(cache.Remove(3));
+    EXPECT_EQ(cache.Size(), 2);
+}
+
+TEST(TinyCache, ZeroKeyInEmptySlots)
+{
+    // unused slots hold zero keys, which must not be reported as hits
+    caches::tiny_cache<int, int, 16> cache;
+
+    EXPECT_FALSE(cache.Cached(0));
+    cache.Put(0, 42);
+    EXPECT_EQ(cache.Get(0), 42);
+}
+
+TEST(TinyCache, SameAsStaticLRU)
+{
+    ExpectSameAsStaticLRU<1>();
+    ExpectSameAsStaticLRU<13>();
+    ExpectSameAsStaticLRU<32>();
+    ExpectSameAsStaticLRU<64>();
+}
+
+TEST(TinyCache, SmallCacheSelection)
+{
+    static_assert(std::is_same<caches::small_cache_t<int, int, 64>,
+                               caches::tiny_cache<int, int, 64>>::value,
+                  "tiny_cache for small integral caches");
+    static_assert(std::is_same<caches::small_cache_t<int, int, 65>,
+                               caches::static_cache<int, int, 65>>::value,
+                  "static_cache for bigger caches");
+    static_assert(std::is_same<caches::small_cache_t<std::string, int, 8>,
+                               caches::static_cache<std::string, int, 8>>::value,
+                  "static_cache for non integral keys");
+}